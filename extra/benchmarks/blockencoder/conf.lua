@@ -0,0 +1,13 @@
+function love.conf(t)
+	t.identity = "love-benchmark-blockencoder"
+
+	-- Only love.image and love.timer are needed.
+	t.window = false
+
+	t.modules.audio = false
+	t.modules.sound = false
+	t.modules.graphics = false
+	t.modules.window = false
+	t.modules.joystick = false
+	t.modules.physics = false
+end
@@ -0,0 +1,196 @@
+-- Reference decoders for the block formats love.image.newCompressedData can
+-- encode to. They're independent of the encoder, so they also catch blocks
+-- which the encoder thinks decode differently than they do on a GPU.
+
+local bit = require("bit")
+local band, bor, lshift, rshift = bit.band, bit.bor, bit.lshift, bit.rshift
+local byte = string.byte
+local min, max = math.min, math.max
+
+local decode = {}
+
+local function expand5(v)
+	return bor(lshift(v, 3), rshift(v, 2))
+end
+
+local function expand6(v)
+	return bor(lshift(v, 2), rshift(v, 4))
+end
+
+-- Decodes the color half of a DXT1 or DXT5 block at offset o of s into the
+-- r, g and b arrays, indexed by pixel (0-15, row-major.)
+local function decodeDXTColor(s, o, r, g, b, dxt1)
+	local c0 = byte(s, o) + byte(s, o + 1) * 256
+	local c1 = byte(s, o + 2) + byte(s, o + 3) * 256
+
+	local pr = {expand5(rshift(c0, 11)), expand5(rshift(c1, 11))}
+	local pg = {expand6(band(rshift(c0, 5), 63)), expand6(band(rshift(c1, 5), 63))}
+	local pb = {expand5(band(c0, 31)), expand5(band(c1, 31))}
+
+	-- DXT1 blocks with c0 <= c1 use 3 colors plus transparent black.
+	local palette = {pr, pg, pb}
+	for i = 1, 3 do
+		local p = palette[i]
+		if not dxt1 or c0 > c1 then
+			p[3] = math.floor((2 * p[1] + p[2]) / 3)
+			p[4] = math.floor((p[1] + 2 * p[2]) / 3)
+		else
+			p[3] = math.floor((p[1] + p[2]) / 2)
+			p[4] = 0
+		end
+	end
+
+	for row = 0, 3 do
+		local indices = byte(s, o + 4 + row)
+		for col = 0, 3 do
+			local k = band(rshift(indices, col * 2), 3) + 1
+			local i = row * 4 + col
+			r[i], g[i], b[i] = pr[k], pg[k], pb[k]
+		end
+	end
+end
+
+-- Decodes the alpha half of a DXT5 block at offset o of s into a.
+local function decodeDXT5Alpha(s, o, a)
+	local a0, a1 = byte(s, o), byte(s, o + 1)
+	local p = {[0] = a0, a1}
+
+	if a0 > a1 then
+		for k = 1, 6 do
+			p[k + 1] = math.floor(((7 - k) * a0 + k * a1) / 7)
+		end
+	else
+		for k = 1, 4 do
+			p[k + 1] = math.floor(((5 - k) * a0 + k * a1) / 5)
+		end
+		p[6], p[7] = 0, 255
+	end
+
+	-- 16 3-bit indices, in two 24-bit halves.
+	for half = 0, 1 do
+		local q = o + 2 + half * 3
+		local indices = byte(s, q) + byte(s, q + 1) * 256 + byte(s, q + 2) * 65536
+		for j = 0, 7 do
+			a[half * 8 + j] = p[band(rshift(indices, j * 3), 7)]
+		end
+	end
+end
+
+local ETC1_MODIFIERS = {
+	[0] = {2, 8, -2, -8},
+	{5, 17, -5, -17},
+	{9, 29, -9, -29},
+	{13, 42, -13, -42},
+	{18, 60, -18, -60},
+	{24, 80, -24, -80},
+	{33, 106, -33, -106},
+	{47, 183, -47, -183},
+}
+
+-- Decodes an ETC1 block at offset o of s.
+local function decodeETC1(s, o, r, g, b)
+	local b0, b1, b2, b3, b4, b5, b6, b7 = byte(s, o, o + 7)
+	local differential = band(b3, 2) ~= 0
+	local flip = band(b3, 1) ~= 0
+	local tables = {ETC1_MODIFIERS[rshift(b3, 5)], ETC1_MODIFIERS[band(rshift(b3, 2), 7)]}
+
+	local bases = {{}, {}}
+	local c = {b0, b1, b2}
+	for i = 1, 3 do
+		if differential then
+			local v = rshift(c[i], 3)
+			local d = band(c[i], 7)
+			if d >= 4 then d = d - 8 end
+			bases[1][i] = expand5(v)
+			bases[2][i] = expand5(v + d)
+		else
+			bases[1][i] = rshift(c[i], 4) * 17
+			bases[2][i] = band(c[i], 15) * 17
+		end
+	end
+
+	local msb = b4 * 256 + b5
+	local lsb = b6 * 256 + b7
+
+	for y = 0, 3 do
+		for x = 0, 3 do
+			local sub
+			if flip then
+				sub = y >= 2 and 2 or 1
+			else
+				sub = x >= 2 and 2 or 1
+			end
+
+			local bitindex = x * 4 + y
+			local m = band(rshift(msb, bitindex), 1) * 2 + band(rshift(lsb, bitindex), 1)
+			local mod = tables[sub][m + 1]
+			local base = bases[sub]
+
+			local i = y * 4 + x
+			r[i] = min(max(base[1] + mod, 0), 255)
+			g[i] = min(max(base[2] + mod, 0), 255)
+			b[i] = min(max(base[3] + mod, 0), 255)
+		end
+	end
+end
+
+local function psnr(se, count)
+	if se == 0 then
+		return math.huge
+	end
+	return 10 * math.log10(255 * 255 / (se / count))
+end
+
+-- Decodes the first mipmap level of blocks (a string) and compares it with
+-- the source rgba8 pixels (also a string.) Returns the PSNR of the color
+-- channels, and of alpha for DXT5.
+function decode.psnr(format, blocks, source, width, height)
+	local blocksize = format == "dxt5" and 16 or 8
+	local blockswide = math.ceil(width / 4)
+	local blockshigh = math.ceil(height / 4)
+
+	local r, g, b, a = {}, {}, {}, {}
+	local colorse, alphase, count = 0, 0, 0
+
+	for by = 0, blockshigh - 1 do
+		for bx = 0, blockswide - 1 do
+			local o = (by * blockswide + bx) * blocksize + 1
+
+			if format == "dxt1" then
+				decodeDXTColor(blocks, o, r, g, b, true)
+			elseif format == "dxt5" then
+				decodeDXT5Alpha(blocks, o, a)
+				decodeDXTColor(blocks, o + 8, r, g, b, false)
+			elseif format == "etc1" then
+				decodeETC1(blocks, o, r, g, b)
+			else
+				error("Unknown block format: " .. tostring(format))
+			end
+
+			for y = 0, 3 do
+				local sy = by * 4 + y
+				for x = 0, 3 do
+					local sx = bx * 4 + x
+					if sx < width and sy < height then
+						local i = y * 4 + x
+						local sr, sg, sb, sa = byte(source, (sy * width + sx) * 4 + 1, (sy * width + sx) * 4 + 4)
+						colorse = colorse + (r[i] - sr)^2 + (g[i] - sg)^2 + (b[i] - sb)^2
+						if format == "dxt5" then
+							alphase = alphase + (a[i] - sa)^2
+						end
+						count = count + 1
+					end
+				end
+			end
+		end
+	end
+
+	local alphapsnr = nil
+	if format == "dxt5" then
+		alphapsnr = psnr(alphase, count)
+	end
+
+	return psnr(colorse, count * 3), alphapsnr
+end
+
+return decode
@@ -0,0 +1,108 @@
+-- Encodes an image with love.image.newCompressedData in every format and
+-- quality, and reports the encoding speed and the PSNR of the result.
+--
+-- Usage: love extra/benchmarks/blockencoder [image.png]
+-- Without an image, a generated 512x512 test image is used.
+
+local decode = require("decode")
+
+local FORMATS = {"dxt1", "dxt5", "etc1"}
+local QUALITIES = {"fast", "normal", "high"}
+local MIN_TIME = 1
+
+-- Gradients, hard edges, fine detail and noise, with an alpha ramp for DXT5.
+local function newTestImage()
+	love.math.setRandomSeed(1)
+
+	local imagedata = love.image.newImageData(512, 512)
+	imagedata:mapPixel(function(x, y)
+		local r, g, b
+		if x < 256 and y < 256 then
+			r, g, b = x, y, 255 - (x + y) / 2
+		elseif y < 256 then
+			local checker = (math.floor(x / 8) + math.floor(y / 8)) % 2
+			r, g, b = checker * 220 + 20, 40, 255 - checker * 200
+		elseif x < 256 then
+			local d = math.sqrt((x - 128)^2 + (y - 384)^2)
+			local v = 128 + 127 * math.sin(d / 4)
+			r, g, b = v, v * 0.5, 255 - v
+		else
+			r = love.math.random(0, 255)
+			g = (r + love.math.random(0, 64)) % 256
+			b = 128 + love.math.noise(x / 32, y / 32) * 127
+		end
+		return r, g, b, (x + y) / 4
+	end)
+
+	return imagedata, "generated 512x512 test image"
+end
+
+local function loadImage(path)
+	local file, err = io.open(path, "rb")
+	if not file then
+		error(err)
+	end
+
+	local contents = file:read("*a")
+	file:close()
+
+	local filedata = love.filesystem.newFileData(contents, path)
+	return love.image.newImageData(filedata), path
+end
+
+-- Calls f until at least MIN_TIME has passed, and returns the average time
+-- of a call in seconds, along with the last result.
+local function time(f)
+	local result = f() -- Warm up.
+
+	local count = 0
+	local start = love.timer.getTime()
+	local now = start
+
+	repeat
+		result = f()
+		count = count + 1
+		now = love.timer.getTime()
+	until now - start >= MIN_TIME
+
+	return (now - start) / count, result
+end
+
+function love.load(arg)
+	if not love.image.newCompressedData or not pcall(love.image.newCompressedData, love.image.newImageData(4, 4), "dxt1") then
+		print("love.image.newCompressedData can't encode ImageData in this version.")
+		return love.event.quit()
+	end
+
+	-- arg[1] is the game's folder.
+	local imagedata, name
+	if arg[2] then
+		imagedata, name = loadImage(arg[2])
+	else
+		imagedata, name = newTestImage()
+	end
+
+	local width, height = imagedata:getDimensions()
+	local source = imagedata:getString()
+	local mb = width * height * 4 / (1000 * 1000)
+
+	print(("%s, %d CPU threads"):format(name, love.system.getProcessorCount()))
+
+	for i, format in ipairs(FORMATS) do
+		for j, quality in ipairs(QUALITIES) do
+			local seconds, cdata = time(function()
+				return love.image.newCompressedData(imagedata, format, quality)
+			end)
+
+			local colorpsnr, alphapsnr = decode.psnr(format, cdata:getString(), source, width, height)
+
+			local line = ("%s %-6s %8.1f MB/s  RGB PSNR %5.2f dB"):format(format, quality, mb / seconds, colorpsnr)
+			if alphapsnr then
+				line = line .. ("  alpha PSNR %5.2f dB"):format(alphapsnr)
+			end
+			print(line)
+		end
+	end
+
+	love.event.quit()
+end
@@ -0,0 +1,13 @@
+function love.conf(t)
+	t.identity = "love-benchmark-lines"
+
+	t.window.title = "Line benchmark"
+	t.window.width = 256
+	t.window.height = 256
+	t.window.vsync = false
+
+	t.modules.audio = false
+	t.modules.sound = false
+	t.modules.joystick = false
+	t.modules.physics = false
+end
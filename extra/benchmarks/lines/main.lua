@@ -0,0 +1,79 @@
+-- Times love.graphics.line with one 10k-segment line, and with many short
+-- lines like a debug overlay draws, for each line join and style.
+
+local SEGMENTS = 10000
+local SHORT_LINES = 1000
+local SHORT_SEGMENTS = 10
+local MIN_TIME = 0.5
+
+-- A noisy graph, so the joins don't degenerate into straight lines.
+local function newGraph(segments, width, height)
+	local points = {}
+	for i = 0, segments do
+		points[#points + 1] = i * width / segments
+		points[#points + 1] = height / 2 + math.sin(i * 0.05) * height / 4 + (love.math.random() - 0.5) * height / 4
+	end
+	return points
+end
+
+-- Calls f until at least MIN_TIME has passed, and returns the average time
+-- of a call in milliseconds.
+local function time(f)
+	f() -- Warm up.
+
+	local count = 0
+	local start = love.timer.getTime()
+	local now = start
+
+	repeat
+		f()
+		count = count + 1
+		now = love.timer.getTime()
+	until now - start >= MIN_TIME
+
+	return (now - start) * 1000 / count
+end
+
+function love.load()
+	love.math.setRandomSeed(1)
+
+	local long = newGraph(SEGMENTS, 1024, 256)
+
+	local short = {}
+	for i = 1, SHORT_LINES do
+		short[i] = newGraph(SHORT_SEGMENTS, 64, 64)
+	end
+
+	-- Draw to a Canvas, so nothing depends on the window or vsync.
+	local canvas = love.graphics.newCanvas(1024, 256)
+	love.graphics.setCanvas(canvas)
+	love.graphics.setLineWidth(3)
+
+	print(("1 line of %d segments, and %d lines of %d segments"):format(SEGMENTS, SHORT_LINES, SHORT_SEGMENTS))
+
+	for i, style in ipairs({"rough", "smooth"}) do
+		love.graphics.setLineStyle(style)
+
+		for j, join in ipairs({"miter", "bevel", "none"}) do
+			love.graphics.setLineJoin(join)
+
+			local longms = time(function()
+				love.graphics.line(long)
+			end)
+
+			local shortms = time(function()
+				for k = 1, SHORT_LINES do
+					love.graphics.line(short[k])
+				end
+			end)
+
+			print(("%-6s %-5s  long: %7.3f ms %8.0f segments/ms   short: %7.3f ms %8.0f segments/ms"):format(
+				style, join,
+				longms, SEGMENTS / longms,
+				shortms, SHORT_LINES * SHORT_SEGMENTS / shortms))
+		end
+	end
+
+	love.graphics.setCanvas()
+	love.event.quit()
+end
@@ -0,0 +1,15 @@
+function love.conf(t)
+	t.identity = "love-benchmark-particles"
+
+	-- ParticleSystems need a texture, so love.graphics needs a window. It's
+	-- never drawn to.
+	t.window.title = "ParticleSystem benchmark"
+	t.window.width = 64
+	t.window.height = 64
+	t.window.vsync = false
+
+	t.modules.audio = false
+	t.modules.sound = false
+	t.modules.joystick = false
+	t.modules.physics = false
+end
@@ -0,0 +1,131 @@
+-- Rebuilds a 50k-sprite SpriteBatch from scratch, once with a SpriteBatch:add
+-- call per sprite and once with a single SpriteBatch:addBatch call reading
+-- the same sprites from packed floats.
+
+local SPRITES = 50000
+local QUADS = 4
+local ITERATIONS = 50
+
+local status, ffi = pcall(require, "ffi")
+
+-- Components per sprite in addBatch's "transform" and "position" formats.
+local TRANSFORM_COMPONENTS = 10
+local POSITION_COMPONENTS = 3
+
+local function time(f)
+	f() -- Warm up.
+
+	local start = love.timer.getTime()
+	for i = 1, ITERATIONS do
+		f()
+	end
+
+	return (love.timer.getTime() - start) * 1000 / ITERATIONS
+end
+
+local function newFloatData(count)
+	local data = love.filesystem.newFileData(string.rep("\0", count * 4), "sprites")
+	return data, ffi.cast("float *", data:getPointer())
+end
+
+function love.load()
+	local image = love.graphics.newImage(love.image.newImageData(64, 64))
+	local batch = love.graphics.newSpriteBatch(image, SPRITES, "stream")
+
+	if not batch.addBatch then
+		print("SpriteBatch:addBatch isn't available in this version.")
+		return love.event.quit()
+	end
+
+	if not status then
+		print("This benchmark needs LuaJIT's FFI to fill the sprite data.")
+		return love.event.quit()
+	end
+
+	local quads = {}
+	for i = 1, QUADS do
+		quads[i] = love.graphics.newQuad((i - 1) * 16, 0, 16, 16, 64, 64)
+	end
+
+	-- The same sprites, as Lua tables and as packed floats.
+	love.math.setRandomSeed(1)
+	local sprites = {}
+	local transformdata, transform = newFloatData(SPRITES * TRANSFORM_COMPONENTS)
+	local positiondata, position = newFloatData(SPRITES * POSITION_COMPONENTS)
+
+	for i = 1, SPRITES do
+		local s = {
+			x = love.math.random() * 1024, y = love.math.random() * 768,
+			r = love.math.random() * math.pi * 2,
+			sx = 0.5 + love.math.random(), sy = 0.5 + love.math.random(),
+			ox = 8, oy = 8, kx = 0, ky = 0,
+			quad = love.math.random(0, QUADS),
+		}
+		sprites[i] = s
+
+		local t = transform + (i - 1) * TRANSFORM_COMPONENTS
+		t[0], t[1], t[2], t[3], t[4] = s.x, s.y, s.r, s.sx, s.sy
+		t[5], t[6], t[7], t[8], t[9] = s.ox, s.oy, s.kx, s.ky, s.quad
+
+		local p = position + (i - 1) * POSITION_COMPONENTS
+		p[0], p[1], p[2] = s.x, s.y, s.quad
+	end
+
+	local results = {}
+
+	results[1] = {"add (transform)", time(function()
+		batch:clear()
+		for i = 1, SPRITES do
+			local s = sprites[i]
+			if s.quad > 0 then
+				batch:add(quads[s.quad], s.x, s.y, s.r, s.sx, s.sy, s.ox, s.oy, s.kx, s.ky)
+			else
+				batch:add(s.x, s.y, s.r, s.sx, s.sy, s.ox, s.oy, s.kx, s.ky)
+			end
+		end
+		batch:flush()
+	end)}
+
+	results[2] = {"addBatch (transform)", time(function()
+		batch:clear()
+		batch:addBatch(transformdata, SPRITES, "transform", quads)
+		batch:flush()
+	end)}
+
+	results[3] = {"add (position)", time(function()
+		batch:clear()
+		for i = 1, SPRITES do
+			local s = sprites[i]
+			if s.quad > 0 then
+				batch:add(quads[s.quad], s.x, s.y)
+			else
+				batch:add(s.x, s.y)
+			end
+		end
+		batch:flush()
+	end)}
+
+	results[4] = {"addBatch (position)", time(function()
+		batch:clear()
+		batch:addBatch(positiondata, SPRITES, "position", quads)
+		batch:flush()
+	end)}
+
+	-- A raw pointer, as an FFI-filled buffer would be passed.
+	local pointer = transformdata:getPointer()
+	results[5] = {"addBatch (pointer)", time(function()
+		batch:clear()
+		batch:addBatch(pointer, SPRITES, "transform", quads)
+		batch:flush()
+	end)}
+
+	print(("%d sprites, %d rebuilds each"):format(SPRITES, ITERATIONS))
+
+	for i, r in ipairs(results) do
+		print(("%-22s %8.3f ms/rebuild  %8.0f sprites/ms"):format(r[1], r[2], SPRITES / r[2]))
+	end
+
+	print(("addBatch speedup: %.1fx (transform), %.1fx (position)"):format(results[1][2] / results[2][2], results[3][2] / results[4][2]))
+
+	love.event.quit()
+end
@@ -0,0 +1,14 @@
+function love.conf(t)
+	t.identity = "love-benchmark-textwrap"
+
+	-- Fonts are part of love.graphics, which needs a window.
+	t.window.title = "Text wrapping benchmark"
+	t.window.width = 64
+	t.window.height = 64
+	t.window.vsync = false
+
+	t.modules.audio = false
+	t.modules.sound = false
+	t.modules.joystick = false
+	t.modules.physics = false
+end
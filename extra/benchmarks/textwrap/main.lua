@@ -0,0 +1,89 @@
+-- Times Font:getWrap and Font:getWidth on a generated 100 KB document, the
+-- way a chat or log window re-wraps its text.
+
+local DOCUMENT_SIZE = 100 * 1024
+local WIDTHS = {200, 400, 800, 1600}
+local MIN_TIME = 0.5
+
+local WORDS = {
+	"the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog", "LÖVE",
+	"framework", "AVA", "Wave", "To", "player", "joined", "the", "game",
+	"naïve", "café", "Grüße", "señor", "x", "1234", "(ok)", "well,", "yes.",
+	"Typography", "kerning", "WAVY", "Tj", "LT", "extraordinarily",
+}
+
+local function newDocument()
+	love.math.setRandomSeed(1)
+
+	local parts = {}
+	local size = 0
+
+	while size < DOCUMENT_SIZE do
+		local word = WORDS[love.math.random(#WORDS)]
+
+		-- Paragraphs of varying length, like chat messages or log lines.
+		local sep = " "
+		if love.math.random() < 1 / 40 then
+			sep = "\n"
+		end
+
+		parts[#parts + 1] = word
+		parts[#parts + 1] = sep
+		size = size + #word + #sep
+	end
+
+	return table.concat(parts)
+end
+
+-- Calls f until at least MIN_TIME has passed, and returns the average time
+-- of a call in milliseconds.
+local function time(f)
+	f() -- Warm up, so glyphs are already loaded.
+
+	local count = 0
+	local start = love.timer.getTime()
+	local now = start
+
+	repeat
+		f()
+		count = count + 1
+		now = love.timer.getTime()
+	until now - start >= MIN_TIME
+
+	return (now - start) * 1000 / count
+end
+
+function love.load()
+	local text = newDocument()
+
+	local lines = {}
+	for line in text:gmatch("[^\n]+") do
+		lines[#lines + 1] = line
+	end
+
+	local mb = #text / (1024 * 1024)
+	print(("Document: %d bytes, %d paragraphs"):format(#text, #lines))
+
+	for i, size in ipairs({12, 24}) do
+		local font = love.graphics.newFont(size)
+		print(("Default font, size %d"):format(size))
+
+		for j, width in ipairs(WIDTHS) do
+			local wrappedlines = 0
+			local ms = time(function()
+				local w, wrapped = font:getWrap(text, width)
+				wrappedlines = #wrapped
+			end)
+			print(("  getWrap  width %4d: %8.3f ms  %7.1f MB/s  %d lines"):format(width, ms, mb / (ms / 1000), wrappedlines))
+		end
+
+		local ms = time(function()
+			for j = 1, #lines do
+				font:getWidth(lines[j])
+			end
+		end)
+		print(("  getWidth per line:  %8.3f ms  %7.1f MB/s"):format(ms, mb / (ms / 1000)))
+	end
+
+	love.event.quit()
+end
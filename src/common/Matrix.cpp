@@ -87,6 +87,22 @@ Matrix4 Matrix4::operator * (const Matrix4 &m) const
 	return t;
 }
 
+Matrix4 Matrix4::multiplyAffine2D(const Matrix4 &m) const
+{
+	Matrix4 t;
+
+	t.e[0] = (e[0]*m.e[0]) + (e[4]*m.e[1]);
+	t.e[1] = (e[1]*m.e[0]) + (e[5]*m.e[1]);
+
+	t.e[4] = (e[0]*m.e[4]) + (e[4]*m.e[5]);
+	t.e[5] = (e[1]*m.e[4]) + (e[5]*m.e[5]);
+
+	t.e[12] = (e[0]*m.e[12]) + (e[4]*m.e[13]) + e[12];
+	t.e[13] = (e[1]*m.e[12]) + (e[5]*m.e[13]) + e[13];
+
+	return t;
+}
+
 void Matrix4::operator *= (const Matrix4 &m)
 {
 	Matrix4 t = (*this) * m;
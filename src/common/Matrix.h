@@ -69,6 +69,15 @@ public:
 	 **/
 	void operator *= (const Matrix4 &m);
 
+	/**
+	 * Multiplies this Matrix with another Matrix, treating both as 2D affine
+	 * transformations. Only the 3x2 parts of the matrices are used, so this is
+	 * much cheaper than operator * when that's all they contain.
+	 * @param m The Matrix to multiply with this Matrix.
+	 * @return The combined matrix.
+	 **/
+	Matrix4 multiplyAffine2D(const Matrix4 &m) const;
+
 	/**
 	 * Gets a pointer to the 16 array elements.
 	 * @return The array elements.
@@ -60,6 +60,13 @@
 #	define LOVE_LITTLE_ENDIAN 1
 #endif
 
+// SIMD instruction sets which every CPU of the target architecture supports.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define LOVE_SIMD_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#	define LOVE_SIMD_NEON 1
+#endif
+
 // Warnings.
 #ifndef _CRT_SECURE_NO_WARNINGS
 #	define _CRT_SECURE_NO_WARNINGS
@@ -22,6 +22,7 @@
 #define LOVE_MATH_H
 
 #include <climits> // for CHAR_BIT
+#include <cmath> // for powf()
 #include <cstdlib> // for rand() and RAND_MAX
 
 /* Definitions of useful mathematical constants
@@ -81,6 +82,30 @@ inline float nextP2(float x)
 	return (float) nextP2((int) x);
 }
 
+/**
+ * Converts a color component in [0, 1] from sRGB to linear space.
+ * http://en.wikipedia.org/wiki/SRGB#The_reverse_transformation
+ **/
+inline float gammaToLinear(float c)
+{
+	if (c <= 0.04045f)
+		return c / 12.92f;
+	else
+		return powf((c + 0.055f) / 1.055f, 2.4f);
+}
+
+/**
+ * Converts a color component in [0, 1] from linear to sRGB space.
+ * http://en.wikipedia.org/wiki/SRGB#The_forward_transformation_.28CIE_xyY_or_CIE_XYZ_to_sRGB.29
+ **/
+inline float linearToGamma(float c)
+{
+	if (c <= 0.0031308f)
+		return c * 12.92f;
+	else
+		return 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+}
+
 } // love
 
 #endif // LOVE_MATH_H
@@ -144,7 +144,12 @@ BMFontRasterizer::BMFontRasterizer(love::filesystem::FileData *fontdef, const st
 
 	// The parseConfig function will try to load any missing page images.
 	for (int i = 0; i < (int) imagelist.size(); i++)
+	{
+		if (imagelist[i]->getFormat() != image::ImageData::PIXELFORMAT_RGBA8)
+			throw love::Exception("BMFont page images must use rgba8 ImageData.");
+
 		images[i] = imagelist[i];
+	}
 
 	std::string configtext((const char *) fontdef->getData(), fontdef->getSize());
 
@@ -332,6 +337,11 @@ float BMFontRasterizer::getKerning(uint32 leftglyph, uint32 rightglyph) const
 	return 0.0f;
 }
 
+bool BMFontRasterizer::hasKerning() const
+{
+	return !kerning.empty();
+}
+
 bool BMFontRasterizer::accepts(love::filesystem::FileData *fontdef)
 {
 	const char *data = (const char *) fontdef->getData();
@@ -40,6 +40,9 @@ ImageRasterizer::ImageRasterizer(love::image::ImageData *data, uint32 *glyphs, i
 	, numglyphs(numglyphs)
 	, extraSpacing(extraspacing)
 {
+	if (data->getFormat() != love::image::ImageData::PIXELFORMAT_RGBA8)
+		throw love::Exception("Image fonts must use rgba8 ImageData.");
+
 	load();
 }
 
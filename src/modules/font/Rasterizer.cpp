@@ -100,5 +100,15 @@ float Rasterizer::getKerning(uint32 /*leftglyph*/, uint32 /*rightglyph*/) const
 	return 0.0f;
 }
 
+bool Rasterizer::hasKerning() const
+{
+	return false;
+}
+
+Rasterizer *Rasterizer::clone() const
+{
+	return nullptr;
+}
+
 } // font
 } // love
@@ -110,6 +110,18 @@ public:
 	 **/
 	virtual float getKerning(uint32 leftglyph, uint32 rightglyph) const;
 
+	/**
+	 * Whether getKerning can return anything other than 0.
+	 **/
+	virtual bool hasKerning() const;
+
+	/**
+	 * Creates an independent copy of this Rasterizer, which can be used on a
+	 * different thread than the original. Returns null if the Rasterizer type
+	 * doesn't support it.
+	 **/
+	virtual Rasterizer *clone() const;
+
 protected:
 
 	FontMetrics metrics;
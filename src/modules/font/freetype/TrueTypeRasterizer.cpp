@@ -31,7 +31,9 @@ namespace freetype
 {
 
 TrueTypeRasterizer::TrueTypeRasterizer(FT_Library library, love::Data *data, int size, Hinting hinting)
-	: data(data)
+	: library(library)
+	, data(data)
+	, size(size)
 	, hinting(hinting)
 {
 	if (size <= 0)
@@ -176,6 +178,19 @@ float TrueTypeRasterizer::getKerning(uint32 leftglyph, uint32 rightglyph) const
 	return float(kerning.x >> 6);
 }
 
+bool TrueTypeRasterizer::hasKerning() const
+{
+	return FT_HAS_KERNING(face) != 0;
+}
+
+Rasterizer *TrueTypeRasterizer::clone() const
+{
+	// Each copy gets its own FT_Face, which is what FreeType requires for
+	// faces used concurrently. Creating and destroying faces still has to
+	// happen on one thread at a time since they share the FT_Library.
+	return new TrueTypeRasterizer(library, data.get(), size, hinting);
+}
+
 bool TrueTypeRasterizer::accepts(FT_Library library, love::Data *data)
 {
 	const FT_Byte *fbase = (const FT_Byte *) data->getData();
@@ -53,6 +53,8 @@ public:
 	virtual int getGlyphCount() const;
 	virtual bool hasGlyph(uint32 glyph) const;
 	virtual float getKerning(uint32 leftglyph, uint32 rightglyph) const;
+	virtual bool hasKerning() const;
+	virtual Rasterizer *clone() const;
 
 	static bool accepts(FT_Library library, love::Data *data);
 
@@ -60,12 +62,15 @@ private:
 
 	static FT_ULong hintingToLoadOption(Hinting hinting);
 
+	FT_Library library;
+
 	// TrueType face
 	FT_Face face;
 
 	// Font data
 	StrongRef<love::Data> data;
 
+	int size;
 	Hinting hinting;
 
 }; // TrueTypeRasterizer
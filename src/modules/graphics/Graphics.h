@@ -141,6 +141,7 @@ public:
 		FEATURE_MULTI_CANVAS_FORMATS,
 		FEATURE_CLAMP_ZERO,
 		FEATURE_LIGHTEN,
+		FEATURE_UNIFORM_BUFFERS,
 		FEATURE_MAX_ENUM
 	};
 
@@ -184,6 +185,13 @@ public:
 		int images;
 		int fonts;
 		size_t textureMemory;
+		size_t bytesStreamed;
+		size_t bufferUploadBytes;
+		int bufferUploadRanges;
+		int redundantCallsAvoided;
+		int textLayoutHits;
+		int textLayoutMisses;
+		int skippedUniformUploads;
 	};
 
 	struct ColorMask
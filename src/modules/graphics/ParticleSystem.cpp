@@ -29,6 +29,13 @@
 #include <algorithm>
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
+
+#if defined(LOVE_SIMD_SSE2)
+#include <emmintrin.h>
+#elif defined(LOVE_SIMD_NEON)
+#include <arm_neon.h>
+#endif
 
 namespace love
 {
@@ -38,9 +45,17 @@ namespace graphics
 namespace
 {
 
-love::math::RandomGenerator rng;
+// Picks the initial seeds of new ParticleSystems.
+love::math::RandomGenerator seedGenerator;
+
+love::math::RandomGenerator::Seed newSeed()
+{
+	love::math::RandomGenerator::Seed seed;
+	seed.b64 = seedGenerator.rand();
+	return seed;
+}
 
-float calculate_variation(float inner, float outer, float var)
+float calculate_variation(love::math::RandomGenerator &rng, float inner, float outer, float var)
 {
 	float low = inner - (outer/2.0f)*var;
 	float high = inner + (outer/2.0f)*var;
@@ -48,13 +63,51 @@ float calculate_variation(float inner, float outer, float var)
 	return low*(1-r)+high*r;
 }
 
+// Moves the values of newly added particles from the end of an array to their
+// sorted insertion positions, shifting the older values up to make room.
+template <typename T>
+void insertPending(T *values, uint32 numold, const std::vector<uint64> &inserts, std::vector<T> &scratch)
+{
+	scratch.resize(inserts.size());
+
+	for (size_t i = 0; i < inserts.size(); i++)
+		scratch[i] = values[~(uint32) inserts[i]];
+
+	// Work backwards so no value is overwritten before it has been moved.
+	uint32 oldend = numold;
+
+	for (size_t i = inserts.size(); i-- > 0;)
+	{
+		uint32 pos = (uint32) (inserts[i] >> 32);
+
+		memmove(values + pos + i + 1, values + pos, (oldend - pos) * sizeof(T));
+		values[pos + i] = scratch[i];
+
+		oldend = pos;
+	}
+}
+
+// Removes the values at the given (sorted) indices from an array, keeping the
+// remaining values in order. The last index must be the array's length.
+template <typename T>
+void removeDead(T *values, const std::vector<uint32> &indices)
+{
+	for (size_t i = 0; i + 1 < indices.size(); i++)
+	{
+		uint32 start = indices[i] + 1;
+		uint32 end = indices[i + 1];
+
+		memmove(values + start - (i + 1), values + start, (end - start) * sizeof(T));
+	}
+}
+
 } // anonymous namespace
 
 ParticleSystem::ParticleSystem(Texture *texture, uint32 size)
-	: pMem(nullptr)
-	, pFree(nullptr)
-	, pHead(nullptr)
-	, pTail(nullptr)
+	: particles()
+	, pMem(nullptr)
+	, numArrays(0)
+	, arrayStride(0)
 	, texture(texture)
 	, active(true)
 	, insertMode(INSERT_MODE_TOP)
@@ -94,14 +147,15 @@ ParticleSystem::ParticleSystem(Texture *texture, uint32 size)
 
 	sizes.push_back(1.0f);
 	colors.push_back(Colorf(1.0f, 1.0f, 1.0f, 1.0f));
+	rng.setSeed(newSeed());
 	setBufferSize(size);
 }
 
 ParticleSystem::ParticleSystem(const ParticleSystem &p)
-	: pMem(nullptr)
-	, pFree(nullptr)
-	, pHead(nullptr)
-	, pTail(nullptr)
+	: particles()
+	, pMem(nullptr)
+	, numArrays(0)
+	, arrayStride(0)
 	, texture(p.texture)
 	, active(p.active)
 	, insertMode(p.insertMode)
@@ -142,6 +196,8 @@ ParticleSystem::ParticleSystem(const ParticleSystem &p)
 	, quads(p.quads)
 	, relativeRotation(p.relativeRotation)
 {
+	// Clones get their own sequence rather than repeating the original's.
+	rng.setSeed(newSeed());
 	setBufferSize(maxParticles);
 }
 
@@ -163,9 +219,26 @@ void ParticleSystem::resetOffset()
 
 void ParticleSystem::createBuffers(size_t size)
 {
+	float **arrays[] =
+	{
+		&particles.lifetime, &particles.life,
+		&particles.positionX, &particles.positionY,
+		&particles.originX, &particles.originY,
+		&particles.velocityX, &particles.velocityY,
+		&particles.linearAccelerationX, &particles.linearAccelerationY,
+		&particles.radialAcceleration, &particles.tangentialAcceleration,
+		&particles.linearDamping,
+		&particles.size, &particles.sizeOffset, &particles.sizeIntervalSize,
+		&particles.rotation, &particles.angle, &particles.spinStart, &particles.spinEnd,
+		&particles.colorR, &particles.colorG, &particles.colorB, &particles.colorA,
+	};
+
+	size_t count = sizeof(arrays) / sizeof(arrays[0]);
+
 	try
 	{
-		pFree = pMem = new Particle[size];
+		pMem = new float[count * size]();
+		particles.quadIndex = new int[size]();
 		maxParticles = (uint32) size;
 	}
 	catch (std::bad_alloc &)
@@ -173,16 +246,29 @@ void ParticleSystem::createBuffers(size_t size)
 		deleteBuffers();
 		throw love::Exception("Out of memory");
 	}
+
+	for (size_t i = 0; i < count; i++)
+		*arrays[i] = pMem + i * size;
+
+	numArrays = count;
+	arrayStride = size;
 }
 
 void ParticleSystem::deleteBuffers()
 {
 	// Clean up for great gracefulness!
 	delete[] pMem;
+	delete[] particles.quadIndex;
+
+	particles = ParticleData();
 
 	pMem = nullptr;
+	numArrays = 0;
+	arrayStride = 0;
 	maxParticles = 0;
 	activeParticles = 0;
+
+	pendingInserts.clear();
 }
 
 void ParticleSystem::setBufferSize(uint32 size)
@@ -204,29 +290,40 @@ void ParticleSystem::addParticle(float t)
 	if (isFull())
 		return;
 
-	// Gets a free particle and updates the allocation pointer.
-	Particle *p = pFree++;
-	initParticle(p, t);
+	// New particles are created after the existing ones, which puts them at
+	// the top of the drawing order.
+	uint32 index = activeParticles;
+	initParticle(index, t);
+
+	// Particles inserted elsewhere are moved into place by
+	// commitInsertedParticles, so each array is only reordered once per batch.
+	// Particles which were added but not yet committed count as being on top.
+	uint32 committed = activeParticles - (uint32) pendingInserts.size();
+	uint64 pos = committed;
 
 	switch (insertMode)
 	{
 	default:
 	case INSERT_MODE_TOP:
-		insertTop(p);
 		break;
 	case INSERT_MODE_BOTTOM:
-		insertBottom(p);
+		pos = 0;
 		break;
 	case INSERT_MODE_RANDOM:
-		insertRandom(p);
+		// Nonuniform, but 64-bit is so large nobody will notice. Hopefully.
+		pos = rng.rand() % ((int64) committed + 1);
 		break;
 	}
 
+	if (pos < committed || !pendingInserts.empty())
+		pendingInserts.push_back((pos << 32) | (uint32) ~index);
+
 	activeParticles++;
 }
 
-void ParticleSystem::initParticle(Particle *p, float t)
+void ParticleSystem::initParticle(uint32 index, float t)
 {
+	ParticleData &p = particles;
 	float min,max;
 
 	// Linearly interpolate between the previous and current emitter position.
@@ -235,36 +332,40 @@ void ParticleSystem::initParticle(Particle *p, float t)
 	min = particleLifeMin;
 	max = particleLifeMax;
 	if (min == max)
-		p->life = min;
+		p.life[index] = min;
 	else
-		p->life = (float) rng.random(min, max);
-	p->lifetime = p->life;
+		p.life[index] = (float) rng.random(min, max);
+	p.lifetime[index] = p.life[index];
 
-	p->position = pos;
+	love::Vector ppos = pos;
 
 	float rand_x, rand_y;
 	switch (areaSpreadDistribution)
 	{
 	case DISTRIBUTION_UNIFORM:
-		p->position.x += (float) rng.random(-areaSpread.getX(), areaSpread.getX());
-		p->position.y += (float) rng.random(-areaSpread.getY(), areaSpread.getY());
+		ppos.x += (float) rng.random(-areaSpread.getX(), areaSpread.getX());
+		ppos.y += (float) rng.random(-areaSpread.getY(), areaSpread.getY());
 		break;
 	case DISTRIBUTION_NORMAL:
-		p->position.x += (float) rng.randomNormal(areaSpread.getX());
-		p->position.y += (float) rng.randomNormal(areaSpread.getY());
+		ppos.x += (float) rng.randomNormal(areaSpread.getX());
+		ppos.y += (float) rng.randomNormal(areaSpread.getY());
 		break;
 	case DISTRIBUTION_ELLIPSE:
 		rand_x = (float) rng.random(-1, 1);
 		rand_y = (float) rng.random(-1, 1);
-		p->position.x += areaSpread.getX() * (rand_x * sqrt(1 - 0.5f*pow(rand_y, 2)));
-		p->position.y += areaSpread.getY() * (rand_y * sqrt(1 - 0.5f*pow(rand_x, 2)));
+		ppos.x += areaSpread.getX() * (rand_x * sqrt(1 - 0.5f*pow(rand_y, 2)));
+		ppos.y += areaSpread.getY() * (rand_y * sqrt(1 - 0.5f*pow(rand_x, 2)));
 		break;
 	case DISTRIBUTION_NONE:
 	default:
 		break;
 	}
 
-	p->origin = pos;
+	p.positionX[index] = ppos.x;
+	p.positionY[index] = ppos.y;
+
+	p.originX[index] = pos.x;
+	p.originY[index] = pos.y;
 
 	min = speedMin;
 	max = speedMax;
@@ -274,146 +375,66 @@ void ParticleSystem::initParticle(Particle *p, float t)
 	max = direction + spread/2.0f;
 	float dir = (float) rng.random(min, max);
 
-	p->velocity = love::Vector(cosf(dir), sinf(dir)) * speed;
+	love::Vector velocity = love::Vector(cosf(dir), sinf(dir)) * speed;
+	p.velocityX[index] = velocity.x;
+	p.velocityY[index] = velocity.y;
 
-	p->linearAcceleration.x = (float) rng.random(linearAccelerationMin.x, linearAccelerationMax.x);
-	p->linearAcceleration.y = (float) rng.random(linearAccelerationMin.y, linearAccelerationMax.y);
+	p.linearAccelerationX[index] = (float) rng.random(linearAccelerationMin.x, linearAccelerationMax.x);
+	p.linearAccelerationY[index] = (float) rng.random(linearAccelerationMin.y, linearAccelerationMax.y);
 
 	min = radialAccelerationMin;
 	max = radialAccelerationMax;
-	p->radialAcceleration = (float) rng.random(min, max);
+	p.radialAcceleration[index] = (float) rng.random(min, max);
 
 	min = tangentialAccelerationMin;
 	max = tangentialAccelerationMax;
-	p->tangentialAcceleration = (float) rng.random(min, max);
+	p.tangentialAcceleration[index] = (float) rng.random(min, max);
 
 	min = linearDampingMin;
 	max = linearDampingMax;
-	p->linearDamping = (float) rng.random(min, max);
+	p.linearDamping[index] = (float) rng.random(min, max);
 
-	p->sizeOffset       = (float) rng.random(sizeVariation); // time offset for size change
-	p->sizeIntervalSize = (1.0f - (float) rng.random(sizeVariation)) - p->sizeOffset;
-	p->size = sizes[(size_t)(p->sizeOffset - .5f) * (sizes.size() - 1)];
+	float sizeoffset = (float) rng.random(sizeVariation); // time offset for size change
+	p.sizeOffset[index] = sizeoffset;
+	p.sizeIntervalSize[index] = (1.0f - (float) rng.random(sizeVariation)) - sizeoffset;
+	p.size[index] = sizes[(size_t)(sizeoffset - .5f) * (sizes.size() - 1)];
 
 	min = rotationMin;
 	max = rotationMax;
-	p->spinStart = calculate_variation(spinStart, spinEnd, spinVariation);
-	p->spinEnd = calculate_variation(spinEnd, spinStart, spinVariation);
-	p->rotation = (float) rng.random(min, max);
+	p.spinStart[index] = calculate_variation(rng, spinStart, spinEnd, spinVariation);
+	p.spinEnd[index] = calculate_variation(rng, spinEnd, spinStart, spinVariation);
+	p.rotation[index] = (float) rng.random(min, max);
 
-	p->angle = p->rotation;
+	p.angle[index] = p.rotation[index];
 	if (relativeRotation)
-		p->angle += atan2f(p->velocity.y, p->velocity.x);
+		p.angle[index] += atan2f(velocity.y, velocity.x);
 
-	p->color = colors[0];
+	p.colorR[index] = colors[0].r;
+	p.colorG[index] = colors[0].g;
+	p.colorB[index] = colors[0].b;
+	p.colorA[index] = colors[0].a;
 
-	p->quadIndex = 0;
+	p.quadIndex[index] = 0;
 }
 
-void ParticleSystem::insertTop(Particle *p)
+void ParticleSystem::commitInsertedParticles()
 {
-	if (pHead == nullptr)
-	{
-		pHead = p;
-		p->prev = nullptr;
-	}
-	else
-	{
-		pTail->next = p;
-		p->prev = pTail;
-	}
-	p->next = nullptr;
-	pTail = p;
-}
-
-void ParticleSystem::insertBottom(Particle *p)
-{
-	if (pTail == nullptr)
-	{
-		pTail = p;
-		p->next = nullptr;
-	}
-	else
-	{
-		pHead->prev = p;
-		p->next = pHead;
-	}
-	p->prev = nullptr;
-	pHead = p;
-}
-
-void ParticleSystem::insertRandom(Particle *p)
-{
-	// Nonuniform, but 64-bit is so large nobody will notice. Hopefully.
-	uint64 pos = rng.rand() % ((int64) activeParticles + 1);
-
-	// Special case where the particle gets inserted before the head.
-	if (pos == activeParticles)
-	{
-		Particle *pA = pHead;
-		if (pA)
-			pA->prev = p;
-		p->prev = nullptr;
-		p->next = pA;
-		pHead = p;
+	if (pendingInserts.empty())
 		return;
-	}
-
-	// Inserts the particle after the randomly selected particle.
-	Particle *pA = pMem + pos;
-	Particle *pB = pA->next;
-	pA->next = p;
-	if (pB)
-		pB->prev = p;
-	else
-		pTail = p;
-	p->prev = pA;
-	p->next = pB;
-}
 
-ParticleSystem::Particle *ParticleSystem::removeParticle(Particle *p)
-{
-	// The linked list is updated in this function and old pointers may be
-	// invalidated. The returned pointer will inform the caller of the new
-	// pointer to the next particle.
-	Particle *pNext = nullptr;
+	uint32 numold = activeParticles - (uint32) pendingInserts.size();
 
-	// Removes the particle from the linked list.
-	if (p->prev)
-		p->prev->next = p->next;
-	else
-		pHead = p->next;
+	// Sort by insertion position. New particles with the same position end up
+	// in the reverse order they were added, as if each was inserted in front
+	// of the previous one.
+	std::sort(pendingInserts.begin(), pendingInserts.end());
 
-	if (p->next)
-	{
-		p->next->prev = p->prev;
-		pNext = p->next;
-	}
-	else
-		pTail = p->prev;
+	for (size_t a = 0; a < numArrays; a++)
+		insertPending(pMem + a * arrayStride, numold, pendingInserts, scratchFloats);
 
-	// The (in memory) last particle can now be moved into the free slot.
-	// It will skip the moving if it happens to be the removed particle.
-	pFree--;
-	if (p != pFree)
-	{
-		*p = *pFree;
-		if (pNext == pFree)
-			pNext = p;
-
-		if (p->prev)
-			p->prev->next = p;
-		else
-			pHead = p;
-
-		if (p->next)
-			p->next->prev = p;
-		else
-			pTail = p;
-	}
+	insertPending(particles.quadIndex, numold, pendingInserts, scratchInts);
 
-	activeParticles--;
-	return pNext;
+	pendingInserts.clear();
 }
 
 void ParticleSystem::setTexture(Texture *tex)
@@ -781,6 +802,16 @@ void ParticleSystem::stop()
 	emitCounter = 0;
 }
 
+void ParticleSystem::setSeed(love::math::RandomGenerator::Seed seed)
+{
+	rng.setSeed(seed);
+}
+
+love::math::RandomGenerator::Seed ParticleSystem::getSeed() const
+{
+	return rng.getSeed();
+}
+
 void ParticleSystem::pause()
 {
 	active = false;
@@ -791,10 +822,8 @@ void ParticleSystem::reset()
 	if (pMem == nullptr)
 		return;
 
-	pFree = pMem;
-	pHead = nullptr;
-	pTail = nullptr;
 	activeParticles = 0;
+	pendingInserts.clear();
 	life = lifetime;
 	emitCounter = 0;
 }
@@ -808,6 +837,8 @@ void ParticleSystem::emit(uint32 num)
 
 	while (num--)
 		addParticle(1.0f);
+
+	commitInsertedParticles();
 }
 
 bool ParticleSystem::isActive() const
@@ -835,102 +866,247 @@ bool ParticleSystem::isFull() const
 	return activeParticles == maxParticles;
 }
 
-void ParticleSystem::update(float dt)
+void ParticleSystem::integrateParticles(uint32 first, uint32 count, float dt)
 {
-	if (pMem == nullptr || dt == 0.0f)
-		return;
+	const ParticleData p = particles;
+
+	uint32 i = first;
+	uint32 end = first + count;
 
-	// Traverse all particles and update.
-	Particle *p = pHead;
+	// The vectorized loops below do exactly the same math as the scalar loop,
+	// 4 particles at a time. Particles which die in this update are processed
+	// too, since they're removed afterwards anyway.
+#if defined(LOVE_SIMD_SSE2)
+	const __m128 vdt = _mm_set1_ps(dt);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 signbit = _mm_set1_ps(-0.0f);
+
+	for (; i + 4 <= end; i += 4)
+	{
+		__m128 life = _mm_sub_ps(_mm_loadu_ps(p.life + i), vdt);
+		_mm_storeu_ps(p.life + i, life);
+
+		__m128 px = _mm_loadu_ps(p.positionX + i);
+		__m128 py = _mm_loadu_ps(p.positionY + i);
+
+		// Normalized vector from the particle's origin to the particle.
+		__m128 rx = _mm_sub_ps(px, _mm_loadu_ps(p.originX + i));
+		__m128 ry = _mm_sub_ps(py, _mm_loadu_ps(p.originY + i));
+		__m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(rx, rx), _mm_mul_ps(ry, ry)));
+		__m128 scale = _mm_and_ps(_mm_cmpgt_ps(len, zero), _mm_div_ps(one, len));
+		rx = _mm_mul_ps(rx, scale);
+		ry = _mm_mul_ps(ry, scale);
+
+		__m128 radial = _mm_loadu_ps(p.radialAcceleration + i);
+		__m128 tangential = _mm_loadu_ps(p.tangentialAcceleration + i);
+
+		__m128 tx = _mm_mul_ps(_mm_xor_ps(ry, signbit), tangential);
+		__m128 ty = _mm_mul_ps(rx, tangential);
+		rx = _mm_mul_ps(rx, radial);
+		ry = _mm_mul_ps(ry, radial);
+
+		__m128 ax = _mm_add_ps(_mm_add_ps(rx, tx), _mm_loadu_ps(p.linearAccelerationX + i));
+		__m128 ay = _mm_add_ps(_mm_add_ps(ry, ty), _mm_loadu_ps(p.linearAccelerationY + i));
+
+		__m128 vx = _mm_add_ps(_mm_loadu_ps(p.velocityX + i), _mm_mul_ps(ax, vdt));
+		__m128 vy = _mm_add_ps(_mm_loadu_ps(p.velocityY + i), _mm_mul_ps(ay, vdt));
+
+		__m128 damping = _mm_div_ps(one, _mm_add_ps(one, _mm_mul_ps(_mm_loadu_ps(p.linearDamping + i), vdt)));
+		vx = _mm_mul_ps(vx, damping);
+		vy = _mm_mul_ps(vy, damping);
+
+		_mm_storeu_ps(p.velocityX + i, vx);
+		_mm_storeu_ps(p.velocityY + i, vy);
+		_mm_storeu_ps(p.positionX + i, _mm_add_ps(px, _mm_mul_ps(vx, vdt)));
+		_mm_storeu_ps(p.positionY + i, _mm_add_ps(py, _mm_mul_ps(vy, vdt)));
+
+		__m128 t = _mm_sub_ps(one, _mm_div_ps(life, _mm_loadu_ps(p.lifetime + i)));
+		__m128 spin = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(p.spinStart + i), _mm_sub_ps(one, t)), _mm_mul_ps(_mm_loadu_ps(p.spinEnd + i), t));
+		_mm_storeu_ps(p.rotation + i, _mm_add_ps(_mm_loadu_ps(p.rotation + i), _mm_mul_ps(spin, vdt)));
+	}
+#elif defined(LOVE_SIMD_NEON) && defined(__aarch64__)
+	const float32x4_t vdt = vdupq_n_f32(dt);
+	const float32x4_t one = vdupq_n_f32(1.0f);
+	const float32x4_t zero = vdupq_n_f32(0.0f);
 
-	while (p)
+	for (; i + 4 <= end; i += 4)
+	{
+		float32x4_t life = vsubq_f32(vld1q_f32(p.life + i), vdt);
+		vst1q_f32(p.life + i, life);
+
+		float32x4_t px = vld1q_f32(p.positionX + i);
+		float32x4_t py = vld1q_f32(p.positionY + i);
+
+		// Normalized vector from the particle's origin to the particle.
+		float32x4_t rx = vsubq_f32(px, vld1q_f32(p.originX + i));
+		float32x4_t ry = vsubq_f32(py, vld1q_f32(p.originY + i));
+		float32x4_t len = vsqrtq_f32(vaddq_f32(vmulq_f32(rx, rx), vmulq_f32(ry, ry)));
+		uint32x4_t nonzero = vcgtq_f32(len, zero);
+		float32x4_t scale = vreinterpretq_f32_u32(vandq_u32(nonzero, vreinterpretq_u32_f32(vdivq_f32(one, len))));
+		rx = vmulq_f32(rx, scale);
+		ry = vmulq_f32(ry, scale);
+
+		float32x4_t radial = vld1q_f32(p.radialAcceleration + i);
+		float32x4_t tangential = vld1q_f32(p.tangentialAcceleration + i);
+
+		float32x4_t tx = vmulq_f32(vnegq_f32(ry), tangential);
+		float32x4_t ty = vmulq_f32(rx, tangential);
+		rx = vmulq_f32(rx, radial);
+		ry = vmulq_f32(ry, radial);
+
+		float32x4_t ax = vaddq_f32(vaddq_f32(rx, tx), vld1q_f32(p.linearAccelerationX + i));
+		float32x4_t ay = vaddq_f32(vaddq_f32(ry, ty), vld1q_f32(p.linearAccelerationY + i));
+
+		float32x4_t vx = vaddq_f32(vld1q_f32(p.velocityX + i), vmulq_f32(ax, vdt));
+		float32x4_t vy = vaddq_f32(vld1q_f32(p.velocityY + i), vmulq_f32(ay, vdt));
+
+		float32x4_t damping = vdivq_f32(one, vaddq_f32(one, vmulq_f32(vld1q_f32(p.linearDamping + i), vdt)));
+		vx = vmulq_f32(vx, damping);
+		vy = vmulq_f32(vy, damping);
+
+		vst1q_f32(p.velocityX + i, vx);
+		vst1q_f32(p.velocityY + i, vy);
+		vst1q_f32(p.positionX + i, vaddq_f32(px, vmulq_f32(vx, vdt)));
+		vst1q_f32(p.positionY + i, vaddq_f32(py, vmulq_f32(vy, vdt)));
+
+		float32x4_t t = vsubq_f32(one, vdivq_f32(life, vld1q_f32(p.lifetime + i)));
+		float32x4_t spin = vaddq_f32(vmulq_f32(vld1q_f32(p.spinStart + i), vsubq_f32(one, t)), vmulq_f32(vld1q_f32(p.spinEnd + i), t));
+		vst1q_f32(p.rotation + i, vaddq_f32(vld1q_f32(p.rotation + i), vmulq_f32(spin, vdt)));
+	}
+#endif
+
+	for (; i < end; i++)
 	{
 		// Decrease lifespan.
-		p->life -= dt;
+		float life = p.life[i] - dt;
+		p.life[i] = life;
+
+		// Get vector from particle center to particle.
+		love::Vector radial(p.positionX[i] - p.originX[i], p.positionY[i] - p.originY[i]);
+		radial.normalize();
+
+		// Tangential acceleration is perpendicular to the radial acceleration.
+		love::Vector tangential(-radial.y, radial.x);
+
+		radial *= p.radialAcceleration[i];
+		tangential *= p.tangentialAcceleration[i];
+
+		love::Vector linear(p.linearAccelerationX[i], p.linearAccelerationY[i]);
+		love::Vector velocity(p.velocityX[i], p.velocityY[i]);
 
-		if (p->life <= 0)
-			p = removeParticle(p);
-		else
+		// Update velocity.
+		velocity += (radial + tangential + linear) * dt;
+
+		// Apply damping.
+		velocity *= 1.0f / (1.0f + p.linearDamping[i] * dt);
+
+		p.velocityX[i] = velocity.x;
+		p.velocityY[i] = velocity.y;
+
+		// Modify position.
+		p.positionX[i] += velocity.x * dt;
+		p.positionY[i] += velocity.y * dt;
+
+		const float t = 1.0f - life / p.lifetime[i];
+
+		// Rotate.
+		p.rotation[i] += (p.spinStart[i] * (1.0f - t) + p.spinEnd[i] * t) * dt;
+	}
+}
+
+void ParticleSystem::updateParticleAttributes()
+{
+	const ParticleData p = particles;
+
+	// Local copies, so the compiler doesn't have to reload them after every
+	// store to the particle arrays.
+	const float *sizetable = &sizes[0];
+	const Colorf *colortable = &colors[0];
+	const size_t numsizes = sizes.size();
+	const size_t numcolors = colors.size();
+	const size_t numquads = quads.size();
+	const uint32 count = activeParticles;
+
+	deadParticles.clear();
+
+	for (uint32 i = 0; i < count; i++)
+	{
+		if (p.life[i] <= 0)
+		{
+			deadParticles.push_back(i);
+			continue;
+		}
+
+		const float t = 1.0f - p.life[i] / p.lifetime[i];
+
+		// Change size according to given intervals:
+		// i = 0       1       2      3          n-1
+		//     |-------|-------|------|--- ... ---|
+		// t = 0    1/(n-1)        3/(n-1)        1
+		//
+		// `s' is the interpolation variable scaled to the current
+		// interval width, e.g. if n = 5 and t = 0.3, then the current
+		// indices are 1,2 and s = 0.3 - 0.25 = 0.05
+		float s = p.sizeOffset[i] + t * p.sizeIntervalSize[i]; // size variation
+		s *= (float)(numsizes - 1); // 0 <= s < sizes.size()
+		size_t j = (size_t)(int)s;
+		size_t k = (j == numsizes - 1) ? j : j + 1; // boundary check (prevents failing on t = 1.0f)
+		s -= (float)j; // transpose s to be in interval [0:1]: j <= s < j + 1 ~> 0 <= s < 1
+		p.size[i] = sizetable[j] * (1.0f - s) + sizetable[k] * s;
+
+		// Update color according to given intervals (as above)
+		s = t * (float)(numcolors - 1);
+		j = (size_t)(int)s;
+		k = (j == numcolors - 1) ? j : j + 1;
+		s -= (float)j;                            // 0 <= s <= 1
+		p.colorR[i] = colortable[j].r * (1.0f - s) + colortable[k].r * s;
+		p.colorG[i] = colortable[j].g * (1.0f - s) + colortable[k].g * s;
+		p.colorB[i] = colortable[j].b * (1.0f - s) + colortable[k].b * s;
+		p.colorA[i] = colortable[j].a * (1.0f - s) + colortable[k].a * s;
+
+		// Update the quad index.
+		if (numquads > 0)
 		{
-			// Temp variables.
-			love::Vector radial, tangential;
-			love::Vector ppos = p->position;
-
-			// Get vector from particle center to particle.
-			radial = ppos - p->origin;
-			radial.normalize();
-			tangential = radial;
-
-			// Resize radial acceleration.
-			radial *= p->radialAcceleration;
-
-			// Calculate tangential acceleration.
-			{
-				float a = tangential.getX();
-				tangential.setX(-tangential.getY());
-				tangential.setY(a);
-			}
-
-			// Resize tangential.
-			tangential *= p->tangentialAcceleration;
-
-			// Update velocity.
-			p->velocity += (radial + tangential + p->linearAcceleration) * dt;
-
-			// Apply damping.
-			p->velocity *= 1.0f / (1.0f + p->linearDamping * dt);
-
-			// Modify position.
-			ppos += p->velocity * dt;
-
-			p->position = ppos;
-
-			const float t = 1.0f - p->life / p->lifetime;
-
-			// Rotate.
-			p->rotation += (p->spinStart * (1.0f - t) + p->spinEnd * t) * dt;
-
-			p->angle = p->rotation;
-
-			if (relativeRotation)
-				p->angle += atan2f(p->velocity.y, p->velocity.x);
-
-			// Change size according to given intervals:
-			// i = 0       1       2      3          n-1
-			//     |-------|-------|------|--- ... ---|
-			// t = 0    1/(n-1)        3/(n-1)        1
-			//
-			// `s' is the interpolation variable scaled to the current
-			// interval width, e.g. if n = 5 and t = 0.3, then the current
-			// indices are 1,2 and s = 0.3 - 0.25 = 0.05
-			float s = p->sizeOffset + t * p->sizeIntervalSize; // size variation
-			s *= (float)(sizes.size() - 1); // 0 <= s < sizes.size()
-			size_t i = (size_t)s;
-			size_t k = (i == sizes.size() - 1) ? i : i + 1; // boundary check (prevents failing on t = 1.0f)
-			s -= (float)i; // transpose s to be in interval [0:1]: i <= s < i + 1 ~> 0 <= s < 1
-			p->size = sizes[i] * (1.0f - s) + sizes[k] * s;
-
-			// Update color according to given intervals (as above)
-			s = t * (float)(colors.size() - 1);
-			i = (size_t)s;
-			k = (i == colors.size() - 1) ? i : i + 1;
-			s -= (float)i;                            // 0 <= s <= 1
-			p->color = colors[i] * (1.0f - s) + colors[k] * s;
-
-			// Update the quad index.
-			k = quads.size();
-			if (k > 0)
-			{
-				s = t * (float) k; // [0:numquads-1] (clamped below)
-				i = (s > 0.0f) ? (size_t) s : 0;
-				p->quadIndex = (int) ((i < k) ? i : k - 1);
-			}
-
-			// Next particle.
-			p = p->next;
+			s = t * (float) numquads; // [0:numquads-1] (clamped below)
+			j = (s > 0.0f) ? (size_t)(int) s : 0;
+			p.quadIndex[i] = (int) ((j < numquads) ? j : numquads - 1);
 		}
 	}
 
+	if (relativeRotation)
+	{
+		for (uint32 i = 0; i < count; i++)
+			p.angle[i] = p.rotation[i] + atan2f(p.velocityY[i], p.velocityX[i]);
+	}
+	else
+		memcpy(p.angle, p.rotation, count * sizeof(float));
+
+	if (deadParticles.empty())
+		return;
+
+	// Remove dead particles without changing the order of the others, by
+	// moving each run of living particles down over the dead ones before it.
+	deadParticles.push_back(count);
+
+	for (size_t a = 0; a < numArrays; a++)
+		removeDead(pMem + a * arrayStride, deadParticles);
+
+	removeDead(p.quadIndex, deadParticles);
+
+	activeParticles = count - (uint32) (deadParticles.size() - 1);
+}
+
+void ParticleSystem::update(float dt)
+{
+	if (pMem == nullptr || dt == 0.0f)
+		return;
+
+	// Update the physics of all particles, then everything else (and remove
+	// the particles which died.)
+	integrateParticles(0, activeParticles, dt);
+	updateParticleAttributes();
+
 	// Make some more particles.
 	if (active)
 	{
@@ -943,6 +1119,8 @@ void ParticleSystem::update(float dt)
 			emitCounter -= rate;
 		}
 
+		commitInsertedParticles();
+
 		life -= dt;
 		if (lifetime != -1 && life < 0)
 			stop();
@@ -25,6 +25,7 @@
 #include "common/int.h"
 #include "common/math.h"
 #include "common/Vector.h"
+#include "modules/math/RandomGenerator.h"
 #include "Drawable.h"
 #include "Color.h"
 #include "Quad.h"
@@ -468,6 +469,14 @@ public:
 	 **/
 	void reset();
 
+	/**
+	 * Sets the seed of the random number generator used when emitting
+	 * particles. Combined with reset(), this lets an effect be replayed
+	 * exactly.
+	 **/
+	void setSeed(love::math::RandomGenerator::Seed seed);
+	love::math::RandomGenerator::Seed getSeed() const;
+
 	/**
 	 * Instantly emits a number of particles.
 	 * @param num The number of particles to emit.
@@ -497,7 +506,8 @@ public:
 	bool isFull() const;
 
 	/**
-	 * Updates the particle system.
+	 * Updates the particle system. Systems only touch their own state while
+	 * updating, so different systems may be updated on different threads.
 	 * @param dt Time since last update.
 	 **/
 	void update(float dt);
@@ -510,52 +520,56 @@ public:
 
 protected:
 
-	// Represents a single particle.
-	struct Particle
+	// Per-particle state, stored as a structure of arrays so the update can
+	// process several particles at once. Particles are kept in drawing order:
+	// the particle at index 0 is drawn first, at the bottom.
+	struct ParticleData
 	{
-		Particle *prev;
-		Particle *next;
+		float *lifetime;
+		float *life;
 
-		float lifetime;
-		float life;
-
-		love::Vector position;
+		float *positionX;
+		float *positionY;
 
 		// Particles gravitate towards this point.
-		love::Vector origin;
+		float *originX;
+		float *originY;
 
-		love::Vector velocity;
-		love::Vector linearAcceleration;
-		float radialAcceleration;
-		float tangentialAcceleration;
+		float *velocityX;
+		float *velocityY;
+		float *linearAccelerationX;
+		float *linearAccelerationY;
+		float *radialAcceleration;
+		float *tangentialAcceleration;
 
-		float linearDamping;
+		float *linearDamping;
 
-		float size;
-		float sizeOffset;
-		float sizeIntervalSize;
+		float *size;
+		float *sizeOffset;
+		float *sizeIntervalSize;
 
-		float rotation; // Amount of rotation applied to the final angle.
-		float angle;
-		float spinStart;
-		float spinEnd;
+		float *rotation; // Amount of rotation applied to the final angle.
+		float *angle;
+		float *spinStart;
+		float *spinEnd;
 
-		Colorf color;
+		float *colorR;
+		float *colorG;
+		float *colorB;
+		float *colorA;
 
-		int quadIndex;
+		int *quadIndex;
 	};
 
-	// Pointer to the beginning of the allocated memory.
-	Particle *pMem;
-
-	// Pointer to a free particle.
-	Particle *pFree;
+	ParticleData particles;
 
-	// Pointer to the start of the linked list.
-	Particle *pHead;
+	// Pointer to the beginning of the allocated memory. Every float array in
+	// 'particles' is a section of this block.
+	float *pMem;
 
-	// Pointer to the end of the linked list.
-	Particle *pTail;
+	// The number of float arrays in pMem, and the number of elements in each.
+	size_t numArrays;
+	size_t arrayStride;
 
 	// The texture to be drawn.
 	StrongRef<Texture> texture;
@@ -644,6 +658,9 @@ protected:
 
 	bool relativeRotation;
 
+	// Each system has its own generator so updates don't depend on each other.
+	love::math::RandomGenerator rng;
+
 private:
 
 	void resetOffset();
@@ -652,13 +669,31 @@ private:
 	void deleteBuffers();
 
 	void addParticle(float t);
-	Particle *removeParticle(Particle *p);
 
 	// Called by addParticle.
-	void initParticle(Particle *p, float t);
-	void insertTop(Particle *p);
-	void insertBottom(Particle *p);
-	void insertRandom(Particle *p);
+	void initParticle(uint32 index, float t);
+
+	// Moves particles added since the last call into their place in the
+	// drawing order, for the bottom and random insert modes.
+	void commitInsertedParticles();
+
+	// Updates the physics of particles in the given index range.
+	void integrateParticles(uint32 first, uint32 count, float dt);
+
+	// Updates the size, color, angle and quad of each living particle, and
+	// removes dead particles while keeping the rest in order.
+	void updateParticleAttributes();
+
+	// Insertion positions of particles which haven't been committed yet, in
+	// the high 32 bits, and their index in the low 32 bits (inverted.)
+	std::vector<uint64> pendingInserts;
+
+	// Temporary storage used when reordering particles.
+	std::vector<float> scratchFloats;
+	std::vector<int> scratchInts;
+
+	// Indices of the particles which died during the current update.
+	std::vector<uint32> deadParticles;
 
 	static StringMap<AreaSpreadDistribution, DISTRIBUTION_MAX_ENUM>::Entry distributionsEntries[];
 	static StringMap<AreaSpreadDistribution, DISTRIBUTION_MAX_ENUM> distributions;
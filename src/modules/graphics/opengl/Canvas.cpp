@@ -308,18 +308,33 @@ void Canvas::drawv(const Matrix4 &t, const Vertex *v)
 
 	OpenGL::TempDebugGroup debuggroup("Canvas draw");
 
-	OpenGL::TempTransform transform(gl);
-	transform.get() *= t;
+	if (!gl.isBatchedDrawPreTransformed())
+	{
+		// Custom shaders see the same vertex positions and TransformMatrix as
+		// they would for an unbatched draw.
+		OpenGL::TempTransform transform(gl, t);
+		Vertex *verts = gl.requestBatchedDraw(OpenGL::BATCH_QUADS, 4, texture);
 
-	gl.bindTexture(texture);
+		for (int i = 0; i < 4; i++)
+		{
+			verts[i] = v[i];
+			verts[i].r = verts[i].g = verts[i].b = verts[i].a = 255;
+		}
 
-	gl.useVertexAttribArrays(ATTRIBFLAG_POS | ATTRIBFLAG_TEXCOORD);
+		return;
+	}
 
-	glVertexAttribPointer(ATTRIB_POS, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), &v[0].x);
-	glVertexAttribPointer(ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), &v[0].s);
+	Vertex *verts = gl.requestBatchedDraw(OpenGL::BATCH_QUADS, 4, texture);
+
+	for (int i = 0; i < 4; i++)
+	{
+		verts[i].s = v[i].s;
+		verts[i].t = v[i].t;
+		verts[i].r = verts[i].g = verts[i].b = verts[i].a = 255;
+	}
 
-	gl.prepareDraw();
-	gl.drawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	Matrix4 transform = gl.getCurrentTransform().multiplyAffine2D(t);
+	transform.transform(verts, v, 4);
 }
 
 void Canvas::draw(float x, float y, float angle, float sx, float sy, float ox, float oy, float kx, float ky)
@@ -342,6 +357,9 @@ void Canvas::setFilter(const Texture::Filter &f)
 		throw love::Exception("Invalid texture filter.");
 
 	filter = f;
+
+	gl.flushBatchedDraws();
+
 	gl.bindTexture(texture);
 	gl.setTextureFilter(filter);
 }
@@ -369,6 +387,8 @@ bool Canvas::setWrap(const Texture::Wrap &w)
 			wrap.t = WRAP_CLAMP;
 	}
 
+	gl.flushBatchedDraws();
+
 	gl.bindTexture(texture);
 	gl.setTextureWrap(wrap);
 
@@ -403,7 +423,7 @@ void Canvas::setupGrab()
 	gl.setViewport({0, 0, width, height});
 
 	// Set up the projection matrix
-	gl.matrices.projection.push_back(Matrix4::ortho(0.0, (float) width, 0.0, (float) height));
+	gl.pushProjection(Matrix4::ortho(0.0, (float) width, 0.0, (float) height));
 }
 
 void Canvas::startGrab(const std::vector<Canvas *> &canvases)
@@ -446,6 +466,8 @@ void Canvas::startGrab(const std::vector<Canvas *> &canvases)
 
 	OpenGL::TempDebugGroup debuggroup("Canvas set");
 
+	gl.flushBatchedDraws();
+
 	setupGrab();
 
 	// Make sure the correct sRGB setting is used when drawing to the canvases.
@@ -489,6 +511,8 @@ void Canvas::startGrab()
 {
 	OpenGL::TempDebugGroup debuggroup("Canvas set");
 
+	gl.flushBatchedDraws();
+
 	setupGrab();
 
 	// Make sure the correct sRGB setting is used when drawing to the canvas.
@@ -520,11 +544,12 @@ void Canvas::stopGrab(bool switchingToOtherCanvas)
 
 	OpenGL::TempDebugGroup debuggroup("Canvas un-set");
 
+	gl.flushBatchedDraws();
+
 	// Make sure the canvas texture is up to date if we're using MSAA.
 	resolveMSAA(false);
 
-	if (gl.matrices.projection.size() > 1)
-		gl.matrices.projection.pop_back();
+	gl.popProjection();
 
 	if (!switchingToOtherCanvas)
 	{
@@ -619,6 +644,9 @@ love::image::ImageData *Canvas::newImageData(love::image::Image *image, int x, i
 		throw love::Exception("Out of memory.");
 	}
 
+	// Pending batched draws might render to this Canvas.
+	gl.flushBatchedDraws();
+
 	// Make sure the canvas texture is up to date if we're using MSAA.
 	if (current == this)
 		resolveMSAA(false);
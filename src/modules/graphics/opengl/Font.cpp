@@ -28,9 +28,13 @@
 #include "graphics/Graphics.h"
 
 #include <math.h>
-#include <sstream>
+#include <cmath>
 #include <algorithm> // for max
 #include <limits>
+#include <memory>
+
+// SDL
+#include <SDL_cpuinfo.h>
 
 namespace love
 {
@@ -44,6 +48,34 @@ static inline uint16 normToUint16(double n)
 	return (uint16) (n * LOVE_UINT16_MAX);
 }
 
+// 64-bit FNV-1a.
+static inline uint64 hashBytes(uint64 hash, const void *data, size_t size)
+{
+	const uint8 *bytes = (const uint8 *) data;
+
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001B3ULL;
+	}
+
+	return hash;
+}
+
+static bool sameText(const std::vector<Font::ColoredString> &a, const std::vector<Font::ColoredString> &b)
+{
+	if (a.size() != b.size())
+		return false;
+
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		if (a[i].color != b[i].color || a[i].str != b[i].str)
+			return false;
+	}
+
+	return true;
+}
+
 int Font::fontCount = 0;
 
 Font::Font(love::font::Rasterizer *r, const Texture::Filter &filter)
@@ -52,6 +84,11 @@ Font::Font(love::font::Rasterizer *r, const Texture::Filter &filter)
 	, lineHeight(1)
 	, textureWidth(128)
 	, textureHeight(128)
+	, glyphUseStamp(0)
+	, useKerning(false)
+	, nextRasterizerWorker(0)
+	, advanceBlocks(ADVANCE_TABLE_SIZE / ADVANCE_BLOCK_SIZE)
+	, layoutCacheVertices(0)
 	, filter(filter)
 	, useSpacesAsTab(false)
 	, quadIndices(20) // We make this bigger at draw-time, if needed.
@@ -78,11 +115,19 @@ Font::Font(love::font::Rasterizer *r, const Texture::Filter &filter)
 
 	love::font::GlyphData *gd = r->getGlyphData(32); // Space character.
 	type = (gd->getFormat() == font::GlyphData::FORMAT_LUMINANCE_ALPHA) ? FONT_TRUETYPE : FONT_IMAGE;
+
+	// Pending glyphs take up about as much space as a wide-ish character.
+	placeholderGlyph = Glyph();
+	placeholderGlyph.page = -1;
+	placeholderGlyph.spacing = std::max(gd->getAdvance(), height / 2);
+
 	gd->release();
 
 	if (!r->hasGlyph(9)) // No tab character in the Rasterizer.
 		useSpacesAsTab = true;
 
+	updateKerningInfo();
+
 	loadVolatile();
 
 	++fontCount;
@@ -90,6 +135,7 @@ Font::Font(love::font::Rasterizer *r, const Texture::Filter &filter)
 
 Font::~Font()
 {
+	stopRasterizerWorkers(false);
 	unloadVolatile();
 
 	--fontCount;
@@ -138,38 +184,60 @@ GLenum Font::getTextureFormat(FontType fontType, GLenum *internalformat) const
 	return format;
 }
 
+size_t Font::getPixelSize() const
+{
+	return type == FONT_TRUETYPE ? 2 : 4;
+}
+
 void Font::createTexture()
 {
 	OpenGL::TempDebugGroup debuggroup("Font create texture");
 
-	size_t bpp = type == FONT_TRUETYPE ? 2 : 4;
-
-	size_t prevmemsize = textureMemorySize;
-	if (prevmemsize > 0)
-	{
-		textureMemorySize -= (textureWidth * textureHeight * bpp);
-		gl.updateTextureMemorySize(prevmemsize, textureMemorySize);
-	}
+	size_t bpp = getPixelSize();
 
-	GLuint t = 0;
 	TextureSize size = {textureWidth, textureHeight};
 	TextureSize nextsize = getNextTextureSize();
-	bool recreatetexture = false;
 
 	// If we have an existing texture already, we'll try replacing it with a
 	// larger-sized one rather than creating a second one. Having a single
 	// texture reduces texture switches and draw calls when rendering.
-	if ((nextsize.width > size.width || nextsize.height > size.height)
-		&& !textures.empty())
+	bool growtexture = (nextsize.width > size.width || nextsize.height > size.height)
+		&& !pages.empty();
+
+	// Once there are as many full-sized pages as we allow, reuse the one whose
+	// glyphs were used least recently instead of adding another.
+	if (!growtexture && pages.size() >= MAX_TEXTURE_PAGES && evictTexturePage())
+		return;
+
+	TexturePage newpage;
+	TexturePage *page = &newpage;
+
+	if (growtexture)
 	{
-		recreatetexture = true;
 		size = nextsize;
-		t = textures.back();
+		page = &pages.back();
 	}
 	else
-		glGenTextures(1, &t);
+	{
+		newpage.texture = 0;
+		newpage.lastUsed = glyphUseStamp;
+		glGenTextures(1, &newpage.texture);
+	}
 
-	gl.bindTexture(t);
+	// Initialize the texture with transparent black.
+	std::vector<uint8> pixels(size.width * size.height * bpp, 0);
+
+	// Glyphs keep their pixel positions when the texture grows.
+	if (growtexture)
+	{
+		size_t oldpitch = textureWidth * bpp;
+		size_t pitch = size.width * bpp;
+
+		for (int y = 0; y < textureHeight; y++)
+			memcpy(&pixels[y * pitch], &page->pixels[y * oldpitch], oldpitch);
+	}
+
+	gl.bindTexture(page->texture);
 
 	gl.setTextureFilter(filter);
 
@@ -179,54 +247,242 @@ void Font::createTexture()
 	GLenum internalformat = GL_RGBA;
 	GLenum format = getTextureFormat(type, &internalformat);
 
-	// Initialize the texture with transparent black.
-	std::vector<GLubyte> emptydata(size.width * size.height * bpp, 0);
-
 	// Clear errors before initializing.
 	while (glGetError() != GL_NO_ERROR);
 
 	glTexImage2D(GL_TEXTURE_2D, 0, internalformat, size.width, size.height, 0,
-	             format, GL_UNSIGNED_BYTE, &emptydata[0]);
+	             format, GL_UNSIGNED_BYTE, &pixels[0]);
 
 	if (glGetError() != GL_NO_ERROR)
 	{
-		if (!recreatetexture)
-			gl.deleteTexture(t);
+		if (!growtexture)
+			gl.deleteTexture(newpage.texture);
 		throw love::Exception("Could not create font texture!");
 	}
 
-	textureWidth  = size.width;
-	textureHeight = size.height;
-
-	rowHeight = textureX = textureY = TEXTURE_PADDING;
-
-	prevmemsize = textureMemorySize;
-	textureMemorySize += emptydata.size();
+	size_t prevmemsize = textureMemorySize;
+	textureMemorySize += pixels.size() - page->pixels.size();
 	gl.updateTextureMemorySize(prevmemsize, textureMemorySize);
 
-	// Re-add the old glyphs if we re-created the existing texture object.
-	if (recreatetexture)
+	page->pixels.swap(pixels);
+	page->dirtyStart = page->dirtyEnd = 0;
+
+	if (growtexture)
 	{
+		// Extend the packed area's top edge over the new columns.
+		if (size.width > textureWidth)
+			page->skyline.push_back({textureWidth, TEXTURE_PADDING, size.width - textureWidth});
+
+		textureWidth  = size.width;
+		textureHeight = size.height;
+
+		// The glyphs' normalized texture coordinates depend on the size.
+		for (auto &glyphpair : glyphs)
+		{
+			if (glyphpair.second.page >= 0)
+				setGlyphTexCoords(glyphpair.second);
+		}
+
 		textureCacheID++;
+	}
+	else
+	{
+		newpage.skyline = {{TEXTURE_PADDING, TEXTURE_PADDING, textureWidth - TEXTURE_PADDING}};
+		pages.push_back(newpage);
+	}
+}
 
-		std::vector<uint32> glyphstoadd;
+bool Font::evictTexturePage()
+{
+	int oldest = -1;
+
+	for (int i = 0; i < (int) pages.size(); i++)
+	{
+		// Pages used by the string which is currently being laid out can't be
+		// cleared, otherwise its earlier glyphs would disappear.
+		if (pages[i].lastUsed >= glyphUseStamp)
+			continue;
 
-		for (const auto &glyphpair : glyphs)
-			glyphstoadd.push_back(glyphpair.first);
+		if (oldest < 0 || pages[i].lastUsed < pages[oldest].lastUsed)
+			oldest = i;
+	}
 
-		glyphs.clear();
+	if (oldest < 0)
+		return false;
 
-		for (uint32 g : glyphstoadd)
-			addGlyph(g);
+	for (auto it = glyphs.begin(); it != glyphs.end(); )
+	{
+		if (it->second.page == oldest)
+			it = glyphs.erase(it);
+		else
+			++it;
 	}
-	else
-		textures.push_back(t);
+
+	clearTexturePage(pages[oldest]);
+	pages[oldest].lastUsed = glyphUseStamp;
+
+	// Text objects may have vertices which reference the evicted glyphs.
+	textureCacheID++;
+
+	return true;
+}
+
+void Font::clearTexturePage(TexturePage &page)
+{
+	// Zeroing the pixels makes sure no leftover glyph bleeds into the padding
+	// around new ones.
+	std::fill(page.pixels.begin(), page.pixels.end(), 0);
+
+	page.skyline = {{TEXTURE_PADDING, TEXTURE_PADDING, textureWidth - TEXTURE_PADDING}};
+
+	page.dirtyStart = 0;
+	page.dirtyEnd = textureHeight;
+}
+
+void Font::uploadTexturePages()
+{
+	GLenum format = getTextureFormat(type);
+	size_t pitch = textureWidth * getPixelSize();
+
+	for (TexturePage &page : pages)
+	{
+		if (page.dirtyEnd <= page.dirtyStart)
+			continue;
+
+		// Whole rows are contiguous in the CPU-side copy, so every glyph added
+		// since the last upload can be sent with a single call.
+		gl.bindTexture(page.texture);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, page.dirtyStart, textureWidth,
+		                page.dirtyEnd - page.dirtyStart, format, GL_UNSIGNED_BYTE,
+		                &page.pixels[page.dirtyStart * pitch]);
+
+		page.dirtyStart = page.dirtyEnd = 0;
+	}
+}
+
+int Font::skylineFit(const TexturePage &page, size_t index, int w, int h) const
+{
+	// Finds the lowest y at which a w*h rectangle whose left edge is at the
+	// given node fits on top of the skyline, or -1 if it doesn't fit.
+	if (page.skyline[index].x + w > textureWidth)
+		return -1;
+
+	int y = 0;
+	int remaining = w;
+
+	for (size_t i = index; remaining > 0; i++)
+	{
+		if (i >= page.skyline.size())
+			return -1;
+
+		y = std::max(y, page.skyline[i].y);
+
+		if (y + h > textureHeight)
+			return -1;
+
+		remaining -= page.skyline[i].width;
+	}
+
+	return y;
+}
+
+bool Font::packGlyph(TexturePage &page, int w, int h, int &x, int &y)
+{
+	w += TEXTURE_PADDING;
+	h += TEXTURE_PADDING;
+
+	int bestindex = -1;
+	int bestbottom = std::numeric_limits<int>::max();
+	int bestwidth = std::numeric_limits<int>::max();
+
+	// Use the position which keeps the rectangle's bottom edge lowest, and
+	// the narrowest node as a tie-breaker.
+	for (size_t i = 0; i < page.skyline.size(); i++)
+	{
+		int fity = skylineFit(page, i, w, h);
+
+		if (fity < 0)
+			continue;
+
+		int bottom = fity + h;
+
+		if (bottom < bestbottom || (bottom == bestbottom && page.skyline[i].width < bestwidth))
+		{
+			bestindex = (int) i;
+			bestbottom = bottom;
+			bestwidth = page.skyline[i].width;
+			x = page.skyline[i].x;
+			y = fity;
+		}
+	}
+
+	if (bestindex < 0)
+		return false;
+
+	std::vector<SkylineNode> &skyline = page.skyline;
+
+	skyline.insert(skyline.begin() + bestindex, {x, y + h, w});
+
+	// Shrink or remove the nodes which are now covered by the new one.
+	for (size_t i = bestindex + 1; i < skyline.size(); )
+	{
+		int overlap = skyline[i - 1].x + skyline[i - 1].width - skyline[i].x;
+
+		if (overlap <= 0)
+			break;
+
+		skyline[i].x += overlap;
+		skyline[i].width -= overlap;
+
+		if (skyline[i].width > 0)
+			break;
+
+		skyline.erase(skyline.begin() + i);
+	}
+
+	// Merge neighbouring nodes at the same height.
+	for (size_t i = 0; i + 1 < skyline.size(); )
+	{
+		if (skyline[i].y == skyline[i + 1].y)
+		{
+			skyline[i].width += skyline[i + 1].width;
+			skyline.erase(skyline.begin() + i + 1);
+		}
+		else
+			i++;
+	}
+
+	return true;
+}
+
+void Font::setGlyphTexCoords(Glyph &g) const
+{
+	double tX     = (double) g.x,          tY      = (double) g.y;
+	double tWidth = (double) textureWidth, tHeight = (double) textureHeight;
+
+	// 0----2
+	// |  / |
+	// | /  |
+	// 1----3
+	g.vertices[0].s = normToUint16((tX+0)/tWidth);
+	g.vertices[0].t = normToUint16((tY+0)/tHeight);
+	g.vertices[1].s = normToUint16((tX+0)/tWidth);
+	g.vertices[1].t = normToUint16((tY+g.height)/tHeight);
+	g.vertices[2].s = normToUint16((tX+g.width)/tWidth);
+	g.vertices[2].t = normToUint16((tY+0)/tHeight);
+	g.vertices[3].s = normToUint16((tX+g.width)/tWidth);
+	g.vertices[3].t = normToUint16((tY+g.height)/tHeight);
 }
 
 love::font::GlyphData *Font::getRasterizerGlyphData(uint32 glyph)
+{
+	return getRasterizerGlyphData(rasterizers, glyph, useSpacesAsTab);
+}
+
+love::font::GlyphData *Font::getRasterizerGlyphData(const std::vector<StrongRef<love::font::Rasterizer>> &rasterizers, uint32 glyph, bool spacesastab)
 {
 	// Use spaces for the tab 'glyph'.
-	if (glyph == 9 && useSpacesAsTab)
+	if (glyph == 9 && spacesastab)
 	{
 		love::font::GlyphData *spacegd = rasterizers[0]->getGlyphData(32);
 		love::font::GlyphData::Format fmt = spacegd->getFormat();
@@ -253,59 +509,81 @@ love::font::GlyphData *Font::getRasterizerGlyphData(uint32 glyph)
 const Font::Glyph &Font::addGlyph(uint32 glyph)
 {
 	StrongRef<love::font::GlyphData> gd(getRasterizerGlyphData(glyph), Acquire::NORETAIN);
+	return addGlyph(glyph, gd);
+}
 
+const Font::Glyph &Font::addGlyph(uint32 glyph, love::font::GlyphData *gd)
+{
 	int w = gd->getWidth();
 	int h = gd->getHeight();
 
-	if (textureX + w + TEXTURE_PADDING > textureWidth)
-	{
-		// out of space - new row!
-		textureX = TEXTURE_PADDING;
-		textureY += rowHeight;
-		rowHeight = TEXTURE_PADDING;
-	}
-
-	if (textureY + h + TEXTURE_PADDING > textureHeight)
-	{
-		// totally out of space - new texture!
-		createTexture();
-
-		// Makes sure the above code for checking if the glyph can fit at
-		// the current position in the texture is run again for this glyph.
-		return addGlyph(glyph);
-	}
-
 	Glyph g;
 
 	g.texture = 0;
 	g.spacing = gd->getAdvance();
+	g.page = -1;
+	g.x = g.y = 0;
+	g.width = w;
+	g.height = h;
 
 	memset(g.vertices, 0, sizeof(GlyphVertex) * 4);
 
 	// don't waste space for empty glyphs. also fixes a divide by zero bug with ATI drivers
 	if (w > 0 && h > 0)
 	{
-		GLenum format = getTextureFormat(type);
-		g.texture = textures.back();
+		int maxsize = std::min(4096, gl.getMaxTextureSize());
+		if (w + TEXTURE_PADDING * 2 > maxsize || h + TEXTURE_PADDING * 2 > maxsize)
+			throw love::Exception("Glyph %u is too large to fit in a font texture.", (unsigned int) glyph);
+
+		while (g.page < 0)
+		{
+			// Newer pages are likely to have the most free space.
+			for (int i = (int) pages.size() - 1; i >= 0; i--)
+			{
+				if (packGlyph(pages[i], w, h, g.x, g.y))
+				{
+					g.page = i;
+					break;
+				}
+			}
+
+			// Out of space: grow the texture, add a new page or reuse one.
+			if (g.page < 0)
+				createTexture();
+		}
+
+		TexturePage &page = pages[g.page];
+
+		g.texture = page.texture;
+		page.lastUsed = glyphUseStamp;
 
-		gl.bindTexture(g.texture);
-		glTexSubImage2D(GL_TEXTURE_2D, 0, textureX, textureY, w, h,
-		                format, GL_UNSIGNED_BYTE, gd->getData());
+		size_t bpp = getPixelSize();
+		const uint8 *src = (const uint8 *) gd->getData();
 
-		double tX     = (double) textureX,     tY      = (double) textureY;
-		double tWidth = (double) textureWidth, tHeight = (double) textureHeight;
+		for (int row = 0; row < h; row++)
+		{
+			uint8 *dst = &page.pixels[((g.y + row) * textureWidth + g.x) * bpp];
+			memcpy(dst, src + row * w * bpp, w * bpp);
+		}
+
+		if (page.dirtyEnd > page.dirtyStart)
+		{
+			page.dirtyStart = std::min(page.dirtyStart, g.y);
+			page.dirtyEnd = std::max(page.dirtyEnd, g.y + h);
+		}
+		else
+		{
+			page.dirtyStart = g.y;
+			page.dirtyEnd = g.y + h;
+		}
 
 		Color c(255, 255, 255, 255);
 
-		// 0----2
-		// |  / |
-		// | /  |
-		// 1----3
 		const GlyphVertex verts[4] = {
-			{float(0), float(0), normToUint16((tX+0)/tWidth), normToUint16((tY+0)/tHeight), c},
-			{float(0), float(h), normToUint16((tX+0)/tWidth), normToUint16((tY+h)/tHeight), c},
-			{float(w), float(0), normToUint16((tX+w)/tWidth), normToUint16((tY+0)/tHeight), c},
-			{float(w), float(h), normToUint16((tX+w)/tWidth), normToUint16((tY+h)/tHeight), c}
+			{float(0), float(0), 0, 0, c},
+			{float(0), float(h), 0, 0, c},
+			{float(w), float(0), 0, 0, c},
+			{float(w), float(h), 0, 0, c}
 		};
 
 		// Copy vertex data to the glyph and set proper bearing.
@@ -316,8 +594,17 @@ const Font::Glyph &Font::addGlyph(uint32 glyph)
 			g.vertices[i].y -= gd->getBearingY();
 		}
 
-		textureX += w + TEXTURE_PADDING;
-		rowHeight = std::max(rowHeight, h + TEXTURE_PADDING);
+		setGlyphTexCoords(g);
+	}
+
+	if (glyph < ADVANCE_TABLE_SIZE)
+	{
+		std::vector<int> &block = advanceBlocks[glyph / ADVANCE_BLOCK_SIZE];
+
+		if (block.empty())
+			block.resize(ADVANCE_BLOCK_SIZE, std::numeric_limits<int>::min());
+
+		block[glyph % ADVANCE_BLOCK_SIZE] = g.spacing;
 	}
 
 	const auto p = glyphs.insert(std::make_pair(glyph, g));
@@ -329,18 +616,199 @@ const Font::Glyph &Font::findGlyph(uint32 glyph)
 	const auto it = glyphs.find(glyph);
 
 	if (it != glyphs.end())
+	{
+		if (it->second.page >= 0)
+			pages[it->second.page].lastUsed = glyphUseStamp;
+
 		return it->second;
+	}
+
+	if (!rasterizerWorkers.empty())
+		return requestGlyph(glyph);
 
 	return addGlyph(glyph);
 }
 
+const Font::Glyph &Font::requestGlyph(uint32 glyph)
+{
+	if (pendingGlyphs.count(glyph) > 0)
+		return placeholderGlyph;
+
+	RasterizerWorker *worker = rasterizerWorkers[nextRasterizerWorker];
+	nextRasterizerWorker = (nextRasterizerWorker + 1) % (int) rasterizerWorkers.size();
+
+	bool spacesastab = useSpacesAsTab;
+	auto result = std::make_shared<StrongRef<love::font::GlyphData>>();
+
+	auto task = [worker, glyph, spacesastab, result]()
+	{
+		love::font::GlyphData *gd = getRasterizerGlyphData(worker->rasterizers, glyph, spacesastab);
+		result->set(gd, Acquire::NORETAIN);
+	};
+
+	// Called from updatePendingGlyphs, on this thread.
+	auto completion = [this, glyph, result](const std::string &error)
+	{
+		pendingGlyphs.erase(glyph);
+
+		if (glyphs.find(glyph) != glyphs.end())
+			return;
+
+		try
+		{
+			if (!error.empty() || result->get() == nullptr)
+				throw love::Exception("%s", error.c_str());
+
+			addGlyph(glyph, result->get());
+		}
+		catch (love::Exception &)
+		{
+			// Draw nothing rather than retrying a glyph which can't be added.
+			Glyph g = placeholderGlyph;
+			g.spacing = 0;
+			glyphs[glyph] = g;
+		}
+	};
+
+	pendingGlyphs.insert(glyph);
+	worker->queue->push(task, completion);
+
+	return placeholderGlyph;
+}
+
+void Font::updatePendingGlyphs()
+{
+	if (pendingGlyphs.empty())
+		return;
+
+	int finished = 0;
+
+	for (RasterizerWorker *worker : rasterizerWorkers)
+		finished += worker->queue->poll();
+
+	// Layouts which used the placeholder for a glyph that is now ready have
+	// to be regenerated.
+	if (finished > 0)
+		textureCacheID++;
+}
+
+bool Font::startRasterizerWorkers()
+{
+	int count = std::min(std::max(SDL_GetCPUCount() - 1, 1), MAX_RASTERIZER_THREADS);
+
+	for (int i = 0; i < count; i++)
+	{
+		RasterizerWorker *worker = new RasterizerWorker();
+		worker->queue = nullptr;
+
+		for (const StrongRef<love::font::Rasterizer> &r : rasterizers)
+		{
+			love::font::Rasterizer *copy = r->clone();
+
+			// Not every Rasterizer type can be cloned (image fonts and BMFonts
+			// can't.) The worker is only added once it's complete, so
+			// stopRasterizerWorkers never sees one without a queue.
+			if (copy == nullptr)
+			{
+				delete worker;
+				stopRasterizerWorkers();
+				return false;
+			}
+
+			worker->rasterizers.emplace_back(copy, Acquire::NORETAIN);
+		}
+
+		worker->queue = new love::thread::TaskQueue("FontRasterizer");
+		rasterizerWorkers.push_back(worker);
+	}
+
+	return true;
+}
+
+void Font::stopRasterizerWorkers(bool keepresults)
+{
+	bool hadpending = !pendingGlyphs.empty();
+
+	// Glyphs which haven't started rasterizing are dropped, and requested
+	// again the next time they're drawn.
+	for (RasterizerWorker *worker : rasterizerWorkers)
+		worker->queue->cancel();
+
+	// Deleting a queue waits for its current task, so nothing uses the
+	// copied Rasterizers when they're released here on the main thread.
+	for (RasterizerWorker *worker : rasterizerWorkers)
+	{
+		if (keepresults)
+		{
+			worker->queue->wait();
+			worker->queue->poll();
+		}
+
+		delete worker->queue;
+		delete worker;
+	}
+
+	rasterizerWorkers.clear();
+	nextRasterizerWorker = 0;
+	pendingGlyphs.clear();
+
+	// Layouts which used the placeholder for any of those glyphs have to be
+	// regenerated.
+	if (hadpending)
+		textureCacheID++;
+}
+
+bool Font::setAsyncRasterizationEnabled(bool enable)
+{
+	if (enable == isAsyncRasterizationEnabled())
+		return enable;
+
+	stopRasterizerWorkers();
+
+	if (enable)
+		return startRasterizerWorkers();
+
+	return false;
+}
+
+bool Font::isAsyncRasterizationEnabled() const
+{
+	return !rasterizerWorkers.empty();
+}
+
+int Font::getAdvance(uint32 glyph)
+{
+	if (glyph < ADVANCE_TABLE_SIZE)
+	{
+		const std::vector<int> &block = advanceBlocks[glyph / ADVANCE_BLOCK_SIZE];
+
+		if (!block.empty() && block[glyph % ADVANCE_BLOCK_SIZE] != std::numeric_limits<int>::min())
+			return block[glyph % ADVANCE_BLOCK_SIZE];
+	}
+
+	return findGlyph(glyph).spacing;
+}
+
 float Font::getKerning(uint32 leftglyph, uint32 rightglyph)
 {
+	if (!useKerning)
+		return 0.0f;
+
+	float *asciik = nullptr;
 	uint64 packedglyphs = ((uint64) leftglyph << 32) | (uint64) rightglyph;
 
-	const auto it = kerning.find(packedglyphs);
-	if (it != kerning.end())
-		return it->second;
+	if (leftglyph < ASCII_KERNING_SIZE && rightglyph < ASCII_KERNING_SIZE)
+	{
+		asciik = &asciiKerning[leftglyph * ASCII_KERNING_SIZE + rightglyph];
+		if (!std::isnan(*asciik))
+			return *asciik;
+	}
+	else
+	{
+		const auto it = kerning.find(packedglyphs);
+		if (it != kerning.end())
+			return it->second;
+	}
 
 	float k = rasterizers[0]->getKerning(leftglyph, rightglyph);
 
@@ -353,10 +821,31 @@ float Font::getKerning(uint32 leftglyph, uint32 rightglyph)
 		}
 	}
 
-	kerning[packedglyphs] = k;
+	if (asciik != nullptr)
+		*asciik = k;
+	else
+		kerning[packedglyphs] = k;
+
 	return k;
 }
 
+void Font::updateKerningInfo()
+{
+	useKerning = false;
+
+	for (const StrongRef<love::font::Rasterizer> &r : rasterizers)
+	{
+		if (r->hasKerning())
+			useKerning = true;
+	}
+
+	kerning.clear();
+	asciiKerning.clear();
+
+	if (useKerning)
+		asciiKerning.resize(ASCII_KERNING_SIZE * ASCII_KERNING_SIZE, std::numeric_limits<float>::quiet_NaN());
+}
+
 void Font::getCodepointsFromString(const std::string &text, Codepoints &codepoints)
 {
 	codepoints.reserve(text.size());
@@ -413,6 +902,13 @@ float Font::getHeight() const
 }
 
 std::vector<Font::DrawCommand> Font::generateVertices(const ColoredCodepoints &codepoints, std::vector<GlyphVertex> &vertices, float extra_spacing, Vector offset, TextInfo *info)
+{
+	updatePendingGlyphs();
+	glyphUseStamp++;
+	return buildVertices(codepoints, vertices, extra_spacing, offset, info);
+}
+
+std::vector<Font::DrawCommand> Font::buildVertices(const ColoredCodepoints &codepoints, std::vector<GlyphVertex> &vertices, float extra_spacing, Vector offset, TextInfo *info)
 {
 	// Spacing counter and newline handling.
 	float dx = offset.x;
@@ -459,7 +955,7 @@ std::vector<Font::DrawCommand> Font::generateVertices(const ColoredCodepoints &c
 		// If findGlyph invalidates the texture cache, re-start the loop.
 		if (cacheid != textureCacheID)
 		{
-			i = 0;
+			i = -1; // The loop increment brings this back to the first glyph.
 			maxwidth = 0;
 			dx = offset.x;
 			dy = offset.y;
@@ -541,6 +1037,16 @@ std::vector<Font::DrawCommand> Font::generateVertices(const std::string &text, s
 }
 
 std::vector<Font::DrawCommand> Font::generateVerticesFormatted(const ColoredCodepoints &text, float wrap, AlignMode align, std::vector<GlyphVertex> &vertices, TextInfo *info)
+{
+	updatePendingGlyphs();
+
+	// All lines share a stamp, so laying out later lines can't evict the
+	// glyphs of earlier ones.
+	glyphUseStamp++;
+	return buildVerticesFormatted(text, wrap, align, vertices, info);
+}
+
+std::vector<Font::DrawCommand> Font::buildVerticesFormatted(const ColoredCodepoints &text, float wrap, AlignMode align, std::vector<GlyphVertex> &vertices, TextInfo *info)
 {
 	
 	wrap = std::max(wrap, 0.0f);
@@ -590,7 +1096,7 @@ std::vector<Font::DrawCommand> Font::generateVerticesFormatted(const ColoredCode
 			break;
 		}
 
-		std::vector<DrawCommand> newcommands = generateVertices(line, vertices, extraspacing, offset);
+		std::vector<DrawCommand> newcommands = buildVertices(line, vertices, extraspacing, offset, nullptr);
 
 		if (!newcommands.empty())
 		{
@@ -625,7 +1131,7 @@ std::vector<Font::DrawCommand> Font::generateVerticesFormatted(const ColoredCode
 	if (cacheid != textureCacheID)
 	{
 		vertices.clear();
-		drawcommands = generateVerticesFormatted(text, wrap, align, vertices);
+		drawcommands = buildVerticesFormatted(text, wrap, align, vertices, nullptr);
 	}
 
 	return drawcommands;
@@ -643,6 +1149,8 @@ void Font::drawVertices(const std::vector<DrawCommand> &drawcommands, bool buffe
 	if ((size_t) totalverts / 4 > quadIndices.getSize())
 		quadIndices = QuadIndices((size_t) totalverts / 4);
 
+	uploadTexturePages();
+
 	gl.prepareDraw();
 
 	const GLenum gltype = quadIndices.getType();
@@ -682,86 +1190,181 @@ void Font::printv(const Matrix4 &t, const std::vector<DrawCommand> &drawcommands
 
 	OpenGL::TempDebugGroup debuggroup("Font print");
 
-	OpenGL::TempTransform transform(gl);
-	transform.get() *= t;
+	gl.flushBatchedDraws();
+
+	OpenGL::TempTransform transform(gl, t);
+
+	StreamBuffer *buffer = gl.getVertexStreamBuffer();
+	size_t offset = buffer->fill(&vertices[0], vertices.size() * sizeof(GlyphVertex));
 
-	glVertexAttribPointer(ATTRIB_POS, 2, GL_FLOAT, GL_FALSE, sizeof(GlyphVertex), &vertices[0].x);
-	glVertexAttribPointer(ATTRIB_TEXCOORD, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(GlyphVertex), &vertices[0].s);
-	glVertexAttribPointer(ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(GlyphVertex), &vertices[0].color.r);
+	gl.setVertexAttribPointer(ATTRIB_POS, 2, GL_FLOAT, GL_FALSE, sizeof(GlyphVertex), BUFFER_OFFSET(offset + offsetof(GlyphVertex, x)));
+	gl.setVertexAttribPointer(ATTRIB_TEXCOORD, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(GlyphVertex), BUFFER_OFFSET(offset + offsetof(GlyphVertex, s)));
+	gl.setVertexAttribPointer(ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(GlyphVertex), BUFFER_OFFSET(offset + offsetof(GlyphVertex, color.r)));
+
+	buffer->unbind();
 
 	gl.useVertexAttribArrays(ATTRIBFLAG_POS | ATTRIBFLAG_TEXCOORD | ATTRIBFLAG_COLOR);
 
-	drawVertices(drawcommands, false);
+	drawVertices(drawcommands, true);
 }
 
-void Font::print(const std::vector<ColoredString> &text, float x, float y, float angle, float sx, float sy, float ox, float oy, float kx, float ky)
+const Font::TextLayout &Font::getLayout(const std::vector<ColoredString> &text, float wrap, AlignMode align, TextLayout &scratch)
 {
+	uint64 hash = 0xCBF29CE484222325ULL;
+
+	for (const ColoredString &cstr : text)
+	{
+		hash = hashBytes(hash, cstr.str.data(), cstr.str.size());
+		hash = hashBytes(hash, &cstr.color, sizeof(Color));
+	}
+
+	hash = hashBytes(hash, &wrap, sizeof(float));
+	hash = hashBytes(hash, &align, sizeof(AlignMode));
+
+	// Finished glyphs invalidate layouts which used placeholders for them.
+	updatePendingGlyphs();
+
+	auto it = layoutCacheMap.find(hash);
+
+	if (it != layoutCacheMap.end())
+	{
+		TextLayout &layout = *it->second;
+
+		if (layout.textureCacheID == textureCacheID && layout.wrap == wrap
+			&& layout.align == align && sameText(layout.text, text))
+		{
+			layoutCache.splice(layoutCache.begin(), layoutCache, it->second);
+			gl.stats.textLayoutHits++;
+
+			// Keep the layout's texture pages from looking unused, since its
+			// glyphs aren't looked up again.
+			glyphUseStamp++;
+
+			for (const DrawCommand &cmd : layout.drawcommands)
+			{
+				for (TexturePage &page : pages)
+				{
+					if (page.texture == cmd.texture)
+						page.lastUsed = glyphUseStamp;
+				}
+			}
+
+			return layout;
+		}
+
+		// Stale, or a different string with the same hash.
+		layoutCacheVertices -= layout.vertices.size();
+		layoutCache.erase(it->second);
+		layoutCacheMap.erase(it);
+	}
+
+	gl.stats.textLayoutMisses++;
+
 	ColoredCodepoints codepoints;
 	getCodepointsFromString(text, codepoints);
 
-	std::vector<GlyphVertex> vertices;
-	std::vector<DrawCommand> drawcommands = generateVertices(codepoints, vertices);
+	scratch.vertices.clear();
+
+	if (align == ALIGN_MAX_ENUM)
+		scratch.drawcommands = generateVertices(codepoints, scratch.vertices);
+	else
+		scratch.drawcommands = generateVerticesFormatted(codepoints, wrap, align, scratch.vertices);
+
+	// Very long strings would push everything else out of the cache.
+	if (scratch.vertices.size() > MAX_CACHED_LAYOUT_VERTICES / 4)
+		return scratch;
+
+	scratch.hash = hash;
+	scratch.text = text;
+	scratch.wrap = wrap;
+	scratch.align = align;
+	scratch.textureCacheID = textureCacheID;
+
+	layoutCacheVertices += scratch.vertices.size();
+
+	layoutCache.push_front(std::move(scratch));
+	layoutCacheMap[hash] = layoutCache.begin();
+
+	while (layoutCache.size() > MAX_CACHED_LAYOUTS || layoutCacheVertices > MAX_CACHED_LAYOUT_VERTICES)
+	{
+		const TextLayout &oldest = layoutCache.back();
+		layoutCacheVertices -= oldest.vertices.size();
+		layoutCacheMap.erase(oldest.hash);
+		layoutCache.pop_back();
+	}
+
+	return layoutCache.front();
+}
+
+void Font::clearLayoutCache()
+{
+	layoutCache.clear();
+	layoutCacheMap.clear();
+	layoutCacheVertices = 0;
+}
+
+void Font::print(const std::vector<ColoredString> &text, float x, float y, float angle, float sx, float sy, float ox, float oy, float kx, float ky)
+{
+	TextLayout scratch;
+	const TextLayout &layout = getLayout(text, 0.0f, ALIGN_MAX_ENUM, scratch);
 
 	Matrix4 t(x, y, angle, sx, sy, ox, oy, kx, ky);
 
-	printv(t, drawcommands, vertices);
+	printv(t, layout.drawcommands, layout.vertices);
 }
 
 void Font::printf(const std::vector<ColoredString> &text, float x, float y, float wrap, AlignMode align, float angle, float sx, float sy, float ox, float oy, float kx, float ky)
 {
-	ColoredCodepoints codepoints;
-	getCodepointsFromString(text, codepoints);
-
-	std::vector<GlyphVertex> vertices;
-	std::vector<DrawCommand> drawcommands = generateVerticesFormatted(codepoints, wrap, align, vertices);
+	TextLayout scratch;
+	const TextLayout &layout = getLayout(text, wrap, align, scratch);
 
 	Matrix4 t(x, y, angle, sx, sy, ox, oy, kx, ky);
 
-	printv(t, drawcommands, vertices);
+	printv(t, layout.drawcommands, layout.vertices);
 }
 
 int Font::getWidth(const std::string &str)
 {
 	if (str.size() == 0) return 0;
 
-	std::istringstream iss(str);
-	std::string line;
+	updatePendingGlyphs();
+
 	int max_width = 0;
+	int width = 0;
+	uint32 prevglyph = 0;
 
-	while (getline(iss, line, '\n'))
+	try
 	{
-		int width = 0;
-		uint32 prevglyph = 0;
-		try
+		utf8::iterator<std::string::const_iterator> i(str.begin(), str.begin(), str.end());
+		utf8::iterator<std::string::const_iterator> end(str.end(), str.begin(), str.end());
+
+		while (i != end)
 		{
-			utf8::iterator<std::string::const_iterator> i(line.begin(), line.begin(), line.end());
-			utf8::iterator<std::string::const_iterator> end(line.end(), line.begin(), line.end());
+			uint32 c = *i++;
 
-			while (i != end)
+			if (c == '\n')
 			{
-				uint32 c = *i++;
-
-				const Glyph &g = findGlyph(c);
-				width += g.spacing + getKerning(prevglyph, c);
-
-				prevglyph = c;
+				max_width = std::max(max_width, width);
+				width = 0;
+				prevglyph = 0;
+				continue;
 			}
-		}
-		catch (utf8::exception &e)
-		{
-			throw love::Exception("UTF-8 decoding error: %s", e.what());
-		}
 
-		max_width = std::max(max_width, width);
+			width += getAdvance(c) + getKerning(prevglyph, c);
+			prevglyph = c;
+		}
+	}
+	catch (utf8::exception &e)
+	{
+		throw love::Exception("UTF-8 decoding error: %s", e.what());
 	}
 
-	return max_width;
+	return std::max(max_width, width);
 }
 
 int Font::getWidth(char character)
 {
-	const Glyph &g = findGlyph(character);
-	return g.spacing;
+	return getAdvance(character);
 }
 
 void Font::getWrap(const ColoredCodepoints &codepoints, float wraplimit, std::vector<ColoredCodepoints> &lines, std::vector<int> *linewidths)
@@ -821,8 +1424,7 @@ void Font::getWrap(const ColoredCodepoints &codepoints, float wraplimit, std::ve
 			continue;
 		}
 
-		const Glyph &g = findGlyph(c);
-		float charwidth = g.spacing + getKerning(prevglyph, c);
+		float charwidth = getAdvance(c) + getKerning(prevglyph, c);
 		float newwidth = width + charwidth;
 
 		// Wrap the line if it exceeds the wrap limit. Don't wrap yet if we're
@@ -917,6 +1519,8 @@ void Font::getWrap(const ColoredCodepoints &codepoints, float wraplimit, std::ve
 
 void Font::getWrap(const std::vector<ColoredString> &text, float wraplimit, std::vector<std::string> &lines, std::vector<int> *linewidths)
 {
+	updatePendingGlyphs();
+
 	ColoredCodepoints cps;
 	getCodepointsFromString(text, cps);
 
@@ -944,6 +1548,7 @@ void Font::getWrap(const std::vector<ColoredString> &text, float wraplimit, std:
 void Font::setLineHeight(float height)
 {
 	lineHeight = height;
+	clearLayoutCache();
 }
 
 float Font::getLineHeight() const
@@ -958,9 +1563,9 @@ void Font::setFilter(const Texture::Filter &f)
 
 	filter = f;
 
-	for (GLuint texture : textures)
+	for (const TexturePage &page : pages)
 	{
-		gl.bindTexture(texture);
+		gl.bindTexture(page.texture);
 		gl.setTextureFilter(filter);
 	}
 }
@@ -983,10 +1588,10 @@ void Font::unloadVolatile()
 
 	glyphs.clear();
 
-	for (GLuint texture : textures)
-		gl.deleteTexture(texture);
+	for (const TexturePage &page : pages)
+		gl.deleteTexture(page.texture);
 
-	textures.clear();
+	pages.clear();
 
 	gl.updateTextureMemorySize(textureMemorySize, 0);
 	textureMemorySize = 0;
@@ -1045,6 +1650,23 @@ bool Font::hasGlyphs(const std::string &text) const
 	return true;
 }
 
+void Font::preload(const Codepoints &codepoints)
+{
+	OpenGL::TempDebugGroup debuggroup("Font preload");
+
+	// With async rasterization enabled this just queues the glyphs.
+	updatePendingGlyphs();
+	glyphUseStamp++;
+
+	for (uint32 c : codepoints)
+	{
+		if (c != '\n')
+			findGlyph(c);
+	}
+
+	uploadTexturePages();
+}
+
 void Font::setFallbacks(const std::vector<Font *> &fallbacks)
 {
 	for (const Font *f : fallbacks)
@@ -1058,10 +1680,24 @@ void Font::setFallbacks(const std::vector<Font *> &fallbacks)
 	// NOTE: this won't invalidate already-rasterized glyphs.
 	for (const Font *f : fallbacks)
 		rasterizers.push_back(f->rasterizers[0]);
+
+	updateKerningInfo();
+	clearLayoutCache();
+
+	// The workers need copies of the new fallback Rasterizers.
+	if (isAsyncRasterizationEnabled())
+	{
+		stopRasterizerWorkers();
+
+		if (!startRasterizerWorkers())
+			throw love::Exception("Asynchronous rasterization was disabled: the fallback fonts can't be used from other threads.");
+	}
 }
 
-uint32 Font::getTextureCacheID() const
+uint32 Font::getTextureCacheID()
 {
+	updatePendingGlyphs();
+
 	return textureCacheID;
 }
 
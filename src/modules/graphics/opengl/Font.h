@@ -25,6 +25,8 @@
 #include <unordered_map>
 #include <string>
 #include <vector>
+#include <list>
+#include <unordered_set>
 
 // LOVE
 #include "common/config.h"
@@ -35,6 +37,7 @@
 #include "font/Rasterizer.h"
 #include "graphics/Texture.h"
 #include "graphics/Volatile.h"
+#include "thread/TaskQueue.h"
 #include "GLBuffer.h"
 
 #include "OpenGL.h"
@@ -190,9 +193,24 @@ public:
 	bool hasGlyph(uint32 glyph) const;
 	bool hasGlyphs(const std::string &text) const;
 
+	/**
+	 * Rasterizes the given glyphs and adds them to the texture atlas ahead of
+	 * time, so they don't have to be rasterized the first time they're drawn.
+	 **/
+	void preload(const Codepoints &codepoints);
+
+	/**
+	 * Rasterizes new glyphs on background threads instead of when they're
+	 * first drawn. Glyphs are drawn as blank space with an approximate width
+	 * until they're ready. Only works if all of the Font's Rasterizers can be
+	 * cloned (i.e. TrueType fonts.) Returns whether it's enabled.
+	 **/
+	bool setAsyncRasterizationEnabled(bool enable);
+	bool isAsyncRasterizationEnabled() const;
+
 	void setFallbacks(const std::vector<Font *> &fallbacks);
 
-	uint32 getTextureCacheID() const;
+	uint32 getTextureCacheID();
 
 	static bool getConstant(const char *in, AlignMode &out);
 	static bool getConstant(AlignMode in, const char *&out);
@@ -212,6 +230,12 @@ private:
 	{
 		GLuint texture;
 		int spacing;
+
+		// The texture page and pixel rectangle the glyph occupies. The page is
+		// -1 for glyphs without any pixels (e.g. spaces.)
+		int page;
+		int x, y, width, height;
+
 		GlyphVertex vertices[4];
 	};
 
@@ -221,13 +245,76 @@ private:
 		int height;
 	};
 
+	// A horizontal segment of the top edge of the packed area in a page.
+	struct SkylineNode
+	{
+		int x, y, width;
+	};
+
+	struct TexturePage
+	{
+		GLuint texture;
+
+		// Copy of the texture's contents. New glyphs are written here and
+		// uploaded together right before drawing.
+		std::vector<uint8> pixels;
+
+		std::vector<SkylineNode> skyline;
+
+		// Range of rows modified since the last upload.
+		int dirtyStart;
+		int dirtyEnd;
+
+		// Value of glyphUseStamp when a glyph in this page was last used.
+		uint64 lastUsed;
+	};
+
+	// Vertices and draw commands of a string drawn with print or printf.
+	struct TextLayout
+	{
+		uint64 hash;
+		std::vector<ColoredString> text;
+		float wrap;
+		AlignMode align;
+		uint32 textureCacheID;
+
+		std::vector<GlyphVertex> vertices;
+		std::vector<DrawCommand> drawcommands;
+	};
+
+	// A thread with its own copies of the Font's Rasterizers.
+	struct RasterizerWorker
+	{
+		love::thread::TaskQueue *queue;
+		std::vector<StrongRef<love::font::Rasterizer>> rasterizers;
+	};
+
 	TextureSize getNextTextureSize() const;
 	GLenum getTextureFormat(FontType fontType, GLenum *internalformat = nullptr) const;
+	size_t getPixelSize() const;
 	void createTexture();
+	bool evictTexturePage();
+	void clearTexturePage(TexturePage &page);
+	void uploadTexturePages();
+	bool packGlyph(TexturePage &page, int w, int h, int &x, int &y);
+	int skylineFit(const TexturePage &page, size_t index, int w, int h) const;
+	void setGlyphTexCoords(Glyph &g) const;
+	static love::font::GlyphData *getRasterizerGlyphData(const std::vector<StrongRef<love::font::Rasterizer>> &rasterizers, uint32 glyph, bool spacesastab);
 	love::font::GlyphData *getRasterizerGlyphData(uint32 glyph);
 	const Glyph &addGlyph(uint32 glyph);
+	const Glyph &addGlyph(uint32 glyph, love::font::GlyphData *gd);
+	const Glyph &requestGlyph(uint32 glyph);
+	void updatePendingGlyphs();
+	bool startRasterizerWorkers();
+	void stopRasterizerWorkers(bool keepresults = true);
 	const Glyph &findGlyph(uint32 glyph);
+	std::vector<DrawCommand> buildVertices(const ColoredCodepoints &codepoints, std::vector<GlyphVertex> &vertices, float extra_spacing, Vector offset, TextInfo *info);
+	std::vector<DrawCommand> buildVerticesFormatted(const ColoredCodepoints &text, float wrap, AlignMode align, std::vector<GlyphVertex> &vertices, TextInfo *info);
+	int getAdvance(uint32 glyph);
 	float getKerning(uint32 leftglyph, uint32 rightglyph);
+	void updateKerningInfo();
+	const TextLayout &getLayout(const std::vector<ColoredString> &text, float wrap, AlignMode align, TextLayout &scratch);
+	void clearLayoutCache();
 	void printv(const Matrix4 &t, const std::vector<DrawCommand> &drawcommands, const std::vector<GlyphVertex> &vertices);
 
 	std::vector<StrongRef<love::font::Rasterizer>> rasterizers;
@@ -238,8 +325,13 @@ private:
 	int textureWidth;
 	int textureHeight;
 
-	// vector of packed textures
-	std::vector<GLuint> textures;
+	// Texture atlas pages. The first page grows until it reaches the maximum
+	// texture size; after that new pages are added, up to MAX_TEXTURE_PAGES.
+	std::vector<TexturePage> pages;
+
+	// Incremented for every string which gets laid out. When all pages are
+	// full, the page whose glyphs were used least recently is cleared.
+	uint64 glyphUseStamp;
 
 	// maps glyphs to glyph texture information
 	std::unordered_map<uint32, Glyph> glyphs;
@@ -247,12 +339,35 @@ private:
 	// map of left/right glyph pairs to horizontal kerning.
 	std::unordered_map<uint64, float> kerning;
 
+	// Direct-indexed kerning of pairs of ASCII glyphs. NaN until looked up.
+	std::vector<float> asciiKerning;
+
+	// False if none of the rasterizers have kerning information.
+	bool useKerning;
+
+	std::vector<RasterizerWorker *> rasterizerWorkers;
+	int nextRasterizerWorker;
+
+	// Glyphs being rasterized by a worker.
+	std::unordered_set<uint32> pendingGlyphs;
+
+	// Returned by findGlyph for pending glyphs.
+	Glyph placeholderGlyph;
+
+	// Advances of glyphs in the Basic Multilingual Plane, in blocks of 256
+	// which are allocated when one of their glyphs is first added. Unlike the
+	// glyph map these aren't cleared when a texture page is evicted.
+	std::vector<std::vector<int>> advanceBlocks;
+
+	// Layouts of recently printed strings, most recently used first, so text
+	// which doesn't change between frames isn't laid out again.
+	std::list<TextLayout> layoutCache;
+	std::unordered_map<uint64, std::list<TextLayout>::iterator> layoutCacheMap;
+	size_t layoutCacheVertices;
+
 	FontType type;
 	Texture::Filter filter;
 
-	int textureX, textureY;
-	int rowHeight;
-
 	bool useSpacesAsTab;
 
 	// Index buffer used for drawing quads with GL_TRIANGLES.
@@ -265,6 +380,17 @@ private:
 
 	static const int TEXTURE_PADDING = 1;
 
+	static const int MAX_TEXTURE_PAGES = 4;
+
+	static const int MAX_RASTERIZER_THREADS = 2;
+
+	static const uint32 ADVANCE_TABLE_SIZE = 0x10000;
+	static const uint32 ADVANCE_BLOCK_SIZE = 256;
+	static const uint32 ASCII_KERNING_SIZE = 128;
+
+	static const size_t MAX_CACHED_LAYOUTS = 256;
+	static const size_t MAX_CACHED_LAYOUT_VERTICES = 65536;
+
 	// This will be used if the Rasterizer doesn't have a tab character itself.
 	static const int SPACES_PER_TAB = 4;
 
@@ -42,8 +42,6 @@ GLBuffer::GLBuffer(size_t size, const void *data, GLenum target, GLenum usage, u
 	, usage(usage)
 	, vbo(0)
 	, memory_map(nullptr)
-	, modified_offset(0)
-	, modified_size(0)
 	, map_flags(mapflags)
 {
 	try
@@ -80,8 +78,7 @@ void *GLBuffer::map()
 
 	is_mapped = true;
 
-	modified_offset = 0;
-	modified_size = 0;
+	modified_ranges.clear();
 
 	return memory_map;
 }
@@ -93,6 +90,9 @@ void GLBuffer::unmapStatic(size_t offset, size_t size)
 
 	// Upload the mapped data to the buffer.
 	glBufferSubData(getTarget(), (GLintptr) offset, (GLsizeiptr) size, memory_map + offset);
+
+	gl.stats.bufferUploadBytes += size;
+	++gl.stats.bufferUploadRanges;
 }
 
 void GLBuffer::unmapStream()
@@ -101,6 +101,9 @@ void GLBuffer::unmapStream()
 	// http://www.seas.upenn.edu/~pcozzi/OpenGLInsights/OpenGLInsights-AsynchronousBufferTransfers.pdf
 	glBufferData(getTarget(), (GLsizeiptr) getSize(), nullptr,    getUsage());
 	glBufferData(getTarget(), (GLsizeiptr) getSize(), memory_map, getUsage());
+
+	gl.stats.bufferUploadBytes += getSize();
+	++gl.stats.bufferUploadRanges;
 }
 
 void GLBuffer::unmap()
@@ -108,49 +111,53 @@ void GLBuffer::unmap()
 	if (!is_mapped)
 		return;
 
-	if ((map_flags & MAP_EXPLICIT_RANGE_MODIFY) != 0)
-	{
-		modified_offset = std::min(modified_offset, getSize() - 1);
-		modified_size = std::min(modified_size, getSize() - modified_offset);
-	}
-	else
+	if ((map_flags & MAP_EXPLICIT_RANGE_MODIFY) == 0)
 	{
-		modified_offset = 0;
-		modified_size = getSize();
+		modified_ranges.clear();
+		modified_ranges.push_back({0, getSize()});
 	}
 
+	size_t modified_size = 0;
+	for (const Range &r : modified_ranges)
+		modified_size += r.size;
+
 	// VBO::bind is a no-op when the VBO is mapped, so we have to make sure it's
 	// bound here.
 	if (!is_bound)
 	{
-		glBindBuffer(getTarget(), vbo);
+		gl.bindBuffer(getTarget(), vbo);
 		is_bound = true;
 	}
 
 	if (modified_size > 0)
 	{
+		bool stream = false;
+
 		switch (getUsage())
 		{
 		case GL_STATIC_DRAW:
-			unmapStatic(modified_offset, modified_size);
 			break;
 		case GL_STREAM_DRAW:
-			unmapStream();
+			stream = true;
 			break;
 		case GL_DYNAMIC_DRAW:
 		default:
 			// It's probably more efficient to treat it like a streaming buffer if
 			// at least a third of its contents have been modified during the map().
-			if (modified_size >= getSize() / 3)
-				unmapStream();
-			else
-				unmapStatic(modified_offset, modified_size);
+			stream = modified_size >= getSize() / 3;
 			break;
 		}
+
+		if (stream)
+			unmapStream();
+		else
+		{
+			for (const Range &r : modified_ranges)
+				unmapStatic(r.offset, r.size);
+		}
 	}
 
-	modified_offset = 0;
-	modified_size = 0;
+	modified_ranges.clear();
 
 	is_mapped = false;
 }
@@ -160,22 +167,60 @@ void GLBuffer::setMappedRangeModified(size_t offset, size_t modifiedsize)
 	if (!is_mapped || !(map_flags & MAP_EXPLICIT_RANGE_MODIFY))
 		return;
 
-	// We're being conservative right now by internally marking the whole range
-	// from the start of section a to the end of section b as modified if both
-	// a and b are marked as modified.
+	if (offset >= getSize() || modifiedsize == 0)
+		return;
+
+	size_t start = offset;
+	size_t end = offset + std::min(modifiedsize, getSize() - offset);
+
+	// Find the first range which ends close enough to the new one to touch it.
+	auto first = std::lower_bound(modified_ranges.begin(), modified_ranges.end(), start,
+		[](const Range &r, size_t s) { return r.offset + r.size + RANGE_MERGE_DISTANCE < s; });
+
+	// Absorb every range which starts close enough to the new one's end.
+	auto last = first;
+	while (last != modified_ranges.end() && last->offset <= end + RANGE_MERGE_DISTANCE)
+	{
+		start = std::min(start, last->offset);
+		end = std::max(end, last->offset + last->size);
+		++last;
+	}
+
+	first = modified_ranges.erase(first, last);
+	modified_ranges.insert(first, {start, end - start});
+
+	// Keep the number of separate uploads bounded by merging the two ranges
+	// with the smallest gap between them.
+	if (modified_ranges.size() > MAX_MODIFIED_RANGES)
+	{
+		size_t best = 0;
+		size_t bestgap = std::numeric_limits<size_t>::max();
+
+		for (size_t i = 0; i + 1 < modified_ranges.size(); i++)
+		{
+			const Range &a = modified_ranges[i];
+			size_t gap = modified_ranges[i + 1].offset - (a.offset + a.size);
+
+			if (gap < bestgap)
+			{
+				best = i;
+				bestgap = gap;
+			}
+		}
 
-	size_t old_range_end = modified_offset + modified_size;
-	modified_offset = std::min(modified_offset, offset);
+		Range &a = modified_ranges[best];
+		const Range &b = modified_ranges[best + 1];
 
-	size_t new_range_end = std::max(offset + modifiedsize, old_range_end);
-	modified_size = new_range_end - modified_offset;
+		a.size = (b.offset + b.size) - a.offset;
+		modified_ranges.erase(modified_ranges.begin() + best + 1);
+	}
 }
 
 void GLBuffer::bind()
 {
 	if (!is_mapped)
 	{
-		glBindBuffer(getTarget(), vbo);
+		gl.bindBuffer(getTarget(), vbo);
 		is_bound = true;
 	}
 }
@@ -183,7 +228,7 @@ void GLBuffer::bind()
 void GLBuffer::unbind()
 {
 	if (is_bound)
-		glBindBuffer(getTarget(), 0);
+		gl.bindBuffer(getTarget(), 0);
 
 	is_bound = false;
 }
@@ -235,11 +280,143 @@ void GLBuffer::unload()
 {
 	is_mapped = false;
 
-	glDeleteBuffers(1, &vbo);
+	gl.deleteBuffer(vbo);
 	vbo = 0;
 }
 
 
+// StreamBuffer
+
+StreamBuffer::StreamBuffer(GLenum target, size_t size)
+	: target(target)
+	, size(size)
+	, vbo(0)
+	, offset(0)
+	, mappedSize(0)
+	, mappedMemory(nullptr)
+	, useMapRange(false)
+{
+	useMapRange = GLAD_VERSION_3_0 || GLAD_ARB_map_buffer_range || GLAD_ES_VERSION_3_0
+		|| (GLAD_EXT_map_buffer_range && GLAD_OES_mapbuffer);
+
+	glGenBuffers(1, &vbo);
+
+	bind();
+
+	while (glGetError() != GL_NO_ERROR)
+		/* Clear the error buffer. */;
+
+	glBufferData(target, (GLsizeiptr) size, nullptr, GL_STREAM_DRAW);
+	GLenum err = glGetError();
+
+	unbind();
+
+	if (err != GL_NO_ERROR)
+	{
+		gl.deleteBuffer(vbo);
+		throw love::Exception("Could not create streaming buffer (out of VRAM?)");
+	}
+}
+
+StreamBuffer::~StreamBuffer()
+{
+	if (mappedMemory != nullptr)
+	{
+		bind();
+		glUnmapBuffer(target);
+	}
+
+	gl.deleteBuffer(vbo);
+}
+
+void StreamBuffer::orphan(size_t newsize)
+{
+	size = newsize;
+	glBufferData(target, (GLsizeiptr) size, nullptr, GL_STREAM_DRAW);
+	offset = 0;
+}
+
+void *StreamBuffer::map(size_t mapsize)
+{
+	bind();
+
+	if (mapsize > size)
+	{
+		size_t newsize = size;
+		while (newsize < mapsize)
+			newsize *= 2;
+
+		orphan(newsize);
+	}
+	else if (offset + mapsize > size)
+		orphan(size);
+
+	mappedSize = mapsize;
+
+	if (useMapRange && mapsize > 0)
+	{
+		// The range after 'offset' hasn't been used since the last orphan, so
+		// there's no need for the driver to synchronize with the GPU.
+		GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT
+			| GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_FLUSH_EXPLICIT_BIT;
+
+		mappedMemory = (char *) glMapBufferRange(target, (GLintptr) offset, (GLsizeiptr) mapsize, access);
+
+		if (mappedMemory != nullptr)
+			return mappedMemory;
+	}
+
+	if (scratch.size() < mapsize)
+		scratch.resize(mapsize);
+
+	return scratch.data();
+}
+
+size_t StreamBuffer::unmap(size_t usedsize)
+{
+	usedsize = std::min(usedsize, mappedSize);
+
+	if (mappedMemory != nullptr)
+	{
+		if (usedsize > 0)
+			glFlushMappedBufferRange(target, 0, (GLsizeiptr) usedsize);
+
+		glUnmapBuffer(target);
+		mappedMemory = nullptr;
+	}
+	else if (usedsize > 0)
+		glBufferSubData(target, (GLintptr) offset, (GLsizeiptr) usedsize, scratch.data());
+
+	size_t dataoffset = offset;
+
+	offset += usedsize;
+	offset = (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+
+	mappedSize = 0;
+
+	gl.stats.bytesStreamed += usedsize;
+
+	return dataoffset;
+}
+
+size_t StreamBuffer::fill(const void *data, size_t datasize)
+{
+	void *dst = map(datasize);
+	memcpy(dst, data, datasize);
+	return unmap(datasize);
+}
+
+void StreamBuffer::bind()
+{
+	gl.bindBuffer(target, vbo);
+}
+
+void StreamBuffer::unbind()
+{
+	gl.bindBuffer(target, 0);
+}
+
+
 // QuadIndices
 
 size_t QuadIndices::maxSize = 0;
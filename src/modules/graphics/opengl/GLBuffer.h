@@ -32,6 +32,9 @@
 // C
 #include <stddef.h>
 
+// C++
+#include <vector>
+
 namespace love
 {
 namespace graphics
@@ -253,6 +256,20 @@ private:
 	void unmapStatic(size_t offset, size_t size);
 	void unmapStream();
 
+	// A modified byte range in the mapped memory.
+	struct Range
+	{
+		size_t offset;
+		size_t size;
+	};
+
+	// Modified ranges closer together than this are uploaded as one, since
+	// each upload call has a cost of its own.
+	static const size_t RANGE_MERGE_DISTANCE = 256;
+
+	// Past this many modified ranges, the closest ones are merged.
+	static const size_t MAX_MODIFIED_RANGES = 32;
+
 	// Whether the buffer is currently bound.
 	bool is_bound;
 
@@ -274,14 +291,110 @@ private:
 	// A pointer to mapped memory.
 	char *memory_map;
 
-	size_t modified_offset;
-	size_t modified_size;
+	// Sorted, non-overlapping ranges modified since the last map().
+	std::vector<Range> modified_ranges;
 
 	uint32 map_flags;
 
 }; // GLBuffer
 
 
+/**
+ * StreamBuffer holds vertex or index data which is regenerated every time it's
+ * drawn. New data is appended after the previous data in a round-robin
+ * fashion, and the buffer's storage is orphaned when it wraps around, so
+ * neither the CPU nor the GPU has to wait for data the other is still using.
+ *
+ * If buffer range mapping isn't supported (e.g. GL 2.1 without
+ * ARB_map_buffer_range), data is written to CPU-side memory and uploaded with
+ * glBufferSubData instead.
+ *
+ * The class is meant for internal use, see OpenGL::getVertexStreamBuffer.
+ **/
+class StreamBuffer
+{
+public:
+
+	/**
+	 * Constructor.
+	 *
+	 * @param target The target buffer object, e.g. GL_ARRAY_BUFFER.
+	 * @param size The initial size of the buffer in bytes. The buffer grows if
+	 *        a single map() requests more than this.
+	 **/
+	StreamBuffer(GLenum target, size_t size);
+	~StreamBuffer();
+
+	/**
+	 * Gets memory which the next 'size' bytes of data should be written to.
+	 * The buffer is bound as a side effect.
+	 *
+	 * @param size The maximum number of bytes which will be written.
+	 * @return A pointer to 'size' bytes of write-only memory.
+	 **/
+	void *map(size_t size);
+
+	/**
+	 * Submits the data written to memory returned by map(). The buffer stays
+	 * bound until unbind() is called.
+	 *
+	 * @param usedsize The number of bytes which were actually written.
+	 * @return The offset of the data in the buffer, in bytes. Use it with
+	 *         BUFFER_OFFSET when setting up vertex attributes or indices.
+	 **/
+	size_t unmap(size_t usedsize);
+
+	/**
+	 * Copies data into the buffer. Equivalent to map + memcpy + unmap.
+	 *
+	 * @return The offset of the data in the buffer, in bytes.
+	 **/
+	size_t fill(const void *data, size_t size);
+
+	void bind();
+	void unbind();
+
+	GLenum getTarget() const
+	{
+		return target;
+	}
+
+	size_t getSize() const
+	{
+		return size;
+	}
+
+private:
+
+	// Allocates new storage for the buffer without waiting for the old storage
+	// to stop being used by the GPU.
+	void orphan(size_t newsize);
+
+	// Offsets of streamed data are aligned to this many bytes.
+	static const size_t ALIGNMENT = 16;
+
+	GLenum target;
+	size_t size;
+
+	GLuint vbo;
+
+	// Where the next block of data will be written, in bytes.
+	size_t offset;
+
+	// The size of the region returned by the current map(), in bytes.
+	size_t mappedSize;
+
+	// Non-null while a range of the buffer is mapped with glMapBufferRange.
+	char *mappedMemory;
+
+	// Used instead of mapping the buffer when range mapping isn't supported.
+	std::vector<char> scratch;
+
+	bool useMapRange;
+
+}; // StreamBuffer
+
+
 /**
  * QuadIndices manages one shared GLBuffer that stores the indices for an
  * element array. Vertex arrays using the vertex structure (or anything else
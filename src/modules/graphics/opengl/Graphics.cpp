@@ -27,16 +27,22 @@
 #include "font/Font.h"
 #include "Polyline.h"
 #include "math/MathModule.h"
+#include "filesystem/Filesystem.h"
 
 // C++
 #include <vector>
 #include <sstream>
 #include <algorithm>
 #include <iterator>
+#include <memory>
 
 // C
 #include <cmath>
 #include <cstdio>
+#include <cstring>
+
+// SDL
+#include <SDL_cpuinfo.h>
 
 #ifdef LOVE_IOS
 #include <SDL_syswm.h>
@@ -49,9 +55,46 @@ namespace graphics
 namespace opengl
 {
 
+// Writes count points of an axis-aligned ellipse, from a table of points on the
+// unit circle. V is Vector or Vertex.
+template <typename V>
+static void scaleUnitCircle(V *dst, const Vector *unit, int count, float x, float y, float a, float b)
+{
+	for (int i = 0; i < count; i++)
+	{
+		dst[i].x = x + a * unit[i].x;
+		dst[i].y = y + b * unit[i].y;
+	}
+}
+
+// Writes count points of a circular arc starting at angle1, by rotating the
+// first point by angle_shift for each of the others.
+template <typename V>
+static void rotateArc(V *dst, int count, float x, float y, float radius, float angle1, float angle_shift)
+{
+	// Rotating in double precision keeps the error from building up over the
+	// arc's points.
+	double c = cos(angle1), s = sin(angle1);
+	double dc = cos(angle_shift), ds = sin(angle_shift);
+
+	for (int i = 0; i < count; i++)
+	{
+		dst[i].x = x + radius * (float) c;
+		dst[i].y = y + radius * (float) s;
+
+		double nc = c * dc - s * ds;
+		s = s * dc + c * ds;
+		c = nc;
+	}
+}
+
 Graphics::Graphics()
 	: currentWindow(Module::getInstance<love::window::Window>(Module::M_WINDOW))
+	, autoSegments(false)
 	, quadIndices(nullptr)
+	, particleWorkers(nullptr)
+	, screenshotBufferCount(0)
+	, screenshotWorker(nullptr)
 	, width(0)
 	, height(0)
 	, created(false)
@@ -94,9 +137,31 @@ Graphics::~Graphics()
 		Shader::defaultVideoShader->release();
 		Shader::defaultVideoShader = nullptr;
 	}
+	if (Shader::defaultParticleShader)
+	{
+		Shader::defaultParticleShader->release();
+		Shader::defaultParticleShader = nullptr;
+	}
 
 	if (quadIndices)
 		delete quadIndices;
+
+	delete particleWorkers;
+
+	if (isCreated())
+		finishScreenshots();
+
+	delete screenshotWorker;
+
+	// Nothing is left to deliver the screenshots to.
+	for (const CompletedScreenshot &screenshot : completedScreenshots)
+	{
+		for (const ScreenshotInfo &info : screenshot.callbacks)
+			info.callback(&info, nullptr, nullptr);
+	}
+
+	for (const ScreenshotInfo &info : pendingScreenshots)
+		info.callback(&info, nullptr, nullptr);
 }
 
 const char *Graphics::getName() const
@@ -223,6 +288,8 @@ void Graphics::setViewportSize(int width, int height)
 	if (!isCreated())
 		return;
 
+	gl.flushBatchedDraws();
+
 	// We want to affect the main screen, not any Canvas that's currently active
 	// (not that any *should* be active when this is called.)
 	std::vector<StrongRef<Canvas>> canvases = states.back().canvases;
@@ -236,7 +303,7 @@ void Graphics::setViewportSize(int width, int height)
 	Canvas::systemViewport = gl.getViewport();
 
 	// Set up the projection matrix
-	gl.matrices.projection.back() = Matrix4::ortho(0.0, (float) width, (float) height, 0.0);
+	gl.setProjection(Matrix4::ortho(0.0, (float) width, (float) height, 0.0));
 
 	// Restore the previously active Canvas.
 	setCanvas(canvases);
@@ -332,6 +399,13 @@ bool Graphics::setMode(int width, int height)
 		Shader::defaultVideoShader = newShader(Shader::defaultVideoCode[renderer][gammacorrect]);
 	}
 
+	// ParticleSystems can expand their quads on the GPU when instancing works.
+	if (!Shader::defaultParticleShader && gl.isInstancingSupported())
+	{
+		Renderer renderer = GLAD_ES_VERSION_2_0 ? RENDERER_OPENGLES : RENDERER_OPENGL;
+		Shader::defaultParticleShader = newShader(Shader::defaultParticleCode[renderer][gammacorrect]);
+	}
+
 	// A shader should always be active, but the default shader shouldn't be
 	// returned by getShader(), so we don't do setShader(defaultShader).
 	if (!Shader::current)
@@ -345,6 +419,10 @@ void Graphics::unSetMode()
 	if (!isCreated())
 		return;
 
+	gl.flushBatchedDraws();
+
+	finishScreenshots();
+
 	// Unload all volatile objects. These must be reloaded after the display
 	// mode change.
 	Volatile::unloadAll();
@@ -444,6 +522,8 @@ void Graphics::clear(Colorf c)
 
 	gammaCorrectColor(nc);
 
+	gl.flushBatchedDraws();
+
 	glClearColor(nc.r, nc.g, nc.b, nc.a);
 	glClear(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -478,6 +558,8 @@ void Graphics::clear(const std::vector<OptionalColorf> &colors)
 		return;
 	}
 
+	gl.flushBatchedDraws();
+
 	bool drawbuffermodified = false;
 
 	for (int i = 0; i < (int) colors.size(); i++)
@@ -539,6 +621,8 @@ void Graphics::discard(const std::vector<bool> &colorbuffers, bool stencil)
 	if (!(GLAD_VERSION_4_3 || GLAD_ARB_invalidate_subdata || GLAD_ES_VERSION_3_0 || GLAD_EXT_discard_framebuffer))
 		return;
 
+	gl.flushBatchedDraws();
+
 	std::vector<GLenum> attachments;
 	attachments.reserve(colorbuffers.size());
 
@@ -580,15 +664,20 @@ void Graphics::discard(const std::vector<bool> &colorbuffers, bool stencil)
 		glDiscardFramebufferEXT(GL_FRAMEBUFFER, (GLint) attachments.size(), &attachments[0]);
 }
 
-void Graphics::present()
+void Graphics::present(void *screenshotCallbackData)
 {
 	if (!isActive())
 		return;
 
+	// Submit any batched geometry which hasn't been drawn yet.
+	gl.flushBatchedDraws();
+
 	// Make sure we don't have a canvas active.
 	std::vector<StrongRef<Canvas>> canvases = states.back().canvases;
 	setCanvas();
 
+	readPendingScreenshots();
+
 	// Discard the stencil buffer before swapping.
 	discard({}, true);
 
@@ -600,9 +689,16 @@ void Graphics::present()
 	glBindRenderbuffer(GL_RENDERBUFFER, info.info.uikit.colorbuffer);
 #endif
 
+	gl.profiler.pushScope("Swap buffers");
+
 	if (currentWindow.get())
 		currentWindow->swapBuffers();
 
+	gl.profiler.popScope();
+	gl.profiler.nextFrame();
+
+	updateScreenshotReadbacks(false);
+
 	// Restore the currently active canvas, if there is one.
 	setCanvas(canvases);
 
@@ -610,6 +706,15 @@ void Graphics::present()
 	gl.stats.drawCalls = 0;
 	gl.stats.framebufferBinds = 0;
 	gl.stats.shaderSwitches = 0;
+	gl.stats.bytesStreamed = 0;
+	gl.stats.bufferUploadBytes = 0;
+	gl.stats.bufferUploadRanges = 0;
+	gl.stats.redundantCallsAvoided = 0;
+	gl.stats.textLayoutHits = 0;
+	gl.stats.textLayoutMisses = 0;
+	gl.stats.skippedUniformUploads = 0;
+
+	dispatchScreenshots(screenshotCallbackData);
 }
 
 int Graphics::getWidth() const
@@ -631,6 +736,8 @@ void Graphics::setScissor(int x, int y, int width, int height)
 {
 	ScissorRect rect = {x, y, width, height};
 
+	gl.flushBatchedDraws();
+
 	glEnable(GL_SCISSOR_TEST);
 	// OpenGL's reversed y-coordinate is compensated for in OpenGL::setScissor.
 	gl.setScissor({rect.x, rect.y, rect.w, rect.h});
@@ -662,6 +769,8 @@ void Graphics::intersectScissor(int x, int y, int width, int height)
 
 void Graphics::setScissor()
 {
+	gl.flushBatchedDraws();
+
 	states.back().scissor = false;
 	glDisable(GL_SCISSOR_TEST);
 }
@@ -680,6 +789,8 @@ bool Graphics::getScissor(int &x, int &y, int &width, int &height) const
 
 void Graphics::drawToStencilBuffer(StencilAction action, int value)
 {
+	gl.flushBatchedDraws();
+
 	writingToStencil = true;
 
 	// Make sure the active canvas has a stencil buffer.
@@ -687,7 +798,7 @@ void Graphics::drawToStencilBuffer(StencilAction action, int value)
 		Canvas::current->checkCreateStencil();
 
 	// Disable color writes but don't save the state for it.
-	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	gl.setColorMask(false, false, false, false);
 
 	GLenum glaction = GL_REPLACE;
 
@@ -715,9 +826,7 @@ void Graphics::drawToStencilBuffer(StencilAction action, int value)
 	}
 
 	// The stencil test must be enabled in order to write to the stencil buffer.
-	glEnable(GL_STENCIL_TEST);
-	glStencilFunc(GL_ALWAYS, value, 0xFFFFFFFF);
-	glStencilOp(GL_KEEP, GL_KEEP, glaction);
+	gl.setStencilState({true, GL_ALWAYS, value, glaction});
 }
 
 void Graphics::stopDrawToStencilBuffer()
@@ -725,6 +834,8 @@ void Graphics::stopDrawToStencilBuffer()
 	if (!writingToStencil)
 		return;
 
+	gl.flushBatchedDraws();
+
 	writingToStencil = false;
 
 	const DisplayState &state = states.back();
@@ -745,9 +856,11 @@ void Graphics::setStencilTest(CompareMode compare, int value)
 	if (writingToStencil)
 		return;
 
+	gl.flushBatchedDraws();
+
 	if (compare == COMPARE_ALWAYS)
 	{
-		glDisable(GL_STENCIL_TEST);
+		gl.setStencilState({false, GL_ALWAYS, 0, GL_KEEP});
 		return;
 	}
 
@@ -795,9 +908,7 @@ void Graphics::setStencilTest(CompareMode compare, int value)
 		break;
 	}
 
-	glEnable(GL_STENCIL_TEST);
-	glStencilFunc(glcompare, value, 0xFFFFFFFF);
-	glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+	gl.setStencilState({true, glcompare, value, GL_KEEP});
 }
 
 void Graphics::setStencilTest()
@@ -814,6 +925,7 @@ void Graphics::getStencilTest(CompareMode &compare, int &value)
 
 void Graphics::clearStencil()
 {
+	gl.flushBatchedDraws();
 	glClear(GL_STENCIL_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
 
@@ -847,6 +959,43 @@ ParticleSystem *Graphics::newParticleSystem(Texture *texture, int size)
 	return new ParticleSystem(texture, size);
 }
 
+void Graphics::updateParticleSystems(const std::vector<ParticleSystem *> &systems, float dt)
+{
+	// A system listed more than once must still be updated serially, so group
+	// the duplicates together and give each unique system a single task.
+	std::vector<ParticleSystem *> sorted(systems);
+	std::sort(sorted.begin(), sorted.end());
+
+	std::vector<std::pair<ParticleSystem *, int>> tasks;
+	for (ParticleSystem *p : sorted)
+	{
+		if (!tasks.empty() && tasks.back().first == p)
+			tasks.back().second++;
+		else
+			tasks.push_back(std::make_pair(p, 1));
+	}
+
+	if (tasks.size() > 1 && particleWorkers == nullptr)
+	{
+		int threads = std::max(SDL_GetCPUCount() - 1, 0);
+		particleWorkers = new love::thread::WorkerPool("ParticleWorker", threads);
+	}
+
+	auto update = [&](int i)
+	{
+		for (int j = 0; j < tasks[i].second; j++)
+			tasks[i].first->update(dt);
+	};
+
+	if (particleWorkers != nullptr)
+		particleWorkers->run((int) tasks.size(), update);
+	else
+	{
+		for (int i = 0; i < (int) tasks.size(); i++)
+			update(i);
+	}
+}
+
 Canvas *Graphics::newCanvas(int width, int height, Canvas::Format format, int msaa)
 {
 	if (!Canvas::isSupported())
@@ -957,6 +1106,11 @@ void Graphics::setColor(Colorf c)
 
 	gammaCorrectColor(nc);
 
+	// Batched geometry uses the constant color, so pending draws have to be
+	// submitted before it changes.
+	if (c != states.back().color)
+		gl.flushBatchedDraws();
+
 	glVertexAttrib4f(ATTRIB_CONSTANTCOLOR, nc.r, nc.g, nc.b, nc.a);
 	states.back().color = c;
 }
@@ -1025,6 +1179,8 @@ void Graphics::setCanvas(Canvas *canvas)
 
 	DisplayState &state = states.back();
 
+	gl.flushBatchedDraws();
+
 	canvas->startGrab();
 
 	std::vector<StrongRef<Canvas>> canvasref;
@@ -1042,6 +1198,8 @@ void Graphics::setCanvas(const std::vector<Canvas *> &canvases)
 
 	DisplayState &state = states.back();
 
+	gl.flushBatchedDraws();
+
 	auto attachments = std::vector<Canvas *>(canvases.begin() + 1, canvases.end());
 	canvases[0]->startGrab(attachments);
 
@@ -1069,6 +1227,8 @@ void Graphics::setCanvas()
 {
 	DisplayState &state = states.back();
 
+	gl.flushBatchedDraws();
+
 	if (Canvas::current != nullptr)
 		Canvas::current->stopGrab();
 
@@ -1088,7 +1248,9 @@ std::vector<Canvas *> Graphics::getCanvas() const
 
 void Graphics::setColorMask(ColorMask mask)
 {
-	glColorMask(mask.r, mask.g, mask.b, mask.a);
+	gl.flushBatchedDraws();
+
+	gl.setColorMask(mask.r, mask.g, mask.b, mask.a);
 	states.back().colorMask = mask;
 }
 
@@ -1165,8 +1327,10 @@ void Graphics::setBlendMode(BlendMode mode, BlendAlpha alphamode)
 	if (srcRGB == GL_ONE && alphamode == BLENDALPHA_MULTIPLY)
 		srcRGB = GL_SRC_ALPHA;
 
-	glBlendEquation(func);
-	glBlendFuncSeparate(srcRGB, dstRGB, srcA, dstA);
+	if (mode != states.back().blendMode || alphamode != states.back().blendAlphaMode)
+		gl.flushBatchedDraws();
+
+	gl.setBlendState({func, srcRGB, srcA, dstRGB, dstA});
 
 	states.back().blendMode = mode;
 	states.back().blendAlphaMode = alphamode;
@@ -1251,6 +1415,8 @@ void Graphics::setWireframe(bool enable)
 	if (GLAD_ES_VERSION_2_0)
 		return;
 
+	gl.flushBatchedDraws();
+
 	glPolygonMode(GL_FRONT_AND_BACK, enable ? GL_LINE : GL_FILL);
 	states.back().wireframe = enable;
 }
@@ -1288,18 +1454,36 @@ void Graphics::points(const float *coords, const uint8 *colors, size_t numpoints
 {
 	OpenGL::TempDebugGroup debuggroup("Graphics points draw");
 
+	gl.flushBatchedDraws();
+
+	StreamBuffer *buffer = gl.getVertexStreamBuffer();
+
+	size_t coordsize = numpoints * sizeof(float) * 2;
+	size_t colorsize = colors ? numpoints * sizeof(uint8) * 4 : 0;
+
+	char *data = (char *) buffer->map(coordsize + colorsize);
+
+	memcpy(data, coords, coordsize);
+
+	if (colors)
+		memcpy(data + coordsize, colors, colorsize);
+
+	size_t offset = buffer->unmap(coordsize + colorsize);
+
 	gl.prepareDraw();
 	gl.bindTexture(gl.getDefaultTexture());
 
 	uint32 attribflags = ATTRIBFLAG_POS;
-	glVertexAttribPointer(ATTRIB_POS, 2, GL_FLOAT, GL_FALSE, 0, coords);
+	gl.setVertexAttribPointer(ATTRIB_POS, 2, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(offset));
 
 	if (colors)
 	{
 		attribflags |= ATTRIBFLAG_COLOR;
-		glVertexAttribPointer(ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, 0, colors);
+		gl.setVertexAttribPointer(ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, 0, BUFFER_OFFSET(offset + coordsize));
 	}
 
+	buffer->unbind();
+
 	gl.useVertexAttribArrays(attribflags);
 	gl.drawArrays(GL_POINTS, 0, numpoints);
 }
@@ -1351,49 +1535,35 @@ void Graphics::rectangle(DrawMode mode, float x, float y, float w, float h, floa
 
 	points = std::max(points, 1);
 
-	const float half_pi = static_cast<float>(LOVE_M_PI / 2);
-	float angle_shift = half_pi / ((float) points + 1.0f);
+	// Each corner is a quarter of a circle with (points + 1) segments, starting
+	// at the top left and going clockwise around the rectangle.
+	int segments = points + 1;
+	const Vector *unit = getUnitCircle(4 * segments);
 
-	int num_coords = (points + 2) * 8;
-	float *coords = new float[num_coords + 2];
-	float phi = .0f;
+	const float cx[] = {x + rx, x + w - rx, x + w - rx, x + rx};
+	const float cy[] = {y + ry, y + ry, y + h - ry, y + h - ry};
 
-	for (int i = 0; i <= points + 2; ++i, phi += angle_shift)
-	{
-		coords[2 * i + 0] = x + rx * (1 - cosf(phi));
-		coords[2 * i + 1] = y + ry * (1 - sinf(phi));
-	}
+	int vertexcount = 4 * (segments + 1);
 
-	phi = half_pi;
-
-	for (int i = points + 2; i <= 2 * (points + 2); ++i, phi += angle_shift)
+	Vertex *verts = mode == DRAW_FILL ? requestFilledShape(vertexcount) : nullptr;
+	if (verts != nullptr)
 	{
-		coords[2 * i + 0] = x + w - rx * (1 + cosf(phi));
-		coords[2 * i + 1] = y + ry * (1 - sinf(phi));
-	}
+		for (int i = 0; i < 4; i++)
+			scaleUnitCircle(verts + i * (segments + 1), unit + i * segments, segments + 1, cx[i], cy[i], -rx, -ry);
 
-	phi = 2 * half_pi;
-
-	for (int i = 2 * (points + 2); i <= 3 * (points + 2); ++i, phi += angle_shift)
-	{
-		coords[2 * i + 0] = x + w - rx * (1 + cosf(phi));
-		coords[2 * i + 1] = y + h - ry * (1 + sinf(phi));
+		if (gl.isBatchedDrawPreTransformed())
+			gl.getCurrentTransform().transform(verts, verts, vertexcount);
+		return;
 	}
 
-	phi =  3 * half_pi;
+	Vector *coords = getShapeScratch(vertexcount + 1);
 
-	for (int i = 3 * (points + 2); i <= 4 * (points + 2); ++i, phi += angle_shift)
-	{
-		coords[2 * i + 0] = x + rx * (1 - cosf(phi));
-		coords[2 * i + 1] = y + h - ry * (1 + sinf(phi));
-	}
+	for (int i = 0; i < 4; i++)
+		scaleUnitCircle(coords + i * (segments + 1), unit + i * segments, segments + 1, cx[i], cy[i], -rx, -ry);
 
-	coords[num_coords + 0] = coords[0];
-	coords[num_coords + 1] = coords[1];
+	coords[vertexcount] = coords[0];
 
-	polygon(mode, coords, num_coords + 2);
-
-	delete[] coords;
+	polygon(mode, (const float *) coords, (vertexcount + 1) * 2);
 }
 
 void Graphics::circle(DrawMode mode, float x, float y, float radius, int points)
@@ -1403,24 +1573,23 @@ void Graphics::circle(DrawMode mode, float x, float y, float radius, int points)
 
 void Graphics::ellipse(DrawMode mode, float x, float y, float a, float b, int points)
 {
-	float two_pi = static_cast<float>(LOVE_M_PI * 2);
 	if (points <= 0) points = 1;
-	float angle_shift = (two_pi / points);
-	float phi = .0f;
 
-	float *coords = new float[2 * (points + 1)];
-	for (int i = 0; i < points; ++i, phi += angle_shift)
+	const Vector *unit = getUnitCircle(points);
+
+	Vertex *verts = mode == DRAW_FILL ? requestFilledShape(points) : nullptr;
+	if (verts != nullptr)
 	{
-		coords[2*i+0] = x + a * cosf(phi);
-		coords[2*i+1] = y + b * sinf(phi);
+		scaleUnitCircle(verts, unit, points, x, y, a, b);
+		if (gl.isBatchedDrawPreTransformed())
+			gl.getCurrentTransform().transform(verts, verts, points);
+		return;
 	}
 
-	coords[2*points+0] = coords[0];
-	coords[2*points+1] = coords[1];
+	Vector *coords = getShapeScratch(points + 1);
+	scaleUnitCircle(coords, unit, points + 1, x, y, a, b);
 
-	polygon(mode, coords, (points + 1) * 2);
-
-	delete[] coords;
+	polygon(mode, (const float *) coords, (points + 1) * 2);
 }
 
 void Graphics::arc(DrawMode drawmode, ArcMode arcmode, float x, float y, float radius, float angle1, float angle2, int points)
@@ -1452,53 +1621,63 @@ void Graphics::arc(DrawMode drawmode, ArcMode arcmode, float x, float y, float r
 	if (drawmode == DRAW_FILL && arcmode == ARC_OPEN)
 		arcmode = ARC_CLOSED;
 
-	float phi = angle1;
-
-	float *coords = nullptr;
-	int num_coords = 0;
-
-	const auto createPoints = [&](float *coordinates)
+	// Filled arcs are triangle fans which don't need their closing vertex.
+	if (drawmode == DRAW_FILL)
 	{
-		for (int i = 0; i <= points; ++i, phi += angle_shift)
+		int vertexcount = points + 1;
+		if (arcmode == ARC_PIE)
+			vertexcount++;
+
+		Vertex *verts = requestFilledShape(vertexcount);
+		if (verts != nullptr)
 		{
-			coordinates[2 * i + 0] = x + radius * cosf(phi);
-			coordinates[2 * i + 1] = y + radius * sinf(phi);
+			if (arcmode == ARC_PIE)
+			{
+				verts[0].x = x;
+				verts[0].y = y;
+				rotateArc(verts + 1, points + 1, x, y, radius, angle1, angle_shift);
+			}
+			else
+				rotateArc(verts, points + 1, x, y, radius, angle1, angle_shift);
+
+			if (gl.isBatchedDrawPreTransformed())
+				gl.getCurrentTransform().transform(verts, verts, vertexcount);
+			return;
 		}
-	};
+	}
+
+	Vector *coords = nullptr;
+	int num_coords = 0;
 
 	if (arcmode == ARC_PIE)
 	{
 		num_coords = (points + 3) * 2;
-		coords = new float[num_coords];
+		coords = getShapeScratch(points + 3);
 
-		coords[0] = coords[num_coords - 2] = x;
-		coords[1] = coords[num_coords - 1] = y;
+		coords[0] = coords[points + 2] = Vector(x, y);
 
-		createPoints(coords + 2);
+		rotateArc(coords + 1, points + 1, x, y, radius, angle1, angle_shift);
 	}
 	else if (arcmode == ARC_OPEN)
 	{
 		num_coords = (points + 1) * 2;
-		coords = new float[num_coords];
+		coords = getShapeScratch(points + 1);
 
-		createPoints(coords);
+		rotateArc(coords, points + 1, x, y, radius, angle1, angle_shift);
 	}
 	else // ARC_CLOSED
 	{
 		num_coords = (points + 2) * 2;
-		coords = new float[num_coords];
+		coords = getShapeScratch(points + 2);
 
-		createPoints(coords);
+		rotateArc(coords, points + 1, x, y, radius, angle1, angle_shift);
 
 		// Connect the ends of the arc.
-		coords[num_coords - 2] = coords[0];
-		coords[num_coords - 1] = coords[1];
+		coords[points + 1] = coords[0];
 	}
 
 	// NOTE: We rely on polygon() using GL_TRIANGLE_FAN, when fill mode is used.
-	polygon(drawmode, coords, num_coords);
-
-	delete[] coords;
+	polygon(drawmode, (const float *) coords, num_coords);
 }
 
 /// @param mode    the draw mode
@@ -1516,43 +1695,112 @@ void Graphics::polygon(DrawMode mode, const float *coords, size_t count)
 	{
 		OpenGL::TempDebugGroup debuggroup("Filled polygon draw");
 
+		int vertexcount = (int) count / 2 - 1; // opengl will close the polygon for us
+
+		Vertex *verts = requestFilledShape(vertexcount);
+
+		if (verts != nullptr)
+		{
+			for (int i = 0; i < vertexcount; i++)
+			{
+				verts[i].x = coords[i * 2 + 0];
+				verts[i].y = coords[i * 2 + 1];
+			}
+
+			if (gl.isBatchedDrawPreTransformed())
+				gl.getCurrentTransform().transform(verts, verts, vertexcount);
+			return;
+		}
+
+		// The polygon has too few or too many vertices to be batched.
+		gl.flushBatchedDraws();
+
 		gl.prepareDraw();
 		gl.bindTexture(gl.getDefaultTexture());
 		gl.useVertexAttribArrays(ATTRIBFLAG_POS);
-		glVertexAttribPointer(ATTRIB_POS, 2, GL_FLOAT, GL_FALSE, 0, coords);
-		gl.drawArrays(GL_TRIANGLE_FAN, 0, (int)count/2-1); // opengl will close the polygon for us
+		gl.setVertexAttribPointer(ATTRIB_POS, 2, GL_FLOAT, GL_FALSE, 0, coords);
+		gl.drawArrays(GL_TRIANGLE_FAN, 0, vertexcount);
 	}
 }
 
-love::image::ImageData *Graphics::newScreenshot(love::image::Image *image, bool copyAlpha)
+Vertex *Graphics::requestFilledShape(int vertexcount)
 {
-	// Temporarily unbind the currently active canvas (glReadPixels reads the
-	// active framebuffer, not the main one.)
-	std::vector<StrongRef<Canvas>> canvases = states.back().canvases;
-	setCanvas();
+	Vertex *verts = gl.requestBatchedDraw(OpenGL::BATCH_TRIANGLE_FAN, vertexcount, gl.getDefaultTexture());
 
-	int w = getWidth();
-	int h = getHeight();
+	if (verts != nullptr)
+	{
+		for (int i = 0; i < vertexcount; i++)
+		{
+			verts[i].s = verts[i].t = 0.0f;
+			verts[i].r = verts[i].g = verts[i].b = verts[i].a = 255;
+		}
+	}
 
-	int row = 4 * w;
-	int size = row * h;
+	return verts;
+}
 
-	GLubyte *pixels = nullptr;
-	GLubyte *screenshot = nullptr;
+const Vector *Graphics::getUnitCircle(int points)
+{
+	auto it = unitCircles.find(points);
+	if (it != unitCircles.end())
+		return it->second.data();
 
-	try
+	std::vector<Vector> *circle = &uncachedUnitCircle;
+
+	if (points <= MAX_UNIT_CIRCLE_POINTS)
 	{
-		pixels = new GLubyte[size];
-		screenshot = new GLubyte[size];
+		// Automatic segment counts make a table for every size of circle drawn,
+		// so forget them all every once in a while rather than keeping track of
+		// which were used last.
+		if (unitCircles.size() >= MAX_UNIT_CIRCLES)
+			unitCircles.clear();
+
+		circle = &unitCircles[points];
 	}
-	catch (std::exception &)
+
+	circle->resize(points + 1);
+
+	for (int i = 0; i < points; i++)
 	{
-		delete[] pixels;
-		delete[] screenshot;
-		setCanvas(canvases);
-		throw love::Exception("Out of memory.");
+		double phi = (LOVE_M_PI * 2.0 * i) / points;
+		(*circle)[i] = Vector((float) cos(phi), (float) sin(phi));
 	}
 
+	(*circle)[points] = (*circle)[0];
+
+	return circle->data();
+}
+
+Vector *Graphics::getShapeScratch(size_t count)
+{
+	if (shapeScratch.size() < count)
+		shapeScratch.resize(count);
+	return shapeScratch.data();
+}
+
+void Graphics::setAutoSegmentsEnabled(bool enable)
+{
+	autoSegments = enable;
+}
+
+bool Graphics::isAutoSegmentsEnabled() const
+{
+	return autoSegments;
+}
+
+int Graphics::calculateEllipsePoints(float rx, float ry) const
+{
+	// A circle of radius r drawn with n segments strays at most about
+	// r * pi^2 / (2 * n^2) from the true circle, so n = sqrt(20 * r) keeps that
+	// at a quarter of a pixel for any on-screen radius r. Rounding up to a
+	// multiple of 4 lets similarly sized shapes share unit circles.
+	float radius = (fabsf(rx) + fabsf(ry)) / 2.0f / (float) pixelSizeStack.back();
+	int points = (int) ceilf(sqrtf(radius * 20.0f) / 4.0f) * 4;
+	return std::max(points, 8);
+}
+
+void Graphics::readScreenPixels(int w, int h, void *dst)
+{
 #ifdef LOVE_IOS
 	SDL_SysWMinfo info = {};
 	SDL_VERSION(&info.version);
@@ -1573,13 +1821,45 @@ love::image::ImageData *Graphics::newScreenshot(love::image::Image *image, bool
 	}
 #endif
 
-	glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, dst);
 
 #ifdef LOVE_IOS
 	// Restore the previous binding for the main framebuffer.
 	if (info.info.uikit.resolveFramebuffer != 0)
 		glBindFramebuffer(GL_FRAMEBUFFER, gl.getDefaultFBO());
 #endif
+}
+
+love::image::ImageData *Graphics::newScreenshot(love::image::Image *image, bool copyAlpha)
+{
+	// Temporarily unbind the currently active canvas (glReadPixels reads the
+	// active framebuffer, not the main one.)
+	std::vector<StrongRef<Canvas>> canvases = states.back().canvases;
+	setCanvas();
+
+	int w = getWidth();
+	int h = getHeight();
+
+	int row = 4 * w;
+	int size = row * h;
+
+	GLubyte *pixels = nullptr;
+	GLubyte *screenshot = nullptr;
+
+	try
+	{
+		pixels = new GLubyte[size];
+		screenshot = new GLubyte[size];
+	}
+	catch (std::exception &)
+	{
+		delete[] pixels;
+		delete[] screenshot;
+		setCanvas(canvases);
+		throw love::Exception("Out of memory.");
+	}
+
+	readScreenPixels(w, h, pixels);
 
 	if (!copyAlpha)
 	{
@@ -1617,6 +1897,223 @@ love::image::ImageData *Graphics::newScreenshot(love::image::Image *image, bool
 	return img;
 }
 
+void Graphics::captureScreenshot(const ScreenshotInfo &info)
+{
+	if (Module::getInstance<love::image::Image>(M_IMAGE) == nullptr)
+		throw love::Exception("love.image must be loaded in order to capture screenshots.");
+
+	pendingScreenshots.push_back(info);
+}
+
+void Graphics::readPendingScreenshots()
+{
+	if (pendingScreenshots.empty())
+		return;
+
+	int w = getWidth();
+	int h = getHeight();
+	size_t size = (size_t) w * (size_t) h * 4;
+
+	bool pixelbuffers = GLAD_VERSION_2_1 || GLAD_ARB_pixel_buffer_object || GLAD_ES_VERSION_3_0;
+
+	if (pixelbuffers && (!freeScreenshotBuffers.empty() || screenshotBufferCount < MAX_SCREENSHOT_BUFFERS))
+	{
+		GLuint buffer = 0;
+
+		if (!freeScreenshotBuffers.empty())
+		{
+			buffer = freeScreenshotBuffers.back();
+			freeScreenshotBuffers.pop_back();
+		}
+		else
+		{
+			glGenBuffers(1, &buffer);
+			screenshotBufferCount++;
+		}
+
+		// glReadPixels into a bound pixel pack buffer returns without waiting
+		// for the GPU to finish rendering.
+		gl.bindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr) size, nullptr, GL_STREAM_READ);
+		readScreenPixels(w, h, BUFFER_OFFSET(0));
+		gl.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		ScreenshotReadback readback;
+		readback.buffer = buffer;
+		readback.width = w;
+		readback.height = h;
+		readback.age = 0;
+		readback.callbacks.swap(pendingScreenshots);
+
+		screenshotReadbacks.push_back(std::move(readback));
+	}
+	else
+	{
+		// Without a free pixel buffer object the read has to be synchronous,
+		// but the rest of the work still happens on the worker.
+		GLubyte *pixels = nullptr;
+
+		try
+		{
+			pixels = new GLubyte[size];
+		}
+		catch (std::exception &)
+		{
+			for (const ScreenshotInfo &info : pendingScreenshots)
+				info.callback(&info, nullptr, nullptr);
+			pendingScreenshots.clear();
+			throw love::Exception("Out of memory.");
+		}
+
+		readScreenPixels(w, h, pixels);
+		decodeScreenshot(pixels, w, h, 0, pendingScreenshots);
+	}
+
+	pendingScreenshots.clear();
+}
+
+void Graphics::updateScreenshotReadbacks(bool finishall)
+{
+	for (ScreenshotReadback &readback : screenshotReadbacks)
+		readback.age++;
+
+	// Readbacks are in order of age, so only the front ones can be ready.
+	while (!screenshotReadbacks.empty())
+	{
+		ScreenshotReadback &readback = screenshotReadbacks.front();
+
+		if (!finishall && readback.age < SCREENSHOT_READBACK_DELAY)
+			break;
+
+		GLsizeiptr size = (GLsizeiptr) readback.width * readback.height * 4;
+
+		// This only waits if the GPU still hasn't finished the frame.
+		gl.bindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+
+		void *pixels = nullptr;
+		if (GLAD_VERSION_3_0 || GLAD_ARB_map_buffer_range || GLAD_ES_VERSION_3_0)
+			pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+		else
+			pixels = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+
+		gl.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		if (pixels != nullptr)
+		{
+			// The buffer stays mapped while the worker copies out of it.
+			decodeScreenshot((const uint8 *) pixels, readback.width, readback.height, readback.buffer, readback.callbacks);
+		}
+		else
+		{
+			freeScreenshotBuffers.push_back(readback.buffer);
+			completedScreenshots.push_back({nullptr, std::move(readback.callbacks)});
+			screenshotError = "Could not map the screenshot pixel buffer.";
+		}
+
+		screenshotReadbacks.pop_front();
+	}
+
+	if (screenshotWorker != nullptr)
+		screenshotWorker->poll();
+}
+
+void Graphics::decodeScreenshot(const uint8 *pixels, int w, int h, GLuint buffer, std::vector<ScreenshotInfo> &callbacks)
+{
+	if (screenshotWorker == nullptr)
+		screenshotWorker = new love::thread::TaskQueue("love.graphics screenshots");
+
+	love::image::Image *imagemodule = Module::getInstance<love::image::Image>(M_IMAGE);
+
+	// std::function needs copyable captures.
+	auto result = std::make_shared<CompletedScreenshot>();
+	result->callbacks.swap(callbacks);
+
+	screenshotWorker->push([=]()
+	{
+		size_t row = (size_t) w * 4;
+		size_t size = row * h;
+
+		GLubyte *screenshot = new GLubyte[size];
+
+		// OpenGL reads pixels from the lower-left, so the rows are flipped
+		// while copying them out.
+		for (int y = 0; y < h; y++)
+			memcpy(screenshot + y * row, pixels + (h - y - 1) * row, row);
+
+		// Replace alpha values with full opacity.
+		for (size_t i = 3; i < size; i += 4)
+			screenshot[i] = 255;
+
+		try
+		{
+			// The ImageData takes ownership of the pixels.
+			result->imageData.set(imagemodule->newImageData(w, h, screenshot, true), Acquire::NORETAIN);
+		}
+		catch (love::Exception &)
+		{
+			delete[] screenshot;
+			throw;
+		}
+	},
+	[=](const std::string &err)
+	{
+		if (buffer != 0)
+		{
+			gl.bindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			gl.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+			freeScreenshotBuffers.push_back(buffer);
+		}
+		else
+			delete[] pixels;
+
+		if (!err.empty())
+			screenshotError = err;
+
+		completedScreenshots.push_back(std::move(*result));
+	});
+}
+
+void Graphics::dispatchScreenshots(void *ud)
+{
+	std::vector<CompletedScreenshot> completed;
+	completed.swap(completedScreenshots);
+
+	for (const CompletedScreenshot &screenshot : completed)
+	{
+		for (const ScreenshotInfo &info : screenshot.callbacks)
+			info.callback(&info, screenshot.imageData.get(), ud);
+	}
+
+	if (!screenshotError.empty())
+	{
+		std::string err = screenshotError;
+		screenshotError.clear();
+		throw love::Exception("Could not capture screenshot: %s", err.c_str());
+	}
+}
+
+void Graphics::finishScreenshots()
+{
+	// The pixel buffer objects belong to the context, so their contents have
+	// to be read before it's destroyed. The results are delivered by the next
+	// present.
+	updateScreenshotReadbacks(true);
+
+	if (screenshotWorker != nullptr)
+	{
+		screenshotWorker->wait();
+		screenshotWorker->poll();
+	}
+
+	for (GLuint buffer : freeScreenshotBuffers)
+		gl.deleteBuffer(buffer);
+
+	freeScreenshotBuffers.clear();
+	screenshotBufferCount = 0;
+}
+
 Graphics::RendererInfo Graphics::getRendererInfo() const
 {
 	RendererInfo info;
@@ -1651,6 +2148,9 @@ Graphics::Stats Graphics::getStats() const
 {
 	Stats stats;
 
+	// Make sure the draw call count includes pending batched draws.
+	gl.flushBatchedDraws();
+
 	stats.drawCalls = gl.stats.drawCalls;
 	stats.canvasSwitches = gl.stats.framebufferBinds;
 	stats.shaderSwitches = gl.stats.shaderSwitches;
@@ -1658,10 +2158,60 @@ Graphics::Stats Graphics::getStats() const
 	stats.images = Image::imageCount;
 	stats.fonts = Font::fontCount;
 	stats.textureMemory = gl.stats.textureMemory;
+	stats.bytesStreamed = gl.stats.bytesStreamed;
+	stats.bufferUploadBytes = gl.stats.bufferUploadBytes;
+	stats.bufferUploadRanges = gl.stats.bufferUploadRanges;
+	stats.redundantCallsAvoided = gl.stats.redundantCallsAvoided;
+	stats.textLayoutHits = gl.stats.textLayoutHits;
+	stats.textLayoutMisses = gl.stats.textLayoutMisses;
+	stats.skippedUniformUploads = gl.stats.skippedUniformUploads;
 
 	return stats;
 }
 
+void Graphics::setProfilingEnabled(bool enable)
+{
+	gl.profiler.setEnabled(enable);
+}
+
+bool Graphics::isProfilingEnabled() const
+{
+	return gl.profiler.isEnabled();
+}
+
+void Graphics::pushProfileScope(const std::string &name)
+{
+	if (!gl.profiler.isEnabled())
+		return;
+
+	gl.flushBatchedDraws();
+	gl.profiler.pushScope(gl.profiler.internName(name));
+}
+
+void Graphics::popProfileScope()
+{
+	if (!gl.profiler.isEnabled())
+		return;
+
+	gl.flushBatchedDraws();
+	gl.profiler.popScope();
+}
+
+const Profiler::Frame *Graphics::getProfile() const
+{
+	return gl.profiler.getLastFrame();
+}
+
+void Graphics::saveProfile(const std::string &filename) const
+{
+	auto fs = Module::getInstance<love::filesystem::Filesystem>(M_FILESYSTEM);
+	if (fs == nullptr)
+		throw love::Exception("love.filesystem is required to save the profile.");
+
+	std::string trace = gl.profiler.getChromeTrace();
+	fs->write(filename.c_str(), trace.data(), (int64) trace.size());
+}
+
 double Graphics::getSystemLimit(SystemLimit limittype) const
 {
 	switch (limittype)
@@ -1689,6 +2239,8 @@ bool Graphics::isSupported(Feature feature) const
 		return gl.isClampZeroTextureWrapSupported();
 	case FEATURE_LIGHTEN:
 		return GLAD_VERSION_1_4 || GLAD_ES_VERSION_3_0 || GLAD_EXT_blend_minmax;
+	case FEATURE_UNIFORM_BUFFERS:
+		return Shader::isUniformBufferSupported();
 	default:
 		return false;
 	}
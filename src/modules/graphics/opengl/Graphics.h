@@ -24,6 +24,8 @@
 // STD
 #include <stack>
 #include <vector>
+#include <deque>
+#include <unordered_map>
 
 // OpenGL
 #include "OpenGL.h"
@@ -31,6 +33,7 @@
 // LOVE
 #include "graphics/Graphics.h"
 #include "graphics/Color.h"
+#include "common/Vector.h"
 
 #include "image/Image.h"
 #include "image/ImageData.h"
@@ -39,6 +42,9 @@
 
 #include "video/VideoStream.h"
 
+#include "thread/WorkerPool.h"
+#include "thread/TaskQueue.h"
+
 #include "Font.h"
 #include "Image.h"
 #include "graphics/Quad.h"
@@ -107,10 +113,28 @@ public:
 	 **/
 	void discard(const std::vector<bool> &colorbuffers, bool stencil);
 
+	struct ScreenshotInfo;
+
+	/**
+	 * Receives a captured screenshot. The ImageData is null if the capture was
+	 * discarded, in which case only cleanup should be done. 'ud' is the value
+	 * which was passed to present. Callbacks run while present is still
+	 * delivering other screenshots, so they must not raise Lua errors; Lua
+	 * functions should be queued and called once present has returned.
+	 **/
+	typedef void (*ScreenshotCallback)(const ScreenshotInfo *info, love::image::ImageData *i, void *ud);
+
+	struct ScreenshotInfo
+	{
+		ScreenshotCallback callback;
+		void *data;
+	};
+
 	/**
 	 * Flips buffers. (Rendered geometry is presented on screen).
+	 * Screenshot callbacks whose captures have finished are called from here.
 	 **/
-	void present();
+	void present(void *screenshotCallbackData = nullptr);
 
 	/**
 	 * Gets the width of the current graphics viewport.
@@ -186,6 +210,12 @@ public:
 
 	ParticleSystem *newParticleSystem(Texture *texture, int size);
 
+	/**
+	 * Updates a list of ParticleSystems, spreading them across worker threads.
+	 * The results are identical to calling update on each system in turn.
+	 **/
+	void updateParticleSystems(const std::vector<ParticleSystem *> &systems, float dt);
+
 	Canvas *newCanvas(int width, int height, Canvas::Format format = Canvas::FORMAT_NORMAL, int msaa = 0);
 
 	Shader *newShader(const Shader::ShaderSource &source);
@@ -441,6 +471,21 @@ public:
 	 **/
 	void polygon(DrawMode mode, const float *coords, size_t count);
 
+	/**
+	 * Sets whether circles, ellipses, arcs and rounded rectangles drawn from
+	 * Lua without a segment count choose one from their size on the screen,
+	 * instead of from their radius alone.
+	 **/
+	void setAutoSegmentsEnabled(bool enable);
+	bool isAutoSegmentsEnabled() const;
+
+	/**
+	 * Gets the number of segments which keeps the outline of an ellipse with
+	 * the given radii within a fraction of a pixel of the true curve, at the
+	 * current scale.
+	 **/
+	int calculateEllipsePoints(float rx, float ry) const;
+
 	/**
 	 * Creates a screenshot of the view and saves it to the default folder.
 	 * @param image The love.image module.
@@ -448,6 +493,13 @@ public:
 	 **/
 	love::image::ImageData *newScreenshot(love::image::Image *image, bool copyAlpha = true);
 
+	/**
+	 * Captures the screen when the current frame is presented. The pixels are
+	 * read back asynchronously, and the callback is called with the result by
+	 * a later present, usually two frames later. Alpha is always opaque.
+	 **/
+	void captureScreenshot(const ScreenshotInfo &info);
+
 	/**
 	 * Returns system-dependent renderer information.
 	 * Returned strings can vary greatly between systems! Do not rely on it for
@@ -460,6 +512,27 @@ public:
 	 **/
 	Stats getStats() const;
 
+	/**
+	 * Enables or disables per-frame CPU and GPU timing of named scopes. GPU
+	 * results are read back a few frames after the frame is presented.
+	 **/
+	void setProfilingEnabled(bool enable);
+	bool isProfilingEnabled() const;
+
+	void pushProfileScope(const std::string &name);
+	void popProfileScope();
+
+	/**
+	 * Returns the most recent frame with complete profiling results, or null.
+	 **/
+	const Profiler::Frame *getProfile() const;
+
+	/**
+	 * Writes the recorded frames to a file in the save directory, in the
+	 * Chrome trace event format.
+	 **/
+	void saveProfile(const std::string &filename) const;
+
 	/**
 	 * Gets the system-dependent numeric limit for the specified parameter.
 	 **/
@@ -522,14 +595,70 @@ private:
 
 	void checkSetDefaultFont();
 
+	// Gets points + 1 points on the unit circle, evenly spaced counterclockwise
+	// from (1, 0) and back to it.
+	const Vector *getUnitCircle(int points);
+
+	// Gets the batched vertices for a filled convex shape with the given number
+	// of vertices, with everything but their positions set. Returns null if
+	// the shape can't be batched.
+	Vertex *requestFilledShape(int vertexcount);
+
+	// Scratch memory for the outlines of shapes drawn with polygon().
+	Vector *getShapeScratch(size_t count);
+
+	// A screenshot which has been read into a pixel buffer object, but hasn't
+	// been mapped yet.
+	struct ScreenshotReadback
+	{
+		GLuint buffer;
+		int width;
+		int height;
+		int age;
+		std::vector<ScreenshotInfo> callbacks;
+	};
+
+	struct CompletedScreenshot
+	{
+		StrongRef<love::image::ImageData> imageData;
+		std::vector<ScreenshotInfo> callbacks;
+	};
+
+	void readScreenPixels(int w, int h, void *dst);
+	void readPendingScreenshots();
+	void updateScreenshotReadbacks(bool finishall);
+	void decodeScreenshot(const uint8 *pixels, int w, int h, GLuint buffer, std::vector<ScreenshotInfo> &callbacks);
+	void dispatchScreenshots(void *ud);
+	void finishScreenshots();
+
 	StrongRef<love::window::Window> currentWindow;
 
 	StrongRef<Font> defaultFont;
 
 	std::vector<double> pixelSizeStack; // stores current size of a pixel (needed for line drawing)
 
+	// Unit circles by number of points, so shapes don't need to call sin and
+	// cos for every point.
+	std::unordered_map<int, std::vector<Vector>> unitCircles;
+	std::vector<Vector> uncachedUnitCircle;
+	std::vector<Vector> shapeScratch;
+	bool autoSegments;
+
 	QuadIndices *quadIndices;
 
+	// Created the first time several ParticleSystems are updated at once.
+	love::thread::WorkerPool *particleWorkers;
+
+	std::vector<ScreenshotInfo> pendingScreenshots;
+	std::deque<ScreenshotReadback> screenshotReadbacks;
+	std::vector<CompletedScreenshot> completedScreenshots;
+	std::vector<GLuint> freeScreenshotBuffers;
+	int screenshotBufferCount;
+	std::string screenshotError;
+
+	// Flips and packages screenshots. Created on first use.
+	love::thread::TaskQueue *screenshotWorker;
+
 	int width;
 	int height;
 	bool created;
@@ -542,6 +671,16 @@ private:
 
 	static const size_t MAX_USER_STACK_DEPTH = 64;
 
+	static const size_t MAX_UNIT_CIRCLES = 64;
+	static const int MAX_UNIT_CIRCLE_POINTS = 4096;
+
+	// Pixel buffer objects used for screenshot readbacks at the same time.
+	static const int MAX_SCREENSHOT_BUFFERS = 3;
+
+	// Presents between reading the screen into a pixel buffer object and
+	// mapping it. By then the GPU has almost always finished the copy.
+	static const int SCREENSHOT_READBACK_DELAY = 2;
+
 }; // Graphics
 
 } // opengl
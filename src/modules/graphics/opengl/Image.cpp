@@ -106,7 +106,11 @@ Image::Image(const std::vector<love::image::ImageData *> &imagedata, const Flags
 		this->flags.mipmaps = true;
 
 	for (const auto &id : imagedata)
+	{
 		data.push_back(id);
+		if (id->getFormat() != data[0]->getFormat())
+			throw love::Exception("All image mipmap levels must have the same format.");
+	}
 
 	preload();
 	loadVolatile();
@@ -193,7 +197,11 @@ void Image::preload()
 	if (!isGammaCorrect())
 		flags.linear = false;
 
-	if (isGammaCorrect() && !flags.linear)
+	// Only RGBA8 and compressed data have sRGB variants; the other raw formats
+	// are always treated as linear.
+	bool hasSRGBFormat = isCompressed() || data[0]->getFormat() == image::ImageData::PIXELFORMAT_RGBA8;
+
+	if (isGammaCorrect() && !flags.linear && hasSRGBFormat)
 		sRGB = true;
 	else
 		sRGB = false;
@@ -256,15 +264,15 @@ void Image::loadFromCompressedData()
 
 void Image::loadFromImageData()
 {
-	GLenum iformat = sRGB ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+	GLenum iformat = GL_RGBA8;
 	GLenum format  = GL_RGBA;
+	GLenum type    = GL_UNSIGNED_BYTE;
+
+	convertFormat(data[0]->getFormat(), sRGB, iformat, format, type);
 
 	// in GLES2, the internalformat and format params of TexImage have to match.
 	if (GLAD_ES_VERSION_2_0 && !GLAD_ES_VERSION_3_0)
-	{
-		format  = sRGB ? GL_SRGB_ALPHA : GL_RGBA;
 		iformat = format;
-	}
 
 	int mipcount = flags.mipmaps ? (int) data.size() : 1;
 
@@ -274,7 +282,7 @@ void Image::loadFromImageData()
 		love::thread::Lock lock(id->getMutex());
 
 		glTexImage2D(GL_TEXTURE_2D, i, iformat, id->getWidth(), id->getHeight(),
-		             0, format, GL_UNSIGNED_BYTE, id->getData());
+		             0, format, type, id->getData());
 	}
 
 	if (data.size() <= 1)
@@ -298,6 +306,13 @@ bool Image::loadVolatile()
 	}
 	else if (!isCompressed())
 	{
+		if (!hasPixelFormatSupport(data[0]->getFormat()))
+		{
+			const char *str = "unknown";
+			image::ImageData::getConstant(data[0]->getFormat(), str);
+			throw love::Exception("Cannot create image: %s images are not supported on this system.", str);
+		}
+
 		if (sRGB && !hasSRGBSupport())
 			throw love::Exception("sRGB images are not supported on this system.");
 
@@ -408,6 +423,9 @@ bool Image::refresh(int xoffset, int yoffset, int w, int h)
 
 	OpenGL::TempDebugGroup debuggroup("Image refresh");
 
+	// Pending batched draws must use the old contents of the texture.
+	gl.flushBatchedDraws();
+
 	gl.bindTexture(texture);
 
 	if (isCompressed())
@@ -416,24 +434,25 @@ bool Image::refresh(int xoffset, int yoffset, int w, int h)
 		return true;
 	}
 
-	GLenum format = GL_RGBA;
+	GLenum iformat = GL_RGBA8;
+	GLenum format  = GL_RGBA;
+	GLenum type    = GL_UNSIGNED_BYTE;
 
-	// In ES2, the format parameter of TexSubImage must match the internal
-	// format of the texture.
-	if (sRGB && (GLAD_ES_VERSION_2_0 && !GLAD_ES_VERSION_3_0))
-		format = GL_SRGB_ALPHA;
+	// The format parameter already matches the internal format in ES2.
+	convertFormat(data[0]->getFormat(), sRGB, iformat, format, type);
 
+	size_t pixelsize = image::ImageData::getPixelSize(data[0]->getFormat());
 	int mipcount = flags.mipmaps ? (int) data.size() : 1;
 
 	// Reupload the sub-rectangle of each mip level (if we have custom mipmaps.)
 	for (int i = 0; i < mipcount; i++)
 	{
-		const image::pixel *pdata = (const image::pixel *) data[i]->getData();
-		pdata += yoffset * data[i]->getWidth() + xoffset;
+		const unsigned char *pdata = (const unsigned char *) data[i]->getData();
+		pdata += (yoffset * data[i]->getWidth() + xoffset) * pixelsize;
 
 		thread::Lock lock(data[i]->getMutex());
 		glTexSubImage2D(GL_TEXTURE_2D, i, xoffset, yoffset, w, h, format,
-						GL_UNSIGNED_BYTE, pdata);
+						type, pdata);
 
 		xoffset /= 2;
 		yoffset /= 2;
@@ -451,18 +470,36 @@ void Image::drawv(const Matrix4 &t, const Vertex *v)
 {
 	OpenGL::TempDebugGroup debuggroup("Image draw");
 
-	OpenGL::TempTransform transform(gl);
-	transform.get() *= t;
+	// The quad is transformed here and appended to the current batch, so
+	// consecutive draws of the same Image only need a single draw call, even
+	// when the global transformation changes between them.
+	if (!gl.isBatchedDrawPreTransformed())
+	{
+		// Custom shaders see the same vertex positions and TransformMatrix as
+		// they would for an unbatched draw.
+		OpenGL::TempTransform transform(gl, t);
+		Vertex *verts = gl.requestBatchedDraw(OpenGL::BATCH_QUADS, 4, texture);
 
-	gl.bindTexture(texture);
+		for (int i = 0; i < 4; i++)
+		{
+			verts[i] = v[i];
+			verts[i].r = verts[i].g = verts[i].b = verts[i].a = 255;
+		}
 
-	gl.useVertexAttribArrays(ATTRIBFLAG_POS | ATTRIBFLAG_TEXCOORD);
+		return;
+	}
 
-	glVertexAttribPointer(ATTRIB_POS, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), &v[0].x);
-	glVertexAttribPointer(ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), &v[0].s);
+	Vertex *verts = gl.requestBatchedDraw(OpenGL::BATCH_QUADS, 4, texture);
 
-	gl.prepareDraw();
-	gl.drawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	for (int i = 0; i < 4; i++)
+	{
+		verts[i].s = v[i].s;
+		verts[i].t = v[i].t;
+		verts[i].r = verts[i].g = verts[i].b = verts[i].a = 255;
+	}
+
+	Matrix4 transform = gl.getCurrentTransform().multiplyAffine2D(t);
+	transform.transform(verts, v, 4);
 }
 
 void Image::draw(float x, float y, float angle, float sx, float sy, float ox, float oy, float kx, float ky)
@@ -513,6 +550,8 @@ void Image::setFilter(const Texture::Filter &f)
 		filter.min = filter.mag = FILTER_NEAREST;
 	}
 
+	gl.flushBatchedDraws();
+
 	gl.bindTexture(texture);
 	gl.setTextureFilter(filter);
 }
@@ -540,6 +579,8 @@ bool Image::setWrap(const Texture::Wrap &w)
 			wrap.t = WRAP_CLAMP;
 	}
 
+	gl.flushBatchedDraws();
+
 	gl.bindTexture(texture);
 	gl.setTextureWrap(wrap);
 
@@ -555,6 +596,8 @@ void Image::setMipmapSharpness(float sharpness)
 	// LOD bias has the range (-maxbias, maxbias)
 	mipmapSharpness = std::min(std::max(sharpness, -maxMipmapSharpness + 0.01f), maxMipmapSharpness - 0.01f);
 
+	gl.flushBatchedDraws();
+
 	gl.bindTexture(texture);
 
 	// negative bias is sharper
@@ -696,6 +739,76 @@ GLenum Image::getCompressedFormat(image::CompressedImageData::Format cformat, bo
 	}
 }
 
+void Image::convertFormat(image::ImageData::PixelFormat format, bool sRGB, GLenum &internalformat, GLenum &externalformat, GLenum &type)
+{
+	externalformat = GL_RGBA;
+
+	switch (format)
+	{
+	case image::ImageData::PIXELFORMAT_RGBA8:
+	default:
+		internalformat = sRGB ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+		type = GL_UNSIGNED_BYTE;
+		if (sRGB && GLAD_ES_VERSION_2_0 && !GLAD_ES_VERSION_3_0)
+			externalformat = GL_SRGB_ALPHA;
+		break;
+	case image::ImageData::PIXELFORMAT_R8:
+		internalformat = GL_R8;
+		externalformat = GL_RED;
+		type = GL_UNSIGNED_BYTE;
+		break;
+	case image::ImageData::PIXELFORMAT_RG8:
+		internalformat = GL_RG8;
+		externalformat = GL_RG;
+		type = GL_UNSIGNED_BYTE;
+		break;
+	case image::ImageData::PIXELFORMAT_RGBA16:
+		internalformat = GL_RGBA16;
+		type = GL_UNSIGNED_SHORT;
+		break;
+	case image::ImageData::PIXELFORMAT_RGBA16F:
+		internalformat = GL_RGBA16F;
+		if (GLAD_OES_texture_half_float && !GLAD_ES_VERSION_3_0)
+			type = GL_HALF_FLOAT_OES;
+		else
+			type = GL_HALF_FLOAT;
+		break;
+	case image::ImageData::PIXELFORMAT_RGBA32F:
+		internalformat = GL_RGBA32F;
+		type = GL_FLOAT;
+		break;
+	}
+}
+
+bool Image::hasPixelFormatSupport(image::ImageData::PixelFormat format)
+{
+	switch (format)
+	{
+	case image::ImageData::PIXELFORMAT_RGBA8:
+		return true;
+	case image::ImageData::PIXELFORMAT_R8:
+	case image::ImageData::PIXELFORMAT_RG8:
+		if (GLAD_VERSION_1_0)
+			return GLAD_VERSION_3_0 || GLAD_ARB_texture_rg;
+		else
+			return GLAD_ES_VERSION_3_0 || GLAD_EXT_texture_rg;
+	case image::ImageData::PIXELFORMAT_RGBA16:
+		return GLAD_VERSION_1_0 || GLAD_EXT_texture_norm16;
+	case image::ImageData::PIXELFORMAT_RGBA16F:
+		if (GLAD_VERSION_1_0)
+			return GLAD_VERSION_3_0 || (GLAD_ARB_texture_float && GLAD_ARB_half_float_pixel);
+		else
+			return GLAD_ES_VERSION_3_0 || GLAD_OES_texture_half_float;
+	case image::ImageData::PIXELFORMAT_RGBA32F:
+		if (GLAD_VERSION_1_0)
+			return GLAD_VERSION_3_0 || GLAD_ARB_texture_float;
+		else
+			return GLAD_ES_VERSION_3_0 || GLAD_OES_texture_float;
+	default:
+		return false;
+	}
+}
+
 bool Image::hasAnisotropicFilteringSupport()
 {
 	return GLAD_EXT_texture_filter_anisotropic != GL_FALSE;
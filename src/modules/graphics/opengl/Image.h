@@ -130,6 +130,7 @@ public:
 	static bool hasAnisotropicFilteringSupport();
 	static bool hasCompressedTextureSupport(image::CompressedImageData::Format format, bool sRGB);
 	static bool hasSRGBSupport();
+	static bool hasPixelFormatSupport(image::ImageData::PixelFormat format);
 
 	static bool getConstant(const char *in, FlagType &out);
 	static bool getConstant(FlagType in, const char *&out);
@@ -149,6 +150,8 @@ private:
 
 	GLenum getCompressedFormat(image::CompressedImageData::Format cformat, bool &isSRGB) const;
 
+	static void convertFormat(image::ImageData::PixelFormat format, bool sRGB, GLenum &internalformat, GLenum &externalformat, GLenum &type);
+
 	// The ImageData from which the texture is created. May be empty if
 	// Compressed image data was used to create the texture.
 	// Each element in the array is a mipmap level.
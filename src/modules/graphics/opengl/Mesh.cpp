@@ -565,7 +565,7 @@ int Mesh::bindAttributeToShaderInput(int attributeindex, const std::string &inpu
 	GLenum datatype = getGLDataType(format.type);
 	GLboolean normalized = (datatype == GL_UNSIGNED_BYTE);
 
-	glVertexAttribPointer(attriblocation, format.components, datatype, normalized, vertexStride, gloffset);
+	gl.setVertexAttribPointer(attriblocation, format.components, datatype, normalized, vertexStride, gloffset);
 
 	return attriblocation;
 }
@@ -574,6 +574,8 @@ void Mesh::draw(float x, float y, float angle, float sx, float sy, float ox, flo
 {
 	OpenGL::TempDebugGroup debuggroup("Mesh draw");
 
+	gl.flushBatchedDraws();
+
 	uint32 enabledattribs = 0;
 
 	for (const auto &attrib : attachedAttributes)
@@ -601,8 +603,7 @@ void Mesh::draw(float x, float y, float angle, float sx, float sy, float ox, flo
 
 	Matrix4 m(x, y, angle, sx, sy, ox, oy, kx, ky);
 
-	OpenGL::TempTransform transform(gl);
-	transform.get() *= m;
+	OpenGL::TempTransform transform(gl, m);
 
 	gl.prepareDraw();
 
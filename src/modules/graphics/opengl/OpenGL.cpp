@@ -24,11 +24,11 @@
 
 #include "Shader.h"
 #include "Canvas.h"
+#include "GLBuffer.h"
 #include "common/Exception.h"
 
 // C++
 #include <algorithm>
-#include <limits>
 
 // C
 #include <cstring>
@@ -52,6 +52,16 @@ namespace graphics
 namespace opengl
 {
 
+namespace
+{
+
+// Matrix versions which are never handed out by newMatrixVersion.
+const uint32 INVALID_MATRIX_VERSION = 0;
+const uint32 IDENTITY_MATRIX_VERSION = 1;
+const uint32 FIRST_MATRIX_VERSION = 2;
+
+} // anonymous namespace
+
 static void *LOVEGetProcAddress(const char *name)
 {
 #ifdef LOVE_ANDROID
@@ -73,9 +83,16 @@ OpenGL::OpenGL()
 	, maxTextureUnits(1)
 	, vendor(VENDOR_UNKNOWN)
 	, state()
+	, batchedDraws()
+	, vertexStreamBuffer(nullptr)
+	, indexStreamBuffer(nullptr)
 {
 	matrices.transform.reserve(10);
 	matrices.projection.reserve(2);
+	matrices.nextVersion = FIRST_MATRIX_VERSION;
+
+	batchedDraws.vertices.reserve(1024);
+	batchedDraws.indices.reserve(1536);
 }
 
 bool OpenGL::initContext()
@@ -113,6 +130,8 @@ void OpenGL::setupContext()
 
 	initMaxValues();
 
+	profiler.initContext();
+
 	GLfloat glcolor[4] = {1.0f, 1.0f, 1.0f, 1.0f};
 	glVertexAttrib4fv(ATTRIB_COLOR, glcolor);
 	glVertexAttrib4fv(ATTRIB_CONSTANTCOLOR, glcolor);
@@ -122,6 +141,28 @@ void OpenGL::setupContext()
 	state.enabledAttribArrays = (uint32) ((1ull << uint32(maxvertexattribs)) - 1);
 	useVertexAttribArrays(0);
 
+	for (auto &attrib : state.vertexAttribs)
+		attrib.valid = false;
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	state.arrayBuffer = 0;
+	state.elementArrayBuffer = 0;
+
+	// Put the blend, color mask and stencil state in a known configuration so
+	// later changes can be compared against it.
+	state.blend = {GL_FUNC_ADD, GL_ONE, GL_ONE, GL_ZERO, GL_ZERO};
+	glBlendEquation(state.blend.func);
+	glBlendFuncSeparate(state.blend.srcRGB, state.blend.dstRGB, state.blend.srcA, state.blend.dstA);
+
+	state.colorMask = 0xF;
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+	state.stencil = {false, GL_ALWAYS, 0, GL_KEEP};
+	glDisable(GL_STENCIL_TEST);
+	glStencilFunc(GL_ALWAYS, 0, 0xFFFFFFFF);
+	glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+
 	// Get the current viewport.
 	glGetIntegerv(GL_VIEWPORT, (GLint *) &state.viewport.x);
 
@@ -158,10 +199,9 @@ void OpenGL::setupContext()
 
 	createDefaultTexture();
 
-	// Invalidate the cached matrices by setting some elements to NaN.
-	float nan = std::numeric_limits<float>::quiet_NaN();
-	state.lastProjectionMatrix.setTranslation(nan, nan);
-	state.lastTransformMatrix.setTranslation(nan, nan);
+	// Invalidate the cached matrices.
+	state.lastProjectionVersion = INVALID_MATRIX_VERSION;
+	state.lastTransformVersion = INVALID_MATRIX_VERSION;
 
 	if (GLAD_VERSION_1_0)
 		glMatrixMode(GL_MODELVIEW);
@@ -177,6 +217,18 @@ void OpenGL::deInitContext()
 	glDeleteTextures(1, &state.defaultTexture);
 	state.defaultTexture = 0;
 
+	// Any pending batched geometry can't be drawn without a context.
+	batchedDraws.vertices.clear();
+	batchedDraws.indices.clear();
+
+	delete vertexStreamBuffer;
+	vertexStreamBuffer = nullptr;
+
+	delete indexStreamBuffer;
+	indexStreamBuffer = nullptr;
+
+	profiler.deInitContext();
+
 	contextInitialized = false;
 }
 
@@ -256,6 +308,22 @@ void OpenGL::initOpenGLFunctions()
 		else if (GLAD_NV_framebuffer_multisample)
 			fp_glRenderbufferStorageMultisample = fp_glRenderbufferStorageMultisampleNV;
 	}
+
+	// Buffer range mapping in ES2 is spread across two extensions.
+	if (GLAD_ES_VERSION_2_0 && !GLAD_ES_VERSION_3_0 && GLAD_EXT_map_buffer_range && GLAD_OES_mapbuffer)
+	{
+		fp_glMapBufferRange = fp_glMapBufferRangeEXT;
+		fp_glFlushMappedBufferRange = fp_glFlushMappedBufferRangeEXT;
+		fp_glUnmapBuffer = fp_glUnmapBufferOES;
+	}
+
+	if (!(GLAD_VERSION_3_3 || GLAD_ES_VERSION_3_0) && GLAD_ARB_instanced_arrays)
+	{
+		fp_glVertexAttribDivisor = fp_glVertexAttribDivisorARB;
+
+		if (!GLAD_VERSION_3_1 && GLAD_ARB_draw_instanced)
+			fp_glDrawArraysInstanced = fp_glDrawArraysInstancedARB;
+	}
 }
 
 void OpenGL::initMaxValues()
@@ -300,8 +368,18 @@ void OpenGL::initMatrices()
 	matrices.transform.clear();
 	matrices.projection.clear();
 
-	matrices.transform.push_back(Matrix4());
-	matrices.projection.push_back(Matrix4());
+	matrices.transform.push_back({Matrix4(), IDENTITY_MATRIX_VERSION});
+	matrices.projection.push_back({Matrix4(), IDENTITY_MATRIX_VERSION});
+}
+
+uint32 OpenGL::newMatrixVersion()
+{
+	uint32 version = matrices.nextVersion++;
+
+	if (matrices.nextVersion == INVALID_MATRIX_VERSION)
+		matrices.nextVersion = FIRST_MATRIX_VERSION;
+
+	return version;
 }
 
 void OpenGL::createDefaultTexture()
@@ -333,6 +411,12 @@ void OpenGL::pushTransform()
 	matrices.transform.push_back(matrices.transform.back());
 }
 
+void OpenGL::pushTransform(const Matrix4 &m)
+{
+	Matrix4 transform = matrices.transform.back().matrix.multiplyAffine2D(m);
+	matrices.transform.push_back({transform, newMatrixVersion()});
+}
+
 void OpenGL::popTransform()
 {
 	matrices.transform.pop_back();
@@ -340,43 +424,87 @@ void OpenGL::popTransform()
 
 Matrix4 &OpenGL::getTransform()
 {
-	return matrices.transform.back();
+	// The caller may modify the matrix, so it has to be treated as new.
+	VersionedMatrix &transform = matrices.transform.back();
+	transform.version = newMatrixVersion();
+	return transform.matrix;
+}
+
+const Matrix4 &OpenGL::getCurrentTransform() const
+{
+	return matrices.transform.back().matrix;
+}
+
+void OpenGL::pushProjection(const Matrix4 &m)
+{
+	matrices.projection.push_back({m, newMatrixVersion()});
+}
+
+void OpenGL::popProjection()
+{
+	if (matrices.projection.size() > 1)
+		matrices.projection.pop_back();
+}
+
+void OpenGL::setProjection(const Matrix4 &m)
+{
+	matrices.projection.back() = {m, newMatrixVersion()};
+}
+
+const Matrix4 &OpenGL::getCurrentProjection() const
+{
+	return matrices.projection.back().matrix;
+}
+
+uint32 OpenGL::getTransformVersion() const
+{
+	return matrices.transform.back().version;
+}
+
+uint32 OpenGL::getProjectionVersion() const
+{
+	return matrices.projection.back().version;
 }
 
 void OpenGL::prepareDraw()
 {
 	TempDebugGroup debuggroup("Prepare OpenGL draw");
 
-	// Make sure the active shader's love-provided uniforms are up to date.
+	// Make sure the active shader's love-provided and user uniforms are up to
+	// date.
 	if (Shader::current != nullptr)
+	{
 		Shader::current->checkSetBuiltinUniforms();
+		Shader::current->uploadPendingUniforms();
+	}
 
 	// We use glLoadMatrix rather than uniforms for our matrices when possible,
 	// because uniform uploads can be significantly slower than glLoadMatrix.
 	if (GLAD_VERSION_1_0)
 	{
-		const Matrix4 &curproj = matrices.projection.back();
-		const Matrix4 &curxform = matrices.transform.back();
-
-		const Matrix4 &lastproj = state.lastProjectionMatrix;
-		const Matrix4 &lastxform = state.lastTransformMatrix;
+		const VersionedMatrix &curproj = matrices.projection.back();
+		const VersionedMatrix &curxform = matrices.transform.back();
 
 		// We only need to re-upload the projection matrix if it's changed.
-		if (memcmp(curproj.getElements(), lastproj.getElements(), sizeof(float) * 16) != 0)
+		if (curproj.version != state.lastProjectionVersion)
 		{
 			glMatrixMode(GL_PROJECTION);
-			glLoadMatrixf(curproj.getElements());
+			glLoadMatrixf(curproj.matrix.getElements());
 			glMatrixMode(GL_MODELVIEW);
 
-			state.lastProjectionMatrix = matrices.projection.back();
+			state.lastProjectionVersion = curproj.version;
 		}
+		else
+			++stats.redundantCallsAvoided;
 
 		// Same with the transform matrix.
-		if (memcmp(curxform.getElements(), lastxform.getElements(), sizeof(float) * 16) != 0)
+		if (curxform.version != state.lastTransformVersion)
 		{
-			glLoadMatrixf(curxform.getElements());
-			state.lastTransformMatrix = matrices.transform.back();
+			glLoadMatrixf(curxform.matrix.getElements());
+			state.lastTransformVersion = curxform.version;
 		}
+		else
+			++stats.redundantCallsAvoided;
 	}
 }
 
@@ -392,12 +520,159 @@ void OpenGL::drawElements(GLenum mode, GLsizei count, GLenum type, const void *i
 	++stats.drawCalls;
 }
 
+void OpenGL::drawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancecount)
+{
+	glDrawArraysInstanced(mode, first, count, instancecount);
+	++stats.drawCalls;
+}
+
+bool OpenGL::isInstancingSupported() const
+{
+	if (GLAD_VERSION_3_3 || GLAD_ES_VERSION_3_0)
+		return true;
+
+	return GLAD_ARB_instanced_arrays && (GLAD_VERSION_3_1 || GLAD_ARB_draw_instanced);
+}
+
+Vertex *OpenGL::requestBatchedDraw(BatchedDrawMode mode, int vertexcount, GLuint texture)
+{
+	if (vertexcount < 3 || vertexcount > MAX_BATCHED_VERTICES)
+		return nullptr;
+
+	if (mode == BATCH_QUADS && (vertexcount % 4) != 0)
+		return nullptr;
+
+	bool pretransformed = isBatchedDrawPreTransformed();
+	const VersionedMatrix &transform = matrices.transform.back();
+
+	if (!batchedDraws.vertices.empty())
+	{
+		bool full = batchedDraws.vertices.size() + vertexcount > (size_t) MAX_BATCHED_VERTICES;
+
+		bool transformchanged = pretransformed != batchedDraws.preTransformed
+			|| (!pretransformed && transform.version != batchedDraws.transform.version);
+
+		if (full || texture != batchedDraws.texture || transformchanged)
+			flushBatchedDraws();
+	}
+
+	if (batchedDraws.vertices.empty())
+	{
+		batchedDraws.texture = texture;
+		batchedDraws.preTransformed = pretransformed;
+		batchedDraws.transform = transform;
+	}
+
+	std::vector<uint16> &indices = batchedDraws.indices;
+
+	size_t firstvertex = batchedDraws.vertices.size();
+	uint16 base = (uint16) firstvertex;
+
+	if (mode == BATCH_QUADS)
+	{
+		// Two triangles per quad, with the same winding as a triangle strip.
+		for (int i = 0; i < vertexcount; i += 4)
+		{
+			uint16 q = (uint16) (base + i);
+
+			indices.push_back(q + 0);
+			indices.push_back(q + 1);
+			indices.push_back(q + 2);
+
+			indices.push_back(q + 2);
+			indices.push_back(q + 1);
+			indices.push_back(q + 3);
+		}
+	}
+	else // BATCH_TRIANGLE_FAN
+	{
+		for (int i = 1; i + 1 < vertexcount; i++)
+		{
+			indices.push_back(base);
+			indices.push_back((uint16) (base + i));
+			indices.push_back((uint16) (base + i + 1));
+		}
+	}
+
+	batchedDraws.vertices.resize(firstvertex + vertexcount);
+
+	return &batchedDraws.vertices[firstvertex];
+}
+
+bool OpenGL::isBatchedDrawPreTransformed() const
+{
+	return Shader::current == nullptr || Shader::current == Shader::defaultShader;
+}
+
+void OpenGL::flushBatchedDraws()
+{
+	if (batchedDraws.indices.empty())
+		return;
+
+	TempDebugGroup debuggroup("Batched draw flush");
+
+	// The pending geometry was either transformed on the CPU when it was
+	// batched, or uses the transformation which was active at the time.
+	if (batchedDraws.preTransformed)
+		matrices.transform.push_back({Matrix4(), IDENTITY_MATRIX_VERSION});
+	else
+		matrices.transform.push_back(batchedDraws.transform);
+
+	StreamBuffer *vertexbuffer = getVertexStreamBuffer();
+	StreamBuffer *indexbuffer = getIndexStreamBuffer();
+
+	size_t vertexsize = batchedDraws.vertices.size() * sizeof(Vertex);
+	size_t indexsize = batchedDraws.indices.size() * sizeof(uint16);
+
+	size_t vertexoffset = vertexbuffer->fill(&batchedDraws.vertices[0], vertexsize);
+	size_t indexoffset = indexbuffer->fill(&batchedDraws.indices[0], indexsize);
+
+	bindTexture(batchedDraws.texture);
+
+	useVertexAttribArrays(ATTRIBFLAG_POS | ATTRIBFLAG_TEXCOORD | ATTRIBFLAG_COLOR);
+
+	setVertexAttribPointer(ATTRIB_POS, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), BUFFER_OFFSET(vertexoffset + offsetof(Vertex, x)));
+	setVertexAttribPointer(ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), BUFFER_OFFSET(vertexoffset + offsetof(Vertex, s)));
+	setVertexAttribPointer(ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), BUFFER_OFFSET(vertexoffset + offsetof(Vertex, r)));
+
+	vertexbuffer->unbind();
+
+	prepareDraw();
+	drawElements(GL_TRIANGLES, (GLsizei) batchedDraws.indices.size(), GL_UNSIGNED_SHORT, BUFFER_OFFSET(indexoffset));
+
+	indexbuffer->unbind();
+
+	matrices.transform.pop_back();
+
+	batchedDraws.vertices.clear();
+	batchedDraws.indices.clear();
+}
+
+StreamBuffer *OpenGL::getVertexStreamBuffer()
+{
+	if (vertexStreamBuffer == nullptr)
+		vertexStreamBuffer = new StreamBuffer(GL_ARRAY_BUFFER, 1024 * 1024);
+
+	return vertexStreamBuffer;
+}
+
+StreamBuffer *OpenGL::getIndexStreamBuffer()
+{
+	if (indexStreamBuffer == nullptr)
+		indexStreamBuffer = new StreamBuffer(GL_ELEMENT_ARRAY_BUFFER, 128 * 1024);
+
+	return indexStreamBuffer;
+}
+
 void OpenGL::useVertexAttribArrays(uint32 arraybits)
 {
 	uint32 diff = arraybits ^ state.enabledAttribArrays;
 
 	if (diff == 0)
+	{
+		++stats.redundantCallsAvoided;
 		return;
+	}
 
 	// Max 32 attributes. As of when this was written, no GL driver exposes more
 	// than 32. Lets hope that doesn't change...
@@ -424,6 +699,156 @@ void OpenGL::useVertexAttribArrays(uint32 arraybits)
 		glVertexAttrib4f(ATTRIB_COLOR, 1.0f, 1.0f, 1.0f, 1.0f);
 }
 
+void OpenGL::setVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer)
+{
+	if (index >= 32)
+	{
+		glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+		return;
+	}
+
+	auto &attrib = state.vertexAttribs[index];
+
+	// The pointer is an offset into whichever array buffer is bound.
+	if (attrib.valid && attrib.size == size && attrib.type == type
+		&& attrib.normalized == normalized && attrib.stride == stride
+		&& attrib.pointer == pointer && attrib.buffer == state.arrayBuffer)
+	{
+		++stats.redundantCallsAvoided;
+		return;
+	}
+
+	glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+
+	attrib.valid = true;
+	attrib.size = size;
+	attrib.type = type;
+	attrib.normalized = normalized;
+	attrib.stride = stride;
+	attrib.pointer = pointer;
+	attrib.buffer = state.arrayBuffer;
+}
+
+void OpenGL::bindBuffer(GLenum target, GLuint buffer)
+{
+	GLuint *bound = nullptr;
+
+	if (target == GL_ARRAY_BUFFER)
+		bound = &state.arrayBuffer;
+	else if (target == GL_ELEMENT_ARRAY_BUFFER)
+		bound = &state.elementArrayBuffer;
+
+	if (bound == nullptr)
+	{
+		glBindBuffer(target, buffer);
+		return;
+	}
+
+	if (*bound == buffer)
+	{
+		++stats.redundantCallsAvoided;
+		return;
+	}
+
+	glBindBuffer(target, buffer);
+	*bound = buffer;
+}
+
+void OpenGL::deleteBuffer(GLuint buffer)
+{
+	// Deleting a buffer resets any bindings to it in the current context,
+	// including the buffers used by vertex attribute arrays.
+	if (state.arrayBuffer == buffer)
+		state.arrayBuffer = 0;
+
+	if (state.elementArrayBuffer == buffer)
+		state.elementArrayBuffer = 0;
+
+	for (auto &attrib : state.vertexAttribs)
+	{
+		if (attrib.buffer == buffer)
+			attrib.valid = false;
+	}
+
+	glDeleteBuffers(1, &buffer);
+}
+
+void OpenGL::setBlendState(const BlendState &blend)
+{
+	if (blend == state.blend)
+	{
+		stats.redundantCallsAvoided += 2;
+		return;
+	}
+
+	if (blend.func != state.blend.func)
+		glBlendEquation(blend.func);
+	else
+		++stats.redundantCallsAvoided;
+
+	glBlendFuncSeparate(blend.srcRGB, blend.dstRGB, blend.srcA, blend.dstA);
+
+	state.blend = blend;
+}
+
+OpenGL::BlendState OpenGL::getBlendState() const
+{
+	return state.blend;
+}
+
+void OpenGL::setColorMask(bool r, bool g, bool b, bool a)
+{
+	uint32 mask = (r ? 1 : 0) | (g ? 2 : 0) | (b ? 4 : 0) | (a ? 8 : 0);
+
+	if (mask == state.colorMask)
+	{
+		++stats.redundantCallsAvoided;
+		return;
+	}
+
+	glColorMask(r, g, b, a);
+	state.colorMask = mask;
+}
+
+void OpenGL::setStencilState(const StencilState &stencil)
+{
+	StencilState &cur = state.stencil;
+
+	if (stencil.enabled != cur.enabled)
+	{
+		if (stencil.enabled)
+			glEnable(GL_STENCIL_TEST);
+		else
+			glDisable(GL_STENCIL_TEST);
+
+		cur.enabled = stencil.enabled;
+	}
+	else
+		++stats.redundantCallsAvoided;
+
+	// The function and operation don't matter while the test is disabled, so
+	// they're only changed when it's in use.
+	if (!stencil.enabled)
+		return;
+
+	if (stencil.compare != cur.compare || stencil.value != cur.value)
+	{
+		glStencilFunc(stencil.compare, stencil.value, 0xFFFFFFFF);
+		cur.compare = stencil.compare;
+		cur.value = stencil.value;
+	}
+	else
+		++stats.redundantCallsAvoided;
+
+	if (stencil.action != cur.action)
+	{
+		glStencilOp(GL_KEEP, GL_KEEP, stencil.action);
+		cur.action = stencil.action;
+	}
+	else
+		++stats.redundantCallsAvoided;
+}
+
 void OpenGL::setViewport(const OpenGL::Viewport &v)
 {
 	glViewport(v.x, v.y, v.w, v.h);
@@ -537,6 +962,8 @@ void OpenGL::bindTexture(GLuint texture)
 		state.boundTextures[state.curTextureUnit] = texture;
 		glBindTexture(GL_TEXTURE_2D, texture);
 	}
+	else
+		++stats.redundantCallsAvoided;
 }
 
 void OpenGL::bindTextureToUnit(GLuint texture, int textureunit, bool restoreprev)
@@ -555,10 +982,16 @@ void OpenGL::bindTextureToUnit(GLuint texture, int textureunit, bool restoreprev
 		if (restoreprev)
 			setTextureUnit(oldtextureunit);
 	}
+	else
+		++stats.redundantCallsAvoided;
 }
 
 void OpenGL::deleteTexture(GLuint texture)
 {
+	// Pending batched geometry might reference the texture.
+	if (texture == batchedDraws.texture)
+		flushBatchedDraws();
+
 	// glDeleteTextures binds texture 0 to all texture units the deleted texture
 	// was bound to before deletion.
 	for (GLuint &texid : state.boundTextures)
@@ -769,6 +1202,26 @@ const char *OpenGL::debugTypeString(GLenum type)
 	}
 }
 
+OpenGL::TempDebugGroup::TempDebugGroup(const char *name)
+{
+#if defined(LOVE_IOS)
+	if (GLAD_EXT_debug_marker)
+		glPushGroupMarkerEXT(0, (const GLchar *) name);
+#endif
+
+	gl.profiler.pushScope(name);
+}
+
+OpenGL::TempDebugGroup::~TempDebugGroup()
+{
+	gl.profiler.popScope();
+
+#if defined(LOVE_IOS)
+	if (GLAD_EXT_debug_marker)
+		glPopGroupMarkerEXT();
+#endif
+}
+
 
 // OpenGL class instance singleton.
 OpenGL gl;
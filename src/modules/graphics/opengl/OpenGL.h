@@ -27,6 +27,7 @@
 #include "graphics/Color.h"
 #include "graphics/Texture.h"
 #include "common/Matrix.h"
+#include "Profiler.h"
 
 // GLAD
 #include "libraries/glad/gladfuncs.hpp"
@@ -50,6 +51,8 @@ namespace opengl
 // no clashes with other GL libraries when linking, etc.
 using namespace glad;
 
+class StreamBuffer;
+
 // Vertex attribute indices used in shaders by LOVE. The values map to OpenGL
 // generic vertex attribute indices.
 enum VertexAttribID
@@ -109,12 +112,6 @@ public:
 		}
 	};
 
-	struct
-	{
-		std::vector<Matrix4> transform;
-		std::vector<Matrix4> projection;
-	} matrices;
-
 	class TempTransform
 	{
 	public:
@@ -125,6 +122,12 @@ public:
 			gl.pushTransform();
 		}
 
+		TempTransform(OpenGL &gl, const Matrix4 &m)
+			: gl(gl)
+		{
+			gl.pushTransform(m);
+		}
+
 		~TempTransform()
 		{
 			gl.popTransform();
@@ -139,27 +142,46 @@ public:
 		OpenGL &gl;
 	};
 
+	// Also opens a profiler scope with the same name, when profiling is
+	// enabled. The name must be a string literal.
 	class TempDebugGroup
 	{
 	public:
 
-#if defined(LOVE_IOS)
-		TempDebugGroup(const char *name)
-		{
-			if (GLAD_EXT_debug_marker)
-				glPushGroupMarkerEXT(0, (const GLchar *) name);
-		}
-#else
-		TempDebugGroup(const char *) {}
-#endif
+		TempDebugGroup(const char *name);
+		~TempDebugGroup();
+	};
 
-#if defined(LOVE_IOS)
-		~TempDebugGroup()
+	// Blend equation and factors, as passed to glBlendEquation and
+	// glBlendFuncSeparate.
+	struct BlendState
+	{
+		GLenum func;
+		GLenum srcRGB, srcA;
+		GLenum dstRGB, dstA;
+
+		bool operator == (const BlendState &rhs) const
 		{
-			if (GLAD_EXT_debug_marker)
-				glPopGroupMarkerEXT();
+			return func == rhs.func && srcRGB == rhs.srcRGB && srcA == rhs.srcA
+				&& dstRGB == rhs.dstRGB && dstA == rhs.dstA;
 		}
-#endif
+	};
+
+	// Stencil test state. The compare function and reference value are used
+	// by glStencilFunc, and the action is applied when the test passes.
+	struct StencilState
+	{
+		bool enabled;
+		GLenum compare;
+		GLint value;
+		GLenum action;
+	};
+
+	// Primitive types which can be appended to the current batch of draws.
+	enum BatchedDrawMode
+	{
+		BATCH_QUADS,        // Groups of 4 vertices in triangle strip order.
+		BATCH_TRIANGLE_FAN, // A single convex polygon.
 	};
 
 	struct Stats
@@ -168,8 +190,17 @@ public:
 		int    drawCalls;
 		int    framebufferBinds;
 		int    shaderSwitches;
+		size_t bytesStreamed;
+		size_t bufferUploadBytes;
+		int    bufferUploadRanges;
+		int    redundantCallsAvoided;
+		int    textLayoutHits;
+		int    textLayoutMisses;
+		int    skippedUniformUploads;
 	} stats;
 
+	Profiler profiler;
+
 	struct Bugs
 	{
 		/**
@@ -234,9 +265,39 @@ public:
 	void deInitContext();
 
 	void pushTransform();
+
+	/**
+	 * Pushes the current transformation combined with a 2D affine
+	 * transformation.
+	 **/
+	void pushTransform(const Matrix4 &m);
+
 	void popTransform();
+
+	/**
+	 * Returns the current transformation so it can be modified. Use
+	 * getCurrentTransform when it's only read, to avoid re-uploading it.
+	 **/
 	Matrix4 &getTransform();
 
+	const Matrix4 &getCurrentTransform() const;
+
+	void pushProjection(const Matrix4 &m);
+
+	// Does nothing if only the base projection is on the stack.
+	void popProjection();
+
+	void setProjection(const Matrix4 &m);
+	const Matrix4 &getCurrentProjection() const;
+
+	/**
+	 * Numbers which change whenever the current transformation or projection
+	 * might have changed. Equal versions mean equal matrices, so these can be
+	 * compared instead of the matrix contents. Versions are never 0.
+	 **/
+	uint32 getTransformVersion() const;
+	uint32 getProjectionVersion() const;
+
 	/**
 	 * Set up necessary state (LOVE-provided shader uniforms, etc.) for drawing.
 	 * This *MUST* be called directly before OpenGL drawing functions.
@@ -249,6 +310,49 @@ public:
 	 **/
 	void drawArrays(GLenum mode, GLint first, GLsizei count);
 	void drawElements(GLenum mode, GLsizei count, GLenum type, const void *indices);
+	void drawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancecount);
+
+	/**
+	 * Whether instanced drawing with per-instance vertex attributes can be used.
+	 **/
+	bool isInstancingSupported() const;
+
+	/**
+	 * Appends geometry to the current batch of draws, which are submitted to
+	 * OpenGL together in a single draw call when flushBatchedDraws is called.
+	 * Pending draws are flushed first if they use a different texture, or if
+	 * the batch is full.
+	 *
+	 * Returns a pointer to 'vertexcount' vertices which must be filled in by
+	 * the caller, or null if the geometry can't be batched. When
+	 * isBatchedDrawPreTransformed is true the batch is drawn without a
+	 * transformation, so the vertex positions must already be transformed by
+	 * getCurrentTransform. Otherwise they're drawn with the transformation
+	 * which was current when they were added.
+	 **/
+	Vertex *requestBatchedDraw(BatchedDrawMode mode, int vertexcount, GLuint texture);
+
+	/**
+	 * Whether batched geometry is transformed on the CPU. This is only done
+	 * while the default shader is active, since custom shaders can see the
+	 * vertex positions and TransformMatrix.
+	 **/
+	bool isBatchedDrawPreTransformed() const;
+
+	/**
+	 * Draws any pending batched geometry. This *MUST* be called before any
+	 * OpenGL state which affects rendering is changed, and before any draw
+	 * which doesn't go through requestBatchedDraw.
+	 **/
+	void flushBatchedDraws();
+
+	/**
+	 * Gets the shared buffers which vertex and index data that changes every
+	 * draw should be written to, instead of using client-side arrays. They
+	 * are created on first use and deleted in deInitContext.
+	 **/
+	StreamBuffer *getVertexStreamBuffer();
+	StreamBuffer *getIndexStreamBuffer();
 
 	/**
 	 * Sets the enabled vertex attribute arrays based on the specified attribute
@@ -259,6 +363,32 @@ public:
 	 **/
 	void useVertexAttribArrays(uint32 arraybits);
 
+	/**
+	 * Calls glVertexAttribPointer, unless the attribute already uses the same
+	 * format, pointer and array buffer. This *must* be used instead of
+	 * glVertexAttribPointer.
+	 **/
+	void setVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer);
+
+	/**
+	 * Binds a buffer object to GL_ARRAY_BUFFER or GL_ELEMENT_ARRAY_BUFFER,
+	 * skipping redundant binds. This *must* be used instead of glBindBuffer
+	 * for those targets.
+	 **/
+	void bindBuffer(GLenum target, GLuint buffer);
+
+	/**
+	 * Deletes a buffer object and forgets any cached state referring to it.
+	 **/
+	void deleteBuffer(GLuint buffer);
+
+	void setBlendState(const BlendState &blend);
+	BlendState getBlendState() const;
+
+	void setColorMask(bool r, bool g, bool b, bool a);
+
+	void setStencilState(const StencilState &stencil);
+
 	/**
 	 * Sets the OpenGL rendering viewport to the specified rectangle.
 	 * The y-coordinate starts at the top.
@@ -409,6 +539,7 @@ private:
 	void initOpenGLFunctions();
 	void initMaxValues();
 	void initMatrices();
+	uint32 newMatrixVersion();
 	void createDefaultTexture();
 
 	GLint getGLWrapMode(Texture::WrapMode wmode);
@@ -435,6 +566,25 @@ private:
 
 		uint32 enabledAttribArrays;
 
+		// Last glVertexAttribPointer values for each attribute index.
+		struct
+		{
+			bool valid;
+			GLint size;
+			GLenum type;
+			GLboolean normalized;
+			GLsizei stride;
+			const void *pointer;
+			GLuint buffer;
+		} vertexAttribs[32];
+
+		GLuint arrayBuffer;
+		GLuint elementArrayBuffer;
+
+		BlendState blend;
+		uint32 colorMask;
+		StencilState stencil;
+
 		Viewport viewport;
 		Viewport scissor;
 
@@ -444,11 +594,45 @@ private:
 
 		GLuint defaultTexture;
 
-		Matrix4 lastProjectionMatrix;
-		Matrix4 lastTransformMatrix;
+		uint32 lastProjectionVersion;
+		uint32 lastTransformVersion;
 
 	} state;
 
+	struct VersionedMatrix
+	{
+		Matrix4 matrix;
+		uint32 version;
+	};
+
+	// Geometry from batched draws which hasn't been submitted yet.
+	struct
+	{
+		std::vector<Vertex> vertices;
+		std::vector<uint16> indices;
+
+		GLuint texture;
+
+		// The transformation to draw with, when the vertices aren't
+		// pre-transformed.
+		bool preTransformed;
+		VersionedMatrix transform;
+
+	} batchedDraws;
+
+	struct
+	{
+		std::vector<VersionedMatrix> transform;
+		std::vector<VersionedMatrix> projection;
+		uint32 nextVersion;
+	} matrices;
+
+	StreamBuffer *vertexStreamBuffer;
+	StreamBuffer *indexStreamBuffer;
+
+	// Batched vertices are indexed with 16 bit integers.
+	static const int MAX_BATCHED_VERTICES = 0xFFFF;
+
 }; // OpenGL
 
 // OpenGL class instance singleton.
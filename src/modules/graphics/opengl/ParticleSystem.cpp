@@ -23,11 +23,13 @@
 #include "ParticleSystem.h"
 
 #include "OpenGL.h"
+#include "Shader.h"
 
 // STD
 #include <algorithm>
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
 
 namespace love
 {
@@ -38,37 +40,18 @@ namespace opengl
 
 ParticleSystem::ParticleSystem(Texture *texture, uint32 size)
 	: love::graphics::ParticleSystem(texture, size)
-	, particleVerts(nullptr)
 	, quadIndices(size)
 {
-	createVertices(size);
 }
 
 ParticleSystem::ParticleSystem(const ParticleSystem &p)
 	: love::graphics::ParticleSystem(p)
-	, particleVerts(nullptr)
 	, quadIndices(p.quadIndices)
 {
-	createVertices(maxParticles);
 }
 
 ParticleSystem::~ParticleSystem()
 {
-	delete[] particleVerts;
-}
-
-void ParticleSystem::createVertices(size_t numparticles)
-{
-	try
-	{
-		love::Vertex *pverts = new love::Vertex[numparticles * 4];
-		delete[] particleVerts;
-		particleVerts = pverts;
-	}
-	catch (std::exception &)
-	{
-		throw love::Exception("Out of memory.");
-	}
 }
 
 ParticleSystem *ParticleSystem::clone()
@@ -81,74 +64,203 @@ void ParticleSystem::setBufferSize(uint32 size)
 	love::graphics::ParticleSystem::setBufferSize(size);
 
 	quadIndices = QuadIndices(size);
-	createVertices(size);
 }
 
 void ParticleSystem::draw(float x, float y, float angle, float sx, float sy, float ox, float oy, float kx, float ky)
 {
 	uint32 pCount = getCount();
 
-	if (pCount == 0 || texture.get() == nullptr || pMem == nullptr || particleVerts == nullptr)
+	if (pCount == 0 || texture.get() == nullptr || pMem == nullptr)
 		return;
 
 	OpenGL::TempDebugGroup debuggroup("ParticleSystem draw");
 
-	OpenGL::TempTransform transform(gl);
-	transform.get() *= Matrix4(x, y, angle, sx, sy, ox, oy, kx, ky);
+	gl.flushBatchedDraws();
+
+	OpenGL::TempTransform transform(gl, Matrix4(x, y, angle, sx, sy, ox, oy, kx, ky));
+
+	gl.bindTexture(*(GLuint *) texture->getHandle());
+
+	if (canDrawInstanced())
+		drawInstanced(pCount);
+	else
+		drawVertices(pCount);
+}
+
+bool ParticleSystem::canDrawInstanced() const
+{
+	// Custom shaders expect regular vertices.
+	if (Shader::defaultParticleShader == nullptr || Shader::current != Shader::defaultShader)
+		return false;
+
+	return quads.size() <= (size_t) Shader::MAX_PARTICLE_QUADS;
+}
+
+void ParticleSystem::drawVertices(uint32 pCount)
+{
+	StreamBuffer *buffer = gl.getVertexStreamBuffer();
+	size_t datasize = sizeof(Vertex) * 4 * pCount;
 
 	const Vertex *textureVerts = texture->getVertices();
-	Vertex *pVerts = particleVerts;
-	Particle *p = pHead;
+	Vertex *pVerts = (Vertex *) buffer->map(datasize);
 
+	const ParticleData &p = particles;
 	bool useQuads = !quads.empty();
 
 	Matrix3 t;
 
 	// set the vertex data for each particle (transformation, texcoords, color)
-	while (p)
+	for (uint32 i = 0; i < pCount; i++)
 	{
 		if (useQuads)
-			textureVerts = quads[p->quadIndex]->getVertices();
+			textureVerts = quads[p.quadIndex[i]]->getVertices();
 
 		// particle vertices are image vertices transformed by particle info
-		t.setTransformation(p->position.x, p->position.y, p->angle, p->size, p->size, offset.x, offset.y, 0.0f, 0.0f);
+		t.setTransformation(p.positionX[i], p.positionY[i], p.angle[i], p.size[i], p.size[i], offset.x, offset.y, 0.0f, 0.0f);
 		t.transform(pVerts, textureVerts, 4);
 
+		// Particle colors are stored as floats (0-1) but vertex colors are
+		// unsigned bytes (0-255).
+		unsigned char r = (unsigned char) (p.colorR[i]*255);
+		unsigned char g = (unsigned char) (p.colorG[i]*255);
+		unsigned char b = (unsigned char) (p.colorB[i]*255);
+		unsigned char a = (unsigned char) (p.colorA[i]*255);
+
 		// set the texture coordinate and color data for particle vertices
 		for (int v = 0; v < 4; v++)
 		{
 			pVerts[v].s = textureVerts[v].s;
 			pVerts[v].t = textureVerts[v].t;
 
-			// Particle colors are stored as floats (0-1) but vertex colors are
-			// unsigned bytes (0-255).
-			pVerts[v].r = (unsigned char) (p->color.r*255);
-			pVerts[v].g = (unsigned char) (p->color.g*255);
-			pVerts[v].b = (unsigned char) (p->color.b*255);
-			pVerts[v].a = (unsigned char) (p->color.a*255);
+			pVerts[v].r = r;
+			pVerts[v].g = g;
+			pVerts[v].b = b;
+			pVerts[v].a = a;
 		}
 
 		pVerts += 4;
-		p = p->next;
 	}
 
-	gl.bindTexture(*(GLuint *) texture->getHandle());
+	size_t offset = buffer->unmap(datasize);
+
 	gl.prepareDraw();
 
 	gl.useVertexAttribArrays(ATTRIBFLAG_POS | ATTRIBFLAG_TEXCOORD | ATTRIBFLAG_COLOR);
 
-	glVertexAttribPointer(ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), &particleVerts[0].r);
-	glVertexAttribPointer(ATTRIB_POS, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), &particleVerts[0].x);
-	glVertexAttribPointer(ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), &particleVerts[0].s);
+	gl.setVertexAttribPointer(ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), BUFFER_OFFSET(offset + offsetof(Vertex, r)));
+	gl.setVertexAttribPointer(ATTRIB_POS, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), BUFFER_OFFSET(offset + offsetof(Vertex, x)));
+	gl.setVertexAttribPointer(ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), BUFFER_OFFSET(offset + offsetof(Vertex, s)));
+
+	buffer->unbind();
 
 	GLsizei count = (GLsizei) quadIndices.getIndexCount(pCount);
 	GLenum gltype = quadIndices.getType();
 
-	// We use a client-side index array instead of an Index Buffers, because
-	// at least one graphics driver (the one for Kepler nvidia GPUs in OS X
-	// 10.11) fails to render geometry if an index buffer is used with
-	// client-side vertex arrays.
-	gl.drawElements(GL_TRIANGLES, count, gltype, quadIndices.getIndices(0));
+	// The vertices come from a buffer object, so the index buffer can be used
+	// as well.
+	GLBuffer::Bind ibobind(*quadIndices.getBuffer());
+	gl.drawElements(GL_TRIANGLES, count, gltype, quadIndices.getPointer(0));
+}
+
+void ParticleSystem::drawInstanced(uint32 pCount)
+{
+	Shader *shader = Shader::defaultParticleShader;
+
+	GLint transformloc = shader->getAttribLocation("ParticleTransform");
+	GLint quadloc = shader->getAttribLocation("ParticleQuadIndex");
+
+	// Every quad is stored as its texture rectangle, followed by its size and
+	// the particle offset. Quad and texture vertices are laid out as a strip,
+	// so the first and last vertices are opposite corners.
+	float quaddata[Shader::MAX_PARTICLE_QUADS * 8];
+	int numquads = quads.empty() ? 1 : (int) quads.size();
+
+	for (int i = 0; i < numquads; i++)
+	{
+		const Vertex *v = quads.empty() ? texture->getVertices() : quads[i]->getVertices();
+		float *q = &quaddata[i * 8];
+
+		q[0] = v[0].s;
+		q[1] = v[0].t;
+		q[2] = v[3].s - v[0].s;
+		q[3] = v[3].t - v[0].t;
+		q[4] = v[3].x - v[0].x;
+		q[5] = v[3].y - v[0].y;
+		q[6] = offset.x;
+		q[7] = offset.y;
+	}
+
+	// The corners of the unit quad, followed by the per-particle data.
+	static const float corners[] = {0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f, 1.0f};
+
+	StreamBuffer *buffer = gl.getVertexStreamBuffer();
+	size_t datasize = sizeof(corners) + sizeof(Instance) * pCount;
+
+	char *data = (char *) buffer->map(datasize);
+	memcpy(data, corners, sizeof(corners));
+
+	Instance *instances = (Instance *) (data + sizeof(corners));
+	const ParticleData &p = particles;
+
+	for (uint32 i = 0; i < pCount; i++)
+	{
+		Instance &inst = instances[i];
+
+		inst.x = p.positionX[i];
+		inst.y = p.positionY[i];
+		inst.size = p.size[i];
+		inst.angle = p.angle[i];
+		inst.quadIndex = quads.empty() ? 0.0f : (float) p.quadIndex[i];
+		inst.r = (unsigned char) (p.colorR[i]*255);
+		inst.g = (unsigned char) (p.colorG[i]*255);
+		inst.b = (unsigned char) (p.colorB[i]*255);
+		inst.a = (unsigned char) (p.colorA[i]*255);
+	}
+
+	size_t vertexoffset = buffer->unmap(datasize);
+	size_t instoffset = vertexoffset + sizeof(corners);
+
+	shader->attach();
+	shader->setParticleQuads(quaddata, numquads);
+
+	gl.prepareDraw();
+
+	uint32 attribs = ATTRIBFLAG_POS | ATTRIBFLAG_COLOR;
+	if (transformloc >= 0)
+		attribs |= 1u << transformloc;
+	if (quadloc >= 0)
+		attribs |= 1u << quadloc;
+
+	gl.useVertexAttribArrays(attribs);
+
+	gl.setVertexAttribPointer(ATTRIB_POS, 2, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(vertexoffset));
+	gl.setVertexAttribPointer(ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Instance), BUFFER_OFFSET(instoffset + offsetof(Instance, r)));
+	glVertexAttribDivisor(ATTRIB_COLOR, 1);
+
+	if (transformloc >= 0)
+	{
+		gl.setVertexAttribPointer(transformloc, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), BUFFER_OFFSET(instoffset + offsetof(Instance, x)));
+		glVertexAttribDivisor(transformloc, 1);
+	}
+
+	if (quadloc >= 0)
+	{
+		gl.setVertexAttribPointer(quadloc, 1, GL_FLOAT, GL_FALSE, sizeof(Instance), BUFFER_OFFSET(instoffset + offsetof(Instance, quadIndex)));
+		glVertexAttribDivisor(quadloc, 1);
+	}
+
+	buffer->unbind();
+
+	gl.drawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei) pCount);
+
+	// Other draws share these attribute locations and expect per-vertex data.
+	glVertexAttribDivisor(ATTRIB_COLOR, 0);
+	if (transformloc >= 0)
+		glVertexAttribDivisor(transformloc, 0);
+	if (quadloc >= 0)
+		glVertexAttribDivisor(quadloc, 0);
+
+	Shader::defaultShader->attach();
 }
 
 } // opengl
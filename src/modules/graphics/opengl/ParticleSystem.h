@@ -47,10 +47,23 @@ public:
 
 private:
 
-	void createVertices(size_t numparticles);
+	// Per-particle data used by the instanced draw path.
+	struct Instance
+	{
+		float x, y;
+		float size, angle;
+		float quadIndex;
+		unsigned char r, g, b, a;
+	};
 
-	// array of transformed vertex data for all particles, for drawing
-	Vertex *particleVerts;
+	// Whether the quads can be expanded by the default particle shader.
+	bool canDrawInstanced() const;
+
+	// Writes four transformed vertices per particle.
+	void drawVertices(uint32 count);
+
+	// Writes one Instance per particle, and expands them on the GPU.
+	void drawInstanced(uint32 count);
 
 	// Vertex index buffer.
 	QuadIndices quadIndices;
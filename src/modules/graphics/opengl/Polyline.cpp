@@ -23,12 +23,20 @@
 
 // OpenGL
 #include "OpenGL.h"
+#include "GLBuffer.h"
 
 // C++
 #include <algorithm>
+#include <vector>
 
-// treat adjacent segments with angles between their directions <5 degree as straight
-static const float LINES_PARALLEL_EPS = 0.05f;
+// C
+#include <cstring>
+
+#if defined(LOVE_SIMD_SSE2)
+#include <emmintrin.h>
+#elif defined(LOVE_SIMD_NEON)
+#include <arm_neon.h>
+#endif
 
 namespace love
 {
@@ -37,99 +45,113 @@ namespace graphics
 namespace opengl
 {
 
-void Polyline::render(const float *coords, size_t count, size_t size_hint, float halfwidth, float pixel_size, bool draw_overdraw)
+namespace
 {
-	static std::vector<Vector> anchors;
-	anchors.clear();
-	anchors.reserve(size_hint);
 
-	static std::vector<Vector> normals;
-	normals.clear();
-	normals.reserve(size_hint);
-
-	// prepare vertex arrays
-	if (draw_overdraw)
-		halfwidth -= pixel_size * 0.3f;
+// treat adjacent segments with angles between their directions <5 degree as straight
+const float LINES_PARALLEL_EPS = 0.05f;
 
-	// compute sleeve
-	bool is_looping = (coords[0] == coords[count - 2]) && (coords[1] == coords[count - 1]);
-	Vector s;
-	if (!is_looping) // virtual starting point at second point mirrored on first point
-		s = Vector(coords[2] - coords[0], coords[3] - coords[1]);
-	else // virtual starting point at last vertex
-		s = Vector(coords[0] - coords[count - 4], coords[1] - coords[count - 3]);
+// Memory used while tessellating a line. It only ever grows, so drawing lines
+// doesn't allocate once the largest line has been seen. Lines are only drawn
+// from the main thread.
+struct
+{
+	// Direction, length and (half line width scaled) normal of each segment.
+	std::vector<Vector> directions;
+	std::vector<float> lengths;
+	std::vector<Vector> segmentNormals;
 
-	float len_s = s.getLength();
-	Vector ns = s.getNormal(halfwidth / len_s);
+	// Offset of each vertex of the sleeve from its point on the line.
+	std::vector<Vector> normals;
 
-	Vector q, r(coords[0], coords[1]);
-	for (size_t i = 0; i + 3 < count; i += 2)
-	{
-		q = r;
-		r = Vector(coords[i + 2], coords[i + 3]);
-		renderEdge(anchors, normals, s, len_s, ns, q, r, halfwidth);
-	}
+	// Core line, degenerate triangle and overdraw vertices.
+	std::vector<Vector> vertices;
+} scratch;
 
-	q = r;
-	r = is_looping ? Vector(coords[2], coords[3]) : r + s;
-	renderEdge(anchors, normals, s, len_s, ns, q, r, halfwidth);
+template <typename T>
+T *growScratch(std::vector<T> &v, size_t size)
+{
+	if (v.size() < size)
+		v.resize(size);
+	return v.data();
+}
 
-	vertex_count = normals.size();
+void computeSegments(const float *coords, size_t nsegments, float hw, Vector *directions, float *lengths, Vector *normals)
+{
+	size_t i = 0;
 
-	size_t extra_vertices = 0;
+	// Two segments at a time: their directions are interleaved (x0, y0, x1, y1)
+	// exactly as the points are.
+#if defined(LOVE_SIMD_SSE2)
+	const __m128 vhw = _mm_set1_ps(hw);
+	const __m128 sign = _mm_setr_ps(-1.0f, 1.0f, -1.0f, 1.0f);
 
-	if (draw_overdraw)
+	for (; i + 2 <= nsegments; i += 2)
 	{
-		calc_overdraw_vertex_count(is_looping);
-
-		// When drawing overdraw lines using triangle strips, we want to add an
-		// extra degenerate triangle in between the core line and the overdraw
-		// line in order to break up the strip into two. This will let us draw
-		// everything in one draw call.
-		if (draw_mode == GL_TRIANGLE_STRIP)
-			extra_vertices = 2;
+		__m128 d = _mm_sub_ps(_mm_loadu_ps(coords + 2*i + 2), _mm_loadu_ps(coords + 2*i));
+		__m128 sq = _mm_mul_ps(d, d);
+		__m128 len = _mm_sqrt_ps(_mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 3, 0, 1))));
+		__m128 scale = _mm_mul_ps(_mm_div_ps(vhw, len), sign);
+		__m128 n = _mm_mul_ps(_mm_shuffle_ps(d, d, _MM_SHUFFLE(2, 3, 0, 1)), scale);
+
+		_mm_storeu_ps((float *) (directions + i), d);
+		_mm_storeu_ps((float *) (normals + i), n);
+		lengths[i + 0] = _mm_cvtss_f32(len);
+		lengths[i + 1] = _mm_cvtss_f32(_mm_movehl_ps(len, len));
 	}
+#elif defined(LOVE_SIMD_NEON) && defined(__aarch64__)
+	const float32x4_t vhw = vdupq_n_f32(hw);
+	const float32x4_t sign = {-1.0f, 1.0f, -1.0f, 1.0f};
 
-	// Use a single linear array for both the regular and overdraw vertices.
-	vertices = new Vector[vertex_count + extra_vertices + overdraw_vertex_count];
-
-	for (size_t i = 0; i < vertex_count; ++i)
-		vertices[i] = anchors[i] + normals[i];
-
-	if (draw_overdraw)
+	for (; i + 2 <= nsegments; i += 2)
 	{
-		overdraw = vertices + vertex_count + extra_vertices;
-		overdraw_vertex_start = vertex_count + extra_vertices;
-		render_overdraw(normals, pixel_size, is_looping);
+		float32x4_t d = vsubq_f32(vld1q_f32(coords + 2*i + 2), vld1q_f32(coords + 2*i));
+		float32x4_t sq = vmulq_f32(d, d);
+		float32x4_t len = vsqrtq_f32(vaddq_f32(sq, vrev64q_f32(sq)));
+		float32x4_t scale = vmulq_f32(vdivq_f32(vhw, len), sign);
+		float32x4_t n = vmulq_f32(vrev64q_f32(d), scale);
+
+		vst1q_f32((float *) (directions + i), d);
+		vst1q_f32((float *) (normals + i), n);
+		lengths[i + 0] = vgetq_lane_f32(len, 0);
+		lengths[i + 1] = vgetq_lane_f32(len, 2);
 	}
+#endif
 
-	// Add the degenerate triangle strip.
-	if (extra_vertices)
+	for (; i < nsegments; i++)
 	{
-		vertices[vertex_count + 0] = vertices[vertex_count - 1];
-		vertices[vertex_count + 1] = vertices[overdraw_vertex_start];
+		Vector d(coords[2*i + 2] - coords[2*i], coords[2*i + 3] - coords[2*i + 1]);
+		directions[i] = d;
+		lengths[i] = d.getLength();
+		normals[i] = d.getNormal(hw / lengths[i]);
 	}
 }
 
-void NoneJoinPolyline::renderEdge(std::vector<Vector> &anchors, std::vector<Vector> &normals,
-                                Vector &s, float &len_s, Vector &ns,
-                                const Vector &q, const Vector &r, float hw)
+} // anonymous namespace
+
+/**
+ * The joins Polyline::render is instantiated with. Each computes the normals
+ * of the sleeve vertices around a point q on the line, given the segment
+ * s = q - p leading to q and the segment t = r - q leaving it (along with
+ * their lengths and normals ns, nt, scaled to the half line width), and
+ * returns how many it wrote. At most MAX_VERTICES are written per point.
+ **/
+
+struct NoneJoin
 {
-	anchors.push_back(q);
-	anchors.push_back(q);
-	normals.push_back(ns);
-	normals.push_back(-ns);
-
-	s     = (r - q);
-	len_s = s.getLength();
-	ns    = s.getNormal(hw / len_s);
-
-	anchors.push_back(q);
-	anchors.push_back(q);
-	normals.push_back(-ns);
-	normals.push_back(ns);
-}
+	static const size_t MAX_VERTICES = 4;
 
+	static inline size_t edge(const Vector &/*s*/, float /*len_s*/, const Vector &ns,
+	                          const Vector &/*t*/, float /*len_t*/, const Vector &nt,
+	                          Vector *normals)
+	{
+		normals[0] = ns;
+		normals[1] = -ns;
+		normals[2] = -nt;
+		normals[3] = nt;
+		return 4;
+	}
+};
 
 /** Calculate line boundary points.
  *
@@ -168,37 +190,32 @@ void NoneJoinPolyline::renderEdge(std::vector<Vector> &anchors, std::vector<Vect
  *
  * the intersection points can be efficiently calculated using Cramer's rule.
  */
-void MiterJoinPolyline::renderEdge(std::vector<Vector> &anchors, std::vector<Vector> &normals,
-                                   Vector &s, float &len_s, Vector &ns,
-                                   const Vector &q, const Vector &r, float hw)
+struct MiterJoin
 {
-	Vector t    = (r - q);
-	float len_t = t.getLength();
-	Vector nt   = t.getNormal(hw / len_t);
+	static const size_t MAX_VERTICES = 2;
 
-	anchors.push_back(q);
-	anchors.push_back(q);
-
-	float det = s ^ t;
-	if (fabs(det) / (len_s * len_t) < LINES_PARALLEL_EPS && s * t > 0)
-	{
-		// lines parallel, compute as u1 = q + ns * w/2, u2 = q - ns * w/2
-		normals.push_back(ns);
-		normals.push_back(-ns);
-	}
-	else
+	static inline size_t edge(const Vector &s, float len_s, const Vector &ns,
+	                          const Vector &t, float len_t, const Vector &nt,
+	                          Vector *normals)
 	{
-		// cramers rule
-		float lambda = ((nt - ns) ^ t) / det;
-		Vector d = ns + s * lambda;
-		normals.push_back(d);
-		normals.push_back(-d);
+		float det = s ^ t;
+		if (fabs(det) / (len_s * len_t) < LINES_PARALLEL_EPS && s * t > 0)
+		{
+			// lines parallel, compute as u1 = q + ns * w/2, u2 = q - ns * w/2
+			normals[0] = ns;
+			normals[1] = -ns;
+		}
+		else
+		{
+			// cramers rule
+			float lambda = ((nt - ns) ^ t) / det;
+			Vector d = ns + s * lambda;
+			normals[0] = d;
+			normals[1] = -d;
+		}
+		return 2;
 	}
-
-	s     = t;
-	ns    = nt;
-	len_s = len_t;
-}
+};
 
 /** Calculate line boundary points.
  *
@@ -217,61 +234,136 @@ void MiterJoinPolyline::renderEdge(std::vector<Vector> &anchors, std::vector<Vec
  *
  * uh1 = q + ns * w/2, uh2 = q + nt * w/2
  */
-void BevelJoinPolyline::renderEdge(std::vector<Vector> &anchors, std::vector<Vector> &normals,
-                                   Vector &s, float &len_s, Vector &ns,
-                                   const Vector &q, const Vector &r, float hw)
+struct BevelJoin
+{
+	static const size_t MAX_VERTICES = 4;
+
+	static inline size_t edge(const Vector &s, float len_s, const Vector &ns,
+	                          const Vector &t, float len_t, const Vector &nt,
+	                          Vector *normals)
+	{
+		float det = s ^ t;
+		if (fabs(det) / (len_s * len_t) < LINES_PARALLEL_EPS && s * t > 0)
+		{
+			// lines parallel, compute as u1 = q + nt * w/2, u2 = q - nt * w/2
+			normals[0] = nt;
+			normals[1] = -nt;
+			return 2;
+		}
+
+		// cramers rule
+		float lambda = ((nt - ns) ^ t) / det;
+		Vector d = ns + s * lambda;
+
+		if (det > 0) // 'left' turn -> intersection on the top
+		{
+			normals[0] = d;
+			normals[1] = -ns;
+			normals[2] = d;
+			normals[3] = -nt;
+		}
+		else
+		{
+			normals[0] = ns;
+			normals[1] = -d;
+			normals[2] = nt;
+			normals[3] = -d;
+		}
+		return 4;
+	}
+};
+
+template <typename Join>
+void Polyline::render(const float *coords, size_t count, float halfwidth, float pixel_size, bool draw_overdraw)
 {
-	Vector t    = (r - q);
-	float len_t = t.getLength();
+	// prepare vertex arrays
+	if (draw_overdraw)
+		halfwidth -= pixel_size * 0.3f;
+
+	size_t npoints = count / 2;
+	size_t nsegments = npoints - 1;
+
+	Vector *directions = growScratch(scratch.directions, nsegments);
+	float *lengths = growScratch(scratch.lengths, nsegments);
+	Vector *segnormals = growScratch(scratch.segmentNormals, nsegments);
+	computeSegments(coords, nsegments, halfwidth, directions, lengths, segnormals);
+
+	// Enough room for the core line, the degenerate triangle and the largest
+	// overdraw any of the joins make (see calc_overdraw_vertex_count).
+	size_t max_vertices = Join::MAX_VERTICES * npoints;
+	Vector *normals = growScratch(scratch.normals, max_vertices);
+	vertices = growScratch(scratch.vertices, 5 * max_vertices + 4);
+
+	// compute sleeve
+	bool is_looping = (coords[0] == coords[count - 2]) && (coords[1] == coords[count - 1]);
 
-	float det = s ^ t;
-	if (fabs(det) / (len_s * len_t) < LINES_PARALLEL_EPS && s * t > 0)
+	vertex_count = 0;
+	for (size_t i = 0; i < npoints; i++)
 	{
-		// lines parallel, compute as u1 = q + ns * w/2, u2 = q - ns * w/2
-		Vector n = t.getNormal(hw / len_t);
-		anchors.push_back(q);
-		anchors.push_back(q);
-		normals.push_back(n);
-		normals.push_back(-n);
-		s     = t;
-		len_s = len_t;
-		return; // early out
+		size_t in, out;
+		if (i > 0)
+			in = i - 1;
+		else if (!is_looping) // virtual starting point at second point mirrored on first point
+			in = 0;
+		else // virtual starting point at last vertex
+			in = nsegments - 1;
+
+		if (i < nsegments)
+			out = i;
+		else if (!is_looping) // virtual end point continuing the last segment
+			out = nsegments - 1;
+		else // back to the second vertex
+			out = 0;
+
+		size_t n = Join::edge(directions[in], lengths[in], segnormals[in],
+		                      directions[out], lengths[out], segnormals[out],
+		                      normals + vertex_count);
+
+		Vector q(coords[2*i], coords[2*i + 1]);
+		for (size_t j = vertex_count; j < vertex_count + n; j++)
+			vertices[j] = q + normals[j];
+
+		vertex_count += n;
 	}
 
-	// cramers rule
-	Vector nt= t.getNormal(hw / len_t);
-	float lambda = ((nt - ns) ^ t) / det;
-	Vector d = ns + s * lambda;
+	size_t extra_vertices = 0;
+	overdraw = nullptr;
 
-	anchors.push_back(q);
-	anchors.push_back(q);
-	anchors.push_back(q);
-	anchors.push_back(q);
-	if (det > 0) // 'left' turn -> intersection on the top
+	if (draw_overdraw)
 	{
-		normals.push_back(d);
-		normals.push_back(-ns);
-		normals.push_back(d);
-		normals.push_back(-nt);
+		calc_overdraw_vertex_count(is_looping);
+
+		// When drawing overdraw lines using triangle strips, we want to add an
+		// extra degenerate triangle in between the core line and the overdraw
+		// line in order to break up the strip into two. This will let us draw
+		// everything in one draw call.
+		if (draw_mode == GL_TRIANGLE_STRIP)
+			extra_vertices = 2;
+
+		// Use a single linear array for both the regular and overdraw vertices.
+		overdraw = vertices + vertex_count + extra_vertices;
+		overdraw_vertex_start = vertex_count + extra_vertices;
+		render_overdraw(normals, pixel_size, is_looping);
 	}
-	else
+
+	// Add the degenerate triangle strip.
+	if (extra_vertices)
 	{
-		normals.push_back(ns);
-		normals.push_back(-d);
-		normals.push_back(nt);
-		normals.push_back(-d);
+		vertices[vertex_count + 0] = vertices[vertex_count - 1];
+		vertices[vertex_count + 1] = vertices[overdraw_vertex_start];
 	}
-	s     = t;
-	len_s = len_t;
-	ns    = nt;
 }
 
+template void Polyline::render<NoneJoin>(const float *, size_t, float, float, bool);
+template void Polyline::render<MiterJoin>(const float *, size_t, float, float, bool);
+template void Polyline::render<BevelJoin>(const float *, size_t, float, float, bool);
+
 void Polyline::calc_overdraw_vertex_count(bool is_looping)
 {
 	overdraw_vertex_count = 2 * vertex_count + (is_looping ? 0 : 2);
 }
 
-void Polyline::render_overdraw(const std::vector<Vector> &normals, float pixel_size, bool is_looping)
+void Polyline::render_overdraw(const Vector *normals, float pixel_size, bool is_looping)
 {
 	// upper segment
 	for (size_t i = 0; i + 1 < vertex_count; i += 2)
@@ -320,7 +412,7 @@ void NoneJoinPolyline::calc_overdraw_vertex_count(bool /*is_looping*/)
 	overdraw_vertex_count = 4 * (vertex_count-2); // less than ideal
 }
 
-void NoneJoinPolyline::render_overdraw(const std::vector<Vector> &/*normals*/, float pixel_size, bool /*is_looping*/)
+void NoneJoinPolyline::render_overdraw(const Vector */*normals*/, float pixel_size, bool /*is_looping*/)
 {
 	for (size_t i = 2; i + 3 < vertex_count; i += 4)
 	{
@@ -354,34 +446,29 @@ void NoneJoinPolyline::render_overdraw(const std::vector<Vector> &/*normals*/, f
 
 Polyline::~Polyline()
 {
-	if (vertices)
-		delete[] vertices;
 }
 
 void Polyline::draw()
 {
 	OpenGL::TempDebugGroup debuggroup("Line draw");
 
-	GLushort *indices = nullptr;
-	Color *colors = nullptr;
+	gl.flushBatchedDraws();
 
 	size_t total_vertex_count = vertex_count;
 	if (overdraw)
 		total_vertex_count = overdraw_vertex_start + overdraw_vertex_count;
 
-	// TODO: We should probably be using a reusable index buffer.
+	StreamBuffer *vertexbuffer = gl.getVertexStreamBuffer();
+	StreamBuffer *indexbuffer = nullptr;
+
+	size_t indexoffset = 0;
+
 	if (use_quad_indices)
 	{
 		size_t numindices = (total_vertex_count / 4) * 6;
 
-		try
-		{
-			indices = new GLushort[numindices];
-		}
-		catch (std::bad_alloc &)
-		{
-			throw love::Exception("Out of memory.");
-		}
+		indexbuffer = gl.getIndexStreamBuffer();
+		GLushort *indices = (GLushort *) indexbuffer->map(numindices * sizeof(GLushort));
 
 		// Fill the index array to make 2 triangles from each quad.
 		// NOTE: The triangle vertex ordering here is important!
@@ -397,44 +484,58 @@ void Polyline::draw()
 			indices[i * 6 + 4] = GLushort(i * 4 + 2);
 			indices[i * 6 + 5] = GLushort(i * 4 + 3);
 		}
+
+		indexoffset = indexbuffer->unmap(numindices * sizeof(GLushort));
 	}
 
-	gl.prepareDraw();
+	// Positions and (for the overdraw) per-vertex colors are written to the
+	// same block of the stream buffer, one after the other.
+	size_t possize = total_vertex_count * sizeof(Vector);
+	size_t colorsize = overdraw ? total_vertex_count * sizeof(Color) : 0;
 
-	gl.bindTexture(gl.getDefaultTexture());
+	char *data = (char *) vertexbuffer->map(possize + colorsize);
 
-	uint32 enabledattribs = ATTRIBFLAG_POS;
+	memcpy(data, vertices, possize);
 
 	if (overdraw)
 	{
 		// Prepare per-vertex colors. Set the core to white, and the overdraw
 		// line's colors to white on one side and transparent on the other.
-		colors = new Color[total_vertex_count];
+		Color *colors = (Color *) (data + possize);
 		memset(colors, 255, overdraw_vertex_start * sizeof(Color));
 		fill_color_array(colors + overdraw_vertex_start);
+	}
+
+	size_t vertexoffset = vertexbuffer->unmap(possize + colorsize);
+
+	gl.prepareDraw();
 
-		glVertexAttribPointer(ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, 0, colors);
+	gl.bindTexture(gl.getDefaultTexture());
+
+	uint32 enabledattribs = ATTRIBFLAG_POS;
 
+	if (overdraw)
+	{
+		gl.setVertexAttribPointer(ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, 0, BUFFER_OFFSET(vertexoffset + possize));
 		enabledattribs |= ATTRIBFLAG_COLOR;
 	}
 
 	gl.useVertexAttribArrays(enabledattribs);
 
-	glVertexAttribPointer(ATTRIB_POS, 2, GL_FLOAT, GL_FALSE, 0, vertices);
+	gl.setVertexAttribPointer(ATTRIB_POS, 2, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(vertexoffset));
+
+	vertexbuffer->unbind();
 
 	// Draw the core line and the overdraw in a single draw call. We can do this
 	// because the vertex array contains both the core line and the overdraw
 	// vertices.
 	if (use_quad_indices)
-		gl.drawElements(draw_mode, (int) (total_vertex_count / 4) * 6, GL_UNSIGNED_SHORT, indices);
+	{
+		gl.drawElements(draw_mode, (int) (total_vertex_count / 4) * 6, GL_UNSIGNED_SHORT, BUFFER_OFFSET(indexoffset));
+		indexbuffer->unbind();
+	}
 	else
 		gl.drawArrays(draw_mode, 0, (int) total_vertex_count);
-
-	if (overdraw)
-		delete[] colors;
-
-	if (indices)
-		delete[] indices;
 }
 
 void Polyline::fill_color_array(Color *colors)
@@ -39,6 +39,11 @@ namespace graphics
 namespace opengl
 {
 
+// Join types which Polyline::render is specialized for. See Polyline.cpp.
+struct NoneJoin;
+struct MiterJoin;
+struct BevelJoin;
+
 /**
  * Abstract base class for a chain of segments.
  * @author Matthias Richter
@@ -57,40 +62,28 @@ public:
 	{}
 	virtual ~Polyline();
 
+	/** Draws the line on the screen
+	 */
+	void draw();
+
+protected:
+
 	/**
 	 * @param vertices      Vertices defining the core line segments
 	 * @param count         Number of coordinates (= size of the array vertices)
-	 * @param size_hint     Expected number of vertices of the rendering sleeve around the core line.
 	 * @param halfwidth     linewidth / 2.
 	 * @param pixel_size    Dimension of one pixel on the screen in world coordinates.
 	 * @param draw_overdraw Fake antialias the line.
 	 */
-	void render(const float *vertices, size_t count, size_t size_hint, float halfwidth, float pixel_size, bool draw_overdraw);
-
-	/** Draws the line on the screen
-	 */
-	void draw();
+	template <typename Join>
+	void render(const float *vertices, size_t count, float halfwidth, float pixel_size, bool draw_overdraw);
 
-protected:
 	virtual void calc_overdraw_vertex_count(bool is_looping);
-	virtual void render_overdraw(const std::vector<Vector> &normals, float pixel_size, bool is_looping);
+	virtual void render_overdraw(const Vector *normals, float pixel_size, bool is_looping);
 	virtual void fill_color_array(Color *colors);
 
-	/** Calculate line boundary points.
-	 *
-	 * @param[out]    anchors Anchor points defining the core line.
-	 * @param[out]    normals Normals defining the edge of the sleeve.
-	 * @param[in,out] s       Direction of segment pq (updated to the segment qr).
-	 * @param[in,out] len_s   Length of segment pq (updated to the segment qr).
-	 * @param[in,out] ns      Normal on the segment pq (updated to the segment qr).
-	 * @param[in]     q       Current point on the line.
-	 * @param[in]     r       Next point on the line.
-	 * @param[in]     hw      Half line width (see Polyline.render()).
-	 */
-	virtual void renderEdge(std::vector<Vector> &anchors, std::vector<Vector> &normals,
-	                        Vector &s, float &len_s, Vector &ns,
-	                        const Vector &q, const Vector &r, float hw) = 0;
-
+	// Points into scratch memory shared by all Polylines, which is only valid
+	// until the next line is rendered.
 	Vector *vertices;
 	Vector *overdraw;
 	size_t vertex_count;
@@ -115,7 +108,7 @@ public:
 
 	void render(const float *vertices, size_t count, float halfwidth, float pixel_size, bool draw_overdraw)
 	{
-		Polyline::render(vertices, count, 2 * count - 4, halfwidth, pixel_size, draw_overdraw);
+		Polyline::render<NoneJoin>(vertices, count, halfwidth, pixel_size, draw_overdraw);
 
 		// discard the first and last two vertices. (these are redundant)
 		for (size_t i = 0; i < vertex_count - 4; ++i)
@@ -132,11 +125,8 @@ public:
 
 protected:
 	virtual void calc_overdraw_vertex_count(bool is_looping);
-	virtual void render_overdraw(const std::vector<Vector> &normals, float pixel_size, bool is_looping);
+	virtual void render_overdraw(const Vector *normals, float pixel_size, bool is_looping);
 	virtual void fill_color_array(Color *colors);
-	virtual void renderEdge(std::vector<Vector> &anchors, std::vector<Vector> &normals,
-	                        Vector &s, float &len_s, Vector &ns,
-	                        const Vector &q, const Vector &r, float hw);
 };
 
 
@@ -149,13 +139,8 @@ class MiterJoinPolyline : public Polyline
 public:
 	void render(const float *vertices, size_t count, float halfwidth, float pixel_size, bool draw_overdraw)
 	{
-		Polyline::render(vertices, count, count, halfwidth, pixel_size, draw_overdraw);
+		Polyline::render<MiterJoin>(vertices, count, halfwidth, pixel_size, draw_overdraw);
 	}
-
-protected:
-	virtual void renderEdge(std::vector<Vector> &anchors, std::vector<Vector> &normals,
-	                        Vector &s, float &len_s, Vector &ns,
-	                        const Vector &q, const Vector &r, float hw);
 };
 
 
@@ -168,13 +153,8 @@ class BevelJoinPolyline : public Polyline
 public:
 	void render(const float *vertices, size_t count, float halfwidth, float pixel_size, bool draw_overdraw)
 	{
-		Polyline::render(vertices, count, 2 * count - 4, halfwidth, pixel_size, draw_overdraw);
+		Polyline::render<BevelJoin>(vertices, count, halfwidth, pixel_size, draw_overdraw);
 	}
-
-protected:
-	virtual void renderEdge(std::vector<Vector> &anchors, std::vector<Vector> &normals,
-	                        Vector &s, float &len_s, Vector &ns,
-	                        const Vector &q, const Vector &r, float hw);
 };
 
 } // opengl
@@ -0,0 +1,403 @@
+/**
+ * Copyright (c) 2006-2016 LOVE Development Team
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ **/
+
+
+// LOVE
+#include "Profiler.h"
+#include "timer/Timer.h"
+
+// C
+#include <cstdio>
+
+namespace love
+{
+namespace graphics
+{
+namespace opengl
+{
+
+namespace
+{
+
+// Frames waiting on GPU timestamps. Past this the oldest is read back even if
+// that means waiting for the GPU.
+const size_t MAX_PENDING_FRAMES = 3;
+
+// Marks an entry in the scope stack which was pushed after the frame's scope
+// list was full.
+const size_t DROPPED_SCOPE = (size_t) -1;
+
+void appendJSONString(std::string &json, const char *str)
+{
+	json += '"';
+
+	for (const char *c = str; *c != '\0'; c++)
+	{
+		if (*c == '"' || *c == '\\')
+		{
+			json += '\\';
+			json += *c;
+		}
+		else if ((unsigned char) *c < 0x20)
+		{
+			char escaped[8];
+			snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned int) *c);
+			json += escaped;
+		}
+		else
+			json += *c;
+	}
+
+	json += '"';
+}
+
+void appendTraceEvent(std::string &json, const char *name, int tid, double start, double duration)
+{
+	if (json.back() != '[')
+		json += ",\n";
+
+	json += "{\"name\":";
+	appendJSONString(json, name);
+
+	// Chrome trace timestamps are in microseconds.
+	char event[128];
+	snprintf(event, sizeof(event), ",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+	         tid, start * 1000000.0, duration * 1000000.0);
+
+	json += event;
+}
+
+} // anonymous namespace
+
+Profiler::Profiler()
+	: enabled(false)
+	, gpuTiming(false)
+	, frameActive(false)
+	, frameCounter(0)
+{
+}
+
+Profiler::~Profiler()
+{
+}
+
+void Profiler::initContext()
+{
+	gpuTiming = GLAD_VERSION_3_3 || GLAD_ARB_timer_query;
+}
+
+void Profiler::deInitContext()
+{
+	// Queries belong to the context, so any in-flight results are lost.
+	bool wasenabled = enabled;
+	setEnabled(false);
+	enabled = wasenabled;
+
+	if (!freeQueries.empty())
+		glDeleteQueries((GLsizei) freeQueries.size(), &freeQueries[0]);
+
+	freeQueries.clear();
+	gpuTiming = false;
+}
+
+void Profiler::setEnabled(bool enable)
+{
+	if (!enable)
+	{
+		if (frameActive)
+			discardRecord(current);
+
+		for (Record &record : pending)
+			discardRecord(record);
+
+		pending.clear();
+		scopeStack.clear();
+		frameActive = false;
+	}
+
+	enabled = enable;
+}
+
+bool Profiler::isEnabled() const
+{
+	return enabled;
+}
+
+bool Profiler::isGPUTimingSupported() const
+{
+	return gpuTiming;
+}
+
+void Profiler::pushScope(const char *name)
+{
+	if (!frameActive)
+		return;
+
+	Frame &frame = current.frame;
+
+	if (frame.scopes.size() >= MAX_FRAME_SCOPES)
+	{
+		frame.droppedScopes++;
+		scopeStack.push_back(DROPPED_SCOPE);
+		return;
+	}
+
+	Scope scope;
+	scope.name = name;
+	scope.depth = (int) scopeStack.size();
+	scope.cpuStart = love::timer::Timer::getTime() - frame.cpuStart;
+	scope.cpuTime = 0.0;
+	scope.gpuStart = -1.0;
+	scope.gpuTime = -1.0;
+
+	scopeStack.push_back(frame.scopes.size());
+	frame.scopes.push_back(scope);
+
+	if (gpuTiming)
+	{
+		current.queries.push_back(0);
+		current.queries.push_back(0);
+		timestamp(current.queries[current.queries.size() - 2]);
+	}
+}
+
+void Profiler::popScope()
+{
+	if (scopeStack.empty())
+		return;
+
+	size_t index = scopeStack.back();
+	scopeStack.pop_back();
+
+	if (index == DROPPED_SCOPE)
+		return;
+
+	Scope &scope = current.frame.scopes[index];
+	scope.cpuTime = love::timer::Timer::getTime() - current.frame.cpuStart - scope.cpuStart;
+
+	if (gpuTiming)
+		timestamp(current.queries[3 + index * 2]);
+}
+
+void Profiler::nextFrame()
+{
+	if (!enabled)
+		return;
+
+	if (frameActive)
+		endFrame();
+
+	// Timestamps complete in order, so nothing after the first incomplete
+	// frame can be ready either.
+	while (!pending.empty())
+	{
+		bool wait = pending.size() > MAX_PENDING_FRAMES;
+
+		if (!resolve(pending.front(), wait))
+			break;
+
+		history.push_back(std::move(pending.front().frame));
+		pending.pop_front();
+
+		if (history.size() > MAX_HISTORY_FRAMES)
+			history.pop_front();
+	}
+
+	current = Record();
+	current.frame.index = frameCounter++;
+	current.frame.cpuStart = love::timer::Timer::getTime();
+	current.frame.cpuTime = 0.0;
+	current.frame.gpuTime = -1.0;
+	current.frame.droppedScopes = 0;
+
+	if (gpuTiming)
+	{
+		current.queries.resize(2, 0);
+		timestamp(current.queries[0]);
+	}
+
+	frameActive = true;
+}
+
+const Profiler::Frame *Profiler::getLastFrame() const
+{
+	if (history.empty())
+		return nullptr;
+
+	return &history.back();
+}
+
+const std::deque<Profiler::Frame> &Profiler::getHistory() const
+{
+	return history;
+}
+
+std::string Profiler::getChromeTrace() const
+{
+	std::string json = "{\"traceEvents\":[";
+
+	json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"CPU\"}}";
+
+	if (gpuTiming)
+		json += ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":1,\"args\":{\"name\":\"GPU\"}}";
+
+	// Keep the timestamps small by making them relative to the oldest frame.
+	double origin = history.empty() ? 0.0 : history.front().cpuStart;
+
+	for (const Frame &frame : history)
+	{
+		char name[64];
+		snprintf(name, sizeof(name), "Frame %llu", (unsigned long long) frame.index);
+
+		double start = frame.cpuStart - origin;
+
+		appendTraceEvent(json, name, 0, start, frame.cpuTime);
+
+		// GPU timestamps use a different clock than the CPU, so GPU events are
+		// placed relative to the start of the CPU frame.
+		if (frame.gpuTime >= 0.0)
+			appendTraceEvent(json, name, 1, start, frame.gpuTime);
+
+		for (const Scope &scope : frame.scopes)
+		{
+			appendTraceEvent(json, scope.name, 0, start + scope.cpuStart, scope.cpuTime);
+
+			if (scope.gpuTime >= 0.0)
+				appendTraceEvent(json, scope.name, 1, start + scope.gpuStart, scope.gpuTime);
+		}
+	}
+
+	json += "]}\n";
+	return json;
+}
+
+const char *Profiler::internName(const std::string &name)
+{
+	auto it = names.find(name);
+	if (it != names.end())
+		return it->c_str();
+
+	if (names.size() >= MAX_INTERNED_NAMES)
+		return "(too many scope names)";
+
+	return names.insert(name).first->c_str();
+}
+
+GLuint Profiler::getQuery()
+{
+	GLuint query = 0;
+
+	if (!freeQueries.empty())
+	{
+		query = freeQueries.back();
+		freeQueries.pop_back();
+	}
+	else
+		glGenQueries(1, &query);
+
+	return query;
+}
+
+void Profiler::timestamp(GLuint &query)
+{
+	query = getQuery();
+	glQueryCounter(query, GL_TIMESTAMP);
+}
+
+bool Profiler::resolve(Record &record, bool wait)
+{
+	std::vector<GLuint> &queries = record.queries;
+
+	if (queries.size() < 2 || queries[0] == 0 || queries[1] == 0)
+	{
+		discardRecord(record);
+		return true;
+	}
+
+	// The frame's end timestamp is the last query issued for it.
+	if (!wait)
+	{
+		GLuint available = 0;
+		glGetQueryObjectuiv(queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+
+		if (!available)
+			return false;
+	}
+
+	GLuint64 framebegin = 0;
+	GLuint64 frameend = 0;
+	glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &framebegin);
+	glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &frameend);
+
+	record.frame.gpuTime = double(frameend - framebegin) / 1000000000.0;
+
+	for (size_t i = 0; i < record.frame.scopes.size(); i++)
+	{
+		GLuint beginquery = queries[2 + i * 2];
+		GLuint endquery = queries[3 + i * 2];
+
+		if (beginquery == 0 || endquery == 0)
+			continue;
+
+		GLuint64 begin = 0;
+		GLuint64 end = 0;
+		glGetQueryObjectui64v(beginquery, GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(endquery, GL_QUERY_RESULT, &end);
+
+		Scope &scope = record.frame.scopes[i];
+		scope.gpuStart = double(begin - framebegin) / 1000000000.0;
+		scope.gpuTime = double(end - begin) / 1000000000.0;
+	}
+
+	discardRecord(record);
+	return true;
+}
+
+void Profiler::discardRecord(Record &record)
+{
+	for (GLuint query : record.queries)
+	{
+		if (query != 0)
+			freeQueries.push_back(query);
+	}
+
+	record.queries.clear();
+}
+
+void Profiler::endFrame()
+{
+	// Close any scopes which were left open, e.g. because of an error.
+	while (!scopeStack.empty())
+		popScope();
+
+	current.frame.cpuTime = love::timer::Timer::getTime() - current.frame.cpuStart;
+
+	if (gpuTiming)
+		timestamp(current.queries[1]);
+
+	pending.push_back(std::move(current));
+	current = Record();
+
+	frameActive = false;
+}
+
+} // opengl
+} // graphics
+} // love
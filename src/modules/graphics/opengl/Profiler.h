@@ -0,0 +1,181 @@
+/**
+ * Copyright (c) 2006-2016 LOVE Development Team
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ **/
+
+
+#ifndef LOVE_GRAPHICS_OPENGL_PROFILER_H
+#define LOVE_GRAPHICS_OPENGL_PROFILER_H
+
+// LOVE
+#include "common/config.h"
+#include "common/int.h"
+
+// GLAD
+#include "libraries/glad/gladfuncs.hpp"
+
+// C++
+#include <vector>
+#include <deque>
+#include <set>
+#include <string>
+
+namespace love
+{
+namespace graphics
+{
+namespace opengl
+{
+
+using namespace glad;
+
+/**
+ * Records the CPU time, and the GPU time when timer queries are supported, of
+ * named scopes within each frame. Scopes are opened by OpenGL::TempDebugGroup
+ * and by the user.
+ *
+ * GPU timestamps are read back a few frames late so waiting on them doesn't
+ * stall the pipeline.
+ **/
+class Profiler
+{
+public:
+
+	// Completed frames kept for getHistory and getChromeTrace.
+	static const size_t MAX_HISTORY_FRAMES = 300;
+
+	// Scopes past this limit in a single frame are dropped.
+	static const size_t MAX_FRAME_SCOPES = 4096;
+
+	// Unique names kept by internName. Past this limit, new names all share a
+	// placeholder, so names built from e.g. entity IDs can't grow forever.
+	static const size_t MAX_INTERNED_NAMES = 1024;
+
+	struct Scope
+	{
+		const char *name;
+		int depth;
+
+		// Times are in seconds. Start times are relative to the start of the
+		// frame. The GPU values are negative when they aren't available.
+		double cpuStart;
+		double cpuTime;
+		double gpuStart;
+		double gpuTime;
+	};
+
+	struct Frame
+	{
+		uint64 index;
+
+		// The value of love.timer.getTime when the frame started.
+		double cpuStart;
+
+		double cpuTime;
+		double gpuTime;
+
+		std::vector<Scope> scopes;
+
+		// Number of scopes which didn't fit in the scopes list.
+		int droppedScopes;
+	};
+
+	Profiler();
+	~Profiler();
+
+	void initContext();
+	void deInitContext();
+
+	void setEnabled(bool enable);
+	bool isEnabled() const;
+
+	bool isGPUTimingSupported() const;
+
+	/**
+	 * The name must stay valid until the profiler is destroyed, e.g. a string
+	 * literal or a string returned by internName.
+	 **/
+	void pushScope(const char *name);
+	void popScope();
+
+	/**
+	 * Finishes the current frame and starts a new one. Called once per
+	 * love.graphics.present.
+	 **/
+	void nextFrame();
+
+	/**
+	 * Returns the most recent frame whose results are complete, or null.
+	 **/
+	const Frame *getLastFrame() const;
+
+	const std::deque<Frame> &getHistory() const;
+
+	/**
+	 * Encodes the frame history in the Chrome trace event JSON format, which
+	 * can be loaded in chrome://tracing.
+	 **/
+	std::string getChromeTrace() const;
+
+	/**
+	 * Returns a persistent copy of the given name, or a shared placeholder
+	 * once MAX_INTERNED_NAMES names have been interned.
+	 **/
+	const char *internName(const std::string &name);
+
+private:
+
+	// A frame whose GPU timestamps may not be available yet.
+	struct Record
+	{
+		Frame frame;
+
+		// Begin and end timestamp queries for the frame, followed by a pair for
+		// each scope. Unused queries are 0.
+		std::vector<GLuint> queries;
+	};
+
+	GLuint getQuery();
+	void timestamp(GLuint &query);
+	bool resolve(Record &record, bool wait);
+	void discardRecord(Record &record);
+	void endFrame();
+
+	bool enabled;
+	bool gpuTiming;
+	bool frameActive;
+
+	uint64 frameCounter;
+
+	Record current;
+	std::vector<size_t> scopeStack;
+
+	std::deque<Record> pending;
+	std::deque<Frame> history;
+
+	std::vector<GLuint> freeQueries;
+
+	std::set<std::string> names;
+
+}; // Profiler
+
+} // opengl
+} // graphics
+} // love
+
+#endif // LOVE_GRAPHICS_OPENGL_PROFILER_H
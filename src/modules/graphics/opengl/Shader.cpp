@@ -26,7 +26,6 @@
 
 // C++
 #include <algorithm>
-#include <limits>
 
 namespace love
 {
@@ -65,12 +64,16 @@ namespace
 Shader *Shader::current = nullptr;
 Shader *Shader::defaultShader = nullptr;
 Shader *Shader::defaultVideoShader = nullptr;
+Shader *Shader::defaultParticleShader = nullptr;
 
 Shader::ShaderSource Shader::defaultCode[Graphics::RENDERER_MAX_ENUM][2];
 Shader::ShaderSource Shader::defaultVideoCode[Graphics::RENDERER_MAX_ENUM][2];
+Shader::ShaderSource Shader::defaultParticleCode[Graphics::RENDERER_MAX_ENUM][2];
 
 std::vector<int> Shader::textureCounters;
 
+std::map<std::string, Shader::UniformBlock> Shader::uniformBlocks;
+
 Shader::Shader(const ShaderSource &source)
 	: shaderSource(source)
 	, program(0)
@@ -183,6 +186,24 @@ void Shader::mapActiveUniforms()
 
 	gl.useProgram(program);
 
+	// The previously active program has to be restored even if this fails.
+	try
+	{
+		mapUniforms();
+	}
+	catch (std::exception &)
+	{
+		gl.useProgram(activeprogram);
+		throw;
+	}
+
+	gl.useProgram(activeprogram);
+}
+
+void Shader::mapUniforms()
+{
+	std::vector<UniformBlock *> blocks = mapUniformBlocks();
+
 	GLint numuniforms;
 	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &numuniforms);
 
@@ -208,6 +229,21 @@ void Shader::mapActiveUniforms()
 		if (u.baseType == UNIFORM_SAMPLER)
 			glUniform1i(u.location, 0);
 
+		if (u.location == -1 && !blocks.empty())
+		{
+			GLuint index = (GLuint) i;
+			GLint blockindex = -1;
+			glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_BLOCK_INDEX, &blockindex);
+
+			if (blockindex >= 0 && blockindex < (GLint) blocks.size())
+			{
+				u.block = blocks[blockindex];
+				glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_OFFSET, &u.blockOffset);
+				glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_ARRAY_STRIDE, &u.arrayStride);
+				glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_MATRIX_STRIDE, &u.matrixStride);
+			}
+		}
+
 		// glGetActiveUniform appends "[0]" to the end of array uniform names...
 		if (u.name.length() > 3)
 		{
@@ -221,11 +257,36 @@ void Shader::mapActiveUniforms()
 		if (builtinNames.find(u.name.c_str(), builtin))
 			builtinUniforms[int(builtin)] = u.location;
 
-		if (u.location != -1)
+		if (u.location != -1 || u.block != nullptr)
 			uniforms[u.name] = u;
 	}
 
-	gl.useProgram(activeprogram);
+	// Lay out the CPU copies of every uniform's values, except for samplers.
+	uniformShadows.clear();
+	pendingUniforms.clear();
+
+	size_t datasize = 0;
+
+	for (auto &it : uniforms)
+	{
+		UniformInfo &u = it.second;
+		u.shadowIndex = -1;
+
+		if (u.baseType == UNIFORM_SAMPLER || u.baseType == UNIFORM_UNKNOWN || u.block != nullptr)
+			continue;
+
+		UniformShadow shadow = {datasize, 0, false, u.baseType != UNIFORM_INT};
+		u.shadowIndex = (int) uniformShadows.size();
+		uniformShadows.push_back(shadow);
+
+		datasize += getUniformElementSize(&u) * u.count;
+	}
+
+	uniformData.clear();
+	uniformData.resize(datasize);
+
+	for (size_t i = 0; i < handleNames.size(); i++)
+		handleUniforms[i] = getUniformInfo(handleNames[i]);
 }
 
 bool Shader::loadVolatile()
@@ -238,10 +299,9 @@ bool Shader::loadVolatile()
 
 	lastPointSize = -1.0f;
 
-	// Invalidate the cached matrices by setting some elements to NaN.
-	float nan = std::numeric_limits<float>::quiet_NaN();
-	lastProjectionMatrix.setTranslation(nan, nan);
-	lastTransformMatrix.setTranslation(nan, nan);
+	// Invalidate the cached matrices. OpenGL never uses a version of 0.
+	lastProjectionVersion = 0;
+	lastTransformVersion = 0;
 
 	for (int i = 0; i < 3; i++)
 		videoTextureUnits[i] = 0;
@@ -311,7 +371,17 @@ bool Shader::loadVolatile()
 	}
 
 	// Get all active uniform variables in this shader from OpenGL.
-	mapActiveUniforms();
+	try
+	{
+		mapActiveUniforms();
+	}
+	catch (love::Exception &)
+	{
+		releaseUniformBlocks();
+		glDeleteProgram(program);
+		program = 0;
+		throw;
+	}
 
 	for (int i = 0; i < int(ATTRIB_MAX_ENUM); i++)
 	{
@@ -359,6 +429,13 @@ void Shader::unloadVolatile()
 
 	// same with uniform location list
 	uniforms.clear();
+	uniformShadows.clear();
+	pendingUniforms.clear();
+
+	for (const UniformInfo *&info : handleUniforms)
+		info = nullptr;
+
+	releaseUniformBlocks();
 
 	// And the locations of any built-in uniform variables.
 	for (int i = 0; i < int(BUILTIN_MAX_ENUM); i++)
@@ -408,6 +485,9 @@ void Shader::attach(bool temporary)
 {
 	if (current != this)
 	{
+		// Pending batched draws must use the previously active shader.
+		gl.flushBatchedDraws();
+
 		gl.useProgram(program);
 		current = this;
 		// retain/release happens in Graphics::setShader.
@@ -439,7 +519,10 @@ void Shader::detach()
 	}
 
 	if (current != nullptr)
+	{
+		gl.flushBatchedDraws();
 		gl.useProgram(0);
+	}
 
 	current = nullptr;
 }
@@ -454,84 +537,362 @@ const Shader::UniformInfo *Shader::getUniformInfo(const std::string &name) const
 	return &(it->second);
 }
 
+int Shader::getUniformHandle(const std::string &name)
+{
+	for (size_t i = 0; i < handleNames.size(); i++)
+	{
+		if (handleNames[i] == name)
+			return handleUniforms[i] != nullptr ? (int) i : -1;
+	}
+
+	const UniformInfo *info = getUniformInfo(name);
+	if (info == nullptr)
+		return -1;
+
+	handleNames.push_back(name);
+	handleUniforms.push_back(info);
+
+	return (int) handleNames.size() - 1;
+}
+
+const Shader::UniformInfo *Shader::getUniformInfo(int handle) const
+{
+	if (handle < 0 || handle >= (int) handleUniforms.size())
+		return nullptr;
+
+	return handleUniforms[handle];
+}
+
 void Shader::sendInts(const UniformInfo *info, const int *vec, int count)
 {
 	if (info->baseType != UNIFORM_INT && info->baseType != UNIFORM_BOOL)
 		return;
 
-	TemporaryAttacher attacher(this);
+	updateUniform(info, vec, count, false);
+}
+
+void Shader::sendFloats(const UniformInfo *info, const float *vec, int count)
+{
+	if (info->baseType != UNIFORM_FLOAT && info->baseType != UNIFORM_BOOL)
+		return;
+
+	updateUniform(info, vec, count, true);
+}
 
+void Shader::sendMatrices(const UniformInfo *info, const float *m, int count)
+{
+	if (info->baseType != UNIFORM_MATRIX)
+		return;
+
+	updateUniform(info, m, count, true);
+}
+
+size_t Shader::getUniformElementSize(const UniformInfo *info) const
+{
+	if (info->baseType == UNIFORM_MATRIX)
+		return sizeof(float) * info->components * info->components;
+
+	// Ints and floats are the same size.
+	return sizeof(float) * info->components;
+}
+
+void Shader::updateUniform(const UniformInfo *info, const void *data, int count, bool floats)
+{
+	if (info->block != nullptr)
+	{
+		updateBlockUniform(info, data, count, floats);
+		return;
+	}
+
+	if (info->shadowIndex < 0)
+		return;
+
+	UniformShadow &shadow = uniformShadows[info->shadowIndex];
+	char *values = &uniformData[shadow.offset];
+
+	count = std::min(count, info->count);
+	size_t size = getUniformElementSize(info) * count;
+
+	// The values are already in the shader, or will be once it's next used.
+	if (count <= shadow.count && floats == shadow.floats && memcmp(values, data, size) == 0)
+	{
+		++gl.stats.skippedUniformUploads;
+		return;
+	}
+
+	// Pending batched draws must use the old uniform values.
+	if (current == this)
+		gl.flushBatchedDraws();
+
+	// Elements after the sent ones can't be uploaded alongside them if they're
+	// a different type.
+	if (floats != shadow.floats)
+		shadow.count = 0;
+
+	memcpy(values, data, size);
+	shadow.count = std::max(shadow.count, count);
+	shadow.floats = floats;
+
+	if (shadow.pending)
+	{
+		// These values replace ones which were never uploaded.
+		++gl.stats.skippedUniformUploads;
+	}
+	else
+	{
+		shadow.pending = true;
+		pendingUniforms.push_back(info);
+	}
+}
+
+void Shader::uploadUniform(const UniformInfo *info, const UniformShadow &shadow)
+{
 	int location = info->location;
+	int count = shadow.count;
+	const char *data = &uniformData[shadow.offset];
 
-	switch (info->components)
+	if (info->baseType == UNIFORM_MATRIX)
 	{
-	case 4:
-		glUniform4iv(location, count, vec);
-		break;
-	case 3:
-		glUniform3iv(location, count, vec);
-		break;
-	case 2:
-		glUniform2iv(location, count, vec);
-		break;
-	case 1:
-	default:
-		glUniform1iv(location, count, vec);
-		break;
+		const float *m = (const float *) data;
+
+		switch (info->components)
+		{
+		case 4:
+			glUniformMatrix4fv(location, count, GL_FALSE, m);
+			break;
+		case 3:
+			glUniformMatrix3fv(location, count, GL_FALSE, m);
+			break;
+		case 2:
+		default:
+			glUniformMatrix2fv(location, count, GL_FALSE, m);
+			break;
+		}
+	}
+	else if (shadow.floats)
+	{
+		const float *vec = (const float *) data;
+
+		switch (info->components)
+		{
+		case 4:
+			glUniform4fv(location, count, vec);
+			break;
+		case 3:
+			glUniform3fv(location, count, vec);
+			break;
+		case 2:
+			glUniform2fv(location, count, vec);
+			break;
+		case 1:
+		default:
+			glUniform1fv(location, count, vec);
+			break;
+		}
+	}
+	else
+	{
+		const int *vec = (const int *) data;
+
+		switch (info->components)
+		{
+		case 4:
+			glUniform4iv(location, count, vec);
+			break;
+		case 3:
+			glUniform3iv(location, count, vec);
+			break;
+		case 2:
+			glUniform2iv(location, count, vec);
+			break;
+		case 1:
+		default:
+			glUniform1iv(location, count, vec);
+			break;
+		}
 	}
 }
 
-void Shader::sendFloats(const UniformInfo *info, const float *vec, int count)
+void Shader::updateBlockUniform(const UniformInfo *info, const void *data, int count, bool floats)
 {
-	if (info->baseType != UNIFORM_FLOAT && info->baseType != UNIFORM_BOOL)
+	UniformBlock *block = info->block;
+	count = std::min(count, info->count);
+
+	// Each array element is written as one or more columns (for matrices) of
+	// tightly packed components, at the offsets GL reported for the block.
+	int columns = info->baseType == UNIFORM_MATRIX ? info->components : 1;
+	size_t columnsize = sizeof(float) * info->components;
+	bool convertbools = info->baseType == UNIFORM_BOOL && floats;
+
+	const auto getColumn = [&](int element, int column, int *ints) -> const char *
+	{
+		const char *src = (const char *) data + (element * columns + column) * columnsize;
+
+		// Bools in uniform blocks are 4 byte integers.
+		if (!convertbools)
+			return src;
+
+		for (int i = 0; i < info->components; i++)
+			ints[i] = ((const float *) src)[i] != 0.0f;
+
+		return (const char *) ints;
+	};
+
+	const auto getOffset = [&](int element, int column) -> size_t
+	{
+		return info->blockOffset + element * info->arrayStride + column * info->matrixStride;
+	};
+
+	int ints[4];
+	bool changed = false;
+
+	for (int i = 0; i < count && !changed; i++)
+	{
+		for (int c = 0; c < columns && !changed; c++)
+			changed = memcmp(&block->data[getOffset(i, c)], getColumn(i, c, ints), columnsize) != 0;
+	}
+
+	if (!changed)
+	{
+		++gl.stats.skippedUniformUploads;
 		return;
+	}
 
-	TemporaryAttacher attacher(this);
+	// Pending batched draws must use the old values, whichever Shader they use.
+	gl.flushBatchedDraws();
 
-	int location = info->location;
+	for (int i = 0; i < count; i++)
+	{
+		for (int c = 0; c < columns; c++)
+		{
+			size_t offset = getOffset(i, c);
+			memcpy(&block->data[offset], getColumn(i, c, ints), columnsize);
+
+			block->dirtyStart = std::min(block->dirtyStart, offset);
+			block->dirtyEnd = std::max(block->dirtyEnd, offset + columnsize);
+		}
+	}
+}
 
-	switch (info->components)
+std::vector<Shader::UniformBlock *> Shader::mapUniformBlocks()
+{
+	std::vector<UniformBlock *> blocks;
+
+	if (!isUniformBufferSupported())
+		return blocks;
+
+	GLint numblocks = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &numblocks);
+
+	for (int i = 0; i < numblocks; i++)
 	{
-	case 4:
-		glUniform4fv(location, count, vec);
-		break;
-	case 3:
-		glUniform3fv(location, count, vec);
-		break;
-	case 2:
-		glUniform2fv(location, count, vec);
-		break;
-	case 1:
-	default:
-		glUniform1fv(location, count, vec);
-		break;
+		GLchar cname[256];
+		GLsizei namelen = 0;
+		glGetActiveUniformBlockName(program, (GLuint) i, (GLsizei) (sizeof(cname) / sizeof(GLchar)), &namelen, cname);
+
+		std::string name(cname, (size_t) namelen);
+
+		GLint size = 0;
+		glGetActiveUniformBlockiv(program, (GLuint) i, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+
+		auto it = uniformBlocks.find(name);
+
+		if (it == uniformBlocks.end())
+		{
+			GLint maxbindings = 0;
+			glGetIntegerv(GL_MAX_UNIFORM_BUFFER_BINDINGS, &maxbindings);
+
+			// Use the lowest binding point no other block uses.
+			std::vector<bool> used(maxbindings, false);
+			for (const auto &b : uniformBlocks)
+				used[b.second.binding] = true;
+
+			auto freebinding = std::find(used.begin(), used.end(), false);
+			if (freebinding == used.end())
+				throw love::Exception("Cannot use uniform block '%s': too many uniform blocks are in use (at most %d are supported.)", name.c_str(), maxbindings);
+
+			UniformBlock block = {};
+			block.binding = (GLuint) (freebinding - used.begin());
+			block.data.resize(size);
+			block.dirtyStart = block.data.size();
+			block.dirtyEnd = 0;
+
+			glGenBuffers(1, &block.buffer);
+			glBindBuffer(GL_UNIFORM_BUFFER, block.buffer);
+			glBufferData(GL_UNIFORM_BUFFER, size, &block.data[0], GL_DYNAMIC_DRAW);
+			glBindBufferBase(GL_UNIFORM_BUFFER, block.binding, block.buffer);
+
+			it = uniformBlocks.insert(std::make_pair(name, block)).first;
+		}
+		else if (it->second.data.size() != (size_t) size)
+			throw love::Exception("Uniform block '%s' must be declared the same way in every shader.", name.c_str());
+
+		it->second.shaderCount++;
+		blockNames.push_back(name);
+
+		glUniformBlockBinding(program, (GLuint) i, it->second.binding);
+		blocks.push_back(&it->second);
 	}
+
+	return blocks;
 }
 
-void Shader::sendMatrices(const UniformInfo *info, const float *m, int count)
+void Shader::releaseUniformBlocks()
 {
-	if (info->baseType != UNIFORM_MATRIX)
-		return;
+	for (const std::string &name : blockNames)
+	{
+		auto it = uniformBlocks.find(name);
+		if (it == uniformBlocks.end())
+			continue;
 
-	TemporaryAttacher attacher(this);
+		// The values are lost once no Shader uses the block anymore.
+		if (--it->second.shaderCount <= 0)
+		{
+			gl.deleteBuffer(it->second.buffer);
+			uniformBlocks.erase(it);
+		}
+	}
 
-	int location = info->location;
+	blockNames.clear();
+}
 
-	switch (info->components)
+void Shader::uploadUniformBlocks()
+{
+	for (auto &it : uniformBlocks)
 	{
-	case 4:
-		glUniformMatrix4fv(location, count, GL_FALSE, m);
-		break;
-	case 3:
-		glUniformMatrix3fv(location, count, GL_FALSE, m);
-		break;
-	case 2:
-	default:
-		glUniformMatrix2fv(location, count, GL_FALSE, m);
-		break;
+		UniformBlock &block = it.second;
+
+		if (block.dirtyStart >= block.dirtyEnd)
+			continue;
+
+		size_t size = block.dirtyEnd - block.dirtyStart;
+
+		glBindBuffer(GL_UNIFORM_BUFFER, block.buffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, (GLintptr) block.dirtyStart, (GLsizeiptr) size, &block.data[block.dirtyStart]);
+
+		gl.stats.bufferUploadBytes += size;
+		++gl.stats.bufferUploadRanges;
+
+		block.dirtyStart = block.data.size();
+		block.dirtyEnd = 0;
 	}
 }
 
+void Shader::uploadPendingUniforms()
+{
+	if (!uniformBlocks.empty())
+		uploadUniformBlocks();
+
+	for (const UniformInfo *info : pendingUniforms)
+	{
+		UniformShadow &shadow = uniformShadows[info->shadowIndex];
+		uploadUniform(info, shadow);
+		shadow.pending = false;
+	}
+
+	pendingUniforms.clear();
+}
+
 void Shader::sendTexture(const UniformInfo *info, Texture *texture)
 {
 	if (info->baseType != UNIFORM_SAMPLER)
@@ -539,6 +900,8 @@ void Shader::sendTexture(const UniformInfo *info, Texture *texture)
 
 	GLuint gltex = *(GLuint *) texture->getHandle();
 
+	gl.flushBatchedDraws();
+
 	TemporaryAttacher attacher(this);
 
 	int texunit = getTextureUnit(info->name);
@@ -690,6 +1053,16 @@ void Shader::setVideoTextures(GLuint ytexture, GLuint cbtexture, GLuint crtextur
 	gl.setTextureUnit(0);
 }
 
+void Shader::setParticleQuads(const float *quads, int count)
+{
+	GLint location = builtinUniforms[BUILTIN_PARTICLE_QUADS];
+	if (location < 0)
+		return;
+
+	TemporaryAttacher attacher(this);
+	glUniform4fv(location, count * 2, quads);
+}
+
 void Shader::checkSetScreenParams()
 {
 	OpenGL::Viewport view = gl.getViewport();
@@ -757,15 +1130,18 @@ void Shader::checkSetBuiltinUniforms()
 	{
 		checkSetPointSize(gl.getPointSize());
 
-		const Matrix4 &curxform = gl.matrices.transform.back();
-		const Matrix4 &curproj = gl.matrices.projection.back();
+		const Matrix4 &curxform = gl.getCurrentTransform();
+		const Matrix4 &curproj = gl.getCurrentProjection();
+
+		uint32 xformversion = gl.getTransformVersion();
+		uint32 projversion = gl.getProjectionVersion();
 
 		TemporaryAttacher attacher(this);
 
 		bool tpmatrixneedsupdate = false;
 
 		// Only upload the matrices if they've changed.
-		if (memcmp(curxform.getElements(), lastTransformMatrix.getElements(), sizeof(float) * 16) != 0)
+		if (xformversion != lastTransformVersion)
 		{
 			GLint location = builtinUniforms[BUILTIN_TRANSFORM_MATRIX];
 			if (location >= 0)
@@ -782,17 +1158,17 @@ void Shader::checkSetBuiltinUniforms()
 			}
 
 			tpmatrixneedsupdate = true;
-			lastTransformMatrix = curxform;
+			lastTransformVersion = xformversion;
 		}
 
-		if (memcmp(curproj.getElements(), lastProjectionMatrix.getElements(), sizeof(float) * 16) != 0)
+		if (projversion != lastProjectionVersion)
 		{
 			GLint location = builtinUniforms[BUILTIN_PROJECTION_MATRIX];
 			if (location >= 0)
 				glUniformMatrix4fv(location, 1, GL_FALSE, curproj.getElements());
 
 			tpmatrixneedsupdate = true;
-			lastProjectionMatrix = curproj;
+			lastProjectionVersion = projversion;
 		}
 
 		if (tpmatrixneedsupdate)
@@ -834,6 +1210,11 @@ bool Shader::isSupported()
 	return GLAD_ES_VERSION_2_0 || (getGLSLVersion() >= "1.2");
 }
 
+bool Shader::isUniformBufferSupported()
+{
+	return GLAD_VERSION_3_1 || GLAD_ARB_uniform_buffer_object;
+}
+
 int Shader::getUniformTypeSize(GLenum type) const
 {
 	switch (type)
@@ -978,6 +1359,7 @@ StringMap<Shader::BuiltinUniform, Shader::BUILTIN_MAX_ENUM>::Entry Shader::built
 	{"love_VideoYChannel", Shader::BUILTIN_VIDEO_Y_CHANNEL},
 	{"love_VideoCbChannel", Shader::BUILTIN_VIDEO_CB_CHANNEL},
 	{"love_VideoCrChannel", Shader::BUILTIN_VIDEO_CR_CHANNEL},
+	{"love_ParticleQuads", Shader::BUILTIN_PARTICLE_QUADS},
 };
 
 StringMap<Shader::BuiltinUniform, Shader::BUILTIN_MAX_ENUM> Shader::builtinNames(Shader::builtinNameEntries, sizeof(Shader::builtinNameEntries));
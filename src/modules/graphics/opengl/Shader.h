@@ -67,6 +67,7 @@ public:
 		BUILTIN_VIDEO_Y_CHANNEL,
 		BUILTIN_VIDEO_CB_CHANNEL,
 		BUILTIN_VIDEO_CR_CHANNEL,
+		BUILTIN_PARTICLE_QUADS,
 		BUILTIN_MAX_ENUM
 	};
 
@@ -88,6 +89,23 @@ public:
 		std::string pixel;
 	};
 
+	// A uniform buffer object which backs every uniform block with the same
+	// name, in all Shaders. Blocks must be declared identically everywhere
+	// (GLSL's default 'shared' layout or std140 keep their layouts the same).
+	struct UniformBlock
+	{
+		GLuint buffer;
+		GLuint binding;
+		std::vector<char> data;
+
+		// Bytes which changed since the buffer was last uploaded.
+		size_t dirtyStart;
+		size_t dirtyEnd;
+
+		// Number of loaded Shaders which use the block.
+		int shaderCount;
+	};
+
 	struct UniformInfo
 	{
 		int location;
@@ -95,6 +113,17 @@ public:
 		int components;
 		UniformType baseType;
 		std::string name;
+
+		// Index of the CPU copy of the uniform's values, or -1 for samplers
+		// and members of uniform blocks.
+		int shadowIndex;
+
+		// Members of uniform blocks don't have a location. Their values live in
+		// the block's buffer, laid out as described by these byte offsets.
+		UniformBlock *block;
+		int blockOffset;
+		int arrayStride;
+		int matrixStride;
 	};
 
 	// Pointer to currently active Shader.
@@ -103,10 +132,16 @@ public:
 	// Pointer to the default Shader.
 	static Shader *defaultShader;
 	static Shader *defaultVideoShader;
+	static Shader *defaultParticleShader;
 
 	// Default shader code (a shader is always required internally.)
 	static ShaderSource defaultCode[Graphics::RENDERER_MAX_ENUM][2];
 	static ShaderSource defaultVideoCode[Graphics::RENDERER_MAX_ENUM][2];
+	static ShaderSource defaultParticleCode[Graphics::RENDERER_MAX_ENUM][2];
+
+	// Size of the quad table in the default particle shader. Must match the
+	// love_ParticleQuads array in wrap_Graphics.lua.
+	static const int MAX_PARTICLE_QUADS = 32;
 
 	/**
 	 * Creates a new Shader using a list of source codes.
@@ -140,6 +175,14 @@ public:
 
 	const UniformInfo *getUniformInfo(const std::string &name) const;
 
+	/**
+	 * Gets a handle which can be used to look up a uniform faster than by its
+	 * name, or -1 if the uniform doesn't exist. Handles stay valid for the
+	 * lifetime of the Shader.
+	 **/
+	int getUniformHandle(const std::string &name);
+	const UniformInfo *getUniformInfo(int handle) const;
+
 	void sendInts(const UniformInfo *info, const int *vec, int count);
 	void sendFloats(const UniformInfo *info, const float *vec, int count);
 	void sendMatrices(const UniformInfo *info, const float *m, int count);
@@ -166,10 +209,22 @@ public:
 	bool hasVertexAttrib(VertexAttribID attrib) const;
 
 	void setVideoTextures(GLuint ytexture, GLuint cbtexture, GLuint crtexture);
+
+	/**
+	 * Sets the quad table used by the instanced particle shader. Each quad is
+	 * two vec4s: its texture rectangle, and its size and the particle offset.
+	 **/
+	void setParticleQuads(const float *quads, int count);
 	void checkSetScreenParams();
 	void checkSetPointSize(float size);
 	void checkSetBuiltinUniforms();
 
+	/**
+	 * Uploads the values of uniforms which have changed since this Shader was
+	 * last used to draw. Must only be called while the Shader is active.
+	 **/
+	void uploadPendingUniforms();
+
 	const std::map<std::string, Object *> &getBoundRetainables() const;
 
 	GLuint getProgram() const
@@ -190,6 +245,7 @@ public:
 
 	static std::string getGLSLVersion();
 	static bool isSupported();
+	static bool isUniformBufferSupported();
 
 	static bool getConstant(const char *in, UniformType &out);
 	static bool getConstant(UniformType in, const char *&out);
@@ -199,8 +255,37 @@ public:
 
 private:
 
+	// A CPU copy of a uniform's values. Values sent to the Shader are only
+	// uploaded when it's next used to draw, and only if they changed.
+	struct UniformShadow
+	{
+		// Offset of the values in uniformData.
+		size_t offset;
+
+		// Number of leading array elements which have been sent.
+		int count;
+
+		bool pending;
+
+		// Bools can be sent as either ints or floats.
+		bool floats;
+	};
+
 	// Map active uniform names to their locations.
 	void mapActiveUniforms();
+	// Does the work of mapActiveUniforms while this program is bound.
+	void mapUniforms();
+
+	// Binds the program's uniform blocks to shared buffers. Returns the blocks
+	// in the order of their GL indices.
+	std::vector<UniformBlock *> mapUniformBlocks();
+	void releaseUniformBlocks();
+	void updateBlockUniform(const UniformInfo *info, const void *data, int count, bool floats);
+	static void uploadUniformBlocks();
+
+	void updateUniform(const UniformInfo *info, const void *data, int count, bool floats);
+	void uploadUniform(const UniformInfo *info, const UniformShadow &shadow);
+	size_t getUniformElementSize(const UniformInfo *info) const;
 
 	int getUniformTypeSize(GLenum type) const;
 	UniformType getUniformBaseType(GLenum type) const;
@@ -234,6 +319,18 @@ private:
 	// Uniform location buffer map
 	std::map<std::string, UniformInfo> uniforms;
 
+	std::vector<UniformShadow> uniformShadows;
+	std::vector<char> uniformData;
+	std::vector<const UniformInfo *> pendingUniforms;
+
+	// Names of the uniforms which handles were made for, and the uniforms they
+	// currently refer to.
+	std::vector<std::string> handleNames;
+	std::vector<const UniformInfo *> handleUniforms;
+
+	// Names of the uniform blocks this Shader uses.
+	std::vector<std::string> blockNames;
+
 	// Texture unit pool for setting images
 	std::map<std::string, GLint> texUnitPool; // texUnitPool[name] = textureunit
 	std::vector<GLuint> activeTexUnits; // activeTexUnits[textureunit-1] = textureid
@@ -247,8 +344,8 @@ private:
 
 	float lastPointSize;
 
-	Matrix4 lastTransformMatrix;
-	Matrix4 lastProjectionMatrix;
+	uint32 lastTransformVersion;
+	uint32 lastProjectionVersion;
 
 	GLuint videoTextureUnits[3];
 
@@ -257,6 +354,9 @@ private:
 	// Counts total number of textures bound to each texture unit in all shaders
 	static std::vector<int> textureCounters;
 
+	// Uniform blocks by name, shared by all Shaders.
+	static std::map<std::string, UniformBlock> uniformBlocks;
+
 	static StringMap<ShaderStage, STAGE_MAX_ENUM>::Entry stageNameEntries[];
 	static StringMap<ShaderStage, STAGE_MAX_ENUM> stageNames;
 
@@ -32,6 +32,7 @@
 #include <algorithm>
 
 // C
+#include <cmath>
 #include <stddef.h>
 
 namespace love
@@ -98,6 +99,82 @@ int SpriteBatch::addq(Quad *quad, float x, float y, float a, float sx, float sy,
 	return index;
 }
 
+int SpriteBatch::addBatch(const float *data, int count, BatchFormat format, const std::vector<Quad *> &quads)
+{
+	if (count < 0)
+		throw love::Exception("Invalid sprite count: %d", count);
+
+	count = std::min(count, size - next);
+
+	if (count == 0)
+		return -1;
+
+	const int components = getBatchFormatComponents(format);
+
+	// Look up the source vertices of every quad once, up front.
+	std::vector<const Vertex *> sources(quads.size() + 1);
+	sources[0] = texture->getVertices();
+	for (size_t i = 0; i < quads.size(); i++)
+		sources[i + 1] = quads[i]->getVertices();
+
+	const int numsources = (int) sources.size();
+
+	GLBuffer::Bind bind(*array_buf);
+
+	// Always keep the VBO mapped when adding data for now (it'll be unmapped
+	// on draw.)
+	Vertex *sprites = (Vertex *) array_buf->map() + next * 4;
+
+	for (int i = 0; i < count; i++)
+	{
+		const float *sprite = data + i * components;
+
+		int quadindex = (int) sprite[components - 1];
+		if (quadindex < 0 || quadindex >= numsources)
+			throw love::Exception("Invalid quad index %d for sprite %d.", quadindex, i + 1);
+
+		// Same transformation as Matrix3::setTransformation, minus the
+		// temporary matrix.
+		float a = 1.0f, b = 0.0f, c = 0.0f, d = 1.0f;
+		float tx = sprite[0], ty = sprite[1];
+
+		if (format == BATCH_FORMAT_TRANSFORM)
+		{
+			float sx = sprite[3], sy = sprite[4];
+			float ox = sprite[5], oy = sprite[6];
+			float kx = sprite[7], ky = sprite[8];
+			float cosr = cosf(sprite[2]), sinr = sinf(sprite[2]);
+
+			a = cosr * sx - ky * sinr * sy;
+			b = sinr * sx + ky * cosr * sy;
+			c = kx * cosr * sx - sinr * sy;
+			d = kx * sinr * sx + cosr * sy;
+			tx = sprite[0] - ox * a - oy * c;
+			ty = sprite[1] - ox * b - oy * d;
+		}
+
+		const Vertex *src = sources[quadindex];
+		Vertex *dst = sprites + i * 4;
+
+		for (int v = 0; v < 4; v++)
+		{
+			dst[v] = src[v];
+			dst[v].x = (a * src[v].x) + (c * src[v].y) + tx;
+			dst[v].y = (b * src[v].x) + (d * src[v].y) + ty;
+		}
+
+		if (color)
+			setColorv(dst, *color);
+	}
+
+	array_buf->setMappedRangeModified(next * 4 * sizeof(Vertex), count * 4 * sizeof(Vertex));
+
+	int first = next;
+	next += count;
+
+	return first;
+}
+
 void SpriteBatch::clear()
 {
 	// Reset the position of the next index.
@@ -230,8 +307,9 @@ void SpriteBatch::draw(float x, float y, float angle, float sx, float sy, float
 
 	OpenGL::TempDebugGroup debuggroup("SpriteBatch draw");
 
-	OpenGL::TempTransform transform(gl);
-	transform.get() *= Matrix4(x, y, angle, sx, sy, ox, oy, kx, ky);
+	gl.flushBatchedDraws();
+
+	OpenGL::TempTransform transform(gl, Matrix4(x, y, angle, sx, sy, ox, oy, kx, ky));
 
 	gl.bindTexture(*(GLuint *) texture->getHandle());
 
@@ -249,11 +327,11 @@ void SpriteBatch::draw(float x, float y, float angle, float sx, float sy, float
 		if (color)
 		{
 			enabledattribs |= ATTRIBFLAG_COLOR;
-			glVertexAttribPointer(ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), array_buf->getPointer(color_offset));
+			gl.setVertexAttribPointer(ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), array_buf->getPointer(color_offset));
 		}
 
-		glVertexAttribPointer(ATTRIB_POS, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), array_buf->getPointer(pos_offset));
-		glVertexAttribPointer(ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), array_buf->getPointer(texel_offset));
+		gl.setVertexAttribPointer(ATTRIB_POS, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), array_buf->getPointer(pos_offset));
+		gl.setVertexAttribPointer(ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), array_buf->getPointer(texel_offset));
 	}
 
 	for (const auto &it : attached_attributes)
@@ -299,6 +377,36 @@ void SpriteBatch::addv(const Vertex *v, const Matrix3 &m, int index)
 	array_buf->fill(index * sprite_size, sprite_size, sprite);
 }
 
+int SpriteBatch::getBatchFormatComponents(BatchFormat format)
+{
+	switch (format)
+	{
+	case BATCH_FORMAT_TRANSFORM:
+		return 10;
+	case BATCH_FORMAT_POSITION:
+	default:
+		return 3;
+	}
+}
+
+bool SpriteBatch::getConstant(const char *in, BatchFormat &out)
+{
+	return batchFormats.find(in, out);
+}
+
+bool SpriteBatch::getConstant(BatchFormat in, const char *&out)
+{
+	return batchFormats.find(in, out);
+}
+
+StringMap<SpriteBatch::BatchFormat, SpriteBatch::BATCH_FORMAT_MAX_ENUM>::Entry SpriteBatch::batchFormatEntries[] =
+{
+	{"transform", BATCH_FORMAT_TRANSFORM},
+	{"position", BATCH_FORMAT_POSITION},
+};
+
+StringMap<SpriteBatch::BatchFormat, SpriteBatch::BATCH_FORMAT_MAX_ENUM> SpriteBatch::batchFormats(SpriteBatch::batchFormatEntries, sizeof(SpriteBatch::batchFormatEntries));
+
 void SpriteBatch::setColorv(Vertex *v, const Color &color)
 {
 	for (size_t i = 0; i < 4; ++i)
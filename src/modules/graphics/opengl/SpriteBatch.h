@@ -26,10 +26,12 @@
 
 // C++
 #include <unordered_map>
+#include <vector>
 
 // LOVE
 #include "common/math.h"
 #include "common/Matrix.h"
+#include "common/StringMap.h"
 #include "graphics/Drawable.h"
 #include "graphics/Volatile.h"
 #include "graphics/Color.h"
@@ -52,11 +54,33 @@ class SpriteBatch : public Drawable
 {
 public:
 
+	// Layouts of the per-sprite floats given to addBatch.
+	enum BatchFormat
+	{
+		BATCH_FORMAT_TRANSFORM, // x, y, r, sx, sy, ox, oy, kx, ky, quad
+		BATCH_FORMAT_POSITION,  // x, y, quad
+		BATCH_FORMAT_MAX_ENUM
+	};
+
 	SpriteBatch(Texture *texture, int size, Mesh::Usage usage);
 	virtual ~SpriteBatch();
 
 	int add(float x, float y, float a, float sx, float sy, float ox, float oy, float kx, float ky, int index = -1);
 	int addq(Quad *quad, float x, float y, float a, float sx, float sy, float ox, float oy, float kx, float ky, int index = -1);
+
+	/**
+	 * Adds many sprites at once from tightly packed floats.
+	 *
+	 * @param data The per-sprite values, laid out according to format.
+	 * @param count The number of sprites in data. Only as many as fit in the
+	 *        remaining space of the SpriteBatch are added.
+	 * @param format The layout of each sprite's values.
+	 * @param quads Quads referenced by the quad value of each sprite, starting
+	 *        at 1. A quad value of 0 uses the whole texture.
+	 * @return The index of the first added sprite, or -1 if the SpriteBatch
+	 *         is full.
+	 **/
+	int addBatch(const float *data, int count, BatchFormat format, const std::vector<Quad *> &quads);
 	void clear();
 
 	void flush();
@@ -110,6 +134,12 @@ public:
 	// Implements Drawable.
 	void draw(float x, float y, float angle, float sx, float sy, float ox, float oy, float kx, float ky);
 
+	// Number of floats used by each sprite in the given batch format.
+	static int getBatchFormatComponents(BatchFormat format);
+
+	static bool getConstant(const char *in, BatchFormat &out);
+	static bool getConstant(BatchFormat in, const char *&out);
+
 private:
 
 	struct AttachedAttribute
@@ -146,6 +176,9 @@ private:
 
 	std::unordered_map<std::string, AttachedAttribute> attached_attributes;
 
+	static StringMap<BatchFormat, BATCH_FORMAT_MAX_ENUM>::Entry batchFormatEntries[];
+	static StringMap<BatchFormat, BATCH_FORMAT_MAX_ENUM> batchFormats;
+
 }; // SpriteBatch
 
 } // opengl
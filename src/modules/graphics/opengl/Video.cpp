@@ -116,6 +116,8 @@ love::video::VideoStream *Video::getStream()
 
 void Video::draw(float x, float y, float angle, float sx, float sy, float ox, float oy, float kx, float ky)
 {
+	gl.flushBatchedDraws();
+
 	update();
 
 	Shader *shader = Shader::current;
@@ -129,13 +131,12 @@ void Video::draw(float x, float y, float angle, float sx, float sy, float ox, fl
 
 	shader->setVideoTextures(textures[0], textures[1], textures[2]);
 
-	OpenGL::TempTransform transform(gl);
-	transform.get() *= Matrix4(x, y, angle, sx, sy, ox, oy, kx, ky);
+	OpenGL::TempTransform transform(gl, Matrix4(x, y, angle, sx, sy, ox, oy, kx, ky));
 
 	gl.useVertexAttribArrays(ATTRIBFLAG_POS | ATTRIBFLAG_TEXCOORD);
 
-	glVertexAttribPointer(ATTRIB_POS, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), &vertices[0].x);
-	glVertexAttribPointer(ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), &vertices[0].s);
+	gl.setVertexAttribPointer(ATTRIB_POS, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), &vertices[0].x);
+	gl.setVertexAttribPointer(ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), &vertices[0].s);
 
 	gl.prepareDraw();
 	gl.drawArrays(GL_TRIANGLE_STRIP, 0, 4);
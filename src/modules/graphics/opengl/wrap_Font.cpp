@@ -176,6 +176,52 @@ int w_Font_hasGlyphs(lua_State *L)
 	return 1;
 }
 
+int w_Font_preload(lua_State *L)
+{
+	Font *t = luax_checkfont(L, 1);
+	Font::Codepoints codepoints;
+
+	for (int i = 2; i <= lua_gettop(L); i++)
+	{
+		if (lua_type(L, i) == LUA_TSTRING)
+		{
+			const char *str = lua_tostring(L, i);
+			luax_catchexcept(L, [&](){ Font::getCodepointsFromString(str, codepoints); });
+		}
+		else if (lua_istable(L, i))
+		{
+			for (int j = 1; j <= (int) luax_objlen(L, i); j++)
+			{
+				lua_rawgeti(L, i, j);
+				codepoints.push_back((uint32) luaL_checknumber(L, -1));
+				lua_pop(L, 1);
+			}
+		}
+		else
+			codepoints.push_back((uint32) luaL_checknumber(L, i));
+	}
+
+	luax_catchexcept(L, [&](){ t->preload(codepoints); });
+	return 0;
+}
+
+int w_Font_setAsyncRasterizationEnabled(lua_State *L)
+{
+	Font *t = luax_checkfont(L, 1);
+	bool enable = luax_toboolean(L, 2);
+	bool enabled = false;
+	luax_catchexcept(L, [&](){ enabled = t->setAsyncRasterizationEnabled(enable); });
+	luax_pushboolean(L, enabled);
+	return 1;
+}
+
+int w_Font_isAsyncRasterizationEnabled(lua_State *L)
+{
+	Font *t = luax_checkfont(L, 1);
+	luax_pushboolean(L, t->isAsyncRasterizationEnabled());
+	return 1;
+}
+
 int w_Font_setFallbacks(lua_State *L)
 {
 	Font *t = luax_checkfont(L, 1);
@@ -201,6 +247,9 @@ static const luaL_Reg w_Font_functions[] =
 	{ "getDescent", w_Font_getDescent },
 	{ "getBaseline", w_Font_getBaseline },
 	{ "hasGlyphs", w_Font_hasGlyphs },
+	{ "preload", w_Font_preload },
+	{ "setAsyncRasterizationEnabled", w_Font_setAsyncRasterizationEnabled },
+	{ "isAsyncRasterizationEnabled", w_Font_isAsyncRasterizationEnabled },
 	{ "setFallbacks", w_Font_setFallbacks },
 	{ 0, 0 }
 };
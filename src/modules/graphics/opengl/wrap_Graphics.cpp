@@ -27,6 +27,8 @@
 #include "filesystem/wrap_Filesystem.h"
 #include "video/VideoStream.h"
 #include "image/wrap_Image.h"
+#include "thread/wrap_Channel.h"
+#include "common/Reference.h"
 
 #include <cassert>
 #include <cstring>
@@ -130,9 +132,48 @@ int w_discard(lua_State *L)
 	return 0;
 }
 
-int w_present(lua_State *)
+int w_present(lua_State *L)
 {
-	instance()->present();
+	// Screenshot functions are queued in this table by present, and called
+	// once it has returned so an error in one can't skip C++ cleanup.
+	lua_newtable(L);
+	int queue = lua_gettop(L);
+
+	int errindex = 0;
+
+	try
+	{
+		instance()->present(L);
+	}
+	catch (std::exception &e)
+	{
+		lua_pushstring(L, e.what());
+		errindex = lua_gettop(L);
+	}
+
+	int count = (int) luax_objlen(L, queue);
+
+	for (int i = 1; i + 1 <= count; i += 2)
+	{
+		lua_rawgeti(L, queue, i);
+		lua_rawgeti(L, queue, i + 1);
+
+		// Keep calling the rest, and re-raise the first error afterwards.
+		if (lua_pcall(L, 1, 0, 0) != 0)
+		{
+			if (errindex == 0)
+				errindex = lua_gettop(L);
+			else
+				lua_pop(L, 1);
+		}
+	}
+
+	if (errindex != 0)
+	{
+		lua_pushvalue(L, errindex);
+		return lua_error(L);
+	}
+
 	return 0;
 }
 
@@ -539,6 +580,26 @@ int w_newParticleSystem(lua_State *L)
 	return 1;
 }
 
+int w_updateParticleSystems(lua_State *L)
+{
+	luaL_checktype(L, 1, LUA_TTABLE);
+	float dt = (float) luaL_checknumber(L, 2);
+
+	size_t count = luax_objlen(L, 1);
+	std::vector<ParticleSystem *> systems;
+	systems.reserve(count);
+
+	for (size_t i = 1; i <= count; i++)
+	{
+		lua_rawgeti(L, 1, (int) i);
+		systems.push_back(luax_checkparticlesystem(L, -1));
+		lua_pop(L, 1);
+	}
+
+	luax_catchexcept(L, [&](){ instance()->updateParticleSystems(systems, dt); });
+	return 0;
+}
+
 int w_newCanvas(lua_State *L)
 {
 	luax_checkgraphicscreated(L);
@@ -1246,6 +1307,18 @@ int w_isWireframe(lua_State *L)
 	return 1;
 }
 
+int w_setAutoSegmentsEnabled(lua_State *L)
+{
+	instance()->setAutoSegmentsEnabled(luax_toboolean(L, 1));
+	return 0;
+}
+
+int w_isAutoSegmentsEnabled(lua_State *L)
+{
+	luax_pushboolean(L, instance()->isAutoSegmentsEnabled());
+	return 1;
+}
+
 int w_newScreenshot(lua_State *L)
 {
 	love::image::Image *image = luax_getmodule<love::image::Image>(L, MODULE_IMAGE_ID);
@@ -1259,6 +1332,71 @@ int w_newScreenshot(lua_State *L)
 	return 1;
 }
 
+// Adds the function and the ImageData to w_present's queue, which is at the top
+// of the stack.
+static void screenshotFunctionCallback(const Graphics::ScreenshotInfo *info, love::image::ImageData *i, void *ud)
+{
+	lua_State *L = (lua_State *) ud;
+	Reference *ref = (Reference *) info->data;
+
+	if (i != nullptr && L != nullptr && ref != nullptr)
+	{
+		int count = (int) luax_objlen(L, -1);
+
+		ref->push(L);
+		lua_rawseti(L, -2, count + 1);
+
+		luax_pushtype(L, IMAGE_IMAGE_DATA_ID, i);
+		lua_rawseti(L, -2, count + 2);
+	}
+
+	delete ref;
+}
+
+static void screenshotChannelCallback(const Graphics::ScreenshotInfo *info, love::image::ImageData *i, void *ud)
+{
+	lua_State *L = (lua_State *) ud;
+	love::thread::Channel *channel = (love::thread::Channel *) info->data;
+
+	if (i != nullptr && L != nullptr && channel != nullptr)
+	{
+		luax_pushtype(L, IMAGE_IMAGE_DATA_ID, i);
+		channel->push(Variant::fromLua(L, -1));
+		lua_pop(L, 1);
+	}
+
+	if (channel != nullptr)
+		channel->release();
+}
+
+int w_captureScreenshot(lua_State *L)
+{
+	Graphics::ScreenshotInfo info;
+
+	if (lua_isfunction(L, 1))
+	{
+		lua_pushvalue(L, 1);
+		info.data = luax_refif(L, LUA_TFUNCTION);
+		info.callback = screenshotFunctionCallback;
+	}
+	else if (luax_istype(L, 1, THREAD_CHANNEL_ID))
+	{
+		love::thread::Channel *channel = love::thread::luax_checkchannel(L, 1);
+		channel->retain();
+		info.data = channel;
+		info.callback = screenshotChannelCallback;
+	}
+	else
+		return luax_typerror(L, 1, "function or Channel");
+
+	luax_catchexcept(L,
+		[&]() { instance()->captureScreenshot(info); },
+		[&](bool except) { if (except) info.callback(&info, nullptr, nullptr); }
+	);
+
+	return 0;
+}
+
 int w_setCanvas(lua_State *L)
 {
 	// Disable stencil writes.
@@ -1359,19 +1497,25 @@ int w_setDefaultShaderCode(lua_State *L)
 			lua_getfield(L, -1, "vertex");
 			lua_getfield(L, -2, "pixel");
 			lua_getfield(L, -3, "videopixel");
+			lua_getfield(L, -4, "particlevertex");
 
 			Shader::ShaderSource code;
-			code.vertex = luax_checkstring(L, -3);
-			code.pixel = luax_checkstring(L, -2);
+			code.vertex = luax_checkstring(L, -4);
+			code.pixel = luax_checkstring(L, -3);
 
 			Shader::ShaderSource videocode;
-			videocode.vertex = luax_checkstring(L, -3);
-			videocode.pixel = luax_checkstring(L, -1);
+			videocode.vertex = luax_checkstring(L, -4);
+			videocode.pixel = luax_checkstring(L, -2);
 
-			lua_pop(L, 4);
+			Shader::ShaderSource particlecode;
+			particlecode.vertex = luax_checkstring(L, -1);
+			particlecode.pixel = luax_checkstring(L, -3);
+
+			lua_pop(L, 5);
 
 			Shader::defaultCode[renderer][i] = code;
 			Shader::defaultVideoCode[renderer][i] = videocode;
+			Shader::defaultParticleCode[renderer][i] = particlecode;
 		}
 	}
 
@@ -1473,7 +1617,7 @@ int w_getStats(lua_State *L)
 {
 	Graphics::Stats stats = instance()->getStats();
 
-	lua_createtable(L, 0, 7);
+	lua_createtable(L, 0, 14);
 
 	lua_pushinteger(L, stats.drawCalls);
 	lua_setfield(L, -2, "drawcalls");
@@ -1496,9 +1640,126 @@ int w_getStats(lua_State *L)
 	lua_pushinteger(L, stats.textureMemory);
 	lua_setfield(L, -2, "texturememory");
 
+	lua_pushinteger(L, stats.bytesStreamed);
+	lua_setfield(L, -2, "bytesstreamed");
+
+	lua_pushinteger(L, stats.bufferUploadBytes);
+	lua_setfield(L, -2, "bufferuploadbytes");
+
+	lua_pushinteger(L, stats.bufferUploadRanges);
+	lua_setfield(L, -2, "bufferuploadranges");
+
+	lua_pushinteger(L, stats.redundantCallsAvoided);
+	lua_setfield(L, -2, "redundantcallsavoided");
+
+	lua_pushinteger(L, stats.textLayoutHits);
+	lua_setfield(L, -2, "textlayouthits");
+
+	lua_pushinteger(L, stats.textLayoutMisses);
+	lua_setfield(L, -2, "textlayoutmisses");
+
+	lua_pushinteger(L, stats.skippedUniformUploads);
+	lua_setfield(L, -2, "skippeduniformuploads");
+
+	return 1;
+}
+
+int w_setProfilingEnabled(lua_State *L)
+{
+	instance()->setProfilingEnabled(luax_toboolean(L, 1));
+	return 0;
+}
+
+int w_isProfilingEnabled(lua_State *L)
+{
+	luax_pushboolean(L, instance()->isProfilingEnabled());
+	return 1;
+}
+
+int w_pushProfileScope(lua_State *L)
+{
+	std::string name = luax_checkstring(L, 1);
+	instance()->pushProfileScope(name);
+	return 0;
+}
+
+int w_popProfileScope(lua_State *)
+{
+	instance()->popProfileScope();
+	return 0;
+}
+
+int w_getProfile(lua_State *L)
+{
+	const Profiler::Frame *frame = instance()->getProfile();
+
+	if (frame == nullptr)
+	{
+		lua_pushnil(L);
+		return 1;
+	}
+
+	lua_createtable(L, 0, 5);
+
+	lua_pushnumber(L, (lua_Number) frame->index);
+	lua_setfield(L, -2, "frame");
+
+	lua_pushnumber(L, frame->cpuTime);
+	lua_setfield(L, -2, "cputime");
+
+	if (frame->gpuTime >= 0.0)
+	{
+		lua_pushnumber(L, frame->gpuTime);
+		lua_setfield(L, -2, "gputime");
+	}
+
+	lua_pushinteger(L, frame->droppedScopes);
+	lua_setfield(L, -2, "droppedscopes");
+
+	lua_createtable(L, (int) frame->scopes.size(), 0);
+
+	for (size_t i = 0; i < frame->scopes.size(); i++)
+	{
+		const Profiler::Scope &scope = frame->scopes[i];
+
+		lua_createtable(L, 0, 6);
+
+		lua_pushstring(L, scope.name);
+		lua_setfield(L, -2, "name");
+
+		lua_pushinteger(L, scope.depth + 1);
+		lua_setfield(L, -2, "depth");
+
+		lua_pushnumber(L, scope.cpuStart);
+		lua_setfield(L, -2, "cpustart");
+
+		lua_pushnumber(L, scope.cpuTime);
+		lua_setfield(L, -2, "cputime");
+
+		if (scope.gpuTime >= 0.0)
+		{
+			lua_pushnumber(L, scope.gpuStart);
+			lua_setfield(L, -2, "gpustart");
+
+			lua_pushnumber(L, scope.gpuTime);
+			lua_setfield(L, -2, "gputime");
+		}
+
+		lua_rawseti(L, -2, (int) i + 1);
+	}
+
+	lua_setfield(L, -2, "scopes");
+
 	return 1;
 }
 
+int w_saveProfile(lua_State *L)
+{
+	std::string filename = luax_checkstring(L, 1);
+	luax_catchexcept(L, [&]() { instance()->saveProfile(filename); });
+	return 0;
+}
+
 int w_draw(lua_State *L)
 {
 	Drawable *drawable = nullptr;
@@ -1745,7 +2006,9 @@ int w_rectangle(lua_State *L)
 	float ry = (float)luaL_optnumber(L, 7, rx);
 
 	int points;
-	if (lua_isnoneornil(L, 8))
+	if (lua_isnoneornil(L, 8) && instance()->isAutoSegmentsEnabled())
+		points = std::max(instance()->calculateEllipsePoints(rx, ry) / 4 - 1, 1);
+	else if (lua_isnoneornil(L, 8))
 		points = std::max(rx, ry) > 20.0 ? (int)(std::max(rx, ry) / 2) : 10;
 	else
 		points = (int) luaL_checknumber(L, 8);
@@ -1765,7 +2028,9 @@ int w_circle(lua_State *L)
 	float y = (float)luaL_checknumber(L, 3);
 	float radius = (float)luaL_checknumber(L, 4);
 	int points;
-	if (lua_isnoneornil(L, 5))
+	if (lua_isnoneornil(L, 5) && instance()->isAutoSegmentsEnabled())
+		points = instance()->calculateEllipsePoints(radius, radius);
+	else if (lua_isnoneornil(L, 5))
 		points = radius > 10 ? (int)(radius) : 10;
 	else
 		points = (int) luaL_checknumber(L, 5);
@@ -1787,7 +2052,9 @@ int w_ellipse(lua_State *L)
 	float b = (float)luaL_optnumber(L, 5, a);
 
 	int points;
-	if (lua_isnoneornil(L, 6))
+	if (lua_isnoneornil(L, 6) && instance()->isAutoSegmentsEnabled())
+		points = instance()->calculateEllipsePoints(a, b);
+	else if (lua_isnoneornil(L, 6))
 		points = a + b > 30 ? (int)((a + b) / 2) : 15;
 	else
 		points = (int) luaL_checknumber(L, 6);
@@ -1822,14 +2089,16 @@ int w_arc(lua_State *L)
 	float angle1 = (float) luaL_checknumber(L, startidx + 3);
 	float angle2 = (float) luaL_checknumber(L, startidx + 4);
 
-	int points = (int) radius;
+	bool autosegments = instance()->isAutoSegmentsEnabled();
+
+	int points = autosegments ? instance()->calculateEllipsePoints(radius, radius) : (int) radius;
 	float angle = fabs(angle1 - angle2);
 
 	// The amount of points is based on the fraction of the circle created by the arc.
 	if (angle < 2.0f * (float) LOVE_M_PI)
 		points *= angle / (2.0f * (float) LOVE_M_PI);
 
-	points = std::max(points, 10);
+	points = std::max(points, autosegments ? 2 : 10);
 	points = (int) luaL_optnumber(L, startidx + 5, points);
 
 	instance()->arc(drawmode, arcmode, x, y, radius, angle1, angle2, points);
@@ -1986,7 +2255,10 @@ static const luaL_Reg functions[] =
 	{ "getPointSize", w_getPointSize },
 	{ "setWireframe", w_setWireframe },
 	{ "isWireframe", w_isWireframe },
+	{ "setAutoSegmentsEnabled", w_setAutoSegmentsEnabled },
+	{ "isAutoSegmentsEnabled", w_isAutoSegmentsEnabled },
 	{ "newScreenshot", w_newScreenshot },
+	{ "captureScreenshot", w_captureScreenshot },
 	{ "setCanvas", w_setCanvas },
 	{ "getCanvas", w_getCanvas },
 
@@ -2000,8 +2272,15 @@ static const luaL_Reg functions[] =
 	{ "getRendererInfo", w_getRendererInfo },
 	{ "getSystemLimits", w_getSystemLimits },
 	{ "getStats", w_getStats },
+	{ "setProfilingEnabled", w_setProfilingEnabled },
+	{ "isProfilingEnabled", w_isProfilingEnabled },
+	{ "pushProfileScope", w_pushProfileScope },
+	{ "popProfileScope", w_popProfileScope },
+	{ "getProfile", w_getProfile },
+	{ "saveProfile", w_saveProfile },
 
 	{ "draw", w_draw },
+	{ "updateParticleSystems", w_updateParticleSystems },
 
 	{ "print", w_print },
 	{ "printf", w_printf },
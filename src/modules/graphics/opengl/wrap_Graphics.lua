@@ -151,6 +151,34 @@ void main() {
 #endif
 	gl_Position = position(TransformProjectionMatrix, VertexPosition);
 }]],
+
+	-- Used when drawing ParticleSystems with instancing. VertexPosition is
+	-- the quad corner in [0, 1], and the rest comes from each particle.
+	-- The array size must match Shader::MAX_PARTICLE_QUADS * 2.
+	FOOTER_PARTICLE = [[
+attribute vec4 ParticleTransform; // position, size, angle
+attribute float ParticleQuadIndex;
+
+// Texture rectangle, then size and offset, of each quad.
+uniform vec4 love_ParticleQuads[64];
+
+void main() {
+	int quad = int(ParticleQuadIndex) * 2;
+	vec4 texrect = love_ParticleQuads[quad];
+	vec4 geometry = love_ParticleQuads[quad + 1];
+
+	vec2 local = (VertexPosition.xy * geometry.xy - geometry.zw) * ParticleTransform.z;
+	float c = cos(ParticleTransform.w);
+	float s = sin(ParticleTransform.w);
+	vec2 pos = ParticleTransform.xy + vec2(c * local.x - s * local.y, s * local.x + c * local.y);
+
+	VaryingTexCoord = vec4(texrect.xy + VertexPosition.xy * texrect.zw, 0.0, 1.0);
+	VaryingColor = gammaCorrectColor(VertexColor) * ConstantColor;
+#ifdef GL_ES
+	gl_PointSize = love_PointSize;
+#endif
+	gl_Position = position(TransformProjectionMatrix, vec4(pos, 0.0, 1.0));
+}]],
 }
 
 GLSL.PIXEL = {
@@ -213,10 +241,13 @@ void main() {
 }]],
 }
 
-local function createShaderStageCode(stage, code, lang, gammacorrect, multicanvas)
+local function createShaderStageCode(stage, code, lang, gammacorrect, multicanvas, footer)
 	stage = stage:upper()
+	footer = footer or (multicanvas and "FOOTER_MULTI_CANVAS" or "FOOTER")
 	local lines = {
 		lang == "glsles" and GLSL.VERSION_ES or GLSL.VERSION,
+		-- Uniform blocks need GLSL 1.40, or this extension with our GLSL 1.20.
+		(lang == "glsl" and code:match("uniform%s+[%w_]+%s*{")) and "#extension GL_ARB_uniform_buffer_object : enable" or "",
 		GLSL.SYNTAX,
 		gammacorrect and "#define LOVE_GAMMA_CORRECT 1" or "",
 		GLSL[stage].HEADER,
@@ -225,7 +256,7 @@ local function createShaderStageCode(stage, code, lang, gammacorrect, multicanva
 		GLSL[stage].FUNCTIONS,
 		lang == "glsles" and "#line 1" or "#line 0",
 		code,
-		multicanvas and GLSL[stage].FOOTER_MULTI_CANVAS or GLSL[stage].FOOTER,
+		GLSL[stage][footer],
 	}
 	return table_concat(lines, "\n")
 end
@@ -342,6 +373,7 @@ for _, lang in ipairs{"glsl", "glsles"} do
 			vertex = createShaderStageCode("VERTEX", defaultcode.vertex, lang, gammacorrect),
 			pixel = createShaderStageCode("PIXEL", defaultcode.pixel, lang, gammacorrect, false),
 			videopixel = createShaderStageCode("PIXEL", defaultcode.videopixel, lang, gammacorrect, false),
+			particlevertex = createShaderStageCode("VERTEX", defaultcode.vertex, lang, gammacorrect, false, "FOOTER_PARTICLE"),
 		}
 	end
 end
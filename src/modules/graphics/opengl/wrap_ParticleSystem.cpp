@@ -25,6 +25,7 @@
 #include "Image.h"
 #include "Canvas.h"
 #include "graphics/wrap_Texture.h"
+#include "math/wrap_RandomGenerator.h"
 
 // C
 #include <cstring>
@@ -668,6 +669,22 @@ int w_ParticleSystem_reset(lua_State *L)
 	return 0;
 }
 
+int w_ParticleSystem_setSeed(lua_State *L)
+{
+	ParticleSystem *t = luax_checkparticlesystem(L, 1);
+	luax_catchexcept(L, [&](){ t->setSeed(love::math::luax_checkrandomseed(L, 2)); });
+	return 0;
+}
+
+int w_ParticleSystem_getSeed(lua_State *L)
+{
+	ParticleSystem *t = luax_checkparticlesystem(L, 1);
+	love::math::RandomGenerator::Seed s = t->getSeed();
+	lua_pushnumber(L, (lua_Number) s.b32.low);
+	lua_pushnumber(L, (lua_Number) s.b32.high);
+	return 2;
+}
+
 int w_ParticleSystem_emit(lua_State *L)
 {
 	ParticleSystem *t = luax_checkparticlesystem(L, 1);
@@ -762,6 +779,8 @@ static const luaL_Reg w_ParticleSystem_functions[] =
 	{ "stop", w_ParticleSystem_stop },
 	{ "pause", w_ParticleSystem_pause },
 	{ "reset", w_ParticleSystem_reset },
+	{ "setSeed", w_ParticleSystem_setSeed },
+	{ "getSeed", w_ParticleSystem_getSeed },
 	{ "emit", w_ParticleSystem_emit },
 	{ "isActive", w_ParticleSystem_isActive },
 	{ "isPaused", w_ParticleSystem_isPaused },
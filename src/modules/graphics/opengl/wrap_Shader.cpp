@@ -212,17 +212,30 @@ int w_Shader_sendTexture(lua_State *L, int startidx, Shader *shader, const Shade
 	return 0;
 }
 
-int w_Shader_send(lua_State *L)
+// Gets the uniform named by, or the uniform handle at, the given index.
+static const Shader::UniformInfo *_checkUniform(lua_State *L, int idx, Shader *shader)
 {
-	Shader *shader = luax_checkshader(L, 1);
-	const char *name = luaL_checkstring(L, 2);
+	const Shader::UniformInfo *info = nullptr;
 
-	const Shader::UniformInfo *info = shader->getUniformInfo(name);
-	if (info == nullptr)
-		return luaL_error(L, "Shader uniform '%s' does not exist.\nA common error is to define but not use the variable.", name);
+	if (lua_type(L, idx) == LUA_TNUMBER)
+	{
+		info = shader->getUniformInfo((int) lua_tointeger(L, idx));
+		if (info == nullptr)
+			luaL_error(L, "Invalid shader uniform handle.");
+	}
+	else
+	{
+		const char *name = luaL_checkstring(L, idx);
+		info = shader->getUniformInfo(name);
+		if (info == nullptr)
+			luaL_error(L, "Shader uniform '%s' does not exist.\nA common error is to define but not use the variable.", name);
+	}
 
-	int startidx = 3;
+	return info;
+}
 
+static int _sendUniform(lua_State *L, int startidx, Shader *shader, const Shader::UniformInfo *info)
+{
 	switch (info->baseType)
 	{
 	case Shader::UNIFORM_FLOAT:
@@ -236,18 +249,21 @@ int w_Shader_send(lua_State *L)
 	case Shader::UNIFORM_SAMPLER:
 		return w_Shader_sendTexture(L, startidx, shader, info);
 	default:
-		return luaL_error(L, "Unknown variable type for shader uniform '%s", name);
+		return luaL_error(L, "Unknown variable type for shader uniform '%s", info->name.c_str());
 	}
 }
 
-int w_Shader_sendColors(lua_State *L)
+int w_Shader_send(lua_State *L)
 {
 	Shader *shader = luax_checkshader(L, 1);
-	const char *name = luaL_checkstring(L, 2);
+	const Shader::UniformInfo *info = _checkUniform(L, 2, shader);
+	return _sendUniform(L, 3, shader, info);
+}
 
-	const Shader::UniformInfo *info = shader->getUniformInfo(name);
-	if (info == nullptr)
-		return luaL_error(L, "Shader uniform '%s' does not exist.\nA common error is to define but not use the variable.", name);
+int w_Shader_sendColors(lua_State *L)
+{
+	Shader *shader = luax_checkshader(L, 1);
+	const Shader::UniformInfo *info = _checkUniform(L, 2, shader);
 
 	if (info->baseType != Shader::UNIFORM_FLOAT || info->components < 3)
 		return luaL_error(L, "sendColor can only be used on vec3 or vec4 uniforms.");
@@ -255,6 +271,56 @@ int w_Shader_sendColors(lua_State *L)
 	return w_Shader_sendFloats(L, 3, shader, info, true);
 }
 
+int w_Shader_sendBatch(lua_State *L)
+{
+	Shader *shader = luax_checkshader(L, 1);
+	luaL_checktype(L, 2, LUA_TTABLE);
+
+	lua_pushnil(L);
+	while (lua_next(L, 2))
+	{
+		// The key is a uniform name or handle, and the value is what send
+		// takes for it. Arrays take a table of their elements.
+		int keyidx = lua_gettop(L) - 1;
+		int validx = lua_gettop(L);
+
+		if (lua_type(L, keyidx) != LUA_TNUMBER && lua_type(L, keyidx) != LUA_TSTRING)
+			return luaL_error(L, "Shader:sendBatch keys must be uniform names or handles.");
+
+		const Shader::UniformInfo *info = _checkUniform(L, keyidx, shader);
+
+		if (info->count > 1 && lua_istable(L, validx))
+		{
+			int count = (int) luax_objlen(L, validx);
+			for (int i = 1; i <= count; i++)
+				lua_rawgeti(L, validx, i);
+
+			_sendUniform(L, validx + 1, shader, info);
+		}
+		else
+			_sendUniform(L, validx, shader, info);
+
+		lua_settop(L, keyidx);
+	}
+
+	return 0;
+}
+
+int w_Shader_getUniformHandle(lua_State *L)
+{
+	Shader *shader = luax_checkshader(L, 1);
+	const char *name = luaL_checkstring(L, 2);
+
+	int handle = shader->getUniformHandle(name);
+
+	if (handle >= 0)
+		lua_pushinteger(L, handle);
+	else
+		lua_pushnil(L);
+
+	return 1;
+}
+
 int w_Shader_getExternVariable(lua_State *L)
 {
 	Shader *shader = luax_checkshader(L, 1);
@@ -297,6 +363,8 @@ static const luaL_Reg w_Shader_functions[] =
 	{ "sendTexture", w_Shader_send },
 	{ "send",        w_Shader_send },
 	{ "sendColor",   w_Shader_sendColors },
+	{ "sendBatch",   w_Shader_sendBatch },
+	{ "getUniformHandle", w_Shader_getUniformHandle },
 	{ "getExternVariable", w_Shader_getExternVariable },
 	{ 0, 0 }
 };
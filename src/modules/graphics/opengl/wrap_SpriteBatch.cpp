@@ -23,9 +23,11 @@
 #include "Image.h"
 #include "Canvas.h"
 #include "graphics/wrap_Texture.h"
+#include "common/Data.h"
 
 // C++
 #include <typeinfo>
+#include <vector>
 
 namespace love
 {
@@ -91,6 +93,69 @@ int w_SpriteBatch_set(lua_State *L)
 	return 0;
 }
 
+int w_SpriteBatch_addBatch(lua_State *L)
+{
+	SpriteBatch *t = luax_checkspritebatch(L, 1);
+
+	const float *data = nullptr;
+	size_t datasize = 0;
+
+	// A raw pointer (e.g. from Data:getPointer) can't be bounds-checked.
+	bool rawpointer = lua_islightuserdata(L, 2);
+
+	if (rawpointer)
+		data = (const float *) lua_touserdata(L, 2);
+	else
+	{
+		Data *d = luax_checktype<Data>(L, 2, DATA_ID);
+		data = (const float *) d->getData();
+		datasize = d->getSize();
+	}
+
+	int count = (int) luaL_checknumber(L, 3);
+
+	SpriteBatch::BatchFormat format = SpriteBatch::BATCH_FORMAT_TRANSFORM;
+	if (!lua_isnoneornil(L, 4))
+	{
+		const char *str = luaL_checkstring(L, 4);
+		if (!SpriteBatch::getConstant(str, format))
+			return luaL_error(L, "Invalid SpriteBatch batch format: %s", str);
+	}
+
+	std::vector<Quad *> quads;
+	if (!lua_isnoneornil(L, 5))
+	{
+		luaL_checktype(L, 5, LUA_TTABLE);
+		size_t numquads = luax_objlen(L, 5);
+		quads.reserve(numquads);
+
+		for (size_t i = 1; i <= numquads; i++)
+		{
+			lua_rawgeti(L, 5, (int) i);
+			quads.push_back(luax_checktype<Quad>(L, -1, GRAPHICS_QUAD_ID));
+			lua_pop(L, 1);
+		}
+	}
+
+	if (count < 0)
+		return luaL_error(L, "Invalid sprite count: %d", count);
+
+	size_t spritesize = sizeof(float) * SpriteBatch::getBatchFormatComponents(format);
+	if (!rawpointer && (size_t) count * spritesize > datasize)
+	{
+		const char *formatname = nullptr;
+		SpriteBatch::getConstant(format, formatname);
+		return luaL_error(L, "Data is too small for %d sprites in the '%s' format.", count, formatname);
+	}
+
+	int index = -1;
+	luax_catchexcept(L, [&](){ index = t->addBatch(data, count, format, quads); });
+
+	lua_pushinteger(L, index + 1);
+	lua_pushinteger(L, index >= 0 ? t->getCount() - index : 0);
+	return 2;
+}
+
 int w_SpriteBatch_clear(lua_State *L)
 {
 	SpriteBatch *t = luax_checkspritebatch(L, 1);
@@ -217,6 +282,7 @@ static const luaL_Reg w_SpriteBatch_functions[] =
 {
 	{ "add", w_SpriteBatch_add },
 	{ "set", w_SpriteBatch_set },
+	{ "addBatch", w_SpriteBatch_addBatch },
 	{ "clear", w_SpriteBatch_clear },
 	{ "flush", w_SpriteBatch_flush },
 	{ "setTexture", w_SpriteBatch_setTexture },
@@ -0,0 +1,945 @@
+/**
+ * Copyright (c) 2006-2016 LOVE Development Team
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ **/
+
+#include "BlockEncoder.h"
+#include "common/Exception.h"
+
+// C++
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+
+namespace love
+{
+namespace image
+{
+
+// Converts an 8 bit channel to the given number of bits, with rounding.
+static inline int quantize(int v, int bits)
+{
+	int max = (1 << bits) - 1;
+	return (v * max + 127) / 255;
+}
+
+// Converts a channel with the given number of bits back to 8 bits, the same
+// way the GPU does.
+static inline int expand(int v, int bits)
+{
+	return (v << (8 - bits)) | (v >> (2 * bits - 8));
+}
+
+static inline int clampChannel(int v)
+{
+	return std::min(std::max(v, 0), 255);
+}
+
+static inline int colorDistance(const int *a, const int *b)
+{
+	int dr = a[0] - b[0];
+	int dg = a[1] - b[1];
+	int db = a[2] - b[2];
+	return dr*dr + dg*dg + db*db;
+}
+
+static void loadColors(const pixel *block, int colors[16][3])
+{
+	for (int i = 0; i < 16; i++)
+	{
+		colors[i][0] = block[i].r;
+		colors[i][1] = block[i].g;
+		colors[i][2] = block[i].b;
+	}
+}
+
+/**
+ * DXT1 / BC1 color blocks, also used for the color half of DXT5 blocks.
+ **/
+
+static inline uint16 to565(const int *c)
+{
+	return (uint16) ((quantize(c[0], 5) << 11) | (quantize(c[1], 6) << 5) | quantize(c[2], 5));
+}
+
+static inline void from565(uint16 v, int *c)
+{
+	c[0] = expand((v >> 11) & 0x1F, 5);
+	c[1] = expand((v >> 5) & 0x3F, 6);
+	c[2] = expand(v & 0x1F, 5);
+}
+
+// Endpoint pairs whose 2/3 interpolant is as close as possible to each 8 bit
+// value, for blocks which are a single color. Ties go to the closest pair of
+// endpoints, so decoders which interpolate slightly differently still agree.
+struct SingleColorTables
+{
+	uint8 match5[256][2];
+	uint8 match6[256][2];
+
+	SingleColorTables()
+	{
+		build(match5, 5);
+		build(match6, 6);
+	}
+
+	static void build(uint8 table[256][2], int bits)
+	{
+		int count = 1 << bits;
+
+		for (int v = 0; v < 256; v++)
+		{
+			int besterror = INT_MAX;
+
+			for (int a = 0; a < count; a++)
+			{
+				for (int b = 0; b < count; b++)
+				{
+					int ea = expand(a, bits);
+					int eb = expand(b, bits);
+					int error = std::abs((2 * ea + eb + 1) / 3 - v) * 256 + std::abs(ea - eb);
+
+					if (error < besterror)
+					{
+						besterror = error;
+						table[v][0] = (uint8) a;
+						table[v][1] = (uint8) b;
+					}
+				}
+			}
+		}
+	}
+};
+
+static const SingleColorTables &getSingleColorTables()
+{
+	static const SingleColorTables tables;
+	return tables;
+}
+
+// Picks the closest of the 4 palette colors for each pixel. Returns the total
+// squared error.
+static int fitColorIndices(const int colors[16][3], uint16 c0, uint16 c1, uint32 &indices)
+{
+	int palette[4][3];
+	from565(c0, palette[0]);
+	from565(c1, palette[1]);
+
+	for (int c = 0; c < 3; c++)
+	{
+		palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+	}
+
+	int error = 0;
+	indices = 0;
+
+	for (int i = 0; i < 16; i++)
+	{
+		int best = 0;
+		int besterror = INT_MAX;
+
+		for (int j = 0; j < 4; j++)
+		{
+			int e = colorDistance(colors[i], palette[j]);
+			if (e < besterror)
+			{
+				besterror = e;
+				best = j;
+			}
+		}
+
+		indices |= (uint32) best << (i * 2);
+		error += besterror;
+	}
+
+	return error;
+}
+
+// Solves for the endpoints which best fit the pixels with a fixed set of
+// indices, in the least squares sense.
+static bool refineColorEndpoints(const int colors[16][3], uint32 indices, uint16 &c0, uint16 &c1)
+{
+	static const float weights[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+
+	float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+	float ax[3] = {0.0f, 0.0f, 0.0f};
+	float bx[3] = {0.0f, 0.0f, 0.0f};
+
+	for (int i = 0; i < 16; i++)
+	{
+		float a = weights[(indices >> (i * 2)) & 3];
+		float b = 1.0f - a;
+
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+
+		for (int c = 0; c < 3; c++)
+		{
+			ax[c] += a * colors[i][c];
+			bx[c] += b * colors[i][c];
+		}
+	}
+
+	float det = aa * bb - ab * ab;
+	if (fabsf(det) < 1e-4f)
+		return false;
+
+	int e0[3], e1[3];
+	for (int c = 0; c < 3; c++)
+	{
+		e0[c] = clampChannel((int) floorf((ax[c] * bb - bx[c] * ab) / det + 0.5f));
+		e1[c] = clampChannel((int) floorf((bx[c] * aa - ax[c] * ab) / det + 0.5f));
+	}
+
+	c0 = to565(e0);
+	c1 = to565(e1);
+	return true;
+}
+
+// Endpoints at the corners of the colors' bounding box, inset slightly since
+// the extremes are rarely worth representing exactly.
+static void boxEndpoints(const int colors[16][3], int *lo, int *hi)
+{
+	for (int c = 0; c < 3; c++)
+	{
+		lo[c] = 255;
+		hi[c] = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			lo[c] = std::min(lo[c], colors[i][c]);
+			hi[c] = std::max(hi[c], colors[i][c]);
+		}
+
+		int inset = (hi[c] - lo[c]) >> 4;
+		lo[c] += inset;
+		hi[c] -= inset;
+	}
+
+	// Use the diagonal of the box that follows how red and blue vary with
+	// green, rather than always going from darkest to brightest.
+	int center[3];
+	for (int c = 0; c < 3; c++)
+		center[c] = (lo[c] + hi[c]) / 2;
+
+	int covrg = 0, covbg = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		int dg = colors[i][1] - center[1];
+		covrg += (colors[i][0] - center[0]) * dg;
+		covbg += (colors[i][2] - center[2]) * dg;
+	}
+
+	if (covrg < 0)
+		std::swap(lo[0], hi[0]);
+	if (covbg < 0)
+		std::swap(lo[2], hi[2]);
+}
+
+// Endpoints at the pixels furthest apart along the colors' principal axis.
+static void principalAxisEndpoints(const int colors[16][3], int *lo, int *hi)
+{
+	float mean[3] = {0.0f, 0.0f, 0.0f};
+	int minc[3] = {255, 255, 255};
+	int maxc[3] = {0, 0, 0};
+
+	for (int i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			mean[c] += colors[i][c];
+			minc[c] = std::min(minc[c], colors[i][c]);
+			maxc[c] = std::max(maxc[c], colors[i][c]);
+		}
+	}
+
+	for (int c = 0; c < 3; c++)
+		mean[c] /= 16.0f;
+
+	// Covariance matrix: rr, rg, rb, gg, gb, bb.
+	float cov[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+	for (int i = 0; i < 16; i++)
+	{
+		float r = colors[i][0] - mean[0];
+		float g = colors[i][1] - mean[1];
+		float b = colors[i][2] - mean[2];
+
+		cov[0] += r * r;
+		cov[1] += r * g;
+		cov[2] += r * b;
+		cov[3] += g * g;
+		cov[4] += g * b;
+		cov[5] += b * b;
+	}
+
+	// Power iteration, starting from the bounding box's extent.
+	float axis[3] = {(float) (maxc[0] - minc[0]), (float) (maxc[1] - minc[1]), (float) (maxc[2] - minc[2])};
+
+	for (int iter = 0; iter < 4; iter++)
+	{
+		float r = axis[0] * cov[0] + axis[1] * cov[1] + axis[2] * cov[2];
+		float g = axis[0] * cov[1] + axis[1] * cov[3] + axis[2] * cov[4];
+		float b = axis[0] * cov[2] + axis[1] * cov[4] + axis[2] * cov[5];
+
+		float len = std::max(fabsf(r), std::max(fabsf(g), fabsf(b)));
+		if (len <= 0.0f)
+			break;
+
+		axis[0] = r / len;
+		axis[1] = g / len;
+		axis[2] = b / len;
+	}
+
+	float magnitude = fabsf(axis[0]) + fabsf(axis[1]) + fabsf(axis[2]);
+	if (magnitude < 1e-4f)
+	{
+		// Degenerate (e.g. every pixel is the same); project onto luma.
+		axis[0] = 0.299f;
+		axis[1] = 0.587f;
+		axis[2] = 0.114f;
+	}
+
+	int minidx = 0, maxidx = 0;
+	float mindot = FLT_MAX, maxdot = -FLT_MAX;
+
+	for (int i = 0; i < 16; i++)
+	{
+		float d = colors[i][0] * axis[0] + colors[i][1] * axis[1] + colors[i][2] * axis[2];
+		if (d < mindot)
+		{
+			mindot = d;
+			minidx = i;
+		}
+		if (d > maxdot)
+		{
+			maxdot = d;
+			maxidx = i;
+		}
+	}
+
+	for (int c = 0; c < 3; c++)
+	{
+		lo[c] = colors[minidx][c];
+		hi[c] = colors[maxidx][c];
+	}
+}
+
+static void encodeColorBlock(const pixel *block, BlockEncoder::Quality quality, uint8 *dst)
+{
+	int colors[16][3];
+	loadColors(block, colors);
+
+	bool solid = true;
+	for (int i = 1; i < 16 && solid; i++)
+		solid = colorDistance(colors[i], colors[0]) == 0;
+
+	uint16 c0, c1;
+	uint32 indices;
+
+	if (solid && quality != BlockEncoder::QUALITY_FAST)
+	{
+		const SingleColorTables &t = getSingleColorTables();
+		const int *c = colors[0];
+
+		c0 = (uint16) ((t.match5[c[0]][0] << 11) | (t.match6[c[1]][0] << 5) | t.match5[c[2]][0]);
+		c1 = (uint16) ((t.match5[c[0]][1] << 11) | (t.match6[c[1]][1] << 5) | t.match5[c[2]][1]);
+		fitColorIndices(colors, c0, c1, indices);
+	}
+	else
+	{
+		int lo[3], hi[3];
+		if (quality == BlockEncoder::QUALITY_FAST)
+			boxEndpoints(colors, lo, hi);
+		else
+			principalAxisEndpoints(colors, lo, hi);
+
+		c0 = to565(hi);
+		c1 = to565(lo);
+		int error = fitColorIndices(colors, c0, c1, indices);
+
+		int refinements = 0;
+		if (quality == BlockEncoder::QUALITY_NORMAL)
+			refinements = 1;
+		else if (quality == BlockEncoder::QUALITY_HIGH)
+			refinements = 4;
+
+		for (int i = 0; i < refinements && error > 0; i++)
+		{
+			uint16 n0, n1;
+			uint32 nindices;
+
+			if (!refineColorEndpoints(colors, indices, n0, n1))
+				break;
+
+			int nerror = fitColorIndices(colors, n0, n1, nindices);
+			if (nerror >= error)
+				break;
+
+			c0 = n0;
+			c1 = n1;
+			indices = nindices;
+			error = nerror;
+		}
+	}
+
+	// The 4 color mode is used when c0 > c1. Swapping the endpoints swaps
+	// indices 0 <-> 1 and 2 <-> 3. When they're equal every index is 0, since
+	// ties go to the first palette entry.
+	if (c0 < c1)
+	{
+		std::swap(c0, c1);
+		indices ^= 0x55555555;
+	}
+
+	dst[0] = (uint8) (c0 & 0xFF);
+	dst[1] = (uint8) (c0 >> 8);
+	dst[2] = (uint8) (c1 & 0xFF);
+	dst[3] = (uint8) (c1 >> 8);
+
+	for (int i = 0; i < 4; i++)
+		dst[4 + i] = (uint8) ((indices >> (i * 8)) & 0xFF);
+}
+
+/**
+ * DXT5 / BC3 alpha blocks.
+ **/
+
+static int fitAlphaIndices(const pixel *block, int a0, int a1, uint64 &indices)
+{
+	int palette[8];
+	palette[0] = a0;
+	palette[1] = a1;
+
+	if (a0 > a1)
+	{
+		for (int k = 1; k <= 6; k++)
+			palette[k + 1] = ((7 - k) * a0 + k * a1 + 3) / 7;
+	}
+	else
+	{
+		for (int k = 1; k <= 4; k++)
+			palette[k + 1] = ((5 - k) * a0 + k * a1 + 2) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+
+	int error = 0;
+	indices = 0;
+
+	for (int i = 0; i < 16; i++)
+	{
+		int best = 0;
+		int besterror = INT_MAX;
+
+		for (int j = 0; j < 8; j++)
+		{
+			int d = block[i].a - palette[j];
+			if (d * d < besterror)
+			{
+				besterror = d * d;
+				best = j;
+			}
+		}
+
+		indices |= (uint64) best << (i * 3);
+		error += besterror;
+	}
+
+	return error;
+}
+
+static void encodeAlphaBlock(const pixel *block, BlockEncoder::Quality quality, uint8 *dst)
+{
+	int mina = 255, maxa = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		mina = std::min(mina, (int) block[i].a);
+		maxa = std::max(maxa, (int) block[i].a);
+	}
+
+	int a0 = maxa;
+	int a1 = mina;
+	uint64 indices;
+	int error = fitAlphaIndices(block, a0, a1, indices);
+
+	if (quality != BlockEncoder::QUALITY_FAST && error > 0)
+	{
+		// The 6 value mode has exact 0 and 255 entries, so its endpoints only
+		// need to cover the alpha values in between.
+		int lo = 255, hi = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			if (block[i].a != 0 && block[i].a != 255)
+			{
+				lo = std::min(lo, (int) block[i].a);
+				hi = std::max(hi, (int) block[i].a);
+			}
+		}
+
+		if (lo <= hi)
+		{
+			uint64 indices6;
+			int error6 = fitAlphaIndices(block, lo, hi, indices6);
+
+			if (error6 < error)
+			{
+				a0 = lo;
+				a1 = hi;
+				indices = indices6;
+				error = error6;
+			}
+		}
+	}
+
+	if (quality == BlockEncoder::QUALITY_HIGH && error > 0 && a0 > a1)
+	{
+		// Pulling the 8 value mode's endpoints inwards often reduces the error
+		// of the values in between more than it costs at the extremes.
+		for (int inset0 = 0; inset0 <= 4; inset0++)
+		{
+			for (int inset1 = 0; inset1 <= 4; inset1++)
+			{
+				int n0 = maxa - inset0;
+				int n1 = mina + inset1;
+				if (n0 <= n1)
+					continue;
+
+				uint64 nindices;
+				int nerror = fitAlphaIndices(block, n0, n1, nindices);
+				if (nerror < error)
+				{
+					a0 = n0;
+					a1 = n1;
+					indices = nindices;
+					error = nerror;
+				}
+			}
+		}
+	}
+
+	dst[0] = (uint8) a0;
+	dst[1] = (uint8) a1;
+
+	for (int i = 0; i < 6; i++)
+		dst[2 + i] = (uint8) ((indices >> (i * 8)) & 0xFF);
+}
+
+/**
+ * ETC1 blocks. Each block is split into two 2x4 or 4x2 sub-blocks, and each
+ * sub-block has a base color plus a per-pixel intensity modifier.
+ **/
+
+static const int etcModifiers[8][2] =
+{
+	{2, 8}, {5, 17}, {9, 29}, {13, 42}, {18, 60}, {24, 80}, {33, 106}, {47, 183},
+};
+
+struct ETCSubblockFit
+{
+	int base[3]; // Quantized to 4 or 5 bits.
+	int table;
+	int modifiers[8];
+	int error;
+};
+
+// Finds the modifier table and per-pixel modifiers which best fit a sub-block
+// with the given 8 bit base color. Stops early once a table can't beat
+// besterror.
+static int fitETCModifiers(const int colors[16][3], const int *pixels, const int *base, int besterror, int &table, int *modifiers)
+{
+	int minbase = std::min(base[0], std::min(base[1], base[2]));
+	int maxbase = std::max(base[0], std::max(base[1], base[2]));
+
+	// The modifier is added to every channel, so unless it clamps the error is
+	// a quadratic in the modifier: sum((b - c)^2) + 2*m*sum(b - c) + 3*m^2.
+	int diffsum[8];
+	int baseerror[8];
+
+	for (int p = 0; p < 8; p++)
+	{
+		const int *c = colors[pixels[p]];
+		diffsum[p] = 0;
+		baseerror[p] = 0;
+
+		for (int ch = 0; ch < 3; ch++)
+		{
+			int d = base[ch] - c[ch];
+			diffsum[p] += d;
+			baseerror[p] += d * d;
+		}
+	}
+
+	for (int t = 0; t < 8; t++)
+	{
+		int large = etcModifiers[t][1];
+		bool clamps = maxbase + large > 255 || minbase - large < 0;
+
+		int error = 0;
+		int mods[8];
+		int p = 0;
+
+		for (; p < 8 && error < besterror; p++)
+		{
+			const int *c = colors[pixels[p]];
+			int best = INT_MAX;
+
+			for (int m = 0; m < 4; m++)
+			{
+				int delta = etcModifiers[t][m & 1];
+				if (m & 2)
+					delta = -delta;
+
+				int e = 0;
+				if (clamps)
+				{
+					for (int ch = 0; ch < 3; ch++)
+					{
+						int d = clampChannel(base[ch] + delta) - c[ch];
+						e += d * d;
+					}
+				}
+				else
+					e = baseerror[p] + delta * (3 * delta + 2 * diffsum[p]);
+
+				if (e < best)
+				{
+					best = e;
+					mods[p] = m;
+				}
+			}
+
+			error += best;
+		}
+
+		if (p == 8 && error < besterror)
+		{
+			besterror = error;
+			table = t;
+			std::copy(mods, mods + 8, modifiers);
+		}
+	}
+
+	return besterror;
+}
+
+static void fitETCBase(const int colors[16][3], const int *pixels, const int *q, int bits, ETCSubblockFit &fit)
+{
+	int base[3] = {expand(q[0], bits), expand(q[1], bits), expand(q[2], bits)};
+
+	int table = 0;
+	int modifiers[8];
+	int error = fitETCModifiers(colors, pixels, base, fit.error, table, modifiers);
+
+	if (error < fit.error)
+	{
+		std::copy(q, q + 3, fit.base);
+		fit.table = table;
+		std::copy(modifiers, modifiers + 8, fit.modifiers);
+		fit.error = error;
+	}
+}
+
+// Fits a sub-block starting from its quantized average color, keeping each
+// channel of the base color within [lo, hi]. When refining, neighboring base
+// colors are tried until none of them improve the fit.
+static ETCSubblockFit fitETCSubblock(const int colors[16][3], const int *pixels, const int *average, int bits, bool refine, const int *lo, const int *hi)
+{
+	ETCSubblockFit fit = {};
+	fit.error = INT_MAX;
+
+	int q[3];
+	for (int c = 0; c < 3; c++)
+		q[c] = std::min(std::max(quantize(average[c], bits), lo[c]), hi[c]);
+
+	fitETCBase(colors, pixels, q, bits, fit);
+
+	for (int iter = 0; refine && iter < 8 && fit.error > 0; iter++)
+	{
+		int start[3] = {fit.base[0], fit.base[1], fit.base[2]};
+		int error = fit.error;
+
+		for (int c = 0; c < 3; c++)
+		{
+			for (int dir = -1; dir <= 1; dir += 2)
+			{
+				int n[3] = {start[0], start[1], start[2]};
+				n[c] += dir;
+
+				if (n[c] >= lo[c] && n[c] <= hi[c])
+					fitETCBase(colors, pixels, n, bits, fit);
+			}
+		}
+
+		if (fit.error >= error)
+			break;
+	}
+
+	return fit;
+}
+
+// Fits both sub-blocks in either differential or individual mode. Returns the
+// total squared error.
+static int fitETCSubblocks(const int colors[16][3], const int pixels[2][8], const int average[2][3], bool diff, bool refine, ETCSubblockFit fits[2])
+{
+	if (diff)
+	{
+		// The second base color is stored as a 3 bit signed offset from the
+		// first.
+		static const int lo0[3] = {0, 0, 0};
+		static const int hi0[3] = {31, 31, 31};
+		fits[0] = fitETCSubblock(colors, pixels[0], average[0], 5, refine, lo0, hi0);
+
+		int lo1[3], hi1[3];
+		for (int c = 0; c < 3; c++)
+		{
+			lo1[c] = std::max(fits[0].base[c] - 4, 0);
+			hi1[c] = std::min(fits[0].base[c] + 3, 31);
+		}
+		fits[1] = fitETCSubblock(colors, pixels[1], average[1], 5, refine, lo1, hi1);
+	}
+	else
+	{
+		static const int lo[3] = {0, 0, 0};
+		static const int hi[3] = {15, 15, 15};
+		fits[0] = fitETCSubblock(colors, pixels[0], average[0], 4, refine, lo, hi);
+		fits[1] = fitETCSubblock(colors, pixels[1], average[1], 4, refine, lo, hi);
+	}
+
+	return fits[0].error + fits[1].error;
+}
+
+static void encodeETC1Block(const pixel *block, BlockEncoder::Quality quality, uint8 *dst)
+{
+	int colors[16][3];
+	loadColors(block, colors);
+
+	int besterror = INT_MAX;
+	int bestflip = 0;
+	bool bestdiff = true;
+	ETCSubblockFit bestfits[2] = {};
+
+	// Indices into the block of the pixels in each sub-block, and their
+	// average colors. Sub-blocks are 2x4 side by side, or 4x2 stacked when
+	// flipped.
+	int pixels[2][2][8];
+	int average[2][2][3];
+
+	for (int flip = 0; flip < 2; flip++)
+	{
+		int count[2] = {0, 0};
+
+		for (int y = 0; y < 4; y++)
+		{
+			for (int x = 0; x < 4; x++)
+			{
+				int s = flip ? (y >= 2) : (x >= 2);
+				pixels[flip][s][count[s]++] = y * 4 + x;
+			}
+		}
+
+		for (int s = 0; s < 2; s++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				int sum = 0;
+				for (int p = 0; p < 8; p++)
+					sum += colors[pixels[flip][s][p]][c];
+				average[flip][s][c] = (sum + 4) / 8;
+			}
+		}
+
+		for (int diff = 1; diff >= 0; diff--)
+		{
+			// Individual mode only helps when the sub-blocks are too different
+			// for differential mode, which fast encoding doesn't bother with.
+			if (!diff && quality == BlockEncoder::QUALITY_FAST)
+				continue;
+
+			ETCSubblockFit fits[2];
+			int error = fitETCSubblocks(colors, pixels[flip], average[flip], diff != 0, false, fits);
+
+			if (error < besterror)
+			{
+				besterror = error;
+				bestflip = flip;
+				bestdiff = diff != 0;
+				std::copy(fits, fits + 2, bestfits);
+			}
+		}
+	}
+
+	// Only the best layout is worth searching nearby base colors for.
+	if (quality == BlockEncoder::QUALITY_HIGH && besterror > 0)
+	{
+		ETCSubblockFit fits[2];
+		int error = fitETCSubblocks(colors, pixels[bestflip], average[bestflip], bestdiff, true, fits);
+
+		if (error < besterror)
+			std::copy(fits, fits + 2, bestfits);
+	}
+
+	uint32 high = 0;
+	if (bestdiff)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			int delta = bestfits[1].base[c] - bestfits[0].base[c];
+			high |= (uint32) ((bestfits[0].base[c] << 3) | (delta & 7)) << (24 - c * 8);
+		}
+	}
+	else
+	{
+		for (int c = 0; c < 3; c++)
+			high |= (uint32) ((bestfits[0].base[c] << 4) | bestfits[1].base[c]) << (24 - c * 8);
+	}
+
+	high |= (uint32) ((bestfits[0].table << 5) | (bestfits[1].table << 2) | ((bestdiff ? 1 : 0) << 1) | bestflip);
+
+	// Pixel indices are stored column-major, with the high bit of every index
+	// in the upper 16 bits.
+	uint32 low = 0;
+	for (int s = 0; s < 2; s++)
+	{
+		for (int p = 0; p < 8; p++)
+		{
+			int i = pixels[bestflip][s][p];
+			int bit = (i % 4) * 4 + (i / 4);
+			int m = bestfits[s].modifiers[p];
+
+			low |= (uint32) (m >> 1) << (bit + 16);
+			low |= (uint32) (m & 1) << bit;
+		}
+	}
+
+	for (int i = 0; i < 4; i++)
+	{
+		dst[i] = (uint8) (high >> (24 - i * 8));
+		dst[4 + i] = (uint8) (low >> (24 - i * 8));
+	}
+}
+
+BlockEncoder::BlockEncoder(CompressedImageData::Format format, Quality quality, love::thread::WorkerPool *pool)
+	: format(format)
+	, quality(quality)
+	, pool(pool)
+	, blockSize(format == CompressedImageData::FORMAT_DXT5 ? 16 : 8)
+{
+	if (!isSupported(format))
+	{
+		const char *name = "unknown";
+		CompressedImageData::getConstant(format, name);
+		throw love::Exception("Cannot encode to the %s compressed format.", name);
+	}
+}
+
+size_t BlockEncoder::getEncodedSize(int width, int height) const
+{
+	return (size_t) ((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+}
+
+void BlockEncoder::encodeBlock(const pixel *block, uint8 *dst) const
+{
+	switch (format)
+	{
+	case CompressedImageData::FORMAT_DXT1:
+		encodeColorBlock(block, quality, dst);
+		break;
+	case CompressedImageData::FORMAT_DXT5:
+		encodeAlphaBlock(block, quality, dst);
+		encodeColorBlock(block, quality, dst + 8);
+		break;
+	case CompressedImageData::FORMAT_ETC1:
+		encodeETC1Block(block, quality, dst);
+		break;
+	default:
+		break;
+	}
+}
+
+void BlockEncoder::encode(const pixel *src, int width, int height, uint8 *dst) const
+{
+	int blocksx = (width + 3) / 4;
+	int blocksy = (height + 3) / 4;
+
+	auto encodeRow = [&](int by)
+	{
+		uint8 *out = dst + (size_t) by * blocksx * blockSize;
+		pixel block[16];
+
+		for (int bx = 0; bx < blocksx; bx++)
+		{
+			for (int y = 0; y < 4; y++)
+			{
+				int sy = std::min(by * 4 + y, height - 1);
+				for (int x = 0; x < 4; x++)
+				{
+					int sx = std::min(bx * 4 + x, width - 1);
+					block[y * 4 + x] = src[(size_t) sy * width + sx];
+				}
+			}
+
+			encodeBlock(block, out);
+			out += blockSize;
+		}
+	};
+
+	if (pool != nullptr)
+		pool->run(blocksy, encodeRow);
+	else
+	{
+		for (int by = 0; by < blocksy; by++)
+			encodeRow(by);
+	}
+}
+
+bool BlockEncoder::isSupported(CompressedImageData::Format format)
+{
+	switch (format)
+	{
+	case CompressedImageData::FORMAT_DXT1:
+	case CompressedImageData::FORMAT_DXT5:
+	case CompressedImageData::FORMAT_ETC1:
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool BlockEncoder::getConstant(const char *in, Quality &out)
+{
+	return qualities.find(in, out);
+}
+
+bool BlockEncoder::getConstant(Quality in, const char *&out)
+{
+	return qualities.find(in, out);
+}
+
+StringMap<BlockEncoder::Quality, BlockEncoder::QUALITY_MAX_ENUM>::Entry BlockEncoder::qualityEntries[] =
+{
+	{"fast", QUALITY_FAST},
+	{"normal", QUALITY_NORMAL},
+	{"high", QUALITY_HIGH},
+};
+
+StringMap<BlockEncoder::Quality, BlockEncoder::QUALITY_MAX_ENUM> BlockEncoder::qualities(BlockEncoder::qualityEntries, sizeof(BlockEncoder::qualityEntries));
+
+} // image
+} // love
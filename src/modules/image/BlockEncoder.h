@@ -0,0 +1,98 @@
+/**
+ * Copyright (c) 2006-2016 LOVE Development Team
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ **/
+
+#ifndef LOVE_IMAGE_BLOCK_ENCODER_H
+#define LOVE_IMAGE_BLOCK_ENCODER_H
+
+// LOVE
+#include "common/StringMap.h"
+#include "common/int.h"
+#include "thread/WorkerPool.h"
+#include "ImageData.h"
+#include "CompressedImageData.h"
+
+namespace love
+{
+namespace image
+{
+
+/**
+ * Encodes RGBA8 pixels into GPU-compressed 4x4 blocks. DXT1 and ETC1 only
+ * store color, so alpha is ignored when encoding to them. Images whose size
+ * isn't a multiple of 4 have their edge blocks padded with the nearest pixels.
+ **/
+class BlockEncoder
+{
+public:
+
+	// Higher qualities search more candidate endpoints for each block.
+	enum Quality
+	{
+		QUALITY_FAST,
+		QUALITY_NORMAL,
+		QUALITY_HIGH,
+		QUALITY_MAX_ENUM
+	};
+
+	/**
+	 * @param format The compressed format to encode to. Must be supported.
+	 * @param quality The amount of effort spent on each block.
+	 * @param pool Worker threads to spread rows of blocks across. May be null.
+	 **/
+	BlockEncoder(CompressedImageData::Format format, Quality quality, love::thread::WorkerPool *pool);
+
+	/**
+	 * Gets the size in bytes of an encoded image with the given dimensions.
+	 **/
+	size_t getEncodedSize(int width, int height) const;
+
+	/**
+	 * Encodes width * height pixels into dst, which must be at least
+	 * getEncodedSize(width, height) bytes.
+	 **/
+	void encode(const pixel *src, int width, int height, uint8 *dst) const;
+
+	/**
+	 * Gets whether pixels can be encoded to the given compressed format.
+	 **/
+	static bool isSupported(CompressedImageData::Format format);
+
+	static bool getConstant(const char *in, Quality &out);
+	static bool getConstant(Quality in, const char *&out);
+
+private:
+
+	void encodeBlock(const pixel *block, uint8 *dst) const;
+
+	CompressedImageData::Format format;
+	Quality quality;
+	love::thread::WorkerPool *pool;
+
+	size_t blockSize;
+
+	static StringMap<Quality, QUALITY_MAX_ENUM>::Entry qualityEntries[];
+	static StringMap<Quality, QUALITY_MAX_ENUM> qualities;
+
+}; // BlockEncoder
+
+} // image
+} // love
+
+#endif // LOVE_IMAGE_BLOCK_ENCODER_H
@@ -25,8 +25,14 @@
 #include "common/config.h"
 #include "common/Module.h"
 #include "filesystem/File.h"
+#include "thread/Channel.h"
 #include "ImageData.h"
 #include "CompressedImageData.h"
+#include "Resampler.h"
+#include "BlockEncoder.h"
+
+// C++
+#include <vector>
 
 namespace love
 {
@@ -60,9 +66,10 @@ public:
 	 * Creates empty ImageData with the given size.
 	 * @param width The width of the ImageData.
 	 * @param height The height of the ImageData.
+	 * @param format The pixel format of the ImageData.
 	 * @return The new ImageData.
 	 **/
-	virtual ImageData *newImageData(int width, int height) = 0;
+	virtual ImageData *newImageData(int width, int height, ImageData::PixelFormat format = ImageData::PIXELFORMAT_RGBA8) = 0;
 
 	/**
 	 * Creates empty ImageData with the given size.
@@ -71,9 +78,10 @@ public:
 	 * @param data The data to load into the ImageData.
 	 * @param own Whether the new ImageData should take ownership of the data or
 	 *        copy it.
+	 * @param format The pixel format of the data.
 	 * @return The new ImageData.
 	 **/
-	virtual ImageData *newImageData(int width, int height, void *data, bool own = false) = 0;
+	virtual ImageData *newImageData(int width, int height, void *data, bool own = false, ImageData::PixelFormat format = ImageData::PIXELFORMAT_RGBA8) = 0;
 
 	/**
 	 * Creates new CompressedImageData from FileData.
@@ -82,12 +90,72 @@ public:
 	 **/
 	virtual CompressedImageData *newCompressedData(love::filesystem::FileData *data) = 0;
 
+	/**
+	 * Creates new CompressedImageData by encoding an ImageData's pixels, spread
+	 * across a pool of worker threads.
+	 * @param data The ImageData to encode.
+	 * @param format The compressed format to encode to: DXT1, DXT5 or ETC1.
+	 * @param quality Trades encoding speed for quality.
+	 * @param mipmaps Whether to also generate and encode every mipmap level.
+	 * @param linear Whether the colors are linear, rather than sRGB. Affects
+	 *        mipmap generation and the sRGB flag of the result.
+	 * @return The new CompressedImageData.
+	 **/
+	virtual CompressedImageData *newCompressedData(ImageData *data, CompressedImageData::Format format, BlockEncoder::Quality quality, bool mipmaps, bool linear) = 0;
+
 	/**
 	 * Determines whether a FileData is Compressed image data or not.
 	 * @param data The FileData to test.
 	 **/
 	virtual bool isCompressed(love::filesystem::FileData *data) = 0;
 
+	/**
+	 * Encodes a copy of the ImageData's current pixels on a background thread.
+	 * The resulting FileData, or an error message string, is pushed to the
+	 * Channel when encoding finishes.
+	 * @param data The ImageData to encode.
+	 * @param format The format of the encoded data.
+	 * @param filename The filename of the resulting FileData.
+	 * @param writefile Whether to also write the file to the save directory.
+	 * @param level The compression level from 0 to 9, or -1 for the default.
+	 * @param channel The Channel which receives the result.
+	 **/
+	virtual void encodeAsync(ImageData *data, ImageData::EncodedFormat format, const std::string &filename, bool writefile, int level, love::thread::Channel *channel) = 0;
+
+	/**
+	 * Decodes several files at once, spread across a pool of worker threads.
+	 * Blocks until every file is decoded. If any file fails to decode, the
+	 * error is thrown after the rest have finished.
+	 * @param files The FileData containing the encoded image data.
+	 * @param decodetimes Receives the time in seconds spent decoding each file.
+	 * @return The new ImageData, in the same order as the files.
+	 **/
+	virtual std::vector<ImageData *> newImageDataBatch(const std::vector<love::filesystem::FileData *> &files, std::vector<double> &decodetimes) = 0;
+
+	/**
+	 * Like newImageDataBatch, but returns immediately. A table with the fields
+	 * 'index', 'filename', 'time' and either 'imagedata' or 'error' is pushed
+	 * to the Channel for each file as soon as it's done, so the results
+	 * arrive in the order they finish rather than the order of the files.
+	 **/
+	virtual void newImageDataBatchAsync(const std::vector<love::filesystem::FileData *> &files, love::thread::Channel *channel) = 0;
+
+	/**
+	 * Creates a resized copy of an ImageData, with the same pixel format.
+	 * @param src The ImageData to resize.
+	 * @param width The width of the new ImageData.
+	 * @param height The height of the new ImageData.
+	 * @param filter The filter used to resample the pixels.
+	 * @param linear Whether rgba8 colors are already linear, rather than sRGB.
+	 **/
+	virtual ImageData *newResizedImageData(ImageData *src, int width, int height, Resampler::Filter filter, bool linear) = 0;
+
+	/**
+	 * Creates every mipmap level below the given ImageData, each half the
+	 * size of the last, down to 1x1. The base level isn't included.
+	 **/
+	virtual std::vector<ImageData *> newMipmaps(ImageData *src, Resampler::Filter filter, bool linear) = 0;
+
 }; // Image
 
 } // image
@@ -19,6 +19,19 @@
  **/
 
 #include "ImageData.h"
+#include "common/config.h"
+#include "common/math.h"
+
+#if defined(LOVE_SIMD_SSE2)
+#include <emmintrin.h>
+#elif defined(LOVE_SIMD_NEON)
+#include <arm_neon.h>
+#endif
+
+// C++
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
 using love::thread::Lock;
 
@@ -29,6 +42,7 @@ namespace image
 
 ImageData::ImageData()
 	: data(nullptr)
+	, format(PIXELFORMAT_RGBA8)
 {
 }
 
@@ -38,7 +52,7 @@ ImageData::~ImageData()
 
 size_t ImageData::getSize() const
 {
-	return size_t(getWidth()*getHeight())*sizeof(pixel);
+	return size_t(getWidth()*getHeight())*getPixelSize(format);
 }
 
 void *ImageData::getData() const
@@ -61,21 +75,380 @@ int ImageData::getHeight() const
 	return height;
 }
 
+static inline unsigned char toUnorm8(float v)
+{
+	return (unsigned char) (std::min(std::max(v, 0.0f), 255.0f) + 0.5f);
+}
+
+static inline uint16 toUnorm16(float v)
+{
+	return (uint16) (std::min(std::max(v * 257.0f, 0.0f), 65535.0f) + 0.5f);
+}
+
+// Rounded division by 255 for values up to 255*255.
+static inline int div255(int x)
+{
+	x += 128;
+	return (x + (x >> 8)) >> 8;
+}
+
+#if defined(LOVE_SIMD_SSE2)
+
+static inline __m128i div255_epi16(__m128i x)
+{
+	x = _mm_add_epi16(x, _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+// Broadcasts the alpha of each of the two pixels in x (16 bits per channel)
+// to all four of its channels.
+static inline __m128i splatAlpha_epi16(__m128i x)
+{
+	x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(3, 3, 3, 3));
+	return _mm_shufflehi_epi16(x, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+#elif defined(LOVE_SIMD_NEON) && defined(__aarch64__)
+
+// Same rounding as div255 above.
+static inline uint8x8_t div255_u16(uint16x8_t x)
+{
+	return vrshrn_n_u16(vrsraq_n_u16(x, x, 8), 8);
+}
+
+#endif
+
+// Alpha mode: dst = src*m + dst*(1 - src.a), where m is src.a for the color
+// channels and 1 for alpha. Premultiplied mode: dst = src + dst*(1 - src.a).
+static void blendRGBA8(pixel *dst, const pixel *src, int count, bool premultiplied)
+{
+	int i = 0;
+
+#if defined(LOVE_SIMD_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i v255 = _mm_set1_epi16(255);
+	const __m128i amask = _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i s = _mm_loadu_si128((const __m128i *) (src + i));
+		__m128i d = _mm_loadu_si128((const __m128i *) (dst + i));
+
+		__m128i result[2];
+		for (int half = 0; half < 2; half++)
+		{
+			__m128i s16 = half == 0 ? _mm_unpacklo_epi8(s, zero) : _mm_unpackhi_epi8(s, zero);
+			__m128i d16 = half == 0 ? _mm_unpacklo_epi8(d, zero) : _mm_unpackhi_epi8(d, zero);
+
+			__m128i sa = splatAlpha_epi16(s16);
+			__m128i inv = _mm_sub_epi16(v255, sa);
+
+			if (premultiplied)
+			{
+				// Saturated by the pack below.
+				result[half] = _mm_add_epi16(s16, div255_epi16(_mm_mullo_epi16(d16, inv)));
+			}
+			else
+			{
+				__m128i m = _mm_or_si128(_mm_andnot_si128(amask, sa), _mm_and_si128(amask, v255));
+				result[half] = div255_epi16(_mm_add_epi16(_mm_mullo_epi16(s16, m), _mm_mullo_epi16(d16, inv)));
+			}
+		}
+
+		_mm_storeu_si128((__m128i *) (dst + i), _mm_packus_epi16(result[0], result[1]));
+	}
+#elif defined(LOVE_SIMD_NEON) && defined(__aarch64__)
+	const uint8x8_t v255 = vdup_n_u8(255);
+
+	for (; i + 8 <= count; i += 8)
+	{
+		uint8x8x4_t s = vld4_u8((const uint8_t *) (src + i));
+		uint8x8x4_t d = vld4_u8((const uint8_t *) (dst + i));
+
+		uint8x8_t sa = s.val[3];
+		uint8x8_t inv = vsub_u8(v255, sa);
+
+		if (premultiplied)
+		{
+			for (int c = 0; c < 4; c++)
+				d.val[c] = vqadd_u8(s.val[c], div255_u16(vmull_u8(d.val[c], inv)));
+		}
+		else
+		{
+			for (int c = 0; c < 3; c++)
+				d.val[c] = div255_u16(vmlal_u8(vmull_u8(s.val[c], sa), d.val[c], inv));
+
+			d.val[3] = div255_u16(vmlal_u8(vmull_u8(sa, v255), d.val[3], inv));
+		}
+
+		vst4_u8((uint8_t *) (dst + i), d);
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		const pixel &s = src[i];
+		pixel &d = dst[i];
+
+		int inv = 255 - s.a;
+
+		if (premultiplied)
+		{
+			// Colors which weren't really premultiplied can overflow.
+			d.r = (unsigned char) std::min(s.r + div255(d.r * inv), 255);
+			d.g = (unsigned char) std::min(s.g + div255(d.g * inv), 255);
+			d.b = (unsigned char) std::min(s.b + div255(d.b * inv), 255);
+		}
+		else
+		{
+			d.r = (unsigned char) div255(s.r * s.a + d.r * inv);
+			d.g = (unsigned char) div255(s.g * s.a + d.g * inv);
+			d.b = (unsigned char) div255(s.b * s.a + d.b * inv);
+		}
+
+		d.a = (unsigned char) (s.a + div255(d.a * inv));
+	}
+}
+
+static void premultiplyRGBA8(pixel *p, size_t count)
+{
+	size_t i = 0;
+
+#if defined(LOVE_SIMD_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i amask = _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1);
+	const __m128i a255 = _mm_and_si128(amask, _mm_set1_epi16(255));
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *) (p + i));
+
+		__m128i lo = _mm_unpacklo_epi8(v, zero);
+		__m128i hi = _mm_unpackhi_epi8(v, zero);
+
+		// Alpha is multiplied by 255, which leaves it unchanged.
+		__m128i mlo = _mm_or_si128(_mm_andnot_si128(amask, splatAlpha_epi16(lo)), a255);
+		__m128i mhi = _mm_or_si128(_mm_andnot_si128(amask, splatAlpha_epi16(hi)), a255);
+
+		lo = div255_epi16(_mm_mullo_epi16(lo, mlo));
+		hi = div255_epi16(_mm_mullo_epi16(hi, mhi));
+
+		_mm_storeu_si128((__m128i *) (p + i), _mm_packus_epi16(lo, hi));
+	}
+#elif defined(LOVE_SIMD_NEON) && defined(__aarch64__)
+	for (; i + 8 <= count; i += 8)
+	{
+		uint8x8x4_t v = vld4_u8((const uint8_t *) (p + i));
+
+		for (int c = 0; c < 3; c++)
+			v.val[c] = div255_u16(vmull_u8(v.val[c], v.val[3]));
+
+		vst4_u8((uint8_t *) (p + i), v);
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		p[i].r = (unsigned char) div255(p[i].r * p[i].a);
+		p[i].g = (unsigned char) div255(p[i].g * p[i].a);
+		p[i].b = (unsigned char) div255(p[i].b * p[i].a);
+	}
+}
+
+static void unpremultiplyRGBA8(pixel *p, size_t count)
+{
+	// 255/a for every alpha value. Fully transparent pixels become black.
+	static const struct Factors
+	{
+		float f[256];
+		Factors()
+		{
+			f[0] = 0.0f;
+			for (int a = 1; a < 256; a++)
+				f[a] = 255.0f / (float) a;
+		}
+	} table;
+
+	const float *factors = table.f;
+
+	size_t i = 0;
+
+#if defined(LOVE_SIMD_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 half = _mm_set1_ps(0.5f);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *) (p + i));
+
+		__m128i lo = _mm_unpacklo_epi8(v, zero);
+		__m128i hi = _mm_unpackhi_epi8(v, zero);
+
+		__m128i px[4] = {
+			_mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+			_mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero),
+		};
+
+		for (int j = 0; j < 4; j++)
+		{
+			float f = factors[p[i + j].a];
+			__m128 c = _mm_mul_ps(_mm_cvtepi32_ps(px[j]), _mm_setr_ps(f, f, f, 1.0f));
+			px[j] = _mm_cvttps_epi32(_mm_add_ps(c, half));
+		}
+
+		// Both packs saturate, which clamps the color channels to 255.
+		lo = _mm_packs_epi32(px[0], px[1]);
+		hi = _mm_packs_epi32(px[2], px[3]);
+
+		_mm_storeu_si128((__m128i *) (p + i), _mm_packus_epi16(lo, hi));
+	}
+#elif defined(LOVE_SIMD_NEON) && defined(__aarch64__)
+	const float32x4_t half = vdupq_n_f32(0.5f);
+
+	for (; i + 8 <= count; i += 8)
+	{
+		uint8x8x4_t v = vld4_u8((const uint8_t *) (p + i));
+
+		float f[8];
+		for (int j = 0; j < 8; j++)
+			f[j] = factors[p[i + j].a];
+
+		float32x4_t flo = vld1q_f32(f);
+		float32x4_t fhi = vld1q_f32(f + 4);
+
+		for (int c = 0; c < 3; c++)
+		{
+			uint16x8_t c16 = vmovl_u8(v.val[c]);
+			float32x4_t clo = vmlaq_f32(half, vcvtq_f32_u32(vmovl_u16(vget_low_u16(c16))), flo);
+			float32x4_t chi = vmlaq_f32(half, vcvtq_f32_u32(vmovl_u16(vget_high_u16(c16))), fhi);
+
+			uint16x8_t r = vcombine_u16(vqmovn_u32(vcvtq_u32_f32(clo)), vqmovn_u32(vcvtq_u32_f32(chi)));
+			v.val[c] = vqmovn_u16(r);
+		}
+
+		vst4_u8((uint8_t *) (p + i), v);
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		float f = factors[p[i].a];
+		p[i].r = (unsigned char) std::min((int) (p[i].r * f + 0.5f), 255);
+		p[i].g = (unsigned char) std::min((int) (p[i].g * f + 0.5f), 255);
+		p[i].b = (unsigned char) std::min((int) (p[i].b * f + 0.5f), 255);
+	}
+}
+
+static void swizzleRGBA8(pixel *p, size_t count, const ImageData::SwizzleSource sources[4])
+{
+	size_t i = 0;
+
+#if defined(LOVE_SIMD_SSE2)
+	// Each output channel is shifted out of its source channel within the
+	// 32-bit pixel, or set to a constant.
+	__m128i shifts[4];
+	__m128i constant = _mm_setzero_si128();
+
+	for (int c = 0; c < 4; c++)
+	{
+		shifts[c] = _mm_cvtsi32_si128(8 * (sources[c] < ImageData::SWIZZLE_ZERO ? sources[c] : 0));
+		if (sources[c] == ImageData::SWIZZLE_ONE)
+			constant = _mm_or_si128(constant, _mm_set1_epi32(0xFF << (8 * c)));
+	}
+
+	const __m128i byte = _mm_set1_epi32(0xFF);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *) (p + i));
+		__m128i result = constant;
+
+		for (int c = 0; c < 4; c++)
+		{
+			if (sources[c] >= ImageData::SWIZZLE_ZERO)
+				continue;
+
+			__m128i channel = _mm_and_si128(_mm_srl_epi32(v, shifts[c]), byte);
+			result = _mm_or_si128(result, _mm_sll_epi32(channel, _mm_cvtsi32_si128(8 * c)));
+		}
+
+		_mm_storeu_si128((__m128i *) (p + i), result);
+	}
+#elif defined(LOVE_SIMD_NEON) && defined(__aarch64__)
+	// Table lookup indices for four pixels. Out-of-range indices give zero,
+	// and the constant mask fills in channels which should be 255.
+	uint8_t indices[16];
+	uint8_t constants[16];
+
+	for (int j = 0; j < 4; j++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			indices[j*4 + c] = sources[c] < ImageData::SWIZZLE_ZERO ? (uint8_t) (j*4 + sources[c]) : 0xFF;
+			constants[j*4 + c] = sources[c] == ImageData::SWIZZLE_ONE ? 0xFF : 0;
+		}
+	}
+
+	const uint8x16_t vindices = vld1q_u8(indices);
+	const uint8x16_t vconstants = vld1q_u8(constants);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		uint8x16_t v = vld1q_u8((const uint8_t *) (p + i));
+		vst1q_u8((uint8_t *) (p + i), vorrq_u8(vqtbl1q_u8(v, vindices), vconstants));
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		const unsigned char c[6] = {p[i].r, p[i].g, p[i].b, p[i].a, 0, 255};
+		p[i].r = c[sources[0]];
+		p[i].g = c[sources[1]];
+		p[i].b = c[sources[2]];
+		p[i].a = c[sources[3]];
+	}
+}
+
+SRGBTables::SRGBTables()
+{
+	for (int i = 0; i < 256; i++)
+	{
+		decode[i] = love::gammaToLinear(i / 255.0f);
+		toLinear[i] = toUnorm8(decode[i] * 255.0f);
+		toGamma[i] = toUnorm8(love::linearToGamma(i / 255.0f) * 255.0f);
+	}
+
+	for (int i = 0; i <= ENCODE_SIZE; i++)
+		encode[i] = toUnorm8(love::linearToGamma(i / (float) ENCODE_SIZE) * 255.0f);
+}
+
+const SRGBTables &SRGBTables::get()
+{
+	static const SRGBTables tables;
+	return tables;
+}
+
 void ImageData::setPixel(int x, int y, pixel c)
 {
 	if (!inside(x, y))
 		throw love::Exception("Attempt to set out-of-range pixel!");
 
 	Lock lock(mutex);
-
-	pixel *pixels = (pixel *) getData();
-	pixels[y*width+x] = c;
+	setPixelUnsafe(x, y, c);
 }
 
 void ImageData::setPixelUnsafe(int x, int y, pixel c)
 {
-	pixel *pixels = (pixel *) getData();
-	pixels[y*width+x] = c;
+	if (format == PIXELFORMAT_RGBA8)
+	{
+		pixel *pixels = (pixel *) getData();
+		pixels[y*width+x] = c;
+	}
+	else
+	{
+		pixelf p = {(float) c.r, (float) c.g, (float) c.b, (float) c.a};
+		setPixelUnsafe(x, y, p);
+	}
 }
 
 pixel ImageData::getPixel(int x, int y) const
@@ -84,24 +457,180 @@ pixel ImageData::getPixel(int x, int y) const
 		throw love::Exception("Attempt to get out-of-range pixel!");
 
 	Lock lock(mutex);
-
-	const pixel *pixels = (const pixel *) getData();
-	return pixels[y*width+x];
+	return getPixelUnsafe(x, y);
 }
 
 pixel ImageData::getPixelUnsafe(int x, int y) const
 {
-	const pixel *pixels = (const pixel *) getData();
-	return pixels[y*width+x];
+	if (format == PIXELFORMAT_RGBA8)
+	{
+		const pixel *pixels = (const pixel *) getData();
+		return pixels[y*width+x];
+	}
+
+	pixelf p = getPixelfUnsafe(x, y);
+	pixel c = {toUnorm8(p.r), toUnorm8(p.g), toUnorm8(p.b), toUnorm8(p.a)};
+	return c;
+}
+
+void ImageData::setPixel(int x, int y, const pixelf &p)
+{
+	if (!inside(x, y))
+		throw love::Exception("Attempt to set out-of-range pixel!");
+
+	Lock lock(mutex);
+	setPixelUnsafe(x, y, p);
+}
+
+void ImageData::setPixelUnsafe(int x, int y, const pixelf &p)
+{
+	size_t i = (size_t) y * width + x;
+
+	switch (format)
+	{
+	case PIXELFORMAT_RGBA8:
+	default:
+	{
+		pixel *pixels = (pixel *) data;
+		pixel c = {toUnorm8(p.r), toUnorm8(p.g), toUnorm8(p.b), toUnorm8(p.a)};
+		pixels[i] = c;
+		break;
+	}
+	case PIXELFORMAT_R8:
+		data[i] = toUnorm8(p.r);
+		break;
+	case PIXELFORMAT_RG8:
+		data[i*2 + 0] = toUnorm8(p.r);
+		data[i*2 + 1] = toUnorm8(p.g);
+		break;
+	case PIXELFORMAT_RGBA16:
+	{
+		uint16 *pixels = (uint16 *) data + i*4;
+		pixels[0] = toUnorm16(p.r);
+		pixels[1] = toUnorm16(p.g);
+		pixels[2] = toUnorm16(p.b);
+		pixels[3] = toUnorm16(p.a);
+		break;
+	}
+	case PIXELFORMAT_RGBA16F:
+	{
+		// Float formats are normalized so shaders see the same values as they
+		// would with the integer formats.
+		half *pixels = (half *) data + i*4;
+		pixels[0] = floatToHalf(p.r / 255.0f);
+		pixels[1] = floatToHalf(p.g / 255.0f);
+		pixels[2] = floatToHalf(p.b / 255.0f);
+		pixels[3] = floatToHalf(p.a / 255.0f);
+		break;
+	}
+	case PIXELFORMAT_RGBA32F:
+	{
+		float *pixels = (float *) data + i*4;
+		pixels[0] = p.r / 255.0f;
+		pixels[1] = p.g / 255.0f;
+		pixels[2] = p.b / 255.0f;
+		pixels[3] = p.a / 255.0f;
+		break;
+	}
+	}
+}
+
+pixelf ImageData::getPixelf(int x, int y) const
+{
+	if (!inside(x, y))
+		throw love::Exception("Attempt to get out-of-range pixel!");
+
+	Lock lock(mutex);
+	return getPixelfUnsafe(x, y);
+}
+
+pixelf ImageData::getPixelfUnsafe(int x, int y) const
+{
+	size_t i = (size_t) y * width + x;
+	pixelf p = {0.0f, 0.0f, 0.0f, 255.0f};
+
+	switch (format)
+	{
+	case PIXELFORMAT_RGBA8:
+	default:
+	{
+		const pixel &c = ((const pixel *) data)[i];
+		p.r = c.r;
+		p.g = c.g;
+		p.b = c.b;
+		p.a = c.a;
+		break;
+	}
+	case PIXELFORMAT_R8:
+		p.r = data[i];
+		break;
+	case PIXELFORMAT_RG8:
+		p.r = data[i*2 + 0];
+		p.g = data[i*2 + 1];
+		break;
+	case PIXELFORMAT_RGBA16:
+	{
+		const uint16 *pixels = (const uint16 *) data + i*4;
+		p.r = pixels[0] / 257.0f;
+		p.g = pixels[1] / 257.0f;
+		p.b = pixels[2] / 257.0f;
+		p.a = pixels[3] / 257.0f;
+		break;
+	}
+	case PIXELFORMAT_RGBA16F:
+	{
+		const half *pixels = (const half *) data + i*4;
+		p.r = halfToFloat(pixels[0]) * 255.0f;
+		p.g = halfToFloat(pixels[1]) * 255.0f;
+		p.b = halfToFloat(pixels[2]) * 255.0f;
+		p.a = halfToFloat(pixels[3]) * 255.0f;
+		break;
+	}
+	case PIXELFORMAT_RGBA32F:
+	{
+		const float *pixels = (const float *) data + i*4;
+		p.r = pixels[0] * 255.0f;
+		p.g = pixels[1] * 255.0f;
+		p.b = pixels[2] * 255.0f;
+		p.a = pixels[3] * 255.0f;
+		break;
+	}
+	}
+
+	return p;
+}
+
+ImageData::PixelFormat ImageData::getFormat() const
+{
+	return format;
+}
+
+void ImageData::copyRGBA8Unsafe(pixel *dst) const
+{
+	if (format == PIXELFORMAT_RGBA8)
+	{
+		memcpy(dst, data, getSize());
+		return;
+	}
+
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+			dst[y*width+x] = getPixelUnsafe(x, y);
+	}
 }
 
-void ImageData::paste(ImageData *src, int dx, int dy, int sx, int sy, int sw, int sh)
+void ImageData::paste(ImageData *src, int dx, int dy, int sx, int sy, int sw, int sh, BlendMode mode)
 {
+	if (src->getFormat() != getFormat())
+		throw love::Exception("Source and destination ImageData pixel formats must match.");
+
 	Lock lock2(src->mutex);
 	Lock lock1(mutex);
 
-	pixel *s = (pixel *)src->getData();
-	pixel *d = (pixel *)getData();
+	unsigned char *s = (unsigned char *)src->getData();
+	unsigned char *d = (unsigned char *)getData();
+	size_t pixelsize = getPixelSize(format);
 
 	// Check bounds; if the data ends up completely out of bounds, get out early.
 	if (sx >= src->getWidth() || sx + sw < 0 || sy >= src->getHeight() || sy + sh < 0
@@ -146,17 +675,205 @@ void ImageData::paste(ImageData *src, int dx, int dy, int sx, int sy, int sw, in
 	if (sy + sh > src->getHeight())
 		sh = src->getHeight() - sy;
 
+	if (mode != BLEND_REPLACE)
+	{
+		if (sw > 0)
+			blendRows(src, dx, dy, sx, sy, sw, sh, mode == BLEND_PREMULTIPLIED);
+	}
 	// If the dimensions match up, copy the entire memory stream in one go
-	if (sw == getWidth() && getWidth() == src->getWidth()
+	else if (sw == getWidth() && getWidth() == src->getWidth()
 		&& sh == getHeight() && getHeight() == src->getHeight())
 	{
-		memcpy(d, s, sizeof(pixel) * sw * sh);
+		memcpy(d, s, pixelsize * sw * sh);
 	}
 	else if (sw > 0)
 	{
 		// Otherwise, copy each row individually.
 		for (int i = 0; i < sh; i++)
-			memcpy(d + dx + (i + dy) * getWidth(), s + sx + (i + sy) * src->getWidth(), sizeof(pixel) * sw);
+			memcpy(d + (dx + (i + dy) * getWidth()) * pixelsize, s + (sx + (i + sy) * src->getWidth()) * pixelsize, pixelsize * sw);
+	}
+}
+
+void ImageData::blendRows(ImageData *src, int dx, int dy, int sx, int sy, int sw, int sh, bool premultiplied)
+{
+	if (format == PIXELFORMAT_RGBA8)
+	{
+		const pixel *s = (const pixel *) src->getData();
+		pixel *d = (pixel *) getData();
+
+		for (int i = 0; i < sh; i++)
+			blendRGBA8(d + dx + (i + dy) * width, s + sx + (i + sy) * src->getWidth(), sw, premultiplied);
+
+		return;
+	}
+
+	for (int y = 0; y < sh; y++)
+	{
+		for (int x = 0; x < sw; x++)
+		{
+			pixelf s = src->getPixelfUnsafe(sx + x, sy + y);
+			pixelf d = getPixelfUnsafe(dx + x, dy + y);
+
+			float inv = 1.0f - s.a / 255.0f;
+			float m = premultiplied ? 1.0f : s.a / 255.0f;
+
+			d.r = s.r * m + d.r * inv;
+			d.g = s.g * m + d.g * inv;
+			d.b = s.b * m + d.b * inv;
+			d.a = s.a + d.a * inv;
+
+			setPixelUnsafe(dx + x, dy + y, d);
+		}
+	}
+}
+
+void ImageData::fill(const pixelf &c, int x, int y, int w, int h)
+{
+	// Clip the rectangle to the bounds of the ImageData.
+	int x2 = std::min(x + w, width);
+	int y2 = std::min(y + h, height);
+	x = std::max(x, 0);
+	y = std::max(y, 0);
+
+	if (x >= x2 || y >= y2)
+		return;
+
+	Lock lock(mutex);
+
+	size_t pixelsize = getPixelSize(format);
+	size_t rowsize = (x2 - x) * pixelsize;
+	size_t stride = width * pixelsize;
+	unsigned char *first = data + y * stride + x * pixelsize;
+
+	// Encode the color once, then replicate it across the first row (doubling
+	// each time) and copy that row to the rest.
+	setPixelUnsafe(x, y, c);
+
+	for (size_t filled = pixelsize; filled < rowsize; filled *= 2)
+		memcpy(first + filled, first, std::min(filled, rowsize - filled));
+
+	for (int row = y + 1; row < y2; row++)
+		memcpy(first + (row - y) * stride, first, rowsize);
+}
+
+void ImageData::premultiplyAlpha()
+{
+	Lock lock(mutex);
+
+	if (format == PIXELFORMAT_RGBA8)
+	{
+		premultiplyRGBA8((pixel *) data, (size_t) width * height);
+		return;
+	}
+
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			pixelf p = getPixelfUnsafe(x, y);
+			float a = p.a / 255.0f;
+			p.r *= a;
+			p.g *= a;
+			p.b *= a;
+			setPixelUnsafe(x, y, p);
+		}
+	}
+}
+
+void ImageData::unpremultiplyAlpha()
+{
+	Lock lock(mutex);
+
+	if (format == PIXELFORMAT_RGBA8)
+	{
+		unpremultiplyRGBA8((pixel *) data, (size_t) width * height);
+		return;
+	}
+
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			pixelf p = getPixelfUnsafe(x, y);
+			float f = p.a != 0.0f ? 255.0f / p.a : 0.0f;
+			p.r *= f;
+			p.g *= f;
+			p.b *= f;
+			setPixelUnsafe(x, y, p);
+		}
+	}
+}
+
+void ImageData::swizzle(const SwizzleSource sources[4])
+{
+	Lock lock(mutex);
+
+	if (format == PIXELFORMAT_RGBA8)
+	{
+		swizzleRGBA8((pixel *) data, (size_t) width * height, sources);
+		return;
+	}
+
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			pixelf p = getPixelfUnsafe(x, y);
+			const float c[6] = {p.r, p.g, p.b, p.a, 0.0f, 255.0f};
+
+			p.r = c[sources[0]];
+			p.g = c[sources[1]];
+			p.b = c[sources[2]];
+			p.a = c[sources[3]];
+			setPixelUnsafe(x, y, p);
+		}
+	}
+}
+
+void ImageData::gammaToLinear()
+{
+	convertGamma(true);
+}
+
+void ImageData::linearToGamma()
+{
+	convertGamma(false);
+}
+
+void ImageData::convertGamma(bool tolinear)
+{
+	Lock lock(mutex);
+
+	if (format == PIXELFORMAT_RGBA8)
+	{
+		const SRGBTables &tables = SRGBTables::get();
+		const unsigned char *table = tolinear ? tables.toLinear : tables.toGamma;
+
+		pixel *pixels = (pixel *) data;
+		size_t count = (size_t) width * height;
+
+		for (size_t i = 0; i < count; i++)
+		{
+			pixels[i].r = table[pixels[i].r];
+			pixels[i].g = table[pixels[i].g];
+			pixels[i].b = table[pixels[i].b];
+		}
+
+		return;
+	}
+
+	float (*convert)(float) = tolinear ? love::gammaToLinear : love::linearToGamma;
+
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			pixelf p = getPixelfUnsafe(x, y);
+			p.r = convert(p.r / 255.0f) * 255.0f;
+			p.g = convert(p.g / 255.0f) * 255.0f;
+			p.b = convert(p.b / 255.0f) * 255.0f;
+			setPixelUnsafe(x, y, p);
+		}
 	}
 }
 
@@ -165,6 +882,81 @@ love::thread::Mutex *ImageData::getMutex() const
 	return mutex;
 }
 
+size_t ImageData::getPixelSize(PixelFormat format)
+{
+	switch (format)
+	{
+	case PIXELFORMAT_RGBA8:
+		return 4;
+	case PIXELFORMAT_R8:
+		return 1;
+	case PIXELFORMAT_RG8:
+		return 2;
+	case PIXELFORMAT_RGBA16:
+	case PIXELFORMAT_RGBA16F:
+		return 8;
+	case PIXELFORMAT_RGBA32F:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+float ImageData::halfToFloat(half h)
+{
+	uint32 sign = uint32(h & 0x8000) << 16;
+	uint32 exponent = (h >> 10) & 0x1F;
+	uint32 mantissa = h & 0x3FF;
+
+	if (exponent == 0)
+	{
+		// Zero or subnormal.
+		float f = ldexpf((float) mantissa, -24);
+		return sign ? -f : f;
+	}
+
+	uint32 bits;
+	if (exponent == 31)
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	else
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+
+	float f;
+	memcpy(&f, &bits, sizeof(float));
+	return f;
+}
+
+half ImageData::floatToHalf(float f)
+{
+	uint32 bits;
+	memcpy(&bits, &f, sizeof(uint32));
+
+	half sign = (half) ((bits >> 16) & 0x8000);
+	bits &= 0x7FFFFFFF;
+
+	// Inf and NaN.
+	if (bits >= 0x7F800000)
+		return sign | 0x7C00 | (bits > 0x7F800000 ? 0x200 : 0);
+
+	// Too large to be represented, even after rounding.
+	if (bits >= 0x477FF000)
+		return sign | 0x7C00;
+
+	// Zero or subnormal in half precision.
+	if (bits < 0x38800000)
+	{
+		float a;
+		memcpy(&a, &bits, sizeof(float));
+		return sign | (half) (a * 16777216.0f + 0.5f);
+	}
+
+	// Rebias the exponent and round the mantissa to nearest-even.
+	bits -= 112u << 23;
+	bits += 0xFFF + ((bits >> 13) & 1);
+
+	return sign | (half) (bits >> 13);
+}
+
 bool ImageData::getConstant(const char *in, EncodedFormat &out)
 {
 	return encodedFormats.find(in, out);
@@ -175,6 +967,26 @@ bool ImageData::getConstant(EncodedFormat in, const char *&out)
 	return encodedFormats.find(in, out);
 }
 
+bool ImageData::getConstant(const char *in, PixelFormat &out)
+{
+	return pixelFormats.find(in, out);
+}
+
+bool ImageData::getConstant(PixelFormat in, const char *&out)
+{
+	return pixelFormats.find(in, out);
+}
+
+bool ImageData::getConstant(const char *in, BlendMode &out)
+{
+	return blendModes.find(in, out);
+}
+
+bool ImageData::getConstant(BlendMode in, const char *&out)
+{
+	return blendModes.find(in, out);
+}
+
 StringMap<ImageData::EncodedFormat, ImageData::ENCODED_MAX_ENUM>::Entry ImageData::encodedFormatEntries[] =
 {
 	{"tga", ENCODED_TGA},
@@ -183,5 +995,26 @@ StringMap<ImageData::EncodedFormat, ImageData::ENCODED_MAX_ENUM>::Entry ImageDat
 
 StringMap<ImageData::EncodedFormat, ImageData::ENCODED_MAX_ENUM> ImageData::encodedFormats(ImageData::encodedFormatEntries, sizeof(ImageData::encodedFormatEntries));
 
+StringMap<ImageData::PixelFormat, ImageData::PIXELFORMAT_MAX_ENUM>::Entry ImageData::pixelFormatEntries[] =
+{
+	{"rgba8", PIXELFORMAT_RGBA8},
+	{"r8", PIXELFORMAT_R8},
+	{"rg8", PIXELFORMAT_RG8},
+	{"rgba16", PIXELFORMAT_RGBA16},
+	{"rgba16f", PIXELFORMAT_RGBA16F},
+	{"rgba32f", PIXELFORMAT_RGBA32F},
+};
+
+StringMap<ImageData::PixelFormat, ImageData::PIXELFORMAT_MAX_ENUM> ImageData::pixelFormats(ImageData::pixelFormatEntries, sizeof(ImageData::pixelFormatEntries));
+
+StringMap<ImageData::BlendMode, ImageData::BLEND_MAX_ENUM>::Entry ImageData::blendModeEntries[] =
+{
+	{"replace", BLEND_REPLACE},
+	{"alpha", BLEND_ALPHA},
+	{"premultiplied", BLEND_PREMULTIPLIED},
+};
+
+StringMap<ImageData::BlendMode, ImageData::BLEND_MAX_ENUM> ImageData::blendModes(ImageData::blendModeEntries, sizeof(ImageData::blendModeEntries));
+
 } // image
 } // love
@@ -23,6 +23,7 @@
 
 // LOVE
 #include "common/Data.h"
+#include "common/int.h"
 #include "filesystem/FileData.h"
 #include "thread/threads.h"
 
@@ -40,6 +41,41 @@ struct pixel
 	unsigned char r, g, b, a;
 };
 
+// Format-independent pixel, with components in the range of [0, 255]. Float
+// formats can store values outside of that range.
+struct pixelf
+{
+	float r, g, b, a;
+};
+
+typedef uint16 half;
+
+/**
+ * Lookup tables for converting 8 bit colors between sRGB and linear space,
+ * shared by ImageData and the Resampler. SSE2 and NEON can't gather, so
+ * tables are faster than converting each value.
+ **/
+struct SRGBTables
+{
+	// Going from linear floats back to sRGB uses a finer table, since linear
+	// values bunch up near zero.
+	static const int ENCODE_SIZE = 4096;
+
+	// sRGB [0, 255] to linear [0, 1].
+	float decode[256];
+
+	// Linear [0, 1] scaled to [0, ENCODE_SIZE], to sRGB [0, 255].
+	unsigned char encode[ENCODE_SIZE + 1];
+
+	// sRGB [0, 255] to linear [0, 255], and back.
+	unsigned char toLinear[256];
+	unsigned char toGamma[256];
+
+	SRGBTables();
+
+	static const SRGBTables &get();
+};
+
 /**
  * Represents raw pixel data.
  **/
@@ -54,6 +90,36 @@ public:
 		ENCODED_MAX_ENUM
 	};
 
+	enum PixelFormat
+	{
+		PIXELFORMAT_RGBA8,
+		PIXELFORMAT_R8,
+		PIXELFORMAT_RG8,
+		PIXELFORMAT_RGBA16,
+		PIXELFORMAT_RGBA16F,
+		PIXELFORMAT_RGBA32F,
+		PIXELFORMAT_MAX_ENUM
+	};
+
+	enum BlendMode
+	{
+		BLEND_REPLACE,
+		BLEND_ALPHA,
+		BLEND_PREMULTIPLIED,
+		BLEND_MAX_ENUM
+	};
+
+	// Where each channel gets its value from when swizzling.
+	enum SwizzleSource
+	{
+		SWIZZLE_R,
+		SWIZZLE_G,
+		SWIZZLE_B,
+		SWIZZLE_A,
+		SWIZZLE_ZERO,
+		SWIZZLE_ONE,
+	};
+
 	ImageData();
 	virtual ~ImageData();
 
@@ -66,8 +132,34 @@ public:
 	 * @param sy The source y-coordinate.
 	 * @param sw The source width.
 	 * @param sh The source height.
+	 * @param mode How the source pixels are combined with the destination.
 	 **/
-	void paste(ImageData *src, int dx, int dy, int sx, int sy, int sw, int sh);
+	void paste(ImageData *src, int dx, int dy, int sx, int sy, int sw, int sh, BlendMode mode = BLEND_REPLACE);
+
+	/**
+	 * Sets every pixel in a rectangle to the same color. The rectangle is
+	 * clipped to the bounds of the ImageData.
+	 **/
+	void fill(const pixelf &c, int x, int y, int w, int h);
+
+	/**
+	 * Multiplies (or divides) the color channels of every pixel by its alpha.
+	 **/
+	void premultiplyAlpha();
+	void unpremultiplyAlpha();
+
+	/**
+	 * Rearranges the channels of every pixel. Channel i of the result comes
+	 * from sources[i].
+	 **/
+	void swizzle(const SwizzleSource sources[4]);
+
+	/**
+	 * Converts the color channels of every pixel between sRGB and linear
+	 * space. Alpha is left alone.
+	 **/
+	void gammaToLinear();
+	void linearToGamma();
 
 	/**
 	 * Checks whether a position is inside this ImageData. Useful for checking bounds.
@@ -116,12 +208,35 @@ public:
 	 **/
 	pixel getPixelUnsafe(int x, int y) const;
 
+	/**
+	 * Format-independent versions of the above. Channels which the ImageData's
+	 * format doesn't have are ignored when setting, and read back as 0 (or
+	 * 255 for alpha).
+	 **/
+	void setPixel(int x, int y, const pixelf &p);
+	void setPixelUnsafe(int x, int y, const pixelf &p);
+	pixelf getPixelf(int x, int y) const;
+	pixelf getPixelfUnsafe(int x, int y) const;
+
+	/**
+	 * Gets the pixel format of this ImageData.
+	 **/
+	PixelFormat getFormat() const;
+
+	/**
+	 * Converts every pixel to RGBA8 and writes them to dst, which must have
+	 * room for width*height pixels. Encoders only understand RGBA8.
+	 * Not thread-safe!
+	 **/
+	void copyRGBA8Unsafe(pixel *dst) const;
+
 	/**
 	 * Encodes raw pixel data into a given format.
 	 * @param f The file to save the encoded image data to.
 	 * @param format The format of the encoded data.
+	 * @param level The compression level from 0 to 9, or -1 for the default.
 	 **/
-	virtual love::filesystem::FileData *encode(EncodedFormat format, const char *filename) = 0;
+	virtual love::filesystem::FileData *encode(EncodedFormat format, const char *filename, int level = -1) = 0;
 
 	love::thread::Mutex *getMutex() const;
 
@@ -129,9 +244,23 @@ public:
 	virtual void *getData() const;
 	virtual size_t getSize() const;
 
+	/**
+	 * Gets the size in bytes of a single pixel in the given format.
+	 **/
+	static size_t getPixelSize(PixelFormat format);
+
+	static float halfToFloat(half h);
+	static half floatToHalf(float f);
+
 	static bool getConstant(const char *in, EncodedFormat &out);
 	static bool getConstant(EncodedFormat in, const char *&out);
 
+	static bool getConstant(const char *in, PixelFormat &out);
+	static bool getConstant(PixelFormat in, const char *&out);
+
+	static bool getConstant(const char *in, BlendMode &out);
+	static bool getConstant(BlendMode in, const char *&out);
+
 protected:
 
 	// The width of the image data.
@@ -143,6 +272,9 @@ protected:
 	// The actual data.
 	unsigned char *data;
 
+	// The layout of each pixel in the data.
+	PixelFormat format;
+
 	// We need to be thread-safe
 	// so we lock when we're accessing our
 	// data
@@ -150,9 +282,20 @@ protected:
 
 private:
 
+	// Blends an already clipped rectangle of src onto this ImageData.
+	void blendRows(ImageData *src, int dx, int dy, int sx, int sy, int sw, int sh, bool premultiplied);
+
+	void convertGamma(bool tolinear);
+
 	static StringMap<EncodedFormat, ENCODED_MAX_ENUM>::Entry encodedFormatEntries[];
 	static StringMap<EncodedFormat, ENCODED_MAX_ENUM> encodedFormats;
 
+	static StringMap<PixelFormat, PIXELFORMAT_MAX_ENUM>::Entry pixelFormatEntries[];
+	static StringMap<PixelFormat, PIXELFORMAT_MAX_ENUM> pixelFormats;
+
+	static StringMap<BlendMode, BLEND_MAX_ENUM>::Entry blendModeEntries[];
+	static StringMap<BlendMode, BLEND_MAX_ENUM> blendModes;
+
 }; // ImageData
 
 } // image
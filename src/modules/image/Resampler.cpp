@@ -0,0 +1,402 @@
+/**
+ * Copyright (c) 2006-2016 LOVE Development Team
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ **/
+
+#include "Resampler.h"
+#include "common/config.h"
+#include "common/math.h"
+
+#if defined(LOVE_SIMD_SSE2)
+#include <emmintrin.h>
+#elif defined(LOVE_SIMD_NEON)
+#include <arm_neon.h>
+#endif
+
+// C++
+#include <algorithm>
+#include <cmath>
+
+namespace love
+{
+namespace image
+{
+
+// Rows per task when spreading work across threads.
+static const int ROWS_PER_TASK = 16;
+
+// Lanczos filter radius, in source pixels when magnifying.
+static const float LANCZOS_RADIUS = 3.0f;
+
+static float sinc(float x)
+{
+	if (x == 0.0f)
+		return 1.0f;
+
+	x *= (float) LOVE_M_PI;
+	return sinf(x) / x;
+}
+
+static float lanczos(float x)
+{
+	if (fabsf(x) >= LANCZOS_RADIUS)
+		return 0.0f;
+
+	return sinc(x) * sinc(x / LANCZOS_RADIUS);
+}
+
+// out[0..count) += in[0..count) * w
+static inline void accumulate(float *out, const float *in, float w, int count)
+{
+	int i = 0;
+
+#if defined(LOVE_SIMD_SSE2)
+	const __m128 vw = _mm_set1_ps(w);
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(_mm_loadu_ps(in + i), vw)));
+#elif defined(LOVE_SIMD_NEON) && defined(__aarch64__)
+	const float32x4_t vw = vdupq_n_f32(w);
+	for (; i + 4 <= count; i += 4)
+		vst1q_f32(out + i, vmlaq_f32(vld1q_f32(out + i), vld1q_f32(in + i), vw));
+#endif
+
+	for (; i < count; i++)
+		out[i] += in[i] * w;
+}
+
+// Weighted sum of count consecutive RGBA pixels.
+static inline void filterPixel(float *out, const float *in, const float *weights, int count)
+{
+#if defined(LOVE_SIMD_SSE2)
+	__m128 acc = _mm_setzero_ps();
+	for (int i = 0; i < count; i++)
+		acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(in + i*4), _mm_set1_ps(weights[i])));
+	_mm_storeu_ps(out, acc);
+#elif defined(LOVE_SIMD_NEON) && defined(__aarch64__)
+	float32x4_t acc = vdupq_n_f32(0.0f);
+	for (int i = 0; i < count; i++)
+		acc = vmlaq_n_f32(acc, vld1q_f32(in + i*4), weights[i]);
+	vst1q_f32(out, acc);
+#else
+	float acc[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+	for (int i = 0; i < count; i++)
+	{
+		for (int c = 0; c < 4; c++)
+			acc[c] += in[i*4 + c] * weights[i];
+	}
+	for (int c = 0; c < 4; c++)
+		out[c] = acc[c];
+#endif
+}
+
+Resampler::Resampler(Filter filter, bool linear, love::thread::WorkerPool *pool)
+	: filter(filter)
+	, linear(linear)
+	, pool(pool)
+	, width(0)
+	, height(0)
+{
+}
+
+int Resampler::getWidth() const
+{
+	return width;
+}
+
+int Resampler::getHeight() const
+{
+	return height;
+}
+
+void Resampler::forRows(int rows, const std::function<void(int, int)> &func) const
+{
+	int tasks = (rows + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+
+	auto task = [&](int i)
+	{
+		int first = i * ROWS_PER_TASK;
+		func(first, std::min(first + ROWS_PER_TASK, rows));
+	};
+
+	if (pool != nullptr)
+		pool->run(tasks, task);
+	else
+	{
+		for (int i = 0; i < tasks; i++)
+			task(i);
+	}
+}
+
+void Resampler::load(ImageData *src)
+{
+	love::thread::Lock lock(src->getMutex());
+
+	width = src->getWidth();
+	height = src->getHeight();
+	pixels.resize((size_t) width * height * 4);
+
+	bool srgb = !linear && src->getFormat() == ImageData::PIXELFORMAT_RGBA8;
+	const float *decode = SRGBTables::get().decode;
+
+	forRows(height, [&](int first, int last)
+	{
+		for (int y = first; y < last; y++)
+		{
+			float *row = &pixels[(size_t) y * width * 4];
+
+			for (int x = 0; x < width; x++)
+			{
+				float *p = row + x*4;
+
+				if (src->getFormat() == ImageData::PIXELFORMAT_RGBA8)
+				{
+					const pixel &c = ((const pixel *) src->getData())[(size_t) y * width + x];
+					if (srgb)
+					{
+						p[0] = decode[c.r];
+						p[1] = decode[c.g];
+						p[2] = decode[c.b];
+					}
+					else
+					{
+						p[0] = c.r / 255.0f;
+						p[1] = c.g / 255.0f;
+						p[2] = c.b / 255.0f;
+					}
+					p[3] = c.a / 255.0f;
+				}
+				else
+				{
+					pixelf c = src->getPixelfUnsafe(x, y);
+					p[0] = c.r / 255.0f;
+					p[1] = c.g / 255.0f;
+					p[2] = c.b / 255.0f;
+					p[3] = c.a / 255.0f;
+				}
+
+				// Premultiply so transparent pixels don't bleed their color
+				// into their neighbours.
+				p[0] *= p[3];
+				p[1] *= p[3];
+				p[2] *= p[3];
+			}
+		}
+	});
+}
+
+void Resampler::computeContributions(int srcsize, int dstsize, std::vector<Contribution> &contribs, std::vector<float> &weights) const
+{
+	// When minifying, the filter is stretched to cover the source pixels which
+	// map to each destination pixel.
+	float ratio = (float) srcsize / (float) dstsize;
+	float scale = std::max(ratio, 1.0f);
+	float radius = filter == FILTER_BOX ? 0.5f * scale : LANCZOS_RADIUS * scale;
+
+	contribs.resize(dstsize);
+	weights.clear();
+
+	for (int i = 0; i < dstsize; i++)
+	{
+		float center = (i + 0.5f) * ratio;
+
+		int first = std::max((int) floorf(center - radius), 0);
+		int last = std::min((int) ceilf(center + radius), srcsize - 1);
+
+		Contribution &c = contribs[i];
+		c.first = first;
+		c.count = 0;
+		c.weights = weights.size();
+
+		float total = 0.0f;
+
+		for (int j = first; j <= last; j++)
+		{
+			float w;
+			if (filter == FILTER_BOX)
+			{
+				// Coverage of source pixel j by the destination pixel.
+				float lo = std::max((float) j, center - radius);
+				float hi = std::min((float) (j + 1), center + radius);
+				w = std::max(hi - lo, 0.0f);
+			}
+			else
+				w = lanczos((j + 0.5f - center) / scale);
+
+			weights.push_back(w);
+			total += w;
+			c.count++;
+		}
+
+		// Normalize, which also makes up for the parts of the filter that
+		// fell outside of the source.
+		if (total != 0.0f)
+		{
+			for (int j = 0; j < c.count; j++)
+				weights[c.weights + j] /= total;
+		}
+	}
+}
+
+void Resampler::resize(int newwidth, int newheight)
+{
+	if (newwidth == width && newheight == height)
+		return;
+
+	std::vector<Contribution> contribs;
+	std::vector<float> weights;
+
+	// Horizontal pass: width x height -> newwidth x height.
+	std::vector<float> temp((size_t) newwidth * height * 4);
+	computeContributions(width, newwidth, contribs, weights);
+
+	forRows(height, [&](int first, int last)
+	{
+		for (int y = first; y < last; y++)
+		{
+			const float *in = &pixels[(size_t) y * width * 4];
+			float *out = &temp[(size_t) y * newwidth * 4];
+
+			for (int x = 0; x < newwidth; x++)
+			{
+				const Contribution &c = contribs[x];
+				filterPixel(out + x*4, in + c.first*4, &weights[c.weights], c.count);
+			}
+		}
+	});
+
+	// Vertical pass: newwidth x height -> newwidth x newheight. Whole rows are
+	// accumulated at once, which keeps the memory access sequential.
+	std::vector<float> result((size_t) newwidth * newheight * 4, 0.0f);
+	computeContributions(height, newheight, contribs, weights);
+
+	int rowfloats = newwidth * 4;
+
+	forRows(newheight, [&](int first, int last)
+	{
+		for (int y = first; y < last; y++)
+		{
+			const Contribution &c = contribs[y];
+			float *out = &result[(size_t) y * rowfloats];
+
+			for (int j = 0; j < c.count; j++)
+				accumulate(out, &temp[(size_t) (c.first + j) * rowfloats], weights[c.weights + j], rowfloats);
+		}
+	});
+
+	pixels.swap(result);
+	width = newwidth;
+	height = newheight;
+}
+
+void Resampler::store(ImageData *dst) const
+{
+	if (dst->getWidth() != width || dst->getHeight() != height)
+		throw love::Exception("Resampled ImageData size mismatch.");
+
+	love::thread::Lock lock(dst->getMutex());
+
+	bool rgba8 = dst->getFormat() == ImageData::PIXELFORMAT_RGBA8;
+	bool srgb = !linear && rgba8;
+
+	// Only float formats can hold colors outside of [0, 1].
+	bool clampcolor = dst->getFormat() != ImageData::PIXELFORMAT_RGBA16F
+		&& dst->getFormat() != ImageData::PIXELFORMAT_RGBA32F;
+
+	const unsigned char *encode = SRGBTables::get().encode;
+
+	forRows(height, [&](int first, int last)
+	{
+		for (int y = first; y < last; y++)
+		{
+			const float *row = &pixels[(size_t) y * width * 4];
+
+			for (int x = 0; x < width; x++)
+			{
+				const float *p = row + x*4;
+
+				float a = p[3];
+
+				if (clampcolor)
+				{
+					// The Lanczos filter's negative lobes can overshoot.
+					a = std::min(std::max(a, 0.0f), 1.0f);
+
+					// Dividing by an alpha which is stored as 0 would only
+					// amplify noise.
+					if (a < 0.5f / 255.0f)
+						a = 0.0f;
+				}
+
+				float inva = a > 0.0f ? 1.0f / a : 0.0f;
+
+				float c[3];
+				for (int i = 0; i < 3; i++)
+				{
+					c[i] = p[i] * inva;
+					if (clampcolor)
+						c[i] = std::min(std::max(c[i], 0.0f), 1.0f);
+				}
+
+				if (rgba8)
+				{
+					pixel &out = ((pixel *) dst->getData())[(size_t) y * width + x];
+					if (srgb)
+					{
+						const int size = SRGBTables::ENCODE_SIZE;
+						out.r = encode[(int) (c[0] * size + 0.5f)];
+						out.g = encode[(int) (c[1] * size + 0.5f)];
+						out.b = encode[(int) (c[2] * size + 0.5f)];
+					}
+					else
+					{
+						out.r = (unsigned char) (c[0] * 255.0f + 0.5f);
+						out.g = (unsigned char) (c[1] * 255.0f + 0.5f);
+						out.b = (unsigned char) (c[2] * 255.0f + 0.5f);
+					}
+					out.a = (unsigned char) (a * 255.0f + 0.5f);
+				}
+				else
+				{
+					pixelf out = {c[0] * 255.0f, c[1] * 255.0f, c[2] * 255.0f, a * 255.0f};
+					dst->setPixelUnsafe(x, y, out);
+				}
+			}
+		}
+	});
+}
+
+bool Resampler::getConstant(const char *in, Filter &out)
+{
+	return filters.find(in, out);
+}
+
+bool Resampler::getConstant(Filter in, const char *&out)
+{
+	return filters.find(in, out);
+}
+
+StringMap<Resampler::Filter, Resampler::FILTER_MAX_ENUM>::Entry Resampler::filterEntries[] =
+{
+	{"box", FILTER_BOX},
+	{"lanczos", FILTER_LANCZOS},
+};
+
+StringMap<Resampler::Filter, Resampler::FILTER_MAX_ENUM> Resampler::filters(Resampler::filterEntries, sizeof(Resampler::filterEntries));
+
+} // image
+} // love
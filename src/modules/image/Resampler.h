@@ -0,0 +1,117 @@
+/**
+ * Copyright (c) 2006-2016 LOVE Development Team
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ **/
+
+#ifndef LOVE_IMAGE_RESAMPLER_H
+#define LOVE_IMAGE_RESAMPLER_H
+
+// LOVE
+#include "common/StringMap.h"
+#include "thread/WorkerPool.h"
+#include "ImageData.h"
+
+// C++
+#include <vector>
+
+namespace love
+{
+namespace image
+{
+
+/**
+ * Resizes pixels in linear, premultiplied floating point. Pixels stay in that
+ * form between resizes, so building a mipmap chain one level at a time doesn't
+ * lose precision at each step.
+ **/
+class Resampler
+{
+public:
+
+	enum Filter
+	{
+		FILTER_BOX,
+		FILTER_LANCZOS,
+		FILTER_MAX_ENUM
+	};
+
+	/**
+	 * @param filter The filter used when resizing.
+	 * @param linear Whether rgba8 colors are already in linear space. Other
+	 *        formats are always treated as linear.
+	 * @param pool Worker threads to spread rows across. May be null.
+	 **/
+	Resampler(Filter filter, bool linear, love::thread::WorkerPool *pool);
+
+	/**
+	 * Replaces the current pixels with a copy of the ImageData's.
+	 **/
+	void load(ImageData *src);
+
+	/**
+	 * Resizes the current pixels.
+	 **/
+	void resize(int width, int height);
+
+	/**
+	 * Writes the current pixels to dst, which must have the same size.
+	 **/
+	void store(ImageData *dst) const;
+
+	int getWidth() const;
+	int getHeight() const;
+
+	static bool getConstant(const char *in, Filter &out);
+	static bool getConstant(Filter in, const char *&out);
+
+private:
+
+	// The source pixels which contribute to one destination pixel along an
+	// axis, and the offset of their weights in the weights array.
+	struct Contribution
+	{
+		int first;
+		int count;
+		size_t weights;
+	};
+
+	void computeContributions(int srcsize, int dstsize, std::vector<Contribution> &contribs, std::vector<float> &weights) const;
+
+	// Calls func(first, last) for chunks of the given rows, in parallel if
+	// there's a worker pool.
+	void forRows(int rows, const std::function<void(int, int)> &func) const;
+
+	Filter filter;
+	bool linear;
+	love::thread::WorkerPool *pool;
+
+	int width;
+	int height;
+
+	// Premultiplied linear RGBA, 4 floats per pixel.
+	std::vector<float> pixels;
+
+	static StringMap<Filter, FILTER_MAX_ENUM>::Entry filterEntries[];
+	static StringMap<Filter, FILTER_MAX_ENUM> filters;
+
+}; // Resampler
+
+} // image
+} // love
+
+#endif // LOVE_IMAGE_RESAMPLER_H
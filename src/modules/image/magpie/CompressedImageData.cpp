@@ -61,6 +61,66 @@ CompressedImageData::CompressedImageData(std::list<CompressedFormatHandler *> fo
 	}
 }
 
+CompressedImageData::CompressedImageData(const std::vector<love::image::ImageData *> &levels, Format format, BlockEncoder::Quality quality, bool sRGB, love::thread::WorkerPool *pool)
+{
+	if (levels.empty())
+		throw love::Exception("Could not encode compressed data: No ImageData given.");
+
+	BlockEncoder encoder(format, quality, pool);
+
+	for (love::image::ImageData *level : levels)
+	{
+		SubImage img;
+		img.width = level->getWidth();
+		img.height = level->getHeight();
+		img.size = encoder.getEncodedSize(img.width, img.height);
+		img.data = nullptr;
+
+		dataImages.push_back(img);
+		dataSize += img.size;
+	}
+
+	try
+	{
+		data = new uint8[dataSize];
+	}
+	catch (std::bad_alloc &)
+	{
+		throw love::Exception("Out of memory");
+	}
+
+	try
+	{
+		std::vector<pixel> pixels;
+		size_t offset = 0;
+
+		for (size_t i = 0; i < levels.size(); i++)
+		{
+			SubImage &img = dataImages[i];
+			img.data = data + offset;
+			offset += img.size;
+
+			// The encoder only understands rgba8, so other formats are
+			// converted while copying.
+			pixels.resize((size_t) img.width * img.height);
+			{
+				love::thread::Lock lock(levels[i]->getMutex());
+				levels[i]->copyRGBA8Unsafe(&pixels[0]);
+			}
+
+			encoder.encode(&pixels[0], img.width, img.height, img.data);
+		}
+	}
+	catch (std::exception &)
+	{
+		delete[] data;
+		throw;
+	}
+
+	this->format = format;
+	this->sRGB = sRGB;
+}
+
 CompressedImageData::~CompressedImageData()
 {
 	delete[] data;
@@ -25,9 +25,13 @@
 #include "CompressedFormatHandler.h"
 #include "filesystem/FileData.h"
 #include "image/CompressedImageData.h"
+#include "image/BlockEncoder.h"
+#include "image/ImageData.h"
+#include "thread/WorkerPool.h"
 
 // C++
 #include <list>
+#include <vector>
 
 namespace love
 {
@@ -41,6 +45,12 @@ class CompressedImageData : public love::image::CompressedImageData
 public:
 
 	CompressedImageData(std::list<CompressedFormatHandler *> formats, love::filesystem::FileData *filedata);
+
+	/**
+	 * Encodes ImageData into the given compressed format, with one mipmap
+	 * level per ImageData. sRGB marks whether the colors are gamma-encoded.
+	 **/
+	CompressedImageData(const std::vector<love::image::ImageData *> &levels, Format format, BlockEncoder::Quality quality, bool sRGB, love::thread::WorkerPool *pool);
 	virtual ~CompressedImageData();
 
 }; // CompressedImageData
@@ -88,9 +88,11 @@ public:
 	 * Encodes an image from raw pixel data into a particular format.
 	 * @param img The raw image data to encode.
 	 * @param format The format to encode to.
+	 * @param level Compression level from 0 (fastest) to 9 (smallest), or -1
+	 *        for the format's default. Formats without compression ignore it.
 	 * @return The encoded image data.
 	 **/
-	virtual EncodedImage encode(const DecodedImage &img, ImageData::EncodedFormat format);
+	virtual EncodedImage encode(const DecodedImage &img, ImageData::EncodedFormat format, int level);
 
 	/**
 	 * Frees memory allocated by the format handler.
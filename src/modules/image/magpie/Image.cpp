@@ -34,6 +34,19 @@
 #include "PKMHandler.h"
 #include "ASTCHandler.h"
 
+#include "filesystem/Filesystem.h"
+#include "timer/Timer.h"
+
+// SDL
+#include <SDL_cpuinfo.h>
+
+// C
+#include <cstring>
+
+// C++
+#include <algorithm>
+#include <memory>
+
 namespace love
 {
 namespace image
@@ -42,6 +55,9 @@ namespace magpie
 {
 
 Image::Image()
+	: encodeQueue(nullptr)
+	, decodeQueue(nullptr)
+	, workers(nullptr)
 {
 	formatHandlers = {
 		new PNGHandler,
@@ -59,6 +75,11 @@ Image::Image()
 
 Image::~Image()
 {
+	// Finishes any pending encodes and decodes, which use the format handlers.
+	delete encodeQueue;
+	delete decodeQueue;
+	delete workers;
+
 	// ImageData objects reference the FormatHandlers in our list, so we should
 	// release them instead of deleting them completely here.
 	for (FormatHandler *handler : formatHandlers)
@@ -78,14 +99,14 @@ love::image::ImageData *Image::newImageData(love::filesystem::FileData *data)
 	return new ImageData(formatHandlers, data);
 }
 
-love::image::ImageData *Image::newImageData(int width, int height)
+love::image::ImageData *Image::newImageData(int width, int height, ImageData::PixelFormat format)
 {
-	return new ImageData(formatHandlers, width, height);
+	return new ImageData(formatHandlers, width, height, format);
 }
 
-love::image::ImageData *Image::newImageData(int width, int height, void *data, bool own)
+love::image::ImageData *Image::newImageData(int width, int height, void *data, bool own, ImageData::PixelFormat format)
 {
-	return new ImageData(formatHandlers, width, height, data, own);
+	return new ImageData(formatHandlers, width, height, data, own, format);
 }
 
 love::image::CompressedImageData *Image::newCompressedData(love::filesystem::FileData *data)
@@ -93,6 +114,25 @@ love::image::CompressedImageData *Image::newCompressedData(love::filesystem::Fil
 	return new CompressedImageData(compressedFormatHandlers, data);
 }
 
+love::image::CompressedImageData *Image::newCompressedData(love::image::ImageData *data, CompressedImageData::Format format, BlockEncoder::Quality quality, bool mipmaps, bool linear)
+{
+	std::vector<StrongRef<love::image::ImageData>> levels;
+	levels.emplace_back(data);
+
+	if (mipmaps)
+	{
+		for (love::image::ImageData *level : newMipmaps(data, Resampler::FILTER_BOX, linear))
+			levels.emplace_back(level, Acquire::NORETAIN);
+	}
+
+	std::vector<love::image::ImageData *> levelptrs;
+	for (const auto &level : levels)
+		levelptrs.push_back(level.get());
+
+	love::thread::Lock lock(workerMutex);
+	return new CompressedImageData(levelptrs, format, quality, !linear, getWorkers());
+}
+
 bool Image::isCompressed(love::filesystem::FileData *data)
 {
 	for (CompressedFormatHandler *handler : compressedFormatHandlers)
@@ -104,6 +144,230 @@ bool Image::isCompressed(love::filesystem::FileData *data)
 	return false;
 }
 
+void Image::encodeAsync(love::image::ImageData *data, ImageData::EncodedFormat format, const std::string &filename, bool writefile, int level, love::thread::Channel *channel)
+{
+	// Copy the pixels so the ImageData can be used (and modified) while the
+	// copy is being encoded. The copy is always RGBA8, which is all the
+	// encoders understand.
+	FormatHandler::DecodedImage img;
+	img.width = data->getWidth();
+	img.height = data->getHeight();
+	img.size = img.width * img.height * sizeof(pixel);
+
+	// Owned by the task, so the copy is freed even if the task never runs or
+	// can't be queued.
+	std::shared_ptr<unsigned char> pixels;
+
+	try
+	{
+		pixels.reset(new unsigned char[img.size], std::default_delete<unsigned char[]>());
+	}
+	catch (std::bad_alloc &)
+	{
+		throw love::Exception("Out of memory");
+	}
+
+	img.data = pixels.get();
+
+	{
+		love::thread::Lock lock(data->getMutex());
+		data->copyRGBA8Unsafe((pixel *) img.data);
+	}
+
+	if (encodeQueue == nullptr)
+		encodeQueue = new love::thread::TaskQueue("love.image encoder");
+
+	StrongRef<love::thread::Channel> channelref(channel);
+
+	encodeQueue->push([this, img, pixels, format, filename, writefile, level, channelref]()
+	{
+		try
+		{
+			love::filesystem::FileData *fd = ImageData::encodeImage(formatHandlers, img, format, filename.c_str(), level);
+			StrongRef<love::filesystem::FileData> filedata(fd, Acquire::NORETAIN);
+
+			if (writefile)
+			{
+				auto fs = Module::getInstance<love::filesystem::Filesystem>(M_FILESYSTEM);
+				if (fs == nullptr)
+					throw love::Exception("love.filesystem is not loaded, cannot write '%s'.", filename.c_str());
+
+				fs->write(filename.c_str(), filedata->getData(), filedata->getSize());
+			}
+
+			Proxy p;
+			p.type = FILESYSTEM_FILE_DATA_ID;
+			p.object = filedata.get();
+			channelref->push(Variant(FILESYSTEM_FILE_DATA_ID, &p));
+		}
+		catch (std::exception &e)
+		{
+			channelref->push(Variant(e.what(), strlen(e.what())));
+		}
+	}, nullptr);
+}
+
+love::thread::WorkerPool *Image::getWorkers()
+{
+	if (workers == nullptr)
+	{
+		// The thread running the batch takes part in the work too.
+		int threads = std::max(SDL_GetCPUCount() - 1, 0);
+		workers = new love::thread::WorkerPool("love.image worker", threads);
+	}
+
+	return workers;
+}
+
+std::vector<love::image::ImageData *> Image::newImageDataBatch(const std::vector<love::filesystem::FileData *> &files, std::vector<double> &decodetimes)
+{
+	std::vector<love::image::ImageData *> results(files.size(), nullptr);
+	decodetimes.assign(files.size(), 0.0);
+
+	try
+	{
+		love::thread::Lock lock(workerMutex);
+
+		getWorkers()->run((int) files.size(), [&](int i)
+		{
+			double start = love::timer::Timer::getTime();
+			results[i] = new ImageData(formatHandlers, files[i]);
+			decodetimes[i] = love::timer::Timer::getTime() - start;
+		});
+	}
+	catch (love::Exception &)
+	{
+		for (love::image::ImageData *d : results)
+		{
+			if (d != nullptr)
+				d->release();
+		}
+		throw;
+	}
+
+	return results;
+}
+
+void Image::newImageDataBatchAsync(const std::vector<love::filesystem::FileData *> &files, love::thread::Channel *channel)
+{
+	std::vector<StrongRef<love::filesystem::FileData>> filerefs;
+	filerefs.reserve(files.size());
+
+	for (love::filesystem::FileData *fd : files)
+		filerefs.emplace_back(fd);
+
+	if (decodeQueue == nullptr)
+		decodeQueue = new love::thread::TaskQueue("love.image batch decoder");
+
+	StrongRef<love::thread::Channel> channelref(channel);
+
+	decodeQueue->push([this, filerefs, channelref]()
+	{
+		int count = (int) filerefs.size();
+
+		// Decode the files in chunks of one file per thread, and only hold the
+		// workers for one chunk at a time so synchronous users of the pool
+		// (resizing, mipmaps, block encoding) don't have to wait for the whole
+		// batch.
+		for (int first = 0; first < count;)
+		{
+			love::thread::Lock lock(workerMutex);
+
+			love::thread::WorkerPool *pool = getWorkers();
+			int chunksize = std::min(pool->getThreadCount() + 1, count - first);
+
+			pool->run(chunksize, [&](int j)
+			{
+				int i = first + j;
+				love::filesystem::FileData *fd = filerefs[i].get();
+				const std::string &filename = fd->getFilename();
+
+				auto table = new std::vector<std::pair<Variant, Variant>>();
+				table->emplace_back(Variant("index", 5), Variant((double) (i + 1)));
+				table->emplace_back(Variant("filename", 8), Variant(filename.c_str(), filename.length()));
+
+				double start = love::timer::Timer::getTime();
+
+				try
+				{
+					StrongRef<ImageData> imagedata(new ImageData(formatHandlers, fd), Acquire::NORETAIN);
+					table->emplace_back(Variant("time", 4), Variant(love::timer::Timer::getTime() - start));
+
+					Proxy p;
+					p.type = IMAGE_IMAGE_DATA_ID;
+					p.object = imagedata.get();
+					table->emplace_back(Variant("imagedata", 9), Variant(IMAGE_IMAGE_DATA_ID, &p));
+				}
+				catch (std::exception &e)
+				{
+					table->emplace_back(Variant("time", 4), Variant(love::timer::Timer::getTime() - start));
+					table->emplace_back(Variant("error", 5), Variant(e.what(), strlen(e.what())));
+				}
+
+				channelref->push(Variant(table));
+			});
+
+			first += chunksize;
+		}
+	}, nullptr);
+}
+
+love::image::ImageData *Image::newResizedImageData(love::image::ImageData *src, int width, int height, Resampler::Filter filter, bool linear)
+{
+	if (width <= 0 || height <= 0)
+		throw love::Exception("Invalid ImageData size.");
+
+	StrongRef<love::image::ImageData> dst(newImageData(width, height, src->getFormat()), Acquire::NORETAIN);
+
+	love::thread::Lock lock(workerMutex);
+
+	Resampler resampler(filter, linear, getWorkers());
+	resampler.load(src);
+	resampler.resize(width, height);
+	resampler.store(dst);
+
+	dst->retain();
+	return dst;
+}
+
+std::vector<love::image::ImageData *> Image::newMipmaps(love::image::ImageData *src, Resampler::Filter filter, bool linear)
+{
+	std::vector<StrongRef<love::image::ImageData>> levels;
+
+	{
+		love::thread::Lock lock(workerMutex);
+
+		// Each level is filtered from the previous one without going back
+		// through the ImageData's pixel format in between.
+		Resampler resampler(filter, linear, getWorkers());
+		resampler.load(src);
+
+		int w = src->getWidth();
+		int h = src->getHeight();
+
+		while (w > 1 || h > 1)
+		{
+			w = std::max(w / 2, 1);
+			h = std::max(h / 2, 1);
+
+			resampler.resize(w, h);
+
+			StrongRef<love::image::ImageData> level(newImageData(w, h, src->getFormat()), Acquire::NORETAIN);
+			resampler.store(level);
+			levels.push_back(level);
+		}
+	}
+
+	std::vector<love::image::ImageData *> result;
+	for (const auto &level : levels)
+	{
+		level->retain();
+		result.push_back(level.get());
+	}
+
+	return result;
+}
+
 } // magpie
 } // image
 } // love
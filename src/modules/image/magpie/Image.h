@@ -25,6 +25,8 @@
 #include "image/Image.h"
 #include "FormatHandler.h"
 #include "CompressedFormatHandler.h"
+#include "thread/TaskQueue.h"
+#include "thread/WorkerPool.h"
 
 // C++
 #include <list>
@@ -52,15 +54,40 @@ public:
 	const char *getName() const;
 
 	love::image::ImageData *newImageData(love::filesystem::FileData *data);
-	love::image::ImageData *newImageData(int width, int height);
-	love::image::ImageData *newImageData(int width, int height, void *data, bool own = false);
+	love::image::ImageData *newImageData(int width, int height, ImageData::PixelFormat format = ImageData::PIXELFORMAT_RGBA8);
+	love::image::ImageData *newImageData(int width, int height, void *data, bool own = false, ImageData::PixelFormat format = ImageData::PIXELFORMAT_RGBA8);
 
 	love::image::CompressedImageData *newCompressedData(love::filesystem::FileData *data);
+	love::image::CompressedImageData *newCompressedData(love::image::ImageData *data, CompressedImageData::Format format, BlockEncoder::Quality quality, bool mipmaps, bool linear);
 
 	bool isCompressed(love::filesystem::FileData *data);
 
+	void encodeAsync(love::image::ImageData *data, ImageData::EncodedFormat format, const std::string &filename, bool writefile, int level, love::thread::Channel *channel);
+
+	std::vector<love::image::ImageData *> newImageDataBatch(const std::vector<love::filesystem::FileData *> &files, std::vector<double> &decodetimes);
+	void newImageDataBatchAsync(const std::vector<love::filesystem::FileData *> &files, love::thread::Channel *channel);
+
+	love::image::ImageData *newResizedImageData(love::image::ImageData *src, int width, int height, Resampler::Filter filter, bool linear);
+	std::vector<love::image::ImageData *> newMipmaps(love::image::ImageData *src, Resampler::Filter filter, bool linear);
+
 private:
 
+	// Gets the worker pool shared by batch decoding, resampling and block
+	// encoding, creating it if needed. Only one batch can use the workers at a
+	// time, so workerMutex must be held while using them.
+	love::thread::WorkerPool *getWorkers();
+
+	// Created the first time encodeAsync is used.
+	love::thread::TaskQueue *encodeQueue;
+
+	// Created the first time a batch of files is decoded asynchronously. The
+	// queue's thread drives the batch, taking part in the work like the
+	// calling thread does for synchronous batches.
+	love::thread::TaskQueue *decodeQueue;
+
+	love::thread::WorkerPool *workers;
+	love::thread::MutexRef workerMutex;
+
 	// Image format handlers we can use for decoding and encoding ImageData.
 	std::list<FormatHandler *> formatHandlers;
 
@@ -21,6 +21,9 @@
 // LOVE
 #include "ImageData.h"
 
+// C++
+#include <vector>
+
 namespace love
 {
 namespace image
@@ -38,7 +41,7 @@ ImageData::ImageData(std::list<FormatHandler *> formats, love::filesystem::FileD
 	decode(data);
 }
 
-ImageData::ImageData(std::list<FormatHandler *> formats, int width, int height)
+ImageData::ImageData(std::list<FormatHandler *> formats, int width, int height, PixelFormat format)
 	: formatHandlers(formats)
 	, decodeHandler(nullptr)
 {
@@ -47,14 +50,15 @@ ImageData::ImageData(std::list<FormatHandler *> formats, int width, int height)
 
 	this->width = width;
 	this->height = height;
+	this->format = format;
 
-	create(width, height);
+	create();
 
 	// Set to black/transparency.
-	memset(data, 0, width*height*sizeof(pixel));
+	memset(data, 0, getSize());
 }
 
-ImageData::ImageData(std::list<FormatHandler *> formats, int width, int height, void *data, bool own)
+ImageData::ImageData(std::list<FormatHandler *> formats, int width, int height, void *data, bool own, PixelFormat format)
 	: formatHandlers(formats)
 	, decodeHandler(nullptr)
 {
@@ -63,11 +67,12 @@ ImageData::ImageData(std::list<FormatHandler *> formats, int width, int height,
 
 	this->width = width;
 	this->height = height;
+	this->format = format;
 
 	if (own)
 		this->data = (unsigned char *) data;
 	else
-		create(width, height, data);
+		create(data);
 }
 
 ImageData::~ImageData()
@@ -81,11 +86,11 @@ ImageData::~ImageData()
 		handler->release();
 }
 
-void ImageData::create(int width, int height, void *data)
+void ImageData::create(void *data)
 {
 	try
 	{
-		this->data = new unsigned char[width*height*sizeof(pixel)];
+		this->data = new unsigned char[getSize()];
 	}
 	catch(std::bad_alloc &)
 	{
@@ -93,7 +98,7 @@ void ImageData::create(int width, int height, void *data)
 	}
 
 	if (data)
-		memcpy(this->data, data, width*height*sizeof(pixel));
+		memcpy(this->data, data, getSize());
 
 	decodeHandler = nullptr;
 }
@@ -137,14 +142,13 @@ void ImageData::decode(love::filesystem::FileData *data)
 	this->width = decodedimage.width;
 	this->height = decodedimage.height;
 	this->data = decodedimage.data;
+	this->format = PIXELFORMAT_RGBA8;
 
 	decodeHandler = decoder;
 }
 
-love::filesystem::FileData *ImageData::encode(EncodedFormat format, const char *filename)
+love::filesystem::FileData *ImageData::encode(EncodedFormat format, const char *filename, int level)
 {
-	FormatHandler *encoder = nullptr;
-	FormatHandler::EncodedImage encodedimage;
 	FormatHandler::DecodedImage rawimage;
 
 	rawimage.width = width;
@@ -152,7 +156,26 @@ love::filesystem::FileData *ImageData::encode(EncodedFormat format, const char *
 	rawimage.size = width*height*sizeof(pixel);
 	rawimage.data = data;
 
-	for (FormatHandler *handler : formatHandlers)
+	thread::Lock lock(mutex);
+
+	// The encoders only deal with RGBA8 pixels.
+	std::vector<pixel> converted;
+	if (getFormat() != PIXELFORMAT_RGBA8)
+	{
+		converted.resize(width*height);
+		copyRGBA8Unsafe(&converted[0]);
+		rawimage.data = (unsigned char *) &converted[0];
+	}
+
+	return encodeImage(formatHandlers, rawimage, format, filename, level);
+}
+
+love::filesystem::FileData *ImageData::encodeImage(const std::list<FormatHandler *> &handlers, const FormatHandler::DecodedImage &img, EncodedFormat format, const char *filename, int level)
+{
+	FormatHandler *encoder = nullptr;
+	FormatHandler::EncodedImage encodedimage;
+
+	for (FormatHandler *handler : handlers)
 	{
 		if (handler->canEncode(format))
 		{
@@ -162,10 +185,7 @@ love::filesystem::FileData *ImageData::encode(EncodedFormat format, const char *
 	}
 
 	if (encoder != nullptr)
-	{
-		thread::Lock lock(mutex);
-		encodedimage = encoder->encode(rawimage, format);
-	}
+		encodedimage = encoder->encode(img, format, level);
 
 	if (encoder == nullptr || encodedimage.data == nullptr)
 	{
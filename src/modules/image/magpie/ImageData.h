@@ -40,17 +40,24 @@ class ImageData : public love::image::ImageData
 public:
 
 	ImageData(std::list<FormatHandler *> formats, love::filesystem::FileData *data);
-	ImageData(std::list<FormatHandler *> formats, int width, int height);
-	ImageData(std::list<FormatHandler *> formats, int width, int height, void *data, bool own);
+	ImageData(std::list<FormatHandler *> formats, int width, int height, PixelFormat format = PIXELFORMAT_RGBA8);
+	ImageData(std::list<FormatHandler *> formats, int width, int height, void *data, bool own, PixelFormat format = PIXELFORMAT_RGBA8);
 	virtual ~ImageData();
 
 	// Implements image::ImageData.
-	virtual love::filesystem::FileData *encode(EncodedFormat format, const char *filename);
+	virtual love::filesystem::FileData *encode(EncodedFormat format, const char *filename, int level = -1);
+
+	/**
+	 * Encodes raw pixels with the first of the handlers which supports the
+	 * format. Doesn't touch any ImageData, so it's safe to call from any
+	 * thread as long as nothing else modifies the pixels.
+	 **/
+	static love::filesystem::FileData *encodeImage(const std::list<FormatHandler *> &handlers, const FormatHandler::DecodedImage &img, EncodedFormat format, const char *filename, int level);
 
 private:
 
 	// Create imagedata. Initialize with data if not null.
-	void create(int width, int height, void *data = 0);
+	void create(void *data = nullptr);
 
 	// Decode and load an encoded format.
 	void decode(love::filesystem::FileData *data);
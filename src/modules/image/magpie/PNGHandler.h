@@ -44,7 +44,7 @@ public:
 	virtual bool canEncode(ImageData::EncodedFormat format);
 
 	virtual DecodedImage decode(love::filesystem::FileData *data);
-	virtual EncodedImage encode(const DecodedImage &img, ImageData::EncodedFormat format);
+	virtual EncodedImage encode(const DecodedImage &img, ImageData::EncodedFormat format, int level);
 
 	virtual void free(unsigned char *mem);
 
@@ -87,7 +87,7 @@ FormatHandler::DecodedImage STBHandler::decode(love::filesystem::FileData *data)
 	return img;
 }
 
-FormatHandler::EncodedImage STBHandler::encode(const DecodedImage &img, ImageData::EncodedFormat format)
+FormatHandler::EncodedImage STBHandler::encode(const DecodedImage &img, ImageData::EncodedFormat format, int /*level*/)
 {
 	if (!canEncode(format))
 		throw love::Exception("Invalid format.");
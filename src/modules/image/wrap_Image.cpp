@@ -26,6 +26,7 @@
 #include "magpie/Image.h"
 
 #include "filesystem/wrap_Filesystem.h"
+#include "thread/wrap_Channel.h"
 
 namespace love
 {
@@ -44,14 +45,22 @@ int w_newImageData(lua_State *L)
 		if (w <= 0 || h <= 0)
 			return luaL_error(L, "Invalid image size.");
 
+		ImageData::PixelFormat format = ImageData::PIXELFORMAT_RGBA8;
+		int bytesidx = 3;
+
+		// An optional format name can come before the raw bytes. None of the
+		// format names can be a valid rgba8 byte string, so this is unambiguous.
+		if (lua_type(L, 3) == LUA_TSTRING && ImageData::getConstant(lua_tostring(L, 3), format))
+			bytesidx = 4;
+
 		size_t numbytes = 0;
 		const char *bytes = nullptr;
 
-		if (!lua_isnoneornil(L, 3))
-			bytes = luaL_checklstring(L, 3, &numbytes);
+		if (!lua_isnoneornil(L, bytesidx))
+			bytes = luaL_checklstring(L, bytesidx, &numbytes);
 
 		ImageData *t = nullptr;
-		luax_catchexcept(L, [&](){ t = instance()->newImageData(w, h); });
+		luax_catchexcept(L, [&](){ t = instance()->newImageData(w, h, format); });
 
 		if (bytes)
 		{
@@ -88,8 +97,128 @@ int w_newImageData(lua_State *L)
 	}
 }
 
+int w_newImageDataBatch(lua_State *L)
+{
+	luaL_checktype(L, 1, LUA_TTABLE);
+
+	love::thread::Channel *channel = nullptr;
+	if (!lua_isnoneornil(L, 2))
+		channel = love::thread::luax_checkchannel(L, 2);
+
+	int count = (int) luax_objlen(L, 1);
+	std::vector<love::filesystem::FileData *> files;
+	files.reserve(count);
+
+	// Read the files up-front, on this thread. The FileData is kept in a table
+	// on the stack so Lua's GC owns it if anything below errors.
+	lua_createtable(L, count, 0);
+
+	for (int i = 1; i <= count; i++)
+	{
+		lua_rawgeti(L, 1, i);
+		love::filesystem::FileData *data = love::filesystem::luax_getfiledata(L, -1);
+		lua_pop(L, 1);
+
+		luax_pushtype(L, FILESYSTEM_FILE_DATA_ID, data);
+		data->release();
+		lua_rawseti(L, -2, i);
+
+		files.push_back(data);
+	}
+
+	if (channel != nullptr)
+	{
+		luax_catchexcept(L, [&](){ instance()->newImageDataBatchAsync(files, channel); });
+
+		// The results are pushed to the Channel as each file finishes decoding.
+		lua_pushvalue(L, 2);
+		return 1;
+	}
+
+	std::vector<ImageData *> results;
+	std::vector<double> decodetimes;
+	luax_catchexcept(L, [&](){ results = instance()->newImageDataBatch(files, decodetimes); });
+
+	lua_createtable(L, count, 0);
+	for (int i = 0; i < count; i++)
+	{
+		luax_pushtype(L, IMAGE_IMAGE_DATA_ID, results[i]);
+		results[i]->release();
+		lua_rawseti(L, -2, i + 1);
+	}
+
+	lua_createtable(L, count, 0);
+	for (int i = 0; i < count; i++)
+	{
+		lua_pushnumber(L, decodetimes[i]);
+		lua_rawseti(L, -2, i + 1);
+	}
+
+	return 2;
+}
+
+int w_newMipmaps(lua_State *L)
+{
+	ImageData *data = luax_checkimagedata(L, 1);
+
+	Resampler::Filter filter = Resampler::FILTER_BOX;
+	if (!lua_isnoneornil(L, 2))
+	{
+		const char *str = luaL_checkstring(L, 2);
+		if (!Resampler::getConstant(str, filter))
+			return luaL_error(L, "Invalid mipmap filter: %s", str);
+	}
+
+	bool linear = luax_optboolean(L, 3, false);
+
+	std::vector<ImageData *> levels;
+	luax_catchexcept(L, [&](){ levels = instance()->newMipmaps(data, filter, linear); });
+
+	lua_createtable(L, (int) levels.size(), 0);
+	for (int i = 0; i < (int) levels.size(); i++)
+	{
+		luax_pushtype(L, IMAGE_IMAGE_DATA_ID, levels[i]);
+		levels[i]->release();
+		lua_rawseti(L, -2, i + 1);
+	}
+
+	return 1;
+}
+
 int w_newCompressedData(lua_State *L)
 {
+	// Case 1: Encoding ImageData.
+	if (luax_istype(L, 1, IMAGE_IMAGE_DATA_ID))
+	{
+		ImageData *data = luax_checkimagedata(L, 1);
+
+		const char *fstr = luaL_checkstring(L, 2);
+		CompressedImageData::Format format;
+		if (!CompressedImageData::getConstant(fstr, format))
+			return luaL_error(L, "Invalid compressed image format: %s", fstr);
+		if (!BlockEncoder::isSupported(format))
+			return luaL_error(L, "Cannot encode ImageData to the %s compressed format.", fstr);
+
+		BlockEncoder::Quality quality = BlockEncoder::QUALITY_NORMAL;
+		if (!lua_isnoneornil(L, 3))
+		{
+			const char *qstr = luaL_checkstring(L, 3);
+			if (!BlockEncoder::getConstant(qstr, quality))
+				return luaL_error(L, "Invalid encoding quality: %s", qstr);
+		}
+
+		bool mipmaps = luax_optboolean(L, 4, false);
+		bool linear = luax_optboolean(L, 5, false);
+
+		CompressedImageData *t = nullptr;
+		luax_catchexcept(L, [&](){ t = instance()->newCompressedData(data, format, quality, mipmaps, linear); });
+
+		luax_pushtype(L, IMAGE_COMPRESSED_IMAGE_DATA_ID, t);
+		t->release();
+		return 1;
+	}
+
+	// Case 2: File(Data).
 	love::filesystem::FileData *data = love::filesystem::luax_getfiledata(L, 1);
 
 	CompressedImageData *t = nullptr;
@@ -117,6 +246,8 @@ int w_isCompressed(lua_State *L)
 static const luaL_Reg functions[] =
 {
 	{ "newImageData",  w_newImageData },
+	{ "newImageDataBatch", w_newImageDataBatch },
+	{ "newMipmaps", w_newMipmaps },
 	{ "newCompressedData", w_newCompressedData },
 	{ "isCompressed", w_isCompressed },
 	{ 0, 0 }
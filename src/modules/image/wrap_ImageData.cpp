@@ -22,6 +22,8 @@
 
 #include "common/wrap_Data.h"
 #include "filesystem/File.h"
+#include "thread/wrap_Channel.h"
+#include "Image.h"
 
 // Shove the wrap_ImageData.lua code directly into a raw string literal.
 static const char imagedata_lua[] =
@@ -70,9 +72,9 @@ int w_ImageData_getPixel(lua_State *L)
 	ImageData *t = luax_checkimagedata(L, 1);
 	int x = (int) luaL_checknumber(L, 2);
 	int y = (int) luaL_checknumber(L, 3);
-	pixel c;
+	pixelf c;
 
-	luax_catchexcept(L, [&](){ c = t->getPixel(x, y); });
+	luax_catchexcept(L, [&](){ c = t->getPixelf(x, y); });
 
 	lua_pushnumber(L, c.r);
 	lua_pushnumber(L, c.g);
@@ -86,26 +88,26 @@ int w_ImageData_setPixel(lua_State *L)
 	ImageData *t = luax_checkimagedata(L, 1);
 	int x = (int) luaL_checknumber(L, 2);
 	int y = (int) luaL_checknumber(L, 3);
-	pixel c;
+	pixelf c;
 
 	if (lua_istable(L, 4))
 	{
 		for (int i = 1; i <= 4; i++)
 			lua_rawgeti(L, 4, i);
 
-		c.r = (unsigned char)luaL_checkinteger(L, -4);
-		c.g = (unsigned char)luaL_checkinteger(L, -3);
-		c.b = (unsigned char)luaL_checkinteger(L, -2);
-		c.a = (unsigned char)luaL_optinteger(L, -1, 255);
+		c.r = (float) luaL_checknumber(L, -4);
+		c.g = (float) luaL_checknumber(L, -3);
+		c.b = (float) luaL_checknumber(L, -2);
+		c.a = (float) luaL_optnumber(L, -1, 255);
 
 		lua_pop(L, 4);
 	}
 	else
 	{
-		c.r = (unsigned char)luaL_checkinteger(L, 4);
-		c.g = (unsigned char)luaL_checkinteger(L, 5);
-		c.b = (unsigned char)luaL_checkinteger(L, 6);
-		c.a = (unsigned char)luaL_optinteger(L, 7, 255);
+		c.r = (float) luaL_checknumber(L, 4);
+		c.g = (float) luaL_checknumber(L, 5);
+		c.b = (float) luaL_checknumber(L, 6);
+		c.a = (float) luaL_optnumber(L, 7, 255);
 	}
 
 	luax_catchexcept(L, [&](){ t->setPixel(x, y, c); });
@@ -164,7 +166,7 @@ int w_ImageData__mapPixelUnsafe(lua_State *L)
 			lua_pushvalue(L, 2);
 			lua_pushnumber(L, x);
 			lua_pushnumber(L, y);
-			pixel c = t->getPixelUnsafe(x, y);
+			pixelf c = t->getPixelfUnsafe(x, y);
 			lua_pushnumber(L, c.r);
 			lua_pushnumber(L, c.g);
 			lua_pushnumber(L, c.b);
@@ -176,15 +178,15 @@ int w_ImageData__mapPixelUnsafe(lua_State *L)
 			// messier code, at least the errors are a bit more descriptive.
 
 			// Treat the pixel as an array for less code duplication. :(
-			unsigned char *parray = (unsigned char *) &c;
+			float *parray = (float *) &c;
 			for (int i = 0; i < 4; i++)
 			{
 				int ttype = lua_type(L, -4 + i);
 
 				if (ttype == LUA_TNUMBER)
-					parray[i] = (unsigned char) lua_tonumber(L, -4 + i);
+					parray[i] = (float) lua_tonumber(L, -4 + i);
 				else if (i == 3 && (ttype == LUA_TNONE || ttype == LUA_TNIL))
-					parray[i] = 255; // Alpha component defaults to 255.
+					parray[i] = 255.0f; // Alpha component defaults to 255.
 				else
 					// Error (level 2 because this is function will be wrapped.)
 					return luax_retnumbererror(L, 2, i + 1, ttype);
@@ -211,10 +213,119 @@ int w_ImageData_paste(lua_State *L)
 	int sy = (int) luaL_optnumber(L, 6, 0);
 	int sw = (int) luaL_optnumber(L, 7, src->getWidth());
 	int sh = (int) luaL_optnumber(L, 8, src->getHeight());
-	t->paste((love::image::ImageData *)src, dx, dy, sx, sy, sw, sh);
+
+	ImageData::BlendMode mode = ImageData::BLEND_REPLACE;
+	if (!lua_isnoneornil(L, 9))
+	{
+		const char *str = luaL_checkstring(L, 9);
+		if (!ImageData::getConstant(str, mode))
+			return luaL_error(L, "Invalid blend mode: %s", str);
+	}
+
+	luax_catchexcept(L, [&](){ t->paste((love::image::ImageData *)src, dx, dy, sx, sy, sw, sh, mode); });
+	return 0;
+}
+
+int w_ImageData_fill(lua_State *L)
+{
+	ImageData *t = luax_checkimagedata(L, 1);
+
+	pixelf c;
+	c.r = (float) luaL_checknumber(L, 2);
+	c.g = (float) luaL_checknumber(L, 3);
+	c.b = (float) luaL_checknumber(L, 4);
+	c.a = (float) luaL_optnumber(L, 5, 255);
+
+	int x = (int) luaL_optnumber(L, 6, 0);
+	int y = (int) luaL_optnumber(L, 7, 0);
+	int w = (int) luaL_optnumber(L, 8, t->getWidth());
+	int h = (int) luaL_optnumber(L, 9, t->getHeight());
+
+	t->fill(c, x, y, w, h);
+	return 0;
+}
+
+int w_ImageData_premultiplyAlpha(lua_State *L)
+{
+	ImageData *t = luax_checkimagedata(L, 1);
+	t->premultiplyAlpha();
 	return 0;
 }
 
+int w_ImageData_unpremultiplyAlpha(lua_State *L)
+{
+	ImageData *t = luax_checkimagedata(L, 1);
+	t->unpremultiplyAlpha();
+	return 0;
+}
+
+int w_ImageData_swizzle(lua_State *L)
+{
+	ImageData *t = luax_checkimagedata(L, 1);
+
+	size_t len = 0;
+	const char *str = luaL_checklstring(L, 2, &len);
+	if (len != 4)
+		return luaL_error(L, "Invalid swizzle '%s' (expected 4 characters.)", str);
+
+	ImageData::SwizzleSource sources[4];
+	for (int i = 0; i < 4; i++)
+	{
+		switch (str[i])
+		{
+		case 'r': sources[i] = ImageData::SWIZZLE_R; break;
+		case 'g': sources[i] = ImageData::SWIZZLE_G; break;
+		case 'b': sources[i] = ImageData::SWIZZLE_B; break;
+		case 'a': sources[i] = ImageData::SWIZZLE_A; break;
+		case '0': sources[i] = ImageData::SWIZZLE_ZERO; break;
+		case '1': sources[i] = ImageData::SWIZZLE_ONE; break;
+		default:
+			return luaL_error(L, "Invalid swizzle '%s' (expected r, g, b, a, 0 or 1.)", str);
+		}
+	}
+
+	t->swizzle(sources);
+	return 0;
+}
+
+int w_ImageData_gammaToLinear(lua_State *L)
+{
+	ImageData *t = luax_checkimagedata(L, 1);
+	t->gammaToLinear();
+	return 0;
+}
+
+int w_ImageData_linearToGamma(lua_State *L)
+{
+	ImageData *t = luax_checkimagedata(L, 1);
+	t->linearToGamma();
+	return 0;
+}
+
+int w_ImageData_getFormat(lua_State *L)
+{
+	ImageData *t = luax_checkimagedata(L, 1);
+
+	const char *str = nullptr;
+	if (!ImageData::getConstant(t->getFormat(), str))
+		return luaL_error(L, "Unknown pixel format.");
+
+	lua_pushstring(L, str);
+	return 1;
+}
+
+static int optCompressionLevel(lua_State *L, int idx)
+{
+	if (lua_isnoneornil(L, idx))
+		return -1;
+
+	int level = (int) luaL_checknumber(L, idx);
+	if (level < 0 || level > 9)
+		return luaL_error(L, "Invalid compression level %d (must be between 0 and 9.)", level);
+
+	return level;
+}
+
 int w_ImageData_encode(lua_State *L)
 {
 	ImageData *t = luax_checkimagedata(L, 1);
@@ -233,8 +344,10 @@ int w_ImageData_encode(lua_State *L)
 		filename = luax_checkstring(L, 3);
 	}
 
+	int level = optCompressionLevel(L, 4);
+
 	love::filesystem::FileData *filedata = nullptr;
-	luax_catchexcept(L, [&](){ filedata = t->encode(format, filename.c_str()); });
+	luax_catchexcept(L, [&](){ filedata = t->encode(format, filename.c_str(), level); });
 
 	luax_pushtype(L, FILESYSTEM_FILE_DATA_ID, filedata);
 	filedata->release();
@@ -250,6 +363,77 @@ int w_ImageData_encode(lua_State *L)
 	return 1;
 }
 
+int w_ImageData_encodeAsync(lua_State *L)
+{
+	ImageData *t = luax_checkimagedata(L, 1);
+
+	ImageData::EncodedFormat format;
+	const char *fmt = luaL_checkstring(L, 2);
+	if (!ImageData::getConstant(fmt, format))
+		return luaL_error(L, "Invalid encoded image format '%s'.", fmt);
+
+	bool hasfilename = false;
+
+	std::string filename = "Image." + std::string(fmt);
+	if (!lua_isnoneornil(L, 3))
+	{
+		hasfilename = true;
+		filename = luax_checkstring(L, 3);
+	}
+
+	int level = optCompressionLevel(L, 4);
+
+	love::thread::Channel *channel = nullptr;
+	if (lua_isnoneornil(L, 5))
+	{
+		luax_catchexcept(L, [&](){ channel = new love::thread::Channel(); });
+		luax_pushtype(L, THREAD_CHANNEL_ID, channel);
+		channel->release();
+	}
+	else
+	{
+		channel = love::thread::luax_checkchannel(L, 5);
+		lua_pushvalue(L, 5);
+	}
+
+	auto module = Module::getInstance<love::image::Image>(Module::M_IMAGE);
+	if (module == nullptr)
+		return luaL_error(L, "love.image must be loaded to encode ImageData asynchronously.");
+
+	luax_catchexcept(L, [&](){ module->encodeAsync(t, format, filename, hasfilename, level, channel); });
+
+	// The result is pushed to the Channel once the encode finishes.
+	return 1;
+}
+
+int w_ImageData_resize(lua_State *L)
+{
+	ImageData *t = luax_checkimagedata(L, 1);
+	int w = (int) luaL_checknumber(L, 2);
+	int h = (int) luaL_checknumber(L, 3);
+
+	Resampler::Filter filter = Resampler::FILTER_BOX;
+	if (!lua_isnoneornil(L, 4))
+	{
+		const char *str = luaL_checkstring(L, 4);
+		if (!Resampler::getConstant(str, filter))
+			return luaL_error(L, "Invalid resize filter: %s", str);
+	}
+
+	bool linear = luax_optboolean(L, 5, false);
+
+	auto module = Module::getInstance<love::image::Image>(Module::M_IMAGE);
+	if (module == nullptr)
+		return luaL_error(L, "love.image must be loaded to resize ImageData.");
+
+	ImageData *resized = nullptr;
+	luax_catchexcept(L, [&](){ resized = module->newResizedImageData(t, w, h, filter, linear); });
+
+	luax_pushtype(L, IMAGE_IMAGE_DATA_ID, resized);
+	resized->release();
+	return 1;
+}
+
 int w_ImageData__performAtomic(lua_State *L)
 {
 	ImageData *t = luax_checkimagedata(L, 1);
@@ -275,6 +459,9 @@ struct FFI_ImageData
 {
 	void (*lockMutex)(Proxy *p);
 	void (*unlockMutex)(Proxy *p);
+
+	float (*halfToFloat)(half h);
+	half (*floatToHalf)(float f);
 };
 
 static FFI_ImageData ffifuncs =
@@ -291,7 +478,10 @@ static FFI_ImageData ffifuncs =
 	{
 		ImageData *i = (ImageData *) p->object;
 		i->getMutex()->unlock();
-	}
+	},
+
+	ImageData::halfToFloat,
+	ImageData::floatToHalf,
 };
 
 static const luaL_Reg w_ImageData_functions[] =
@@ -299,10 +489,19 @@ static const luaL_Reg w_ImageData_functions[] =
 	{ "getWidth", w_ImageData_getWidth },
 	{ "getHeight", w_ImageData_getHeight },
 	{ "getDimensions", w_ImageData_getDimensions },
+	{ "getFormat", w_ImageData_getFormat },
 	{ "getPixel", w_ImageData_getPixel },
 	{ "setPixel", w_ImageData_setPixel },
 	{ "paste", w_ImageData_paste },
+	{ "fill", w_ImageData_fill },
+	{ "premultiplyAlpha", w_ImageData_premultiplyAlpha },
+	{ "unpremultiplyAlpha", w_ImageData_unpremultiplyAlpha },
+	{ "swizzle", w_ImageData_swizzle },
+	{ "gammaToLinear", w_ImageData_gammaToLinear },
+	{ "linearToGamma", w_ImageData_linearToGamma },
+	{ "resize", w_ImageData_resize },
 	{ "encode", w_ImageData_encode },
+	{ "encodeAsync", w_ImageData_encodeAsync },
 
 	// Used in the Lua wrapper code.
 	{ "_mapPixelUnsafe", w_ImageData__mapPixelUnsafe },
@@ -27,7 +27,7 @@ local ImageData = ImageData_mt.__index
 
 local tonumber, assert, error = tonumber, assert, error
 local type, pcall = type, pcall
-local floor = math.floor
+local floor, min, max = math.floor, math.min, math.max
 
 local function inside(x, y, w, h)
 	return x >= 0 and x < w and y >= 0 and y < h
@@ -75,6 +75,9 @@ typedef struct FFI_ImageData
 {
 	void (*lockMutex)(Proxy *p);
 	void (*unlockMutex)(Proxy *p);
+
+	float (*halfToFloat)(uint16_t h);
+	uint16_t (*floatToHalf)(float f);
 } FFI_ImageData;
 
 typedef struct ImageData_Pixel
@@ -85,7 +88,83 @@ typedef struct ImageData_Pixel
 
 local ffifuncs = ffi.cast("FFI_ImageData *", ffifuncspointer)
 
-local pixelpointer = ffi.typeof("ImageData_Pixel *")
+local halfToFloat = ffifuncs.halfToFloat
+local floatToHalf = ffifuncs.floatToHalf
+
+local function tounorm8(v)
+	return floor(min(max(v, 0), 255) + 0.5)
+end
+
+local function tounorm16(v)
+	return floor(min(max(v * 257, 0), 65535) + 0.5)
+end
+
+-- Per-format pixel accessors. Colors are in the range of [0, 255] regardless
+-- of the format, to match the C++ side. Keep in sync with ImageData.cpp!
+local pixelformats = {
+	rgba8 = {
+		pointer = ffi.typeof("ImageData_Pixel *"),
+		get = function(d, i)
+			local p = d[i]
+			return tonumber(p.r), tonumber(p.g), tonumber(p.b), tonumber(p.a)
+		end,
+		set = function(d, i, r, g, b, a)
+			local p = d[i]
+			p.r, p.g, p.b, p.a = tounorm8(r), tounorm8(g), tounorm8(b), tounorm8(a)
+		end,
+	},
+	r8 = {
+		pointer = ffi.typeof("uint8_t *"),
+		get = function(d, i)
+			return tonumber(d[i]), 0, 0, 255
+		end,
+		set = function(d, i, r, g, b, a)
+			d[i] = tounorm8(r)
+		end,
+	},
+	rg8 = {
+		pointer = ffi.typeof("uint8_t *"),
+		get = function(d, i)
+			return tonumber(d[i*2]), tonumber(d[i*2+1]), 0, 255
+		end,
+		set = function(d, i, r, g, b, a)
+			d[i*2], d[i*2+1] = tounorm8(r), tounorm8(g)
+		end,
+	},
+	rgba16 = {
+		pointer = ffi.typeof("uint16_t *"),
+		get = function(d, i)
+			i = i * 4
+			return d[i]/257, d[i+1]/257, d[i+2]/257, d[i+3]/257
+		end,
+		set = function(d, i, r, g, b, a)
+			i = i * 4
+			d[i], d[i+1], d[i+2], d[i+3] = tounorm16(r), tounorm16(g), tounorm16(b), tounorm16(a)
+		end,
+	},
+	rgba16f = {
+		pointer = ffi.typeof("uint16_t *"),
+		get = function(d, i)
+			i = i * 4
+			return halfToFloat(d[i])*255, halfToFloat(d[i+1])*255, halfToFloat(d[i+2])*255, halfToFloat(d[i+3])*255
+		end,
+		set = function(d, i, r, g, b, a)
+			i = i * 4
+			d[i], d[i+1], d[i+2], d[i+3] = floatToHalf(r/255), floatToHalf(g/255), floatToHalf(b/255), floatToHalf(a/255)
+		end,
+	},
+	rgba32f = {
+		pointer = ffi.typeof("float *"),
+		get = function(d, i)
+			i = i * 4
+			return d[i]*255, d[i+1]*255, d[i+2]*255, d[i+3]*255
+		end,
+		set = function(d, i, r, g, b, a)
+			i = i * 4
+			d[i], d[i+1], d[i+2], d[i+3] = r/255, g/255, b/255, a/255
+		end,
+	},
+}
 
 local _getWidth = ImageData.getWidth
 local _getHeight = ImageData.getHeight
@@ -97,12 +176,15 @@ local objectcache = setmetatable({}, {
 	__mode = "k",
 	__index = function(self, imagedata)
 		local width, height = _getDimensions(imagedata)
-		local pointer = ffi.cast(pixelpointer, imagedata:getPointer())
+		local format = pixelformats[imagedata:getFormat()]
+		local pointer = ffi.cast(format.pointer, imagedata:getPointer())
 
 		local p = {
 			width = width,
 			height = height,
 			pointer = pointer,
+			get = format.get,
+			set = format.set,
 		}
 
 		self[imagedata] = p
@@ -133,15 +215,13 @@ function ImageData:_mapPixelUnsafe(func, ix, iy, iw, ih)
 	ih = floor(ih)
 
 	local pixels = p.pointer
+	local get, set = p.get, p.set
 
 	for y=iy, iy+ih-1 do
 		for x=ix, ix+iw-1 do
-			local p = pixels[y*idw+x]
-			local r, g, b, a = func(x, y, tonumber(p.r), tonumber(p.g), tonumber(p.b), tonumber(p.a))
-			pixels[y*idw+x].r = r
-			pixels[y*idw+x].g = g
-			pixels[y*idw+x].b = b
-			pixels[y*idw+x].a = a == nil and 255 or a
+			local i = y*idw+x
+			local r, g, b, a = func(x, y, get(pixels, i))
+			set(pixels, i, r, g, b, a == nil and 255 or a)
 		end
 	end
 end
@@ -157,15 +237,12 @@ function ImageData:getPixel(x, y)
 	if not inside(x, y, p.width, p.height) then error("Attempt to get out-of-range pixel!", 2) end
 
 	ffifuncs.lockMutex(self)
-	local pixel = p.pointer[y * p.width + x]
-	local r, g, b, a = tonumber(pixel.r), tonumber(pixel.g), tonumber(pixel.b), tonumber(pixel.a)
+	local r, g, b, a = p.get(p.pointer, y * p.width + x)
 	ffifuncs.unlockMutex(self)
 
 	return r, g, b, a
 end
 
-local temppixel = ffi.new("ImageData_Pixel")
-
 function ImageData:setPixel(x, y, r, g, b, a)
 	if type(x) ~= "number" then error("bad argument #1 to ImageData:setPixel (expected number)", 2) end
 	if type(y) ~= "number" then error("bad argument #2 to ImageData:setPixel (expected number)", 2) end
@@ -186,13 +263,10 @@ function ImageData:setPixel(x, y, r, g, b, a)
 	local p = objectcache[self]
 	if not inside(x, y, p.width, p.height) then error("Attempt to set out-of-range pixel!", 2) end
 
-	temppixel.r = r
-	temppixel.g = g
-	temppixel.b = b
-	temppixel.a = a == nil and 255 or a
+	if a == nil then a = 255 end
 
 	ffifuncs.lockMutex(self)
-	p.pointer[y * p.width + x] = temppixel
+	p.set(p.pointer, y * p.width + x, r, g, b, a)
 	ffifuncs.unlockMutex(self)
 end
 
@@ -194,26 +194,14 @@ bool Math::isConvex(const std::vector<love::Vector> &polygon)
 	return true;
 }
 
-/**
- * http://en.wikipedia.org/wiki/SRGB#The_reverse_transformation
- **/
 float Math::gammaToLinear(float c) const
 {
-	if (c <= 0.04045f)
-		return c / 12.92f;
-	else
-		return powf((c + 0.055f) / 1.055f, 2.4f);
+	return love::gammaToLinear(c);
 }
 
-/**
- * http://en.wikipedia.org/wiki/SRGB#The_forward_transformation_.28CIE_xyY_or_CIE_XYZ_to_sRGB.29
- **/
 float Math::linearToGamma(float c) const
 {
-	if (c <= 0.0031308f)
-		return c * 12.92f;
-	else
-		return 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+	return love::linearToGamma(c);
 }
 
 CompressedData *Math::compress(Compressor::Format format, love::Data *rawdata, int level)
@@ -34,6 +34,9 @@ Cursor::Cursor(image::ImageData *data, int hotx, int hoty)
 	, type(CURSORTYPE_IMAGE)
 	, systemType(CURSOR_MAX_ENUM)
 {
+	if (data->getFormat() != image::ImageData::PIXELFORMAT_RGBA8)
+		throw love::Exception("Cursor ImageData must use the rgba8 pixel format.");
+
 	Uint32 rmask, gmask, bmask, amask;
 #ifdef LOVE_BIG_ENDIAN
 	rmask = 0xFF000000;
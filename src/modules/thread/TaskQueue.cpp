@@ -0,0 +1,184 @@
+/**
+ * Copyright (c) 2006-2016 LOVE Development Team
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ **/
+
+// LOVE
+#include "TaskQueue.h"
+
+namespace love
+{
+namespace thread
+{
+
+TaskQueue::Worker::Worker(TaskQueue *queue, const std::string &name)
+	: queue(queue)
+{
+	threadName = name;
+}
+
+void TaskQueue::Worker::threadFunction()
+{
+	queue->workerLoop();
+}
+
+TaskQueue::TaskQueue(const std::string &name)
+	: worker(nullptr)
+	, running(0)
+	, stopping(false)
+{
+	worker = new Worker(this, name);
+
+	if (!worker->start())
+	{
+		worker->release();
+		worker = nullptr;
+	}
+}
+
+TaskQueue::~TaskQueue()
+{
+	if (worker == nullptr)
+		return;
+
+	{
+		Lock l(mutex);
+		stopping = true;
+		taskAvailable->broadcast();
+	}
+
+	worker->wait();
+	worker->release();
+}
+
+void TaskQueue::push(const std::function<void()> &func, const Completion &completion)
+{
+	Task task;
+	task.func = func;
+	task.completion = completion;
+
+	if (worker == nullptr)
+	{
+		runTask(task);
+
+		if (task.completion)
+		{
+			Lock l(mutex);
+			finished.push_back(std::move(task));
+		}
+		return;
+	}
+
+	Lock l(mutex);
+	queued.push_back(std::move(task));
+	taskAvailable->signal();
+}
+
+int TaskQueue::poll()
+{
+	std::deque<Task> done;
+
+	{
+		Lock l(mutex);
+		done.swap(finished);
+	}
+
+	// The completion functions may push more tasks, so they're called without
+	// holding the lock.
+	for (Task &task : done)
+	{
+		if (task.completion)
+			task.completion(task.error);
+	}
+
+	return (int) done.size();
+}
+
+void TaskQueue::wait()
+{
+	Lock l(mutex);
+
+	while (!queued.empty() || running > 0)
+		taskDone->wait(mutex);
+}
+
+int TaskQueue::cancel()
+{
+	Lock l(mutex);
+
+	int count = (int) queued.size();
+	queued.clear();
+
+	// wait() may be waiting on the tasks which were just removed.
+	taskDone->broadcast();
+
+	return count;
+}
+
+int TaskQueue::getPendingCount() const
+{
+	Lock l(mutex);
+	return (int) (queued.size() + finished.size()) + running;
+}
+
+void TaskQueue::runTask(Task &task)
+{
+	try
+	{
+		if (task.func)
+			task.func();
+	}
+	catch (std::exception &e)
+	{
+		task.error = e.what();
+	}
+}
+
+void TaskQueue::workerLoop()
+{
+	Lock l(mutex);
+
+	while (true)
+	{
+		while (!stopping && queued.empty())
+			taskAvailable->wait(mutex);
+
+		// Queued tasks still run when stopping, so their results aren't lost.
+		if (queued.empty())
+			return;
+
+		Task task = std::move(queued.front());
+		queued.pop_front();
+		running++;
+
+		mutex->unlock();
+		runTask(task);
+		mutex->lock();
+
+		running--;
+
+		// Nothing will poll for tasks which don't have a completion function.
+		if (task.completion)
+			finished.push_back(std::move(task));
+
+		taskDone->broadcast();
+	}
+}
+
+} // thread
+} // love
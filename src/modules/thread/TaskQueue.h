@@ -0,0 +1,131 @@
+/**
+ * Copyright (c) 2006-2016 LOVE Development Team
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ **/
+
+#ifndef LOVE_THREAD_TASK_QUEUE_H
+#define LOVE_THREAD_TASK_QUEUE_H
+
+// LOVE
+#include "common/config.h"
+#include "threads.h"
+
+// C++
+#include <functional>
+#include <string>
+#include <deque>
+
+namespace love
+{
+namespace thread
+{
+
+/**
+ * Runs tasks on a background thread, one at a time and in the order they were
+ * pushed. Each task can have a completion function, which is called on the
+ * thread that calls poll once the task has finished. This is how results get
+ * back to threads which can't be called into directly, e.g. Lua's main thread.
+ **/
+class TaskQueue
+{
+public:
+
+	// Receives the error message if the task threw, or an empty string.
+	typedef std::function<void(const std::string &error)> Completion;
+
+	TaskQueue(const std::string &name);
+
+	/**
+	 * Waits for all pushed tasks to finish. Completion functions which haven't
+	 * been called by poll are destroyed without being called.
+	 **/
+	~TaskQueue();
+
+	/**
+	 * Queues a task. The completion function may be empty, in which case the
+	 * task is forgotten as soon as it has run.
+	 **/
+	void push(const std::function<void()> &task, const Completion &completion);
+
+	/**
+	 * Calls the completion functions of finished tasks, in the order the tasks
+	 * were pushed. Returns the number of completion functions called.
+	 **/
+	int poll();
+
+	/**
+	 * Blocks until every pushed task has run. Doesn't call completion
+	 * functions.
+	 **/
+	void wait();
+
+	/**
+	 * Removes tasks which haven't started running yet. Their completion
+	 * functions are destroyed without being called. Returns the number of
+	 * tasks removed.
+	 **/
+	int cancel();
+
+	/**
+	 * Number of tasks whose completion functions haven't been called yet.
+	 **/
+	int getPendingCount() const;
+
+private:
+
+	class Worker : public Threadable
+	{
+	public:
+		Worker(TaskQueue *queue, const std::string &name);
+		void threadFunction();
+	private:
+		TaskQueue *queue;
+	};
+
+	struct Task
+	{
+		std::function<void()> func;
+		Completion completion;
+		std::string error;
+	};
+
+	void workerLoop();
+
+	// Runs a task on the calling thread, if the worker couldn't be started.
+	void runTask(Task &task);
+
+	Worker *worker;
+
+	MutexRef mutex;
+	ConditionalRef taskAvailable;
+	ConditionalRef taskDone;
+
+	std::deque<Task> queued;
+	std::deque<Task> finished;
+
+	// Queued tasks which are currently running.
+	int running;
+
+	bool stopping;
+
+}; // TaskQueue
+
+} // thread
+} // love
+
+#endif // LOVE_THREAD_TASK_QUEUE_H
@@ -0,0 +1,173 @@
+/**
+ * Copyright (c) 2006-2016 LOVE Development Team
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ **/
+
+// LOVE
+#include "WorkerPool.h"
+#include "common/Exception.h"
+
+namespace love
+{
+namespace thread
+{
+
+WorkerPool::Worker::Worker(WorkerPool *pool, const std::string &name)
+	: pool(pool)
+{
+	threadName = name;
+}
+
+void WorkerPool::Worker::threadFunction()
+{
+	pool->workerLoop();
+}
+
+WorkerPool::WorkerPool(const std::string &name, int numthreads)
+	: task(nullptr)
+	, taskCount(0)
+	, nextTask(0)
+	, finishedTasks(0)
+	, batch(0)
+	, stopping(false)
+{
+	for (int i = 0; i < numthreads; i++)
+	{
+		Worker *worker = new Worker(this, name);
+
+		if (!worker->start())
+		{
+			worker->release();
+			break;
+		}
+
+		workers.push_back(worker);
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		Lock l(mutex);
+		stopping = true;
+		workAvailable->broadcast();
+	}
+
+	for (Worker *worker : workers)
+	{
+		worker->wait();
+		worker->release();
+	}
+}
+
+int WorkerPool::getThreadCount() const
+{
+	return (int) workers.size();
+}
+
+void WorkerPool::run(int count, const std::function<void(int)> &func)
+{
+	if (count <= 0)
+		return;
+
+	// Not worth waking anyone up for.
+	if (workers.empty() || count == 1)
+	{
+		for (int i = 0; i < count; i++)
+			func(i);
+		return;
+	}
+
+	std::string err;
+
+	{
+		Lock l(mutex);
+
+		task = &func;
+		taskCount = count;
+		nextTask = 0;
+		finishedTasks = 0;
+		error.clear();
+		batch++;
+
+		workAvailable->broadcast();
+
+		runTasks();
+
+		while (finishedTasks < taskCount)
+			workDone->wait(mutex);
+
+		task = nullptr;
+		err = error;
+	}
+
+	if (!err.empty())
+		throw love::Exception("%s", err.c_str());
+}
+
+void WorkerPool::runTasks()
+{
+	while (nextTask < taskCount)
+	{
+		int i = nextTask++;
+		const std::function<void(int)> &func = *task;
+
+		mutex->unlock();
+
+		std::string err;
+
+		try
+		{
+			func(i);
+		}
+		catch (std::exception &e)
+		{
+			err = e.what();
+		}
+
+		mutex->lock();
+
+		if (!err.empty() && error.empty())
+			error = err;
+
+		if (++finishedTasks == taskCount)
+			workDone->broadcast();
+	}
+}
+
+void WorkerPool::workerLoop()
+{
+	Lock l(mutex);
+
+	uint32 lastbatch = 0;
+
+	while (true)
+	{
+		while (!stopping && batch == lastbatch)
+			workAvailable->wait(mutex);
+
+		if (stopping)
+			return;
+
+		lastbatch = batch;
+		runTasks();
+	}
+}
+
+} // thread
+} // love
@@ -0,0 +1,99 @@
+/**
+ * Copyright (c) 2006-2016 LOVE Development Team
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ **/
+
+#ifndef LOVE_THREAD_WORKER_POOL_H
+#define LOVE_THREAD_WORKER_POOL_H
+
+// LOVE
+#include "common/config.h"
+#include "common/int.h"
+#include "threads.h"
+
+// C++
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace love
+{
+namespace thread
+{
+
+/**
+ * A fixed set of worker threads for running batches of independent tasks.
+ * The calling thread takes part in the work as well, so a pool created with
+ * zero threads simply runs every task serially.
+ **/
+class WorkerPool
+{
+public:
+
+	WorkerPool(const std::string &name, int numthreads);
+	~WorkerPool();
+
+	/**
+	 * Calls task(i) once for every i in [0, count) and returns when all calls
+	 * have finished. The order in which the calls run is unspecified, so the
+	 * tasks must not depend on each other. If any task throws, the first
+	 * error message is rethrown as a love::Exception once the batch is done.
+	 **/
+	void run(int count, const std::function<void(int)> &task);
+
+	int getThreadCount() const;
+
+private:
+
+	class Worker : public Threadable
+	{
+	public:
+		Worker(WorkerPool *pool, const std::string &name);
+		void threadFunction();
+	private:
+		WorkerPool *pool;
+	};
+
+	// Runs tasks from the current batch until none are left. The mutex must be
+	// held by the caller, and is released while each task runs.
+	void runTasks();
+
+	// Main loop of each worker thread.
+	void workerLoop();
+
+	std::vector<Worker *> workers;
+
+	MutexRef mutex;
+	ConditionalRef workAvailable;
+	ConditionalRef workDone;
+
+	const std::function<void(int)> *task;
+	int taskCount;
+	int nextTask;
+	int finishedTasks;
+	uint32 batch;
+	bool stopping;
+
+	std::string error;
+
+}; // WorkerPool
+
+} // thread
+} // love
+
+#endif // LOVE_THREAD_WORKER_POOL_H
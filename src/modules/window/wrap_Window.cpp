@@ -318,6 +318,9 @@ int w_getPosition(lua_State *L)
 int w_setIcon(lua_State *L)
 {
 	image::ImageData *i = luax_checktype<image::ImageData>(L, 1, IMAGE_IMAGE_DATA_ID);
+	if (i->getFormat() != image::ImageData::PIXELFORMAT_RGBA8)
+		return luaL_error(L, "Window icon ImageData must use the rgba8 pixel format.");
+
 	luax_pushboolean(L, instance()->setIcon(i));
 	return 1;
 }